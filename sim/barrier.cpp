@@ -0,0 +1,86 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "barrier.hpp"
+
+#include <thread>
+
+#ifdef __x86_64__
+#include <emmintrin.h>
+#endif  // __x86_64__
+
+namespace {
+void spin_pause(const uint32_t count) {
+  // Busy-wait for a short while, then give other host threads a chance to run (there may be more
+  // simulated cores than host CPUs).
+  if (count < 100u) {
+#ifdef __x86_64__
+    _mm_pause();
+#endif  // __x86_64__
+  } else {
+    std::this_thread::yield();
+  }
+}
+}  // namespace
+
+barrier_t::barrier_t(const uint32_t num_threads) : m_state(make_state(0u, num_threads, 0u)) {
+}
+
+void barrier_t::wait() {
+  auto state = m_state.load(std::memory_order_relaxed);
+  while (true) {
+    const auto new_arrived = arrived(state) + 1u;
+    if (new_arrived >= participants(state)) {
+      // We are the last thread to arrive: Release the waiting threads.
+      const auto new_state = make_state(0u, participants(state), generation(state) + 1u);
+      if (m_state.compare_exchange_weak(state, new_state, std::memory_order_acq_rel)) {
+        return;
+      }
+    } else {
+      const auto new_state = make_state(new_arrived, participants(state), generation(state));
+      if (m_state.compare_exchange_weak(state, new_state, std::memory_order_acq_rel)) {
+        break;
+      }
+    }
+  }
+
+  // Wait for the generation to change.
+  const auto my_generation = generation(state);
+  for (uint32_t count = 0u; generation(m_state.load(std::memory_order_acquire)) == my_generation;
+       ++count) {
+    spin_pause(count);
+  }
+}
+
+void barrier_t::leave() {
+  auto state = m_state.load(std::memory_order_relaxed);
+  while (true) {
+    const auto new_participants = participants(state) - 1u;
+    uint64_t new_state;
+    if (arrived(state) > 0u && arrived(state) >= new_participants) {
+      // All the remaining threads are waiting for us: Release them.
+      new_state = make_state(0u, new_participants, generation(state) + 1u);
+    } else {
+      new_state = make_state(arrived(state), new_participants, generation(state));
+    }
+    if (m_state.compare_exchange_weak(state, new_state, std::memory_order_acq_rel)) {
+      return;
+    }
+  }
+}
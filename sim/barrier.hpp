@@ -0,0 +1,64 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_BARRIER_HPP_
+#define SIM_BARRIER_HPP_
+
+#include <atomic>
+#include <cstdint>
+
+/// @brief A lock-free barrier for synchronizing a group of threads.
+///
+/// The barrier state (number of arrived threads, number of participating threads and the
+/// generation counter) is kept in a single atomic word, so that threads can leave the group at
+/// any time (e.g. when a simulated CPU core exits) without deadlocking the remaining threads.
+class barrier_t {
+public:
+  /// @brief Constructor.
+  /// @param num_threads The number of participating threads (at most 65535).
+  explicit barrier_t(const uint32_t num_threads);
+
+  /// @brief Wait until all participating threads have arrived at the barrier.
+  void wait();
+
+  /// @brief Leave the group of participating threads.
+  void leave();
+
+private:
+  // State word layout: arrived (bits 0-15), participants (bits 16-31), generation (bits 32-63).
+  static uint32_t arrived(const uint64_t state) {
+    return static_cast<uint32_t>(state & 0xffffu);
+  }
+  static uint32_t participants(const uint64_t state) {
+    return static_cast<uint32_t>((state >> 16) & 0xffffu);
+  }
+  static uint32_t generation(const uint64_t state) {
+    return static_cast<uint32_t>(state >> 32);
+  }
+  static uint64_t make_state(const uint32_t arrived,
+                             const uint32_t participants,
+                             const uint32_t generation) {
+    return static_cast<uint64_t>(arrived) | (static_cast<uint64_t>(participants) << 16) |
+           (static_cast<uint64_t>(generation) << 32);
+  }
+
+  std::atomic<uint64_t> m_state;
+};
+
+#endif  // SIM_BARRIER_HPP_
@@ -0,0 +1,274 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "branch_predictor.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+bool is_pow2(const uint32_t x) {
+  return x != 0u && (x & (x - 1u)) == 0u;
+}
+
+uint32_t parse_number(const std::string& key, const std::string& value) {
+  std::size_t pos = 0;
+  unsigned long result = 0u;
+  try {
+    result = std::stoul(value, &pos, 0);
+  } catch (...) {
+    pos = 0;
+  }
+  if (pos == 0 || pos != value.size() || result > 0x10000000u) {
+    throw std::runtime_error("Invalid branch predictor " + key + ": " + value);
+  }
+  return static_cast<uint32_t>(result);
+}
+
+const char* type_name(const branch_predictor_t::type_t type) {
+  switch (type) {
+    case branch_predictor_t::type_t::STATIC:
+      return "static";
+    case branch_predictor_t::type_t::BIMODAL:
+      return "bimodal";
+    case branch_predictor_t::type_t::GSHARE:
+      return "gshare";
+    case branch_predictor_t::type_t::BTB:
+      return "btb";
+  }
+  return "?";
+}
+
+double percent(const uint64_t part, const uint64_t total) {
+  return (total > 0u) ? (100.0 * static_cast<double>(part) / static_cast<double>(total)) : 0.0;
+}
+}  // namespace
+
+branch_predictor_t::params_t branch_predictor_t::parse_params(const std::string& spec) {
+  params_t params;
+  std::istringstream ss(spec);
+  std::string item;
+  bool first = true;
+  bool has_btb_entries = false;
+  while (std::getline(ss, item, ',')) {
+    if (first) {
+      first = false;
+      if (item == "static") {
+        params.type = type_t::STATIC;
+      } else if (item == "bimodal") {
+        params.type = type_t::BIMODAL;
+      } else if (item == "gshare") {
+        params.type = type_t::GSHARE;
+      } else if (item == "btb") {
+        params.type = type_t::BTB;
+      } else {
+        throw std::runtime_error("Invalid branch predictor type: " + item);
+      }
+      continue;
+    }
+    const auto eq_pos = item.find('=');
+    if (eq_pos == std::string::npos) {
+      throw std::runtime_error("Invalid branch predictor parameter (expected key=value): " + item);
+    }
+    const auto key = item.substr(0, eq_pos);
+    const auto value = item.substr(eq_pos + 1);
+    if (key == "entries") {
+      params.entries = parse_number(key, value);
+    } else if (key == "history") {
+      params.history_bits = parse_number(key, value);
+    } else if (key == "btb") {
+      params.btb_entries = parse_number(key, value);
+      has_btb_entries = true;
+    } else if (key == "top") {
+      params.top_n = parse_number(key, value);
+    } else {
+      throw std::runtime_error("Unknown branch predictor parameter: " + key);
+    }
+  }
+
+  // The BTB predictor needs a BTB.
+  if (params.type == type_t::BTB && !has_btb_entries) {
+    params.btb_entries = 64u;
+  }
+
+  if (!is_pow2(params.entries)) {
+    throw std::runtime_error("The number of branch predictor entries must be a power of 2");
+  }
+  if (params.btb_entries != 0u && !is_pow2(params.btb_entries)) {
+    throw std::runtime_error("The number of BTB entries must be a power of 2");
+  }
+  if (params.type == type_t::BTB && params.btb_entries == 0u) {
+    throw std::runtime_error("The btb branch predictor needs at least one BTB entry");
+  }
+  if (params.history_bits > 30u) {
+    throw std::runtime_error("Too many branch history bits (max 30)");
+  }
+  return params;
+}
+
+branch_predictor_t::branch_predictor_t(const params_t& params)
+    : m_params(params), m_counters(params.entries), m_btb(params.btb_entries) {
+  reset();
+}
+
+void branch_predictor_t::reset() {
+  // Counters start out as weakly not taken.
+  std::fill(m_counters.begin(), m_counters.end(), 1u);
+  std::fill(m_btb.begin(), m_btb.end(), btb_entry_t{0u, 0u, false});
+  m_history = 0u;
+
+  m_num_branches = 0u;
+  m_num_mispredicts = 0u;
+  m_branch_stats.clear();
+}
+
+bool branch_predictor_t::predict(const uint32_t pc,
+                                 const uint32_t target,
+                                 const bool taken,
+                                 const bool is_conditional,
+                                 const bool is_indirect) {
+  bool mispredicted = false;
+  if (is_conditional) {
+    mispredicted = (predict_direction(pc, target) != taken);
+    update_direction(pc, taken);
+  } else if (is_indirect) {
+    if (m_btb.empty()) {
+      mispredicted = true;
+    } else {
+      auto& entry = btb_entry(pc);
+      mispredicted = !(entry.valid && entry.pc == pc && entry.target == target);
+      entry = btb_entry_t{pc, target, true};
+    }
+  }
+
+  // Update the statistics.
+  ++m_num_branches;
+  auto& stats = m_branch_stats[pc];
+  ++stats.count;
+  if (taken) {
+    ++stats.taken;
+  }
+  if (mispredicted) {
+    ++m_num_mispredicts;
+    ++stats.mispredicted;
+  }
+
+  return mispredicted;
+}
+
+bool branch_predictor_t::predict_direction(const uint32_t pc, const uint32_t target) {
+  switch (m_params.type) {
+    case type_t::BIMODAL:
+    case type_t::GSHARE:
+      return m_counters[counter_index(pc)] >= 2u;
+    case type_t::BTB: {
+      const auto& entry = btb_entry(pc);
+      return entry.valid && entry.pc == pc;
+    }
+    case type_t::STATIC:
+      break;
+  }
+
+  // Backward taken, forward not taken.
+  return target <= pc;
+}
+
+void branch_predictor_t::update_direction(const uint32_t pc, const bool taken) {
+  if (m_params.type == type_t::BIMODAL || m_params.type == type_t::GSHARE) {
+    auto& counter = m_counters[counter_index(pc)];
+    if (taken && counter < 3u) {
+      ++counter;
+    } else if (!taken && counter > 0u) {
+      --counter;
+    }
+    m_history = (m_history << 1) | (taken ? 1u : 0u);
+  } else if (m_params.type == type_t::BTB) {
+    // Allocate BTB entries for taken branches, and drop entries for not taken branches.
+    auto& entry = btb_entry(pc);
+    if (taken) {
+      entry = btb_entry_t{pc, 0u, true};
+    } else if (entry.valid && entry.pc == pc) {
+      entry.valid = false;
+    }
+  }
+}
+
+uint32_t branch_predictor_t::counter_index(const uint32_t pc) const {
+  auto idx = pc >> 2;
+  if (m_params.type == type_t::GSHARE) {
+    idx ^= m_history & ((1u << m_params.history_bits) - 1u);
+  }
+  return idx & (m_params.entries - 1u);
+}
+
+branch_predictor_t::btb_entry_t& branch_predictor_t::btb_entry(const uint32_t pc) {
+  return m_btb[(pc >> 2) & (m_params.btb_entries - 1u)];
+}
+
+void branch_predictor_t::print_stats(perf_symbols_t& perf_symbols) const {
+  printf("Branch predictor (%s", type_name(m_params.type));
+  if (m_params.type == type_t::BIMODAL || m_params.type == type_t::GSHARE) {
+    printf(", %u entries", m_params.entries);
+  }
+  if (m_params.type == type_t::GSHARE) {
+    printf(", %u history bits", m_params.history_bits);
+  }
+  if (!m_btb.empty()) {
+    printf(", %u BTB entries", m_params.btb_entries);
+  }
+  printf("):\n");
+  printf(" Branches:             %lu\n", static_cast<unsigned long>(m_num_branches));
+  printf(" Mispredictions:       %lu (%g%%)\n",
+         static_cast<unsigned long>(m_num_mispredicts),
+         percent(m_num_mispredicts, m_num_branches));
+
+  // Sort the branches by decreasing number of mispredictions.
+  std::vector<std::pair<uint32_t, branch_stats_t>> branches;
+  for (const auto& item : m_branch_stats) {
+    if (item.second.mispredicted > 0u) {
+      branches.emplace_back(item);
+    }
+  }
+  std::sort(branches.begin(),
+            branches.end(),
+            [](const std::pair<uint32_t, branch_stats_t>& a,
+               const std::pair<uint32_t, branch_stats_t>& b) {
+              return (a.second.mispredicted > b.second.mispredicted) ||
+                     (a.second.mispredicted == b.second.mispredicted && a.first < b.first);
+            });
+  if (branches.size() > m_params.top_n) {
+    branches.resize(m_params.top_n);
+  }
+
+  if (!branches.empty()) {
+    printf(" Hardest to predict branches:\n");
+    printf("  Address (hex)\tCount\tTaken\tMispredicted\tFunction\n");
+    for (const auto& item : branches) {
+      const auto& stats = item.second;
+      printf("  0x%08x\t%lu\t%.1f%%\t%.1f%%\t%s\n",
+             item.first,
+             static_cast<unsigned long>(stats.count),
+             percent(stats.taken, stats.count),
+             percent(stats.mispredicted, stats.count),
+             perf_symbols.symbol_name(item.first).c_str());
+    }
+  }
+}
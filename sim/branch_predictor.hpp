@@ -0,0 +1,117 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_BRANCH_PREDICTOR_HPP_
+#define SIM_BRANCH_PREDICTOR_HPP_
+
+#include "perf_symbols.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// @brief A branch prediction model.
+///
+/// The following predictor types are supported:
+///
+///  - static: Conditional branches are predicted taken if they branch backwards.
+///  - bimodal: A table of two-bit saturating counters, indexed by the branch address.
+///  - gshare: A table of two-bit saturating counters, indexed by the branch address XOR:ed with the
+///    global branch history.
+///  - btb: Conditional branches are predicted taken if they hit in the branch target buffer.
+///
+/// PC-relative jumps are always predicted correctly. Register based jumps (e.g. function returns)
+/// are predicted using the branch target buffer (BTB), if there is one, and are otherwise always
+/// mispredicted.
+class branch_predictor_t {
+public:
+  enum class type_t { STATIC, BIMODAL, GSHARE, BTB };
+
+  /// @brief Branch predictor configuration.
+  struct params_t {
+    type_t type = type_t::STATIC;  ///< Predictor type.
+    uint32_t entries = 1024u;      ///< Number of counters (bimodal and gshare).
+    uint32_t history_bits = 10u;   ///< Number of global history bits (gshare).
+    uint32_t btb_entries = 0u;     ///< Number of BTB entries (0 = no BTB).
+    uint32_t top_n = 10u;          ///< Number of hard-to-predict branches to report.
+  };
+
+  /// @brief Parse a branch predictor specification string.
+  ///
+  /// The specification is the predictor type (static, bimodal, gshare or btb), optionally followed
+  /// by comma separated key=value pairs, where the keys are: entries, history, btb and top. For
+  /// example: "gshare,entries=4096,history=12,btb=64".
+  /// @throws std::runtime_error if the specification is invalid.
+  static params_t parse_params(const std::string& spec);
+
+  explicit branch_predictor_t(const params_t& params);
+
+  /// @brief Clear the predictor state and the statistics.
+  void reset();
+
+  /// @brief Predict a branch and update the predictor with the actual outcome.
+  /// @param pc The branch instruction address.
+  /// @param target The branch target address.
+  /// @param taken True if the branch was taken.
+  /// @param is_conditional True for conditional branches.
+  /// @param is_indirect True for register based jumps.
+  /// @returns true if the branch was mispredicted.
+  bool predict(const uint32_t pc,
+               const uint32_t target,
+               const bool taken,
+               const bool is_conditional,
+               const bool is_indirect);
+
+  /// @brief Print branch statistics, including the hardest to predict branches.
+  /// @param perf_symbols Symbols for showing function names.
+  void print_stats(perf_symbols_t& perf_symbols) const;
+
+private:
+  struct btb_entry_t {
+    uint32_t pc;
+    uint32_t target;
+    bool valid;
+  };
+
+  struct branch_stats_t {
+    uint64_t count;
+    uint64_t taken;
+    uint64_t mispredicted;
+  };
+
+  bool predict_direction(const uint32_t pc, const uint32_t target);
+  void update_direction(const uint32_t pc, const bool taken);
+  uint32_t counter_index(const uint32_t pc) const;
+  btb_entry_t& btb_entry(const uint32_t pc);
+
+  const params_t m_params;
+
+  // Predictor state.
+  std::vector<uint8_t> m_counters;
+  std::vector<btb_entry_t> m_btb;
+  uint32_t m_history = 0u;
+
+  // Statistics.
+  uint64_t m_num_branches = 0u;
+  uint64_t m_num_mispredicts = 0u;
+  std::unordered_map<uint32_t, branch_stats_t> m_branch_stats;
+};
+
+#endif  // SIM_BRANCH_PREDICTOR_HPP_
@@ -0,0 +1,259 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "cache.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+bool is_pow2(const uint32_t x) {
+  return x != 0u && (x & (x - 1u)) == 0u;
+}
+
+uint32_t log2_u32(uint32_t x) {
+  uint32_t result = 0u;
+  while (x > 1u) {
+    x >>= 1;
+    ++result;
+  }
+  return result;
+}
+
+uint32_t parse_number(const std::string& key, const std::string& value) {
+  std::size_t pos = 0;
+  uint64_t result = 0u;
+  try {
+    result = std::stoul(value, &pos, 0);
+  } catch (...) {
+    pos = 0;
+  }
+  if (pos == 0) {
+    throw std::runtime_error("Invalid cache " + key + ": " + value);
+  }
+
+  // Optional size suffix.
+  const auto suffix = value.substr(pos);
+  if (suffix == "k" || suffix == "K") {
+    result <<= 10;
+  } else if (suffix == "M") {
+    result <<= 20;
+  } else if (!suffix.empty()) {
+    throw std::runtime_error("Invalid cache " + key + ": " + value);
+  }
+  if (result > 0x80000000u) {
+    throw std::runtime_error("Invalid cache " + key + ": " + value);
+  }
+  return static_cast<uint32_t>(result);
+}
+
+double percent(const uint64_t part, const uint64_t total) {
+  return (total > 0u) ? (100.0 * static_cast<double>(part) / static_cast<double>(total)) : 0.0;
+}
+}  // namespace
+
+cache_t::params_t cache_t::parse_params(const std::string& spec) {
+  params_t params;
+  std::istringstream ss(spec);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.empty()) {
+      continue;
+    }
+    const auto eq_pos = item.find('=');
+    if (eq_pos == std::string::npos) {
+      throw std::runtime_error("Invalid cache parameter (expected key=value): " + item);
+    }
+    const auto key = item.substr(0, eq_pos);
+    const auto value = item.substr(eq_pos + 1);
+    if (key == "size") {
+      params.size = parse_number(key, value);
+    } else if (key == "ways") {
+      params.ways = parse_number(key, value);
+    } else if (key == "line") {
+      params.line_size = parse_number(key, value);
+    } else if (key == "penalty") {
+      params.miss_penalty = parse_number(key, value);
+    } else if (key == "policy") {
+      if (value == "lru") {
+        params.policy = policy_t::LRU;
+      } else if (value == "fifo") {
+        params.policy = policy_t::FIFO;
+      } else if (value == "random") {
+        params.policy = policy_t::RANDOM;
+      } else {
+        throw std::runtime_error("Invalid cache policy: " + value);
+      }
+    } else if (key == "write") {
+      if (value == "back") {
+        params.write_back = true;
+      } else if (value == "through") {
+        params.write_back = false;
+      } else {
+        throw std::runtime_error("Invalid cache write policy: " + value);
+      }
+    } else {
+      throw std::runtime_error("Unknown cache parameter: " + key);
+    }
+  }
+
+  // Validate the cache geometry.
+  if (!is_pow2(params.line_size) || params.line_size < 4u) {
+    throw std::runtime_error("The cache line size must be a power of 2 (at least 4 bytes)");
+  }
+  if (params.ways == 0u || params.size % (params.ways * params.line_size) != 0u ||
+      !is_pow2(params.size / (params.ways * params.line_size))) {
+    throw std::runtime_error("The cache size / (ways * line) must be a power of 2");
+  }
+  return params;
+}
+
+cache_t::cache_t(const std::string& name, const params_t& params)
+    : m_name(name),
+      m_params(params),
+      m_num_sets(params.size / (params.ways * params.line_size)),
+      m_line_shift(log2_u32(params.line_size)),
+      m_set_shift(log2_u32(m_num_sets)),
+      m_lines(params.size / params.line_size) {
+  reset();
+}
+
+void cache_t::reset() {
+  std::fill(m_lines.begin(), m_lines.end(), line_t{0u, false, false, 0u});
+  m_time = 0u;
+  m_random_state = 1u;
+
+  m_reads = 0u;
+  m_writes = 0u;
+  m_read_misses = 0u;
+  m_write_misses = 0u;
+  m_line_fills = 0u;
+  m_write_backs = 0u;
+  m_memory_writes = 0u;
+}
+
+cache_t::result_t cache_t::access(const uint32_t addr, const bool is_write) {
+  ++m_time;
+  if (is_write) {
+    ++m_writes;
+  } else {
+    ++m_reads;
+  }
+
+  const auto line_addr = addr >> m_line_shift;
+  const auto set_idx = line_addr & (m_num_sets - 1u);
+  const auto tag = line_addr >> m_set_shift;
+  line_t* set = &m_lines[set_idx * m_params.ways];
+
+  // Look for the line in the set.
+  for (uint32_t way = 0u; way < m_params.ways; ++way) {
+    auto& line = set[way];
+    if (line.valid && line.tag == tag) {
+      if (m_params.policy == policy_t::LRU) {
+        line.stamp = m_time;
+      }
+      if (is_write) {
+        if (m_params.write_back) {
+          line.dirty = true;
+        } else {
+          ++m_memory_writes;
+        }
+      }
+      return result_t{false, 0u, is_write && !m_params.write_back};
+    }
+  }
+
+  // Cache miss.
+  if (is_write) {
+    ++m_write_misses;
+    if (!m_params.write_back) {
+      // Write-through caches do not allocate lines on write misses, and the write is assumed to be
+      // absorbed by a write buffer.
+      ++m_memory_writes;
+      return result_t{true, 0u, true};
+    }
+  } else {
+    ++m_read_misses;
+  }
+
+  // Replace a line.
+  auto& line = set[select_victim(set)];
+  uint32_t cycles = m_params.miss_penalty;
+  if (line.valid && line.dirty) {
+    ++m_write_backs;
+    ++m_memory_writes;
+    cycles += m_params.miss_penalty;
+  }
+  line.tag = tag;
+  line.valid = true;
+  line.dirty = is_write;
+  line.stamp = m_time;
+  ++m_line_fills;
+
+  return result_t{true, cycles, true};
+}
+
+uint32_t cache_t::select_victim(line_t* set) {
+  // Prefer invalid lines.
+  for (uint32_t way = 0u; way < m_params.ways; ++way) {
+    if (!set[way].valid) {
+      return way;
+    }
+  }
+
+  if (m_params.policy == policy_t::RANDOM) {
+    // xorshift32.
+    m_random_state ^= m_random_state << 13;
+    m_random_state ^= m_random_state >> 17;
+    m_random_state ^= m_random_state << 5;
+    return m_random_state % m_params.ways;
+  }
+
+  // LRU and FIFO: Replace the line with the oldest time stamp.
+  uint32_t victim = 0u;
+  for (uint32_t way = 1u; way < m_params.ways; ++way) {
+    if (set[way].stamp < set[victim].stamp) {
+      victim = way;
+    }
+  }
+  return victim;
+}
+
+void cache_t::print_stats() const {
+  const auto accesses = m_reads + m_writes;
+  const auto misses = m_read_misses + m_write_misses;
+  std::cout << m_name << " (" << m_params.size << " bytes, " << m_params.ways << "-way, "
+            << m_params.line_size << " byte lines):\n";
+  std::cout << " Reads:                " << m_reads << "\n";
+  std::cout << " Read misses:          " << m_read_misses << " ("
+            << percent(m_read_misses, m_reads) << "%)\n";
+  if (m_writes > 0u) {
+    std::cout << " Writes:               " << m_writes << "\n";
+    std::cout << " Write misses:         " << m_write_misses << " ("
+              << percent(m_write_misses, m_writes) << "%)\n";
+  }
+  std::cout << " Miss rate:            " << percent(misses, accesses) << "%\n";
+  std::cout << " Line fills:           " << m_line_fills << "\n";
+  if (m_writes > 0u) {
+    std::cout << " Write-backs:          " << m_write_backs << "\n";
+    std::cout << " Memory writes:        " << m_memory_writes << "\n";
+  }
+}
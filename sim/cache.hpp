@@ -0,0 +1,113 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_CACHE_HPP_
+#define SIM_CACHE_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// @brief A set associative cache model.
+///
+/// The cache model only keeps track of which memory lines are present in the cache (the data is
+/// always read from and written to the RAM), and is used for gathering cache statistics and for
+/// estimating the cost of cache misses.
+class cache_t {
+public:
+  enum class policy_t { LRU, FIFO, RANDOM };
+
+  /// @brief Cache configuration.
+  struct params_t {
+    uint32_t size = 4096u;            ///< Total cache size (bytes).
+    uint32_t ways = 1u;               ///< Associativity (1 = direct mapped).
+    uint32_t line_size = 32u;         ///< Cache line size (bytes).
+    policy_t policy = policy_t::LRU;  ///< Replacement policy.
+    bool write_back = true;           ///< Write-back (true) or write-through (false).
+    uint32_t miss_penalty = 0u;       ///< Number of cycles for each line transfer to/from memory.
+  };
+
+  /// @brief The result of a cache access.
+  struct result_t {
+    bool miss;            ///< True if the access was a cache miss.
+    uint32_t cycles;      ///< Number of stall cycles caused by the access.
+    bool reaches_memory;  ///< True if the access goes to memory (a miss or a write-through store).
+  };
+
+  /// @brief Parse a cache specification string.
+  ///
+  /// The specification is a comma separated list of key=value pairs, where the keys are: size
+  /// (bytes, optionally with a k or M suffix), ways, line (bytes), policy (lru, fifo or random),
+  /// write (back or through) and penalty (cycles). Keys that are not given get default values.
+  /// For example: "size=16k,ways=2,line=32,policy=lru,write=back,penalty=10".
+  /// @throws std::runtime_error if the specification is invalid.
+  static params_t parse_params(const std::string& spec);
+
+  /// @brief Constructor.
+  /// @param name The name of the cache (used when printing statistics).
+  /// @param params The cache configuration.
+  cache_t(const std::string& name, const params_t& params);
+
+  /// @brief Clear the cache contents and the statistics.
+  void reset();
+
+  /// @brief Simulate a read access.
+  result_t read(const uint32_t addr) {
+    return access(addr, false);
+  }
+
+  /// @brief Simulate a write access.
+  result_t write(const uint32_t addr) {
+    return access(addr, true);
+  }
+
+  /// @brief Print cache statistics.
+  void print_stats() const;
+
+private:
+  struct line_t {
+    uint32_t tag;
+    bool valid;
+    bool dirty;
+    uint64_t stamp;  // Time of last use (LRU) or time of fill (FIFO).
+  };
+
+  result_t access(const uint32_t addr, const bool is_write);
+  uint32_t select_victim(line_t* set);
+
+  const std::string m_name;
+  const params_t m_params;
+  uint32_t m_num_sets;
+  uint32_t m_line_shift;
+  uint32_t m_set_shift;
+  std::vector<line_t> m_lines;
+  uint64_t m_time = 0u;
+  uint32_t m_random_state = 1u;
+
+  // Statistics.
+  uint64_t m_reads = 0u;
+  uint64_t m_writes = 0u;
+  uint64_t m_read_misses = 0u;
+  uint64_t m_write_misses = 0u;
+  uint64_t m_line_fills = 0u;
+  uint64_t m_write_backs = 0u;
+  uint64_t m_memory_writes = 0u;
+};
+
+#endif  // SIM_CACHE_HPP_
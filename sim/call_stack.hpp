@@ -0,0 +1,91 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_CALL_STACK_HPP_
+#define SIM_CALL_STACK_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief A shadow call stack, driven by the guest j/jl instructions.
+///
+/// A jl instruction pushes a frame with its return address (and some data of type T), and a jump
+/// to the return address of the innermost frame pops it. Other jumps (e.g. tail calls) do not
+/// change the stack. The depth is limited (e.g. for programs that never return from functions),
+/// and calls beyond the limit are ignored.
+template <typename T>
+class call_stack_t {
+public:
+  struct frame_t {
+    uint32_t return_addr;
+    T data;
+  };
+
+  /// @brief Remove all the frames.
+  void clear() {
+    m_frames.clear();
+  }
+
+  /// @brief Record a j/jl instruction.
+  /// @param target The branch target address.
+  /// @param return_addr The return address (for jl).
+  /// @param is_call True for jl (subroutine call).
+  /// @param data The data for the new frame (for jl).
+  /// @returns true if the jump returned from the innermost frame (which the caller must pop).
+  bool jump(const uint32_t target, const uint32_t return_addr, const bool is_call, const T& data) {
+    if (is_call) {
+      if (m_frames.size() < MAX_DEPTH) {
+        m_frames.push_back(frame_t{return_addr, data});
+      }
+      return false;
+    }
+    return !m_frames.empty() && target == m_frames.back().return_addr;
+  }
+
+  /// @brief Remove the innermost frame.
+  void pop() {
+    m_frames.pop_back();
+  }
+
+  bool empty() const {
+    return m_frames.empty();
+  }
+
+  std::size_t depth() const {
+    return m_frames.size();
+  }
+
+  /// @brief Get the innermost frame.
+  frame_t& back() {
+    return m_frames.back();
+  }
+
+  /// @brief Get all the frames (outermost first).
+  const std::vector<frame_t>& frames() const {
+    return m_frames;
+  }
+
+private:
+  static const std::size_t MAX_DEPTH = 100000u;
+
+  std::vector<frame_t> m_frames;
+};
+
+#endif  // SIM_CALL_STACK_HPP_
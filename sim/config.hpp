@@ -20,8 +20,10 @@
 #ifndef SIM_CONFIG_HPP_
 #define SIM_CONFIG_HPP_
 
+#include <algorithm>
 #include <cstdint>
 #include <string>
+#include <vector>
 
 class config_t {
 public:
@@ -114,6 +116,182 @@ public:
     m_auto_close = x;
   }
 
+  uint32_t present_rate() const {
+    return m_present_rate;
+  }
+
+  void set_present_rate(const uint32_t x) {
+    m_present_rate = x;
+  }
+
+  bool headless_enabled() const {
+    return m_headless_enabled;
+  }
+
+  void set_headless_enabled(const bool x) {
+    m_headless_enabled = x;
+  }
+
+  const std::vector<uint32_t>& snapshot_frames() const {
+    return m_snapshot_frames;
+  }
+
+  void set_snapshot_frames(const std::vector<uint32_t>& x) {
+    m_snapshot_frames = x;
+  }
+
+  const std::string& snapshot_prefix() const {
+    return m_snapshot_prefix;
+  }
+
+  void set_snapshot_prefix(const std::string& x) {
+    m_snapshot_prefix = x;
+  }
+
+  const std::string& video_file_name() const {
+    return m_video_file_name;
+  }
+
+  void set_video_file_name(const std::string& x) {
+    m_video_file_name = x;
+  }
+
+  const std::string& frame_hashes_file_name() const {
+    return m_frame_hashes_file_name;
+  }
+
+  void set_frame_hashes_file_name(const std::string& x) {
+    m_frame_hashes_file_name = x;
+  }
+
+  uint32_t frame_hash_interval() const {
+    return m_frame_hash_interval;
+  }
+
+  void set_frame_hash_interval(const uint32_t x) {
+    m_frame_hash_interval = std::max(x, 1u);
+  }
+
+  bool timing_enabled() const {
+    return m_timing_enabled;
+  }
+
+  void set_timing_enabled(const bool x) {
+    m_timing_enabled = x;
+  }
+
+  const std::string& latency_file_name() const {
+    return m_latency_file_name;
+  }
+
+  void set_latency_file_name(const std::string& x) {
+    m_latency_file_name = x;
+  }
+
+  bool pipeline_enabled() const {
+    return m_pipeline_enabled;
+  }
+
+  void set_pipeline_enabled(const bool x) {
+    m_pipeline_enabled = x;
+  }
+
+  uint32_t num_cores() const {
+    return m_num_cores;
+  }
+
+  void set_num_cores(const uint32_t x) {
+    m_num_cores = x;
+  }
+
+  uint64_t quantum() const {
+    return m_quantum;
+  }
+
+  void set_quantum(const uint64_t x) {
+    m_quantum = x;
+  }
+
+  bool deterministic() const {
+    return m_deterministic;
+  }
+
+  void set_deterministic(const bool x) {
+    m_deterministic = x;
+  }
+
+  bool stack_profile_enabled() const {
+    return m_stack_profile_enabled;
+  }
+
+  void set_stack_profile_enabled(const bool x) {
+    m_stack_profile_enabled = x;
+  }
+
+  bool loop_profile_enabled() const {
+    return m_loop_profile_enabled;
+  }
+
+  void set_loop_profile_enabled(const bool x) {
+    m_loop_profile_enabled = x;
+  }
+
+  const std::string& icache_spec() const {
+    return m_icache_spec;
+  }
+
+  void set_icache_spec(const std::string& x) {
+    m_icache_spec = x;
+  }
+
+  const std::string& dcache_spec() const {
+    return m_dcache_spec;
+  }
+
+  void set_dcache_spec(const std::string& x) {
+    m_dcache_spec = x;
+  }
+
+  const std::string& branch_predictor_spec() const {
+    return m_branch_predictor_spec;
+  }
+
+  void set_branch_predictor_spec(const std::string& x) {
+    m_branch_predictor_spec = x;
+  }
+
+  const std::string& memory_regions_spec() const {
+    return m_memory_regions_spec;
+  }
+
+  void set_memory_regions_spec(const std::string& x) {
+    m_memory_regions_spec = x;
+  }
+
+  const std::string& mem_profile_spec() const {
+    return m_mem_profile_spec;
+  }
+
+  void set_mem_profile_spec(const std::string& x) {
+    m_mem_profile_spec = x;
+  }
+
+  const std::vector<std::string>& watch_specs() const {
+    return m_watch_specs;
+  }
+
+  void add_watch_spec(const std::string& x) {
+    m_watch_specs.push_back(x);
+  }
+
+  const std::string& history_spec() const {
+    return m_history_spec;
+  }
+
+  void set_history_spec(const std::string& x) {
+    m_history_spec = x;
+  }
+
 private:
   config_t() {
   }
@@ -129,6 +307,16 @@ private:
   static const uint32_t DEFAULT_GFX_HEIGHT = 180u;
   static const uint32_t DEFAULT_GFX_DEPTH = 1u;
   static const bool DEFAULT_AUTO_CLOSE = true;
+  static const uint32_t DEFAULT_PRESENT_RATE = 0u;  // 0 = vsync
+  static const bool DEFAULT_HEADLESS_ENABLED = false;
+  static const uint32_t DEFAULT_FRAME_HASH_INTERVAL = 1u;
+  static const bool DEFAULT_TIMING_ENABLED = false;
+  static const bool DEFAULT_PIPELINE_ENABLED = false;
+  static const uint32_t DEFAULT_NUM_CORES = 1u;
+  static const uint64_t DEFAULT_QUANTUM = 0u;  // 0 = free running
+  static const bool DEFAULT_DETERMINISTIC = false;
+  static const bool DEFAULT_STACK_PROFILE_ENABLED = false;
+  static const bool DEFAULT_LOOP_PROFILE_ENABLED = false;
 
   uint64_t m_ram_size = DEFAULT_RAM_SIZE;
   bool m_trace_enabled = DEFAULT_TRACE_ENABLED;
@@ -141,6 +329,28 @@ private:
   uint32_t m_gfx_height = DEFAULT_GFX_HEIGHT;
   uint32_t m_gfx_depth = DEFAULT_GFX_DEPTH;
   bool m_auto_close = DEFAULT_AUTO_CLOSE;
+  uint32_t m_present_rate = DEFAULT_PRESENT_RATE;
+  bool m_headless_enabled = DEFAULT_HEADLESS_ENABLED;
+  std::vector<uint32_t> m_snapshot_frames;
+  std::string m_snapshot_prefix = "frame_";
+  std::string m_video_file_name;
+  std::string m_frame_hashes_file_name;
+  uint32_t m_frame_hash_interval = DEFAULT_FRAME_HASH_INTERVAL;
+  bool m_timing_enabled = DEFAULT_TIMING_ENABLED;
+  std::string m_latency_file_name;
+  bool m_pipeline_enabled = DEFAULT_PIPELINE_ENABLED;
+  uint32_t m_num_cores = DEFAULT_NUM_CORES;
+  uint64_t m_quantum = DEFAULT_QUANTUM;
+  bool m_deterministic = DEFAULT_DETERMINISTIC;
+  bool m_stack_profile_enabled = DEFAULT_STACK_PROFILE_ENABLED;
+  bool m_loop_profile_enabled = DEFAULT_LOOP_PROFILE_ENABLED;
+  std::string m_icache_spec;
+  std::string m_dcache_spec;
+  std::string m_branch_predictor_spec;
+  std::string m_memory_regions_spec;
+  std::string m_mem_profile_spec;
+  std::vector<std::string> m_watch_specs;
+  std::string m_history_spec;
 };
 
 #endif  // SIM_CONFIG_HPP_
@@ -20,11 +20,15 @@
 #include "cpu.hpp"
 
 #include "config.hpp"
+#include "exec_history.hpp"
+#include "gdb_stub.hpp"
+#include "mmio.hpp"
 
 #include <algorithm>
 #include <cstdio>
 #include <iomanip>
 #include <iostream>
+#include <string>
 
 #ifdef __x86_64__
 #include <pmmintrin.h>
@@ -33,6 +37,11 @@
 
 namespace {
 
+// Secondary cores write to separate files (e.g. "trace.bin.1" for core 1).
+std::string core_file_name(const std::string& file_name, const uint32_t core_id) {
+  return (core_id == 0u) ? file_name : (file_name + "." + std::to_string(core_id));
+}
+
 void configure_fpu() {
 #ifdef __x86_64__
   _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
@@ -42,12 +51,67 @@ void configure_fpu() {
 
 }  // namespace
 
-cpu_t::cpu_t(ram_t& ram, perf_symbols_t& perf_symbols)
-    : m_ram(ram), m_perf_symbols(perf_symbols), m_syscalls(ram) {
+cpu_t::cpu_t(ram_t& ram,
+             perf_symbols_t& perf_symbols,
+             const uint32_t core_id,
+             const bool configure)
+    : m_core_id(core_id), m_ram(ram), m_perf_symbols(perf_symbols), m_syscalls(ram) {
+  if (!configure) {
+    reset();
+    return;
+  }
   if (config_t::instance().trace_enabled()) {
-    m_trace_file.open(config_t::instance().trace_file_name(), std::ios::out | std::ios::binary);
+    const auto file_name = core_file_name(config_t::instance().trace_file_name(), core_id);
+    m_trace_file.open(file_name, std::ios::out | std::ios::binary);
     m_enable_tracing = true;
   }
+  if (config_t::instance().timing_enabled()) {
+    if (!config_t::instance().latency_file_name().empty()) {
+      m_latency_model.load(config_t::instance().latency_file_name());
+    }
+    m_timing_enabled = true;
+  }
+  if (!config_t::instance().icache_spec().empty()) {
+    const auto params = cache_t::parse_params(config_t::instance().icache_spec());
+    m_icache.reset(new cache_t("Instruction cache", params));
+  }
+  if (!config_t::instance().dcache_spec().empty()) {
+    const auto params = cache_t::parse_params(config_t::instance().dcache_spec());
+    m_dcache.reset(new cache_t("Data cache", params));
+  }
+  if (!config_t::instance().branch_predictor_spec().empty()) {
+    const auto& spec = config_t::instance().branch_predictor_spec();
+    const auto params = branch_predictor_t::parse_params(spec);
+    m_branch_predictor.reset(new branch_predictor_t(params));
+  }
+  if (!config_t::instance().memory_regions_spec().empty()) {
+    const auto params = memory_regions_t::parse_params(config_t::instance().memory_regions_spec());
+    m_memory_regions.reset(new memory_regions_t(params));
+  }
+  if (!config_t::instance().mem_profile_spec().empty()) {
+    auto params = mem_profiler_t::parse_params(config_t::instance().mem_profile_spec());
+    if (!params.file_name.empty()) {
+      params.file_name = core_file_name(params.file_name, core_id);
+    }
+    m_mem_profiler.reset(new mem_profiler_t(params));
+  }
+  if (config_t::instance().stack_profile_enabled()) {
+    m_stack_profiler.reset(new stack_profiler_t());
+  }
+  if (config_t::instance().loop_profile_enabled()) {
+    m_loop_profiler.reset(new loop_profiler_t());
+  }
+  if (!config_t::instance().watch_specs().empty()) {
+    std::vector<watchpoints_t::watchpoint_t> watchpoints;
+    for (const auto& spec : config_t::instance().watch_specs()) {
+      watchpoints.push_back(watchpoints_t::parse_spec(spec));
+    }
+    m_watchpoints.reset(new watchpoints_t(watchpoints, m_ram, m_perf_symbols));
+  }
+  if (!config_t::instance().history_spec().empty()) {
+    const auto params = exec_history_t::parse_params(config_t::instance().history_spec());
+    m_history.reset(new exec_history_t(params, m_ram));
+  }
   reset();
 }
 
@@ -77,6 +141,24 @@ void cpu_t::terminate() {
   m_terminate_requested = true;
 }
 
+void cpu_t::enable_vblank(const vblank_callback_t& callback) {
+  m_vblank_enabled = true;
+  m_vblank_callback = callback;
+}
+
+void cpu_t::enable_quantum(const uint64_t quantum, const quantum_callback_t& callback) {
+  m_quantum = quantum;
+  m_quantum_callback = callback;
+}
+
+void cpu_t::enable_core_start(const core_start_callback_t& callback) {
+  m_core_start_callback = callback;
+}
+
+void cpu_t::enable_heap_profiler(const heap_profiler_t::functions_t& functions) {
+  m_heap_profiler.reset(new heap_profiler_t(functions));
+}
+
 void cpu_t::dump_stats() {
   const auto dt_us =
       std::chrono::duration_cast<std::chrono::microseconds>(m_stop_time - m_start_time).count();
@@ -86,8 +168,36 @@ void cpu_t::dump_stats() {
   std::cout << "CPU instructions:\n";
   std::cout << " Fetched instructions: " << m_fetched_instr_count << "\n";
   std::cout << " Vector loops:         " << m_vector_loop_count << "\n";
-  std::cout << " Total CPU cycles:     " << m_total_cycle_count << "\n";
+  std::cout << " Total CPU cycles:     " << m_total_cycle_count
+            << (m_timing_enabled ? " (modeled)" : "") << "\n";
   std::cout << " Mcycles/s:            " << mops << "\n";
+  if (m_icache) {
+    m_icache->print_stats();
+  }
+  if (m_dcache) {
+    m_dcache->print_stats();
+  }
+  if (m_branch_predictor) {
+    m_branch_predictor->print_stats(m_perf_symbols);
+  }
+  if (m_memory_regions) {
+    m_memory_regions->print_stats();
+  }
+  if (m_mem_profiler) {
+    m_mem_profiler->print_stats(m_perf_symbols);
+  }
+  if (m_stack_profiler) {
+    m_stack_profiler->print_stats(m_perf_symbols);
+  }
+  if (m_loop_profiler) {
+    m_loop_profiler->print_stats(m_perf_symbols);
+  }
+  if (m_watchpoints) {
+    m_watchpoints->print_stats();
+  }
+  if (m_history) {
+    m_history->print_stats();
+  }
 }
 
 void cpu_t::dump_ram(const uint32_t begin, const uint32_t end, const std::string& file_name) {
@@ -142,6 +252,15 @@ void cpu_t::append_debug_trace_impl(const debug_trace_t& trace) {
   }
 }
 
+void cpu_t::append_debug_trace_bubbles_impl(const uint32_t pc, const uint32_t count) {
+  // Bubbles are written as invalid ("defunct") records, just like the RTL does.
+  debug_trace_t bubble = debug_trace_t();
+  bubble.pc = pc;
+  for (uint32_t i = 0u; i < count; ++i) {
+    append_debug_trace_impl(bubble);
+  }
+}
+
 void cpu_t::flush_debug_trace_buffer() {
   if (m_debug_trace_file_buf_entries > 0) {
     const auto num_bytes = m_debug_trace_file_buf_entries * TRACE_ENTRY_SIZE;
@@ -151,10 +270,126 @@ void cpu_t::flush_debug_trace_buffer() {
   }
 }
 
-void cpu_t::begin_simulation() {
+bool cpu_t::instrumentation_enabled() const {
+  // The GDB stub does not need the instrumented run loop while continuing without any breakpoints
+  // or watchpoints.
+  const bool gdb_hooks = (m_gdb_stub != nullptr) && !m_gdb_stub->fast_continue();
+  return m_icache || m_dcache || m_branch_predictor || m_memory_regions || m_mem_profiler ||
+         m_heap_profiler || m_stack_profiler || m_loop_profiler || m_verifier || m_watchpoints ||
+         gdb_hooks || m_history;
+}
+
+bool cpu_t::handle_cycle_events() {
+  if (m_total_cycle_count >= m_max_cycle_count) {
+    return false;
+  }
+  if (m_total_cycle_count >= m_next_vblank_cycle) {
+    vblank();
+  }
+  if (m_total_cycle_count >= m_next_quantum_cycle) {
+    m_quantum_callback();
+    m_next_quantum_cycle += m_quantum;
+  }
+  if (m_total_cycle_count >= m_next_gdb_poll_cycle) {
+    m_gdb_stub->poll(*this);
+    m_next_gdb_poll_cycle = m_total_cycle_count + gdb_stub_t::POLL_INTERVAL;
+  }
+  m_next_event_cycle = std::min(std::min(m_max_cycle_count, m_next_vblank_cycle),
+                                std::min(m_next_quantum_cycle, m_next_gdb_poll_cycle));
+  return true;
+}
+
+void cpu_t::vblank() {
+  if (m_vblank_callback) {
+    m_vblank_callback(m_frame_no, m_total_cycle_count);
+  }
+
+  // Advance the MC1 video frame counter.
+  ++m_frame_no;
+  if (m_ram.valid_range(MMIO_VIDFRAMENO, 4u)) {
+    m_ram.store32(MMIO_VIDFRAMENO, m_frame_no);
+  }
+  m_next_vblank_cycle = vblank_cycle(m_frame_no + 1u);
+}
+
+uint64_t cpu_t::vblank_cycle(const uint32_t frame_no) const {
+  // Calculate the exact cycle from the frame number, to avoid accumulating rounding errors.
+  const auto n = static_cast<uint64_t>(frame_no);
+  const auto q = m_vblank_period_num / m_vblank_period_den;
+  const auto r = m_vblank_period_num % m_vblank_period_den;
+  return n * q + (n * r) / m_vblank_period_den;
+}
+
+void cpu_t::begin_simulation(const int64_t max_cycles) {
   m_start_time = std::chrono::high_resolution_clock::now();
+
+  // Start with cold caches.
+  if (m_icache) {
+    m_icache->reset();
+  }
+  if (m_dcache) {
+    m_dcache->reset();
+  }
+  if (m_branch_predictor) {
+    m_branch_predictor->reset();
+  }
+  if (m_memory_regions) {
+    m_memory_regions->configure(m_ram);
+  }
+  if (m_mem_profiler) {
+    m_mem_profiler->reset();
+  }
+  if (m_heap_profiler) {
+    m_heap_profiler->reset();
+  }
+  if (m_stack_profiler) {
+    m_stack_profiler->reset();
+  }
+  if (m_loop_profiler) {
+    m_loop_profiler->reset();
+  }
+  if (m_watchpoints) {
+    m_watchpoints->reset();
+  }
+  if (m_history) {
+    m_history->reset();
+  }
+  m_store_log_hash = 0u;
+  m_store_log_size = 0u;
+
+  // Set up the cycle limit.
+  m_max_cycle_count = (max_cycles >= 0) ? static_cast<uint64_t>(max_cycles) : ~uint64_t(0);
+
+  // Set up the simulated vertical blanking interval.
+  m_frame_no = 0u;
+  m_next_vblank_cycle = ~uint64_t(0);
+  if (m_vblank_enabled) {
+    uint32_t cpu_clk = 0u;
+    uint32_t vid_fps = 0u;
+    if (m_ram.valid_range(MMIO_START, 64u)) {
+      cpu_clk = m_ram.load32(MMIO_CPUCLK);
+      vid_fps = m_ram.load32(MMIO_VIDFPS);
+      m_ram.store32(MMIO_VIDFRAMENO, m_frame_no);
+    }
+    cpu_clk = (cpu_clk != 0u) ? cpu_clk : DEFAULT_CPUCLK;
+    vid_fps = (vid_fps != 0u) ? vid_fps : DEFAULT_VIDFPS;
+    m_vblank_period_num = static_cast<uint64_t>(cpu_clk) << 16;
+    m_vblank_period_den = static_cast<uint64_t>(vid_fps);
+    m_next_vblank_cycle = vblank_cycle(1u);
+  }
+
+  // Set up quantum based scheduling.
+  m_next_quantum_cycle = (m_quantum > 0u) ? m_quantum : ~uint64_t(0);
+
+  // Poll the GDB connection for interrupt requests.
+  m_next_gdb_poll_cycle = (m_gdb_stub != nullptr) ? gdb_stub_t::POLL_INTERVAL : ~uint64_t(0);
+  m_next_event_cycle = std::min(std::min(m_max_cycle_count, m_next_vblank_cycle),
+                                std::min(m_next_quantum_cycle, m_next_gdb_poll_cycle));
 }
 
 void cpu_t::end_simulation() {
   m_stop_time = std::chrono::high_resolution_clock::now();
+  if (m_mem_profiler) {
+    m_mem_profiler->finish();
+  }
 }
@@ -20,15 +20,31 @@
 #ifndef SIM_CPU_HPP_
 #define SIM_CPU_HPP_
 
+#include "branch_predictor.hpp"
+#include "cache.hpp"
+#include "hash.hpp"
+#include "heap_profiler.hpp"
+#include "latency_model.hpp"
+#include "loop_profiler.hpp"
+#include "mem_profiler.hpp"
+#include "memory_regions.hpp"
 #include "perf_symbols.hpp"
 #include "ram.hpp"
+#include "stack_profiler.hpp"
 #include "syscalls.hpp"
+#include "watchpoints.hpp"
 
 #include <array>
 #include <atomic>
 #include <chrono>
 #include <cstdint>
 #include <fstream>
+#include <functional>
+#include <memory>
+
+class engine_verifier_t;
+class exec_history_t;
+class gdb_stub_t;
 
 /// @brief A CPU core instance.
 class cpu_t {
@@ -47,15 +63,92 @@ public:
   /// @returns The program return code (the argument to exit()).
   virtual uint32_t run(uint32_t start_addr, int64_t max_cycles) = 0;
 
+  /// @brief Continue running from the current state.
+  ///
+  /// This is used for continuing a run that was stopped by an error, after an earlier state has
+  /// been restored from the execution history.
+  /// @returns The program return code (the argument to exit()).
+  virtual uint32_t resume() = 0;
+
+  /// @brief Vertical blanking callback.
+  ///
+  /// The first argument is the number of the frame that just ended, and the second argument is the
+  /// CPU cycle count at the time of the vertical blanking interval.
+  using vblank_callback_t = std::function<void(uint32_t, uint64_t)>;
+
+  /// @brief Enable simulated vertical blanking intervals.
+  ///
+  /// When enabled, the MC1 video frame counter is advanced by the simulated CPU clock (at the rate
+  /// given by the CPUCLK and VIDFPS MMIO registers) rather than by the host display, and the
+  /// callback is called (from the CPU thread) at each vertical blanking interval.
+  /// @param callback The function to call at each vertical blanking interval (may be empty).
+  void enable_vblank(const vblank_callback_t& callback);
+
+  /// @brief Quantum callback.
+  using quantum_callback_t = std::function<void()>;
+
+  /// @brief Enable quantum based scheduling.
+  ///
+  /// When enabled, the callback is called (from the CPU thread) every time the CPU has executed
+  /// the given number of cycles. This is used for synchronizing several CPU cores.
+  /// @param quantum The number of cycles per quantum.
+  /// @param callback The function to call at the end of each quantum.
+  void enable_quantum(const uint64_t quantum, const quantum_callback_t& callback);
+
+  /// @brief Core start callback.
+  ///
+  /// The argument is the start address for the secondary cores.
+  using core_start_callback_t = std::function<void(uint32_t)>;
+
+  /// @brief Handle writes to the CORE_START system register.
+  ///
+  /// The callback is called (from the CPU thread) when the first core (core 0) writes the
+  /// CORE_START system register. This is used for releasing the secondary cores.
+  /// @param callback The function to call with the written start address.
+  void enable_core_start(const core_start_callback_t& callback);
+
   /// @brief Dump CPU stats from the last run.
-  void dump_stats();
+  virtual void dump_stats();
 
   /// @brief Dump RAM contents.
   void dump_ram(const uint32_t begin, const uint32_t end, const std::string& file_name);
 
+  /// @brief Enable the guest heap profiler.
+  /// @param functions The addresses of the guest heap functions.
+  void enable_heap_profiler(const heap_profiler_t::functions_t& functions);
+
+  /// @brief Get the guest heap profiler (null when disabled).
+  const heap_profiler_t* heap_profiler() const {
+    return m_heap_profiler.get();
+  }
+
+  /// @brief Get the core ID (0 for the first core).
+  uint32_t core_id() const {
+    return m_core_id;
+  }
+
 protected:
-  // This constructor is called from derived classes.
-  cpu_t(ram_t& ram, perf_symbols_t& perf_symbols);
+  // The latency model refers to the EX and MEM operation constants.
+  friend class latency_model_t;
+
+  // The engine verifier compares the architectural state of two cores.
+  friend class engine_verifier_t;
+
+  // The GDB stub reads and writes the registers and memory of a stopped core.
+  friend class gdb_stub_t;
+
+  // The execution history saves and restores the architectural and run state.
+  friend class exec_history_t;
+
+  // The stress tester sets up the register state and the run loop variants directly.
+  friend class stress_tester_t;
+
+  // This constructor is called from derived classes. Unless configure is false, tracing, timing
+  // and the instrumentation features are set up from the configuration.
+  cpu_t(ram_t& ram,
+        perf_symbols_t& perf_symbols,
+        const uint32_t core_id,
+        const bool configure = true);
 
   // Register configuration.
   static const uint32_t NUM_REGS = 33u;                 // R32 is PC (only implicitly addressable).
@@ -214,9 +307,40 @@ protected:
     }
   }
 
-  void begin_simulation();
+  /// @brief Append debug trace records for pipeline bubbles (stall cycles).
+  /// @param pc The address of the stalled instruction.
+  /// @param count The number of bubbles.
+  void append_debug_trace_bubbles(const uint32_t pc, const uint32_t count) {
+    if (m_enable_tracing && count > 0u) {
+      append_debug_trace_bubbles_impl(pc, count);
+    }
+  }
+
+  /// @brief Check if a cycle event (the cycle limit or a vertical blanking interval) is due.
+  ///
+  /// This should be called once per cycle, after the cycle count has been updated.
+  /// @returns false if the cycle limit has been reached.
+  bool check_cycle_events() {
+    return (m_total_cycle_count < m_next_event_cycle) || handle_cycle_events();
+  }
+
+  /// @brief Check if any of the instrumentation features (e.g. cache simulation) are enabled.
+  bool instrumentation_enabled() const;
+
+  /// @brief Append a memory store to the store log (used for engine verification).
+  void log_store(const uint32_t addr, const uint32_t value, const uint32_t size) {
+    const uint32_t mask = (size < 4u) ? ((1u << (size * 8u)) - 1u) : 0xffffffffu;
+    const uint32_t entry[3] = {addr, value & mask, size};
+    m_store_log_hash = hash64(&entry[0], sizeof(entry), m_store_log_hash);
+    ++m_store_log_size;
+  }
+
+  void begin_simulation(int64_t max_cycles);
   void end_simulation();
 
+  // Core ID (for multi-core simulation).
+  const uint32_t m_core_id;
+
   // Memory interface.
   ram_t& m_ram;
 
@@ -232,6 +356,50 @@ protected:
   // Vector registers.
   std::array<vreg_t, NUM_VECTOR_REGS> m_vregs;
 
+  // Instruction cost model (used when timing is enabled).
+  latency_model_t m_latency_model;
+  bool m_timing_enabled = false;
+
+  // Cache models (null when disabled).
+  std::unique_ptr<cache_t> m_icache;
+  std::unique_ptr<cache_t> m_dcache;
+
+  // Branch predictor model (null when disabled).
+  std::unique_ptr<branch_predictor_t> m_branch_predictor;
+
+  // Memory region model (null when disabled).
+  std::unique_ptr<memory_regions_t> m_memory_regions;
+
+  // Data memory profiler (null when disabled).
+  std::unique_ptr<mem_profiler_t> m_mem_profiler;
+
+  // Guest heap profiler (null when disabled).
+  std::unique_ptr<heap_profiler_t> m_heap_profiler;
+
+  // Stack usage profiler (null when disabled).
+  std::unique_ptr<stack_profiler_t> m_stack_profiler;
+
+  // Hot-loop detector (null when disabled).
+  std::unique_ptr<loop_profiler_t> m_loop_profiler;
+
+  // Guest memory watchpoints (null when disabled).
+  std::unique_ptr<watchpoints_t> m_watchpoints;
+
+  // Execution history for reverse execution (null when disabled).
+  std::unique_ptr<exec_history_t> m_history;
+
+  // Engine verifier (null when disabled) and the hashed log of memory stores.
+  engine_verifier_t* m_verifier = nullptr;
+  uint64_t m_store_log_hash = 0u;
+  uint64_t m_store_log_size = 0u;
+
+  // GDB stub (null when disabled), polled for interrupt requests.
+  gdb_stub_t* m_gdb_stub = nullptr;
+  uint64_t m_next_gdb_poll_cycle = ~uint64_t(0);
+
+  // Secondary core start handler (multi-core only, see enable_core_start()).
+  core_start_callback_t m_core_start_callback;
+
   // Run stats.
   uint64_t m_fetched_instr_count;
   uint64_t m_vector_loop_count;
@@ -242,7 +410,11 @@ protected:
 
 private:
   void append_debug_trace_impl(const debug_trace_t& trace);
+  void append_debug_trace_bubbles_impl(const uint32_t pc, const uint32_t count);
   void flush_debug_trace_buffer();
+  bool handle_cycle_events();
+  void vblank();
+  uint64_t vblank_cycle(uint32_t frame_no) const;
 
   // Debug trace file.
   std::ofstream m_trace_file;
@@ -254,6 +426,23 @@ private:
   std::array<uint8_t, TRACE_FLUSH_INTERVAL * TRACE_ENTRY_SIZE> m_debug_trace_buf;
   int m_debug_trace_file_buf_entries = 0;
 
+  // Cycle events.
+  uint64_t m_next_event_cycle = 0u;
+  uint64_t m_max_cycle_count = 0u;
+
+  // Simulated vertical blanking state.
+  bool m_vblank_enabled = false;
+  vblank_callback_t m_vblank_callback;
+  uint64_t m_next_vblank_cycle = ~uint64_t(0);
+  uint64_t m_vblank_period_num = 0u;  // CPU cycles per frame = num / den.
+  uint64_t m_vblank_period_den = 1u;
+  uint32_t m_frame_no = 0u;
+
+  // Quantum scheduling state.
+  uint64_t m_quantum = 0u;
+  quantum_callback_t m_quantum_callback;
+  uint64_t m_next_quantum_cycle = ~uint64_t(0);
+
   // Runtime measurment.
   std::chrono::high_resolution_clock::time_point m_start_time;
   std::chrono::high_resolution_clock::time_point m_stop_time;
@@ -0,0 +1,328 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "cpu_cluster.hpp"
+
+#include "config.hpp"
+#include "cpu_pipelined.hpp"
+#include "cpu_simple.hpp"
+
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+cpu_t* create_core(ram_t& ram, perf_symbols_t& perf_symbols, const uint32_t core_id) {
+  if (config_t::instance().pipeline_enabled()) {
+    return new cpu_pipelined_t(ram, perf_symbols, core_id);
+  }
+  return new cpu_simple_t(ram, perf_symbols, core_id);
+}
+
+double seconds_since(const std::chrono::high_resolution_clock::time_point& t0) {
+  const auto dt = std::chrono::high_resolution_clock::now() - t0;
+  return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(dt).count()) *
+         1e-9;
+}
+
+double percent(const double part, const double total) {
+  return (total > 0.0) ? (100.0 * part / total) : 0.0;
+}
+}  // namespace
+
+cpu_cluster_t::cpu_cluster_t(ram_t& ram, perf_symbols_t& perf_symbols, const uint32_t num_cores)
+    : m_perf_symbols(perf_symbols), m_core_stats(num_cores) {
+  // The execution history is per core, and re-executing one core would not replay the accesses
+  // of the other cores to the shared RAM.
+  if (num_cores > 1u && !config_t::instance().history_spec().empty()) {
+    throw std::runtime_error("The execution history requires a single core.");
+  }
+
+  for (uint32_t core_id = 0u; core_id < num_cores; ++core_id) {
+    auto* core_perf_symbols = &perf_symbols;
+    if (core_id > 0u) {
+      m_core_perf_symbols.emplace_back(new perf_symbols_t(perf_symbols));
+      core_perf_symbols = m_core_perf_symbols.back().get();
+    }
+    m_cores.emplace_back(create_core(ram, *core_perf_symbols, core_id));
+  }
+
+  // Set up quantum based scheduling.
+  const auto quantum = config_t::instance().quantum();
+  m_deterministic = config_t::instance().deterministic() && num_cores > 1u;
+  if (m_deterministic && quantum == 0u) {
+    throw std::runtime_error("Deterministic scheduling requires a quantum.");
+  }
+  if (num_cores > 1u && quantum > 0u) {
+    if (!m_deterministic) {
+      m_barrier.reset(new barrier_t(num_cores));
+    }
+    for (uint32_t core_id = 0u; core_id < num_cores; ++core_id) {
+      m_cores[core_id]->enable_quantum(quantum, [this, core_id] { wait_for_quantum(core_id); });
+    }
+  }
+
+  if (num_cores > 1u) {
+    m_cores[0]->enable_core_start(
+        [this](const uint32_t start_addr) { start_secondary_cores(start_addr); });
+  }
+}
+
+uint32_t cpu_cluster_t::run(const uint32_t start_addr, const int64_t max_cycles) {
+  if (m_verifier) {
+    return m_verifier->run(start_addr, max_cycles);
+  }
+  if (m_gdb_stub != nullptr) {
+    return m_gdb_stub->run(*m_cores[0], start_addr, max_cycles);
+  }
+  if (m_cores.size() == 1u) {
+    return m_cores[0]->run(start_addr, max_cycles);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_start_mutex);
+    m_start_requested = false;
+    m_stop_requested = false;
+  }
+  for (auto& stats : m_core_stats) {
+    stats = core_stats_t();
+  }
+  if (m_deterministic) {
+    std::lock_guard<std::mutex> lock(m_turn_mutex);
+    m_active.assign(m_cores.size(), true);
+    m_turn = 0u;
+  }
+
+  // Start the secondary cores in separate threads (they wait for core 0 to release them).
+  std::vector<std::thread> threads;
+  std::vector<uint32_t> exit_codes(m_cores.size(), 1u);
+  for (uint32_t core_id = 1u; core_id < num_cores(); ++core_id) {
+    threads.emplace_back([this, core_id, max_cycles, &exit_codes] {
+      try {
+        // The time that the core is held counts as host thread time too.
+        const auto t0 = std::chrono::high_resolution_clock::now();
+        uint32_t core_start_addr;
+        const bool started = wait_for_start(core_id, core_start_addr);
+        m_core_stats[core_id].run_time += seconds_since(t0);
+        if (started) {
+          run_core(core_id, core_start_addr, max_cycles, exit_codes[core_id]);
+        } else {
+          leave_quantum_scheduling(core_id);
+        }
+      } catch (std::exception& e) {
+        std::cerr << "Exception in CPU core " << core_id << ": " << e.what() << "\n";
+      }
+    });
+  }
+
+  // Run the first core in this thread.
+  std::exception_ptr exception;
+  try {
+    run_core(0u, start_addr, max_cycles, exit_codes[0]);
+  } catch (...) {
+    exception = std::current_exception();
+  }
+
+  // Stop the secondary cores.
+  terminate();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& core_perf_symbols : m_core_perf_symbols) {
+    m_perf_symbols.merge(*core_perf_symbols);
+  }
+
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+  return exit_codes[0];
+}
+
+void cpu_cluster_t::run_core(const uint32_t core_id,
+                             const uint32_t start_addr,
+                             const int64_t max_cycles,
+                             uint32_t& exit_code) {
+  auto& stats = m_core_stats[core_id];
+  const auto t0 = std::chrono::high_resolution_clock::now();
+  try {
+    exit_code = m_cores[core_id]->run(start_addr, max_cycles);
+  } catch (...) {
+    // Do not keep the other cores waiting for us.
+    leave_quantum_scheduling(core_id);
+    stats.run_time += seconds_since(t0);
+    throw;
+  }
+  leave_quantum_scheduling(core_id);
+  stats.run_time += seconds_since(t0);
+}
+
+void cpu_cluster_t::wait_for_quantum(const uint32_t core_id) {
+  auto& stats = m_core_stats[core_id];
+  const auto t0 = std::chrono::high_resolution_clock::now();
+  if (m_deterministic) {
+    pass_turn(core_id);
+    wait_for_turn(core_id);
+  } else {
+    m_barrier->wait();
+  }
+  stats.wait_time += seconds_since(t0);
+  ++stats.num_quanta;
+
+  // A secondary core that was started just as the cluster was terminated may have missed the
+  // request (the core clears it when it starts running).
+  std::lock_guard<std::mutex> lock(m_start_mutex);
+  if (m_stop_requested) {
+    m_cores[core_id]->terminate();
+  }
+}
+
+void cpu_cluster_t::leave_quantum_scheduling(const uint32_t core_id) {
+  if (m_barrier) {
+    m_barrier->leave();
+  } else if (m_deterministic) {
+    std::lock_guard<std::mutex> lock(m_turn_mutex);
+    m_active[core_id] = false;
+    if (m_turn == core_id) {
+      for (uint32_t i = 1u; i < num_cores(); ++i) {
+        const auto next = (core_id + i) % num_cores();
+        if (m_active[next]) {
+          m_turn = next;
+          break;
+        }
+      }
+      m_turn_cond.notify_all();
+    }
+  }
+}
+
+void cpu_cluster_t::wait_for_turn(const uint32_t core_id) {
+  std::unique_lock<std::mutex> lock(m_turn_mutex);
+  m_turn_cond.wait(lock, [this, core_id] { return m_turn == core_id; });
+}
+
+void cpu_cluster_t::pass_turn(const uint32_t core_id) {
+  std::lock_guard<std::mutex> lock(m_turn_mutex);
+  for (uint32_t i = 1u; i <= num_cores(); ++i) {
+    const auto next = (core_id + i) % num_cores();
+    if (m_active[next]) {
+      m_turn = next;
+      break;
+    }
+  }
+  m_turn_cond.notify_all();
+}
+
+void cpu_cluster_t::start_secondary_cores(const uint32_t start_addr) {
+  std::lock_guard<std::mutex> lock(m_start_mutex);
+  if (!m_start_requested) {
+    m_start_requested = true;
+    m_start_addr = start_addr;
+    m_start_quantum = m_core_stats[0].num_quanta;
+    m_start_cond.notify_all();
+  }
+}
+
+bool cpu_cluster_t::wait_for_start(const uint32_t core_id, uint32_t& start_addr) {
+  if (m_deterministic) {
+    // Core 0 runs the first quantum.
+    wait_for_turn(core_id);
+  }
+  std::unique_lock<std::mutex> lock(m_start_mutex);
+  if (m_barrier || m_deterministic) {
+    // Keep taking part in the quantum scheduling while waiting. The cores are started at the end of
+    // the quantum in which core 0 requested the start, which does not depend on the host timing.
+    while (!m_stop_requested &&
+           !(m_start_requested && m_core_stats[core_id].num_quanta > m_start_quantum)) {
+      lock.unlock();
+      wait_for_quantum(core_id);
+      lock.lock();
+    }
+  } else {
+    m_start_cond.wait(lock, [this] { return m_start_requested || m_stop_requested; });
+  }
+  start_addr = m_start_addr;
+  return !m_stop_requested;
+}
+
+void cpu_cluster_t::enable_heap_profiler(const heap_profiler_t::functions_t& functions) {
+  for (auto& core : m_cores) {
+    core->enable_heap_profiler(functions);
+  }
+}
+
+void cpu_cluster_t::enable_engine_verification(ram_t& reference_ram) {
+  if (m_cores.size() != 1u) {
+    throw std::runtime_error("Engine verification requires a single core.");
+  }
+  m_verifier.reset(new engine_verifier_t(*m_cores[0], reference_ram));
+}
+
+void cpu_cluster_t::enable_gdb_stub(gdb_stub_t& gdb_stub) {
+  if (m_cores.size() != 1u) {
+    throw std::runtime_error("The GDB stub requires a single core.");
+  }
+  if (m_verifier) {
+    throw std::runtime_error("The GDB stub can not be combined with engine verification.");
+  }
+  m_gdb_stub = &gdb_stub;
+}
+
+void cpu_cluster_t::terminate() {
+  {
+    std::lock_guard<std::mutex> lock(m_start_mutex);
+    m_stop_requested = true;
+    m_start_cond.notify_all();
+  }
+  for (auto& core : m_cores) {
+    core->terminate();
+  }
+}
+
+void cpu_cluster_t::dump_stats() {
+  if (m_cores.size() == 1u) {
+    m_cores[0]->dump_stats();
+    if (m_verifier) {
+      m_verifier->print_stats();
+    }
+  } else {
+    for (auto& core : m_cores) {
+      std::cout << "Core " << core->core_id() << ":\n";
+      core->dump_stats();
+      if (m_barrier || m_deterministic) {
+        const auto& stats = m_core_stats[core->core_id()];
+        std::cout << "Quantum scheduling (" << config_t::instance().quantum() << " cycles"
+                  << (m_deterministic ? ", deterministic" : "") << "):\n";
+        std::cout << " Quanta:               " << stats.num_quanta << "\n";
+        std::cout << " Wait time:            " << stats.wait_time << " s ("
+                  << percent(stats.wait_time, stats.run_time) << "% of the host thread time)\n";
+      }
+    }
+  }
+
+  // The heap is shared by all the cores (the events are merged in cycle order).
+  if (m_cores[0]->heap_profiler() != nullptr) {
+    std::vector<const heap_profiler_t*> profilers;
+    for (const auto& core : m_cores) {
+      profilers.push_back(core->heap_profiler());
+    }
+    heap_profiler_t::print_report(profilers, m_perf_symbols);
+  }
+}
@@ -0,0 +1,153 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_CPU_CLUSTER_HPP_
+#define SIM_CPU_CLUSTER_HPP_
+
+#include "barrier.hpp"
+#include "cpu.hpp"
+#include "engine_verifier.hpp"
+#include "gdb_stub.hpp"
+#include "perf_symbols.hpp"
+#include "ram.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// @brief A group of CPU cores that share the same RAM.
+///
+/// Each core runs in its own host thread. Only the first core (core 0) starts executing at the
+/// program start address. The secondary cores are held until core 0 writes a start address to the
+/// CORE_START system register (e.g. when the startup code has initialized the memory), and then
+/// all start at that address. Guest software can tell the cores apart by reading the CORE_ID system
+/// register (and the number of cores from the NUM_CORES system register).
+///
+/// The program exit code is given by the first core (core 0). When it exits, the other cores are
+/// terminated. Secondary cores that exit simply stop executing.
+///
+/// By default the cores run freely. With quantum based scheduling, each core runs for a fixed
+/// number of cycles (the quantum) and then waits for the other cores at a barrier, which keeps the
+/// cores in step. A shorter quantum gives a more accurate interleaving of the cores, at the cost
+/// of simulation speed. The cores still run concurrently within a quantum, so the interleaving of
+/// their memory accesses depends on the host scheduling.
+///
+/// With deterministic scheduling, the cores instead take turns to run one quantum each, in core ID
+/// order. Only one core runs at a time, so the result is reproducible (but the simulation does not
+/// benefit from multiple host CPUs).
+class cpu_cluster_t {
+public:
+  /// @brief Constructor.
+  /// @param ram The shared RAM.
+  /// @param perf_symbols Performance symbols for profiling (the statistics from all the cores are
+  /// accumulated).
+  /// @param num_cores The number of CPU cores.
+  /// @throws std::runtime_error if the execution history is enabled with more than one core, or if
+  /// deterministic scheduling is enabled without a quantum.
+  cpu_cluster_t(ram_t& ram, perf_symbols_t& perf_symbols, const uint32_t num_cores);
+
+  /// @brief Get the number of cores.
+  uint32_t num_cores() const {
+    return static_cast<uint32_t>(m_cores.size());
+  }
+
+  /// @brief Get a CPU core.
+  cpu_t& core(const uint32_t core_id) {
+    return *m_cores[core_id];
+  }
+
+  /// @brief Run all the cores until the first core exits.
+  /// @param start_addr The program start address.
+  /// @param max_cycles The maximum number of cycles to simulate per core (-1 = no limit).
+  /// @returns The program return code (from the first core).
+  uint32_t run(const uint32_t start_addr, const int64_t max_cycles);
+
+  /// @brief Enable the guest heap profiler for all the cores.
+  void enable_heap_profiler(const heap_profiler_t::functions_t& functions);
+
+  /// @brief Verify the execution against a reference core (see engine_verifier_t).
+  /// @param reference_ram The RAM for the reference core (initialized like the shared RAM).
+  /// @throws std::runtime_error if there is more than one core.
+  void enable_engine_verification(ram_t& reference_ram);
+
+  /// @brief Run the program under GDB control (see gdb_stub_t).
+  /// @param gdb_stub The GDB stub (must outlive the cluster).
+  /// @throws std::runtime_error if there is more than one core, or with engine verification.
+  void enable_gdb_stub(gdb_stub_t& gdb_stub);
+
+  /// @brief Terminate the execution of all the cores (can be called from another thread).
+  void terminate();
+
+  /// @brief Dump CPU stats from the last run (per core).
+  void dump_stats();
+
+private:
+  struct core_stats_t {
+    uint64_t num_quanta;
+    double run_time;   // Host thread time (seconds).
+    double wait_time;  // Time spent waiting at the barrier (seconds).
+  };
+
+  void run_core(const uint32_t core_id,
+                const uint32_t start_addr,
+                const int64_t max_cycles,
+                uint32_t& exit_code);
+  void wait_for_quantum(const uint32_t core_id);
+  void leave_quantum_scheduling(const uint32_t core_id);
+  void wait_for_turn(const uint32_t core_id);
+  void pass_turn(const uint32_t core_id);
+  void start_secondary_cores(const uint32_t start_addr);
+  bool wait_for_start(const uint32_t core_id, uint32_t& start_addr);
+
+  perf_symbols_t& m_perf_symbols;
+
+  // Secondary cores use private copies of the perf symbols (merged after the run).
+  std::vector<std::unique_ptr<perf_symbols_t>> m_core_perf_symbols;
+
+  std::vector<std::unique_ptr<cpu_t>> m_cores;
+
+  // Engine verification (null when disabled).
+  std::unique_ptr<engine_verifier_t> m_verifier;
+
+  // GDB stub (null when disabled).
+  gdb_stub_t* m_gdb_stub = nullptr;
+
+  // Quantum based scheduling (null when the cores run freely, or with deterministic scheduling).
+  std::unique_ptr<barrier_t> m_barrier;
+  std::vector<core_stats_t> m_core_stats;
+
+  // Deterministic scheduling: the core that holds the turn is the only one that runs.
+  bool m_deterministic = false;
+  std::mutex m_turn_mutex;
+  std::condition_variable m_turn_cond;
+  std::vector<bool> m_active;  // Cores that still take turns.
+  uint32_t m_turn = 0u;
+
+  // Secondary core start (see CORE_START).
+  std::mutex m_start_mutex;
+  std::condition_variable m_start_cond;
+  bool m_start_requested = false;
+  bool m_stop_requested = false;
+  uint32_t m_start_addr = 0u;
+  uint64_t m_start_quantum = 0u;  // The quantum of core 0 in which the start was requested.
+};
+
+#endif  // SIM_CPU_CLUSTER_HPP_
@@ -0,0 +1,34 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "cpu_pipelined.hpp"
+
+cpu_pipelined_t::cpu_pipelined_t(ram_t& ram,
+                                 perf_symbols_t& perf_symbols,
+                                 const uint32_t core_id,
+                                 const bool configure)
+    : cpu_simple_t(ram, perf_symbols, core_id, configure),
+      m_pipeline_model(NUM_REGS + NUM_VECTOR_REGS * NUM_VECTOR_ELEMENTS) {
+  m_pipeline = &m_pipeline_model;
+}
+
+void cpu_pipelined_t::dump_stats() {
+  cpu_t::dump_stats();
+  m_pipeline_model.print_stats(m_fetched_instr_count);
+}
@@ -0,0 +1,52 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_CPU_PIPELINED_HPP_
+#define SIM_CPU_PIPELINED_HPP_
+
+#include "cpu_simple.hpp"
+#include "pipeline.hpp"
+
+/// @brief A CPU core with a pipeline timing model.
+///
+/// This implementation executes instructions exactly like cpu_simple_t, but the cycle count is
+/// given by a model of the MRISC32-A1 pipeline (see pipeline_t), including operand forwarding,
+/// load-use and multi-cycle stalls, non-pipelined units and branch misprediction penalties. The
+/// debug trace contains one record per cycle, with pipeline bubbles as invalid records (like the
+/// debug trace from the RTL simulation).
+class cpu_pipelined_t : public cpu_simple_t {
+public:
+  /// @brief Constructor for cpu_pipelined_t.
+  ///
+  /// @param ram The RAM to use for this CPU instance.
+  /// @param perf_symbols Performance symbols for profiling.
+  /// @param core_id The core ID (for multi-core simulation).
+  /// @param configure Set up tracing and instrumentation from the configuration.
+  cpu_pipelined_t(ram_t& ram,
+                  perf_symbols_t& perf_symbols,
+                  const uint32_t core_id = 0u,
+                  const bool configure = true);
+
+  void dump_stats() override;
+
+private:
+  pipeline_t m_pipeline_model;
+};
+
+#endif  // SIM_CPU_PIPELINED_HPP_
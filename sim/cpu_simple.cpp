@@ -19,14 +19,24 @@
 
 #include "cpu_simple.hpp"
 
+#include "config.hpp"
+#include "engine_verifier.hpp"
+#include "exec_history.hpp"
+#include "gdb_stub.hpp"
+#include "host_cpu.hpp"
 #include "packed_float.hpp"
+#include "packed_int.hpp"
+#include "pipeline.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstring>
 #include <exception>
 
 namespace {
+using namespace packed_int;
+
 struct reg_id_t {
   uint32_t no;
   bool is_vector;
@@ -46,6 +56,16 @@ struct decode_t {
   uint32_t packed_mode;  // Packed operation mode.
 
   uint32_t mem_op;  // MEM operation.
+
+  uint32_t latency;   // Cycles for the first element (timed modes only).
+  uint32_t interval;  // Cycles for each subsequent vector element (timed modes only).
+
+  // Pipeline model information (pipelined mode only).
+  bool src_a_used;
+  bool src_b_used;
+  bool src_c_used;
+  bool is_load;
+  bool is_mispredicted;
 };
 
 struct vector_state_t {
@@ -135,60 +155,6 @@ inline uint32_t as_u32(const float x) {
   return result;
 }
 
-inline uint32_t add32(const uint32_t a, const uint32_t b) {
-  return a + b;
-}
-
-inline uint32_t add16x2(const uint32_t a, const uint32_t b) {
-  const uint32_t hi = (a & 0xffff0000u) + (b & 0xffff0000u);
-  const uint32_t lo = (a + b) & 0x0000ffffu;
-  return hi | lo;
-}
-
-inline uint32_t add8x4(const uint32_t a, const uint32_t b) {
-  const uint32_t hi = ((a & 0xff00ff00u) + (b & 0xff00ff00u)) & 0xff00ff00u;
-  const uint32_t lo = ((a & 0x00ff00ffu) + (b & 0x00ff00ffu)) & 0x00ff00ffu;
-  return hi | lo;
-}
-
-inline uint32_t sub32(const uint32_t a, const uint32_t b) {
-  return add32((~a) + 1u, b);
-}
-
-inline uint32_t sub16x2(const uint32_t a, const uint32_t b) {
-  return add16x2(add16x2(~a, 0x00010001u), b);
-}
-
-inline uint32_t sub8x4(const uint32_t a, const uint32_t b) {
-  return add8x4(add8x4(~a, 0x01010101u), b);
-}
-
-inline uint32_t set32(const uint32_t a, const uint32_t b, bool (*cmp)(uint32_t, uint32_t)) {
-  return cmp(a, b) ? 0xffffffffu : 0u;
-}
-
-inline uint32_t set16x2(const uint32_t a, const uint32_t b, bool (*cmp)(uint16_t, uint16_t)) {
-  const uint32_t h1 =
-      (cmp(static_cast<uint16_t>(a >> 16), static_cast<uint16_t>(b >> 16)) ? 0xffff0000u : 0u);
-  const uint32_t h0 = (cmp(static_cast<uint16_t>(a), static_cast<uint16_t>(b)) ? 0x0000ffffu : 0u);
-  return h1 | h0;
-}
-
-inline uint32_t set8x4(const uint32_t a, const uint32_t b, bool (*cmp)(uint8_t, uint8_t)) {
-  const uint32_t b3 =
-      (cmp(static_cast<uint8_t>(a >> 24), static_cast<uint8_t>(b >> 24)) ? 0xff000000u : 0u);
-  const uint32_t b2 =
-      (cmp(static_cast<uint8_t>(a >> 16), static_cast<uint8_t>(b >> 16)) ? 0x00ff0000u : 0u);
-  const uint32_t b1 =
-      (cmp(static_cast<uint8_t>(a >> 8), static_cast<uint8_t>(b >> 8)) ? 0x0000ff00u : 0u);
-  const uint32_t b0 = (cmp(static_cast<uint8_t>(a), static_cast<uint8_t>(b)) ? 0x000000ffu : 0u);
-  return b3 | b2 | b1 | b0;
-}
-
-inline uint32_t sel32(const uint32_t a, const uint32_t b, const uint32_t mask) {
-  return (a & mask) | (b & ~mask);
-}
-
 template <int BITS>
 inline uint32_t bf_ctrl_width(const uint32_t ctrl) {
   constexpr int WIDTH_POS = (BITS >= 4) ? 8 : 4;
@@ -346,507 +312,28 @@ inline uint32_t ibf8x4(const uint32_t a, const uint32_t b, const uint32_t c) {
   return mkbf8x4(a, b) | (c & ~mkbf8x4(0xffffffff, b));
 }
 
-inline uint32_t crc32c_8(uint32_t crc, const uint32_t data) {
-  static const uint32_t CRC32C_TAB[] = {0x00000000U,
-                                        0x105ec76fU,
-                                        0x20bd8edeU,
-                                        0x30e349b1U,
-                                        0x417b1dbcU,
-                                        0x5125dad3U,
-                                        0x61c69362U,
-                                        0x7198540dU,
-                                        0x82f63b78U,
-                                        0x92a8fc17U,
-                                        0xa24bb5a6U,
-                                        0xb21572c9U,
-                                        0xc38d26c4U,
-                                        0xd3d3e1abU,
-                                        0xe330a81aU,
-                                        0xf36e6f75U};
-
-  crc = CRC32C_TAB[(crc ^ data) & 0x0fu] ^ (crc >> 4);
-  crc = CRC32C_TAB[(crc ^ (data >> 4)) & 0x0fu] ^ (crc >> 4);
-  return crc;
-}
-
-uint32_t crc32c_16(uint32_t crc, const uint32_t data) {
-  crc = crc32c_8(crc, data);
-  return crc32c_8(crc, data >> 8);
-}
-
-uint32_t crc32c_32(uint32_t crc, const uint32_t data) {
-  crc = crc32c_8(crc, data);
-  crc = crc32c_8(crc, data >> 8);
-  crc = crc32c_8(crc, data >> 16);
-  return crc32c_8(crc, data >> 24);
-}
-
-inline uint32_t crc32_8(uint32_t crc, const uint32_t data) {
-  static const uint32_t CRC32_TAB[] = {0x00000000U,
-                                       0x1db71064U,
-                                       0x3b6e20c8U,
-                                       0x26d930acU,
-                                       0x76dc4190U,
-                                       0x6b6b51f4U,
-                                       0x4db26158U,
-                                       0x5005713cU,
-                                       0xedb88320U,
-                                       0xf00f9344U,
-                                       0xd6d6a3e8U,
-                                       0xcb61b38cU,
-                                       0x9b64c2b0U,
-                                       0x86d3d2d4U,
-                                       0xa00ae278U,
-                                       0xbdbdf21cU};
-
-  crc = CRC32_TAB[(crc ^ data) & 0x0fu] ^ (crc >> 4);
-  crc = CRC32_TAB[(crc ^ (data >> 4)) & 0x0fu] ^ (crc >> 4);
-  return crc;
-}
-
-uint32_t crc32_16(uint32_t crc, const uint32_t data) {
-  crc = crc32_8(crc, data);
-  return crc32_8(crc, data >> 8);
-}
-
-uint32_t crc32_32(uint32_t crc, const uint32_t data) {
-  crc = crc32_8(crc, data);
-  crc = crc32_8(crc, data >> 8);
-  crc = crc32_8(crc, data >> 16);
-  return crc32_8(crc, data >> 24);
-}
-
-inline uint32_t saturate32(const int64_t x) {
-  return (x > INT64_C(0x000000007fffffff))
-             ? 0x7fffffffu
-             : ((x < INT64_C(-0x0000000080000000)) ? 0x80000000u : static_cast<uint32_t>(x));
-}
-
-inline uint32_t saturate16(const int32_t x) {
-  return (x > 0x00007fff)
-             ? 0x7fffu
-             : ((x < -0x00008000) ? 0x8000u : (static_cast<uint32_t>(x) & 0x0000ffffu));
-}
-
-inline uint32_t saturate8(const int16_t x) {
-  return (x > 0x007f) ? 0x7fu : ((x < -0x0080) ? 0x80u : (static_cast<uint32_t>(x) & 0x00ffu));
-}
-
-inline uint32_t saturate4(const int8_t x) {
-  return (x > 0x07) ? 0x7u : ((x < -0x08) ? 0x8u : (static_cast<uint32_t>(x) & 0x0fu));
-}
-
-inline uint32_t saturateu32(const uint64_t x) {
-  return (x > UINT64_C(0x8000000000000000))
-             ? 0x00000000u
-             : ((x > UINT64_C(0x00000000ffffffff)) ? 0xffffffffu : static_cast<uint32_t>(x));
-}
-
-inline uint32_t saturateu16(const uint32_t x) {
-  return (x > 0x80000000u) ? 0x0000u : ((x > 0x0000ffffu) ? 0xffffu : static_cast<uint32_t>(x));
+inline uint32_t crc32c_8(const uint32_t crc, const uint32_t data) {
+  return host_crc32c(crc, data, 1);
 }
 
-inline uint32_t saturateu8(const uint16_t x) {
-  return (x > 0x8000u) ? 0x00u : ((x > 0x00ffu) ? 0xffu : static_cast<uint32_t>(x));
+inline uint32_t crc32c_16(const uint32_t crc, const uint32_t data) {
+  return host_crc32c(crc, data, 2);
 }
 
-inline uint32_t saturateu16_no_uf(const uint32_t x) {
-  return (x > 0x0000ffffu) ? 0xffffu : static_cast<uint32_t>(x);
+inline uint32_t crc32c_32(const uint32_t crc, const uint32_t data) {
+  return host_crc32c(crc, data, 4);
 }
 
-inline uint32_t saturateu8_no_uf(const uint16_t x) {
-  return (x > 0x00ffu) ? 0xffu : static_cast<uint32_t>(x);
+inline uint32_t crc32_8(const uint32_t crc, const uint32_t data) {
+  return host_crc32(crc, data, 1);
 }
 
-inline uint32_t saturateu4_no_uf(const uint8_t x) {
-  return (x > 0x0fu) ? 0xfu : static_cast<uint32_t>(x);
+inline uint32_t crc32_16(const uint32_t crc, const uint32_t data) {
+  return host_crc32(crc, data, 2);
 }
 
-inline uint32_t saturating_op_32(const uint32_t a,
-                                 const uint32_t b,
-                                 int64_t (*op)(int64_t, int64_t)) {
-  const auto a64 = static_cast<int64_t>(static_cast<int32_t>(a));
-  const auto b64 = static_cast<int64_t>(static_cast<int32_t>(b));
-  return saturate32(op(a64, b64));
-}
-
-inline uint32_t saturating_op_16x2(const uint32_t a,
-                                   const uint32_t b,
-                                   int32_t (*op)(int32_t, int32_t)) {
-  const auto a1 = static_cast<int32_t>(static_cast<int16_t>(a >> 16));
-  const auto a2 = static_cast<int32_t>(static_cast<int16_t>(a));
-  const auto b1 = static_cast<int32_t>(static_cast<int16_t>(b >> 16));
-  const auto b2 = static_cast<int32_t>(static_cast<int16_t>(b));
-  const auto c1 = saturate16(op(a1, b1));
-  const auto c2 = saturate16(op(a2, b2));
-  return (c1 << 16) | c2;
-}
-
-inline uint32_t saturating_op_8x4(const uint32_t a,
-                                  const uint32_t b,
-                                  int16_t (*op)(int16_t, int16_t)) {
-  const auto a1 = static_cast<int16_t>(static_cast<int8_t>(a >> 24));
-  const auto a2 = static_cast<int16_t>(static_cast<int8_t>(a >> 16));
-  const auto a3 = static_cast<int16_t>(static_cast<int8_t>(a >> 8));
-  const auto a4 = static_cast<int16_t>(static_cast<int8_t>(a));
-  const auto b1 = static_cast<int16_t>(static_cast<int8_t>(b >> 24));
-  const auto b2 = static_cast<int16_t>(static_cast<int8_t>(b >> 16));
-  const auto b3 = static_cast<int16_t>(static_cast<int8_t>(b >> 8));
-  const auto b4 = static_cast<int16_t>(static_cast<int8_t>(b));
-  const auto c1 = saturate8(op(a1, b1));
-  const auto c2 = saturate8(op(a2, b2));
-  const auto c3 = saturate8(op(a3, b3));
-  const auto c4 = saturate8(op(a4, b4));
-  return (c1 << 24) | (c2 << 16) | (c3 << 8) | c4;
-}
-
-inline uint32_t saturating_op_u32(const uint32_t a,
-                                  const uint32_t b,
-                                  uint64_t (*op)(uint64_t, uint64_t)) {
-  return saturateu32(op(static_cast<uint64_t>(a), static_cast<uint64_t>(b)));
-}
-
-inline uint32_t saturating_op_u16x2(const uint32_t a,
-                                    const uint32_t b,
-                                    uint32_t (*op)(uint32_t, uint32_t)) {
-  const auto a1 = static_cast<uint32_t>(static_cast<uint16_t>(a >> 16));
-  const auto a2 = static_cast<uint32_t>(static_cast<uint16_t>(a));
-  const auto b1 = static_cast<uint32_t>(static_cast<uint16_t>(b >> 16));
-  const auto b2 = static_cast<uint32_t>(static_cast<uint16_t>(b));
-  const auto c1 = saturateu16(op(a1, b1));
-  const auto c2 = saturateu16(op(a2, b2));
-  return (c1 << 16) | c2;
-}
-
-inline uint32_t saturating_op_u8x4(const uint32_t a,
-                                   const uint32_t b,
-                                   uint16_t (*op)(uint16_t, uint16_t)) {
-  const auto a1 = static_cast<uint16_t>(static_cast<uint8_t>(a >> 24));
-  const auto a2 = static_cast<uint16_t>(static_cast<uint8_t>(a >> 16));
-  const auto a3 = static_cast<uint16_t>(static_cast<uint8_t>(a >> 8));
-  const auto a4 = static_cast<uint16_t>(static_cast<uint8_t>(a));
-  const auto b1 = static_cast<uint16_t>(static_cast<uint8_t>(b >> 24));
-  const auto b2 = static_cast<uint16_t>(static_cast<uint8_t>(b >> 16));
-  const auto b3 = static_cast<uint16_t>(static_cast<uint8_t>(b >> 8));
-  const auto b4 = static_cast<uint16_t>(static_cast<uint8_t>(b));
-  const auto c1 = saturateu8(op(a1, b1));
-  const auto c2 = saturateu8(op(a2, b2));
-  const auto c3 = saturateu8(op(a3, b3));
-  const auto c4 = saturateu8(op(a4, b4));
-  return (c1 << 24) | (c2 << 16) | (c3 << 8) | c4;
-}
-
-inline uint32_t halve32(const int64_t x) {
-  return static_cast<uint32_t>(x >> 1);
-}
-
-inline uint32_t halve16(const int32_t x) {
-  return static_cast<uint32_t>(static_cast<uint16_t>(x >> 1));
-}
-
-inline uint32_t halve8(const int16_t x) {
-  return static_cast<uint32_t>(static_cast<uint8_t>(x >> 1));
-}
-
-inline uint32_t halveu32(const uint64_t x) {
-  return static_cast<uint32_t>(x >> 1);
-}
-
-inline uint32_t halveu16(const uint32_t x) {
-  return static_cast<uint32_t>(static_cast<uint16_t>(x >> 1));
-}
-
-inline uint32_t halveu8(const uint16_t x) {
-  return static_cast<uint32_t>(static_cast<uint8_t>(x >> 1));
-}
-
-inline uint32_t halving_op_32(const uint32_t a, const uint32_t b, int64_t (*op)(int64_t, int64_t)) {
-  const auto a64 = static_cast<int64_t>(static_cast<int32_t>(a));
-  const auto b64 = static_cast<int64_t>(static_cast<int32_t>(b));
-  return halve32(op(a64, b64));
-}
-
-inline uint32_t halving_op_16x2(const uint32_t a,
-                                const uint32_t b,
-                                int32_t (*op)(int32_t, int32_t)) {
-  const auto a1 = static_cast<int32_t>(static_cast<int16_t>(a >> 16));
-  const auto a2 = static_cast<int32_t>(static_cast<int16_t>(a));
-  const auto b1 = static_cast<int32_t>(static_cast<int16_t>(b >> 16));
-  const auto b2 = static_cast<int32_t>(static_cast<int16_t>(b));
-  const auto c1 = halve16(op(a1, b1));
-  const auto c2 = halve16(op(a2, b2));
-  return (c1 << 16) | c2;
-}
-
-inline uint32_t halving_op_8x4(const uint32_t a,
-                               const uint32_t b,
-                               int16_t (*op)(int16_t, int16_t)) {
-  const auto a1 = static_cast<int16_t>(static_cast<int8_t>(a >> 24));
-  const auto a2 = static_cast<int16_t>(static_cast<int8_t>(a >> 16));
-  const auto a3 = static_cast<int16_t>(static_cast<int8_t>(a >> 8));
-  const auto a4 = static_cast<int16_t>(static_cast<int8_t>(a));
-  const auto b1 = static_cast<int16_t>(static_cast<int8_t>(b >> 24));
-  const auto b2 = static_cast<int16_t>(static_cast<int8_t>(b >> 16));
-  const auto b3 = static_cast<int16_t>(static_cast<int8_t>(b >> 8));
-  const auto b4 = static_cast<int16_t>(static_cast<int8_t>(b));
-  const auto c1 = halve8(op(a1, b1));
-  const auto c2 = halve8(op(a2, b2));
-  const auto c3 = halve8(op(a3, b3));
-  const auto c4 = halve8(op(a4, b4));
-  return (c1 << 24) | (c2 << 16) | (c3 << 8) | c4;
-}
-
-inline uint32_t halving_op_u32(const uint32_t a,
-                               const uint32_t b,
-                               uint64_t (*op)(uint64_t, uint64_t)) {
-  return halveu32(op(static_cast<uint64_t>(a), static_cast<uint64_t>(b)));
-}
-
-inline uint32_t halving_op_u16x2(const uint32_t a,
-                                 const uint32_t b,
-                                 uint32_t (*op)(uint32_t, uint32_t)) {
-  const auto a1 = static_cast<uint32_t>(static_cast<uint16_t>(a >> 16));
-  const auto a2 = static_cast<uint32_t>(static_cast<uint16_t>(a));
-  const auto b1 = static_cast<uint32_t>(static_cast<uint16_t>(b >> 16));
-  const auto b2 = static_cast<uint32_t>(static_cast<uint16_t>(b));
-  const auto c1 = halveu16(op(a1, b1));
-  const auto c2 = halveu16(op(a2, b2));
-  return (c1 << 16) | c2;
-}
-
-inline uint32_t halving_op_u8x4(const uint32_t a,
-                                const uint32_t b,
-                                uint16_t (*op)(uint16_t, uint16_t)) {
-  const auto a1 = static_cast<uint16_t>(static_cast<uint8_t>(a >> 24));
-  const auto a2 = static_cast<uint16_t>(static_cast<uint8_t>(a >> 16));
-  const auto a3 = static_cast<uint16_t>(static_cast<uint8_t>(a >> 8));
-  const auto a4 = static_cast<uint16_t>(static_cast<uint8_t>(a));
-  const auto b1 = static_cast<uint16_t>(static_cast<uint8_t>(b >> 24));
-  const auto b2 = static_cast<uint16_t>(static_cast<uint8_t>(b >> 16));
-  const auto b3 = static_cast<uint16_t>(static_cast<uint8_t>(b >> 8));
-  const auto b4 = static_cast<uint16_t>(static_cast<uint8_t>(b));
-  const auto c1 = halveu8(op(a1, b1));
-  const auto c2 = halveu8(op(a2, b2));
-  const auto c3 = halveu8(op(a3, b3));
-  const auto c4 = halveu8(op(a4, b4));
-  return (c1 << 24) | (c2 << 16) | (c3 << 8) | c4;
-}
-
-inline uint32_t mul32(const uint32_t a, const uint32_t b) {
-  return a * b;
-}
-
-inline uint32_t mul16x2(const uint32_t a, const uint32_t b) {
-  const auto h1 = (a >> 16) * (b >> 16) << 16;
-  const auto h0 = (a * b) & 0x0000ffffu;
-  return h1 | h0;
-}
-
-inline uint32_t mul8x4(const uint32_t a, const uint32_t b) {
-  const auto b3 = (a >> 24) * (b >> 24) << 24;
-  const auto b2 = (((a >> 16) * (b >> 16)) & 0x000000ffu) << 16;
-  const auto b1 = (((a >> 8) * (b >> 8)) & 0x000000ffu) << 8;
-  const auto b0 = (a * b) & 0x000000ffu;
-  return b3 | b2 | b1 | b0;
-}
-
-inline uint32_t mulhi32(const uint32_t a, const uint32_t b) {
-  const int64_t p =
-      static_cast<int64_t>(static_cast<int32_t>(a)) * static_cast<int64_t>(static_cast<int32_t>(b));
-  return static_cast<uint32_t>(p >> 32u);
-}
-
-inline uint32_t mulhi16x2(const uint32_t a, const uint32_t b) {
-  const auto a1 = static_cast<int32_t>(static_cast<int16_t>(a >> 16u));
-  const auto a0 = static_cast<int32_t>(static_cast<int16_t>(a));
-  const auto b1 = static_cast<int32_t>(static_cast<int16_t>(b >> 16u));
-  const auto b0 = static_cast<int32_t>(static_cast<int16_t>(b));
-  const auto c1 = static_cast<uint32_t>(a1 * b1) & 0xffff0000u;
-  const auto c0 = static_cast<uint32_t>(a0 * b0) >> 16u;
-  return c1 | c0;
-}
-
-inline uint32_t mulhi8x4(const uint32_t a, const uint32_t b) {
-  const auto a3 = static_cast<int32_t>(static_cast<int8_t>(a >> 24u));
-  const auto a2 = static_cast<int32_t>(static_cast<int8_t>(a >> 16u));
-  const auto a1 = static_cast<int32_t>(static_cast<int8_t>(a >> 8u));
-  const auto a0 = static_cast<int32_t>(static_cast<int8_t>(a));
-  const auto b3 = static_cast<int32_t>(static_cast<int8_t>(b >> 24u));
-  const auto b2 = static_cast<int32_t>(static_cast<int8_t>(b >> 16u));
-  const auto b1 = static_cast<int32_t>(static_cast<int8_t>(b >> 8u));
-  const auto b0 = static_cast<int32_t>(static_cast<int8_t>(b));
-  const auto c3 = (static_cast<uint32_t>(a3 * b3) & 0x0000ff00u) << 16u;
-  const auto c2 = (static_cast<uint32_t>(a2 * b2) & 0x0000ff00u) << 8u;
-  const auto c1 = (static_cast<uint32_t>(a1 * b1) & 0x0000ff00u);
-  const auto c0 = (static_cast<uint32_t>(a0 * b0) & 0x0000ff00u) >> 8u;
-  return c3 | c2 | c1 | c0;
-}
-
-inline uint32_t mulhiu32(const uint32_t a, const uint32_t b) {
-  const uint64_t p = static_cast<uint64_t>(a) * static_cast<uint64_t>(b);
-  return static_cast<uint32_t>(p >> 32u);
-}
-
-inline uint32_t mulhiu16x2(const uint32_t a, const uint32_t b) {
-  const auto h1 = (a >> 16) * (b >> 16) & 0xffff0000u;
-  const auto h0 = ((a & 0x0000ffffu) * (b & 0x0000ffffu)) >> 16;
-  return h1 | h0;
-}
-
-inline uint32_t mulhiu8x4(const uint32_t a, const uint32_t b) {
-  const auto b3 = ((a & 0xff000000u) >> 16u) * ((b & 0xff000000u) >> 16u) & 0xff000000u;
-  const auto b2 = (((a & 0x00ff0000u) >> 12u) * ((b & 0x00ff0000u) >> 12u)) & 0x00ff0000u;
-  const auto b1 = ((a & 0x0000ff00u) >> 8u) * ((b & 0x0000ff00u) >> 8u) & 0x0000ff00u;
-  const auto b0 = ((a & 0x000000ffu) * (b & 0x000000ffu)) >> 8u;
-  return b3 | b2 | b1 | b0;
-}
-
-inline uint32_t madd32(const uint32_t a, const uint32_t b, const uint32_t c) {
-  return c + a * b;
-}
-
-inline uint32_t madd16x2(const uint32_t a, const uint32_t b, const uint32_t c) {
-  const auto h1 = ((c >> 16) + (a >> 16) * (b >> 16)) << 16;
-  const auto h0 = (c + a * b) & 0x0000ffffu;
-  return h1 | h0;
-}
-
-inline uint32_t madd8x4(const uint32_t a, const uint32_t b, const uint32_t c) {
-  const auto b3 = ((c >> 24) + (a >> 24) * (b >> 24)) << 24;
-  const auto b2 = (((c >> 16) + (a >> 16) * (b >> 16)) & 0x000000ffu) << 16;
-  const auto b1 = (((c >> 8) + (a >> 8) * (b >> 8)) & 0x000000ffu) << 8;
-  const auto b0 = (c + a * b) & 0x000000ffu;
-  return b3 | b2 | b1 | b0;
-}
-
-template <typename T>
-inline T div_allow_zero(const T a, const T b) {
-  return b != static_cast<T>(0) ? (a / b) : static_cast<T>(-1);
-}
-
-template <typename T>
-inline T mod_allow_zero(const T a, const T b) {
-  return b != static_cast<T>(0) ? (a % b) : a;
-}
-
-inline uint32_t div32(const uint32_t a, const uint32_t b) {
-  return static_cast<uint32_t>(div_allow_zero(static_cast<int32_t>(a), static_cast<int32_t>(b)));
-}
-
-inline uint32_t div16x2(const uint32_t a, const uint32_t b) {
-  const auto a1 = static_cast<int32_t>(static_cast<int16_t>(a >> 16u));
-  const auto a0 = static_cast<int32_t>(static_cast<int16_t>(a));
-  const auto b1 = static_cast<int32_t>(static_cast<int16_t>(b >> 16u));
-  const auto b0 = static_cast<int32_t>(static_cast<int16_t>(b));
-  const auto c1 = (static_cast<uint32_t>(div_allow_zero(a1, b1)) & 0x0000ffffu) << 16u;
-  const auto c0 = static_cast<uint32_t>(div_allow_zero(a0, b0)) & 0x0000ffffu;
-  return c1 | c0;
-}
-
-inline uint32_t div8x4(const uint32_t a, const uint32_t b) {
-  const auto a3 = static_cast<int32_t>(static_cast<int8_t>(a >> 24u));
-  const auto a2 = static_cast<int32_t>(static_cast<int8_t>(a >> 16u));
-  const auto a1 = static_cast<int32_t>(static_cast<int8_t>(a >> 8u));
-  const auto a0 = static_cast<int32_t>(static_cast<int8_t>(a));
-  const auto b3 = static_cast<int32_t>(static_cast<int8_t>(b >> 24u));
-  const auto b2 = static_cast<int32_t>(static_cast<int8_t>(b >> 16u));
-  const auto b1 = static_cast<int32_t>(static_cast<int8_t>(b >> 8u));
-  const auto b0 = static_cast<int32_t>(static_cast<int8_t>(b));
-  const auto c3 = (static_cast<uint32_t>(div_allow_zero(a3, b3)) & 0x000000ffu) << 24u;
-  const auto c2 = (static_cast<uint32_t>(div_allow_zero(a2, b2)) & 0x000000ffu) << 16u;
-  const auto c1 = (static_cast<uint32_t>(div_allow_zero(a1, b1)) & 0x000000ffu) << 8u;
-  const auto c0 = static_cast<uint32_t>(div_allow_zero(a0, b0)) & 0x000000ffu;
-  return c3 | c2 | c1 | c0;
-}
-
-inline uint32_t divu32(const uint32_t a, const uint32_t b) {
-  return div_allow_zero(a, b);
-}
-
-inline uint32_t divu16x2(const uint32_t a, const uint32_t b) {
-  const auto a1 = a >> 16u;
-  const auto a0 = a & 0x0000ffff;
-  const auto b1 = b >> 16u;
-  const auto b0 = b & 0x0000ffff;
-  const auto c1 = div_allow_zero(a1, b1) << 16u;
-  const auto c0 = div_allow_zero(a0, b0);
-  return c1 | c0;
-}
-
-inline uint32_t divu8x4(const uint32_t a, const uint32_t b) {
-  const auto a3 = a >> 24u;
-  const auto a2 = (a >> 16u) & 0x000000ff;
-  const auto a1 = (a >> 8u) & 0x000000ff;
-  const auto a0 = a & 0x000000ff;
-  const auto b3 = b >> 24u;
-  const auto b2 = (b >> 16u) & 0x000000ff;
-  const auto b1 = (b >> 8u) & 0x000000ff;
-  const auto b0 = b & 0x000000ff;
-  const auto c3 = div_allow_zero(a3, b3) << 24u;
-  const auto c2 = div_allow_zero(a2, b2) << 16u;
-  const auto c1 = div_allow_zero(a1, b1) << 8u;
-  const auto c0 = div_allow_zero(a0, b0);
-  return c3 | c2 | c1 | c0;
-}
-
-inline uint32_t rem32(const uint32_t a, const uint32_t b) {
-  return static_cast<uint32_t>(mod_allow_zero(static_cast<int32_t>(a), static_cast<int32_t>(b)));
-}
-
-inline uint32_t rem16x2(const uint32_t a, const uint32_t b) {
-  const auto a1 = static_cast<int32_t>(static_cast<int16_t>(a >> 16u));
-  const auto a0 = static_cast<int32_t>(static_cast<int16_t>(a));
-  const auto b1 = static_cast<int32_t>(static_cast<int16_t>(b >> 16u));
-  const auto b0 = static_cast<int32_t>(static_cast<int16_t>(b));
-  const auto c1 = (static_cast<uint32_t>(mod_allow_zero(a1, b1)) & 0x0000ffffu) << 16u;
-  const auto c0 = static_cast<uint32_t>(mod_allow_zero(a0, b0)) & 0x0000ffffu;
-  return c1 | c0;
-}
-
-inline uint32_t rem8x4(const uint32_t a, const uint32_t b) {
-  const auto a3 = static_cast<int32_t>(static_cast<int8_t>(a >> 24u));
-  const auto a2 = static_cast<int32_t>(static_cast<int8_t>(a >> 16u));
-  const auto a1 = static_cast<int32_t>(static_cast<int8_t>(a >> 8u));
-  const auto a0 = static_cast<int32_t>(static_cast<int8_t>(a));
-  const auto b3 = static_cast<int32_t>(static_cast<int8_t>(b >> 24u));
-  const auto b2 = static_cast<int32_t>(static_cast<int8_t>(b >> 16u));
-  const auto b1 = static_cast<int32_t>(static_cast<int8_t>(b >> 8u));
-  const auto b0 = static_cast<int32_t>(static_cast<int8_t>(b));
-  const auto c3 = (static_cast<uint32_t>(mod_allow_zero(a3, b3)) & 0x000000ffu) << 24u;
-  const auto c2 = (static_cast<uint32_t>(mod_allow_zero(a2, b2)) & 0x000000ffu) << 16u;
-  const auto c1 = (static_cast<uint32_t>(mod_allow_zero(a1, b1)) & 0x000000ffu) << 8u;
-  const auto c0 = static_cast<uint32_t>(mod_allow_zero(a0, b0)) & 0x000000ffu;
-  return c3 | c2 | c1 | c0;
-}
-
-inline uint32_t remu32(const uint32_t a, const uint32_t b) {
-  return mod_allow_zero(a, b);
-}
-
-inline uint32_t remu16x2(const uint32_t a, const uint32_t b) {
-  const auto a1 = a >> 16u;
-  const auto a0 = a & 0x0000ffff;
-  const auto b1 = b >> 16u;
-  const auto b0 = b & 0x0000ffff;
-  const auto c1 = mod_allow_zero(a1, b1) << 16u;
-  const auto c0 = mod_allow_zero(a0, b0);
-  return c1 | c0;
-}
-
-inline uint32_t remu8x4(const uint32_t a, const uint32_t b) {
-  const auto a3 = a >> 24u;
-  const auto a2 = (a >> 16u) & 0x000000ff;
-  const auto a1 = (a >> 8u) & 0x000000ff;
-  const auto a0 = a & 0x000000ff;
-  const auto b3 = b >> 24u;
-  const auto b2 = (b >> 16u) & 0x000000ff;
-  const auto b1 = (b >> 8u) & 0x000000ff;
-  const auto b0 = b & 0x000000ff;
-  const auto c3 = mod_allow_zero(a3, b3) << 24u;
-  const auto c2 = mod_allow_zero(a2, b2) << 16u;
-  const auto c1 = mod_allow_zero(a1, b1) << 8u;
-  const auto c0 = mod_allow_zero(a0, b0);
-  return c3 | c2 | c1 | c0;
+inline uint32_t crc32_32(const uint32_t crc, const uint32_t data) {
+  return host_crc32(crc, data, 4);
 }
 
 inline uint32_t fpack32(const uint32_t a, const uint32_t b) {
@@ -857,8 +344,24 @@ inline uint32_t fpack16x2(const uint32_t a, const uint32_t b) {
   return f8x4_t::from_f16x4(f16x2_t(a), f16x2_t(b)).packf();
 }
 
+// The compiler may swap the operands of commutative float operations, which changes which NaN
+// payload is propagated when both operands are NaN. Use the first NaN operand (like x86 does) so
+// that the result does not depend on how the run loop was compiled.
+inline uint32_t propagate_nan32(const uint32_t result, const uint32_t a, const uint32_t b) {
+  if ((result & 0x7fffffffu) <= 0x7f800000u) {
+    return result;
+  }
+  if ((a & 0x7fffffffu) > 0x7f800000u) {
+    return a | 0x00400000u;
+  }
+  if ((b & 0x7fffffffu) > 0x7f800000u) {
+    return b | 0x00400000u;
+  }
+  return result;
+}
+
 inline uint32_t fadd32(const uint32_t a, const uint32_t b) {
-  return as_u32(as_f32(a) + as_f32(b));
+  return propagate_nan32(as_u32(as_f32(a) + as_f32(b)), a, b);
 }
 
 inline uint32_t fadd16x2(const uint32_t a, const uint32_t b) {
@@ -882,7 +385,7 @@ inline uint32_t fsub8x4(const uint32_t a, const uint32_t b) {
 }
 
 inline uint32_t fmul32(const uint32_t a, const uint32_t b) {
-  return as_u32(as_f32(a) * as_f32(b));
+  return propagate_nan32(as_u32(as_f32(a) * as_f32(b)), a, b);
 }
 
 inline uint32_t fmul16x2(const uint32_t a, const uint32_t b) {
@@ -945,14 +448,7 @@ inline uint32_t fmax8x4(const uint32_t a, const uint32_t b) {
 }
 
 inline uint32_t clz32(const uint32_t x) {
-#if defined(__GNUC__) || defined(__clang__)
-  return (x == 0u) ? 32u : static_cast<uint32_t>(__builtin_clz(x));
-#else
-  uint32_t count = 0u;
-  for (; (count != 32u) && ((x & (0x80000000u >> count)) == 0u); ++count)
-    ;
-  return count;
-#endif
+  return host_clz32(x);
 }
 
 inline uint32_t clz16x2(const uint32_t x) {
@@ -965,97 +461,36 @@ inline uint32_t clz8x4(const uint32_t x) {
 }
 
 inline uint32_t popcnt32(const uint32_t x) {
-#if defined(__GNUC__) || defined(__clang__)
-  return static_cast<uint32_t>(__builtin_popcount(x));
-#else
-  uint32_t count = 0u;
-  for (int i = 0; i < 32; ++i) {
-    if ((x & (0x80000000u >> i)) == 1u) {
-      ++count;
-    }
-  }
-  return count;
-#endif
-}
-
-inline uint32_t popcnt16x2(const uint32_t x) {
-  return (popcnt32(x & 0xffff0000u) << 16u) | popcnt32(x & 0x0000ffffu);
+  return host_popcnt32(x);
 }
 
 inline uint32_t popcnt8x4(const uint32_t x) {
-  return (popcnt32(x & 0xff000000u) << 24u) | (popcnt32(x & 0x00ff0000u) << 16u) |
-         (popcnt32(x & 0x0000ff00u) << 8u) | popcnt32(x & 0x000000ffu);
-}
-
-inline uint32_t rev32(const uint32_t x) {
-  return ((x >> 31u) & 0x00000001u) | ((x >> 29u) & 0x00000002u) | ((x >> 27u) & 0x00000004u) |
-         ((x >> 25u) & 0x00000008u) | ((x >> 23u) & 0x00000010u) | ((x >> 21u) & 0x00000020u) |
-         ((x >> 19u) & 0x00000040u) | ((x >> 17u) & 0x00000080u) | ((x >> 15u) & 0x00000100u) |
-         ((x >> 13u) & 0x00000200u) | ((x >> 11u) & 0x00000400u) | ((x >> 9u) & 0x00000800u) |
-         ((x >> 7u) & 0x00001000u) | ((x >> 5u) & 0x00002000u) | ((x >> 3u) & 0x00004000u) |
-         ((x >> 1u) & 0x00008000u) | ((x << 1u) & 0x00010000u) | ((x << 3u) & 0x00020000u) |
-         ((x << 5u) & 0x00040000u) | ((x << 7u) & 0x00080000u) | ((x << 9u) & 0x00100000u) |
-         ((x << 11u) & 0x00200000u) | ((x << 13u) & 0x00400000u) | ((x << 15u) & 0x00800000u) |
-         ((x << 17u) & 0x01000000u) | ((x << 19u) & 0x02000000u) | ((x << 21u) & 0x04000000u) |
-         ((x << 23u) & 0x08000000u) | ((x << 25u) & 0x10000000u) | ((x << 27u) & 0x20000000u) |
-         ((x << 29u) & 0x40000000u) | ((x << 31u) & 0x80000000u);
+  // Count the bits in each byte in parallel (SWAR).
+  uint32_t y = x - ((x >> 1u) & 0x55555555u);
+  y = (y & 0x33333333u) + ((y >> 2u) & 0x33333333u);
+  return (y + (y >> 4u)) & 0x0f0f0f0fu;
 }
 
-inline uint32_t rev16x2(const uint32_t x) {
-  return ((x >> 15u) & 0x00010001u) | ((x >> 13u) & 0x00020002u) | ((x >> 11u) & 0x00040004u) |
-         ((x >> 9u) & 0x00080008u) | ((x >> 7u) & 0x00100010u) | ((x >> 5u) & 0x00200020u) |
-         ((x >> 3u) & 0x00400040u) | ((x >> 1u) & 0x00800080u) | ((x << 1u) & 0x01000100u) |
-         ((x << 3u) & 0x02000200u) | ((x << 5u) & 0x04000400u) | ((x << 7u) & 0x08000800u) |
-         ((x << 9u) & 0x10001000u) | ((x << 11u) & 0x20002000u) | ((x << 13u) & 0x40004000u) |
-         ((x << 15u) & 0x80008000u);
+inline uint32_t popcnt16x2(const uint32_t x) {
+  const uint32_t y = popcnt8x4(x);
+  return (y + (y >> 8u)) & 0x00ff00ffu;
 }
 
 inline uint32_t rev8x4(const uint32_t x) {
-  return ((x >> 7u) & 0x01010101u) | ((x >> 5u) & 0x02020202u) | ((x >> 3u) & 0x04040404u) |
-         ((x >> 1u) & 0x08080808u) | ((x << 1u) & 0x10101010u) | ((x << 3u) & 0x20202020u) |
-         ((x << 5u) & 0x40404040u) | ((x << 7u) & 0x80808080u);
+  // Reverse the bits within each byte (swap adjacent bits, bit pairs and nibbles).
+  uint32_t y = ((x >> 1u) & 0x55555555u) | ((x & 0x55555555u) << 1u);
+  y = ((y >> 2u) & 0x33333333u) | ((y & 0x33333333u) << 2u);
+  return ((y >> 4u) & 0x0f0f0f0fu) | ((y & 0x0f0f0f0fu) << 4u);
 }
 
-inline uint8_t shuf_op(const uint8_t x, const bool fill, const bool sign_fill) {
-  const uint8_t fill_bits = (sign_fill && ((x & 0x80u) != 0u)) ? 0xffu : 0x00u;
-  return fill ? fill_bits : x;
+inline uint32_t rev16x2(const uint32_t x) {
+  const uint32_t y = rev8x4(x);
+  return ((y >> 8u) & 0x00ff00ffu) | ((y & 0x00ff00ffu) << 8u);
 }
 
-inline uint32_t shuf32(const uint32_t x, const uint32_t idx) {
-  // Extract the four bytes from x.
-  uint8_t xv[4];
-  xv[0] = static_cast<uint8_t>(x);
-  xv[1] = static_cast<uint8_t>(x >> 8u);
-  xv[2] = static_cast<uint8_t>(x >> 16u);
-  xv[3] = static_cast<uint8_t>(x >> 24u);
-
-  // Extract the four indices from idx.
-  uint8_t idxv[4];
-  idxv[0] = static_cast<uint8_t>(idx & 3u);
-  idxv[1] = static_cast<uint8_t>((idx >> 3u) & 3u);
-  idxv[2] = static_cast<uint8_t>((idx >> 6u) & 3u);
-  idxv[3] = static_cast<uint8_t>((idx >> 9u) & 3u);
-
-  // Extract the four fill operation descriptions from idx.
-  bool fillv[4];
-  fillv[0] = ((idx & 4u) != 0u);
-  fillv[1] = ((idx & (4u << 3u)) != 0u);
-  fillv[2] = ((idx & (4u << 6u)) != 0u);
-  fillv[3] = ((idx & (4u << 9u)) != 0u);
-
-  // Sign-fill or zero-fill?
-  const bool sign_fill = (((idx >> 12u) & 1u) != 0u);
-
-  // Combine the parts into four new bytes.
-  uint8_t yv[4];
-  yv[0] = shuf_op(xv[idxv[0]], fillv[0], sign_fill);
-  yv[1] = shuf_op(xv[idxv[1]], fillv[1], sign_fill);
-  yv[2] = shuf_op(xv[idxv[2]], fillv[2], sign_fill);
-  yv[3] = shuf_op(xv[idxv[3]], fillv[3], sign_fill);
-
-  // Combine the four bytes into a 32-bit word.
-  return static_cast<uint32_t>(yv[0]) | (static_cast<uint32_t>(yv[1]) << 8u) |
-         (static_cast<uint32_t>(yv[2]) << 16u) | (static_cast<uint32_t>(yv[3]) << 24u);
+inline uint32_t rev32(const uint32_t x) {
+  const uint32_t y = rev16x2(x);
+  return (y >> 16u) | (y << 16u);
 }
 
 inline uint32_t pack32(const uint32_t a, const uint32_t b) {
@@ -1295,9 +730,14 @@ inline uint32_t ftour8x4(const uint32_t a, const uint32_t b) {
 }
 }  // namespace
 
-cpu_simple_t::cpu_simple_t(ram_t& ram, perf_symbols_t& perf_symbols) : cpu_t(ram, perf_symbols) {
+cpu_simple_t::cpu_simple_t(ram_t& ram,
+                           perf_symbols_t& perf_symbols,
+                           const uint32_t core_id,
+                           const bool configure)
+    : cpu_t(ram, perf_symbols, core_id, configure) {
+  // Only the first core drives the MC1 clock counter.
   const uint32_t MMIO_START = 0xc0000000u;
-  const auto has_mc1_mmio_regs = m_ram.valid_range(MMIO_START, 64);
+  const auto has_mc1_mmio_regs = (core_id == 0u) && m_ram.valid_range(MMIO_START, 64);
   m_mc1_mmio = has_mc1_mmio_regs ? reinterpret_cast<uint32_t*>(&m_ram.at(MMIO_START)) : nullptr;
 }
 
@@ -1343,6 +783,16 @@ uint32_t cpu_simple_t::xchgsr(uint32_t a, uint32_t b, bool a_is_z_reg) {
       result = LOG2_NUM_VECTOR_ELEMENTS;
       break;
 
+    case 0x00000020u:
+      // CORE_ID (ID of this CPU core, starting at zero).
+      result = m_core_id;
+      break;
+
+    case 0x00000021u:
+      // NUM_CORES (Number of CPU cores in the system).
+      result = config_t::instance().num_cores();
+      break;
+
     default:
       break;
   }
@@ -1350,7 +800,13 @@ uint32_t cpu_simple_t::xchgsr(uint32_t a, uint32_t b, bool a_is_z_reg) {
   // 2) Write system register (optional).
   if (!a_is_z_reg) {
     switch (b) {
-        // TODO(m): There are currently no writable system registers.
+      case 0x00000022u:
+        // CORE_START (Start the secondary cores at the given address, write-only). Only the first
+        // core can start the other cores.
+        if (m_core_id == 0u && m_core_start_callback) {
+          m_core_start_callback(a);
+        }
+        break;
 
       default:
         break;
@@ -1370,7 +826,7 @@ void cpu_simple_t::update_mc1_clkcnt() {
 }
 
 uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles) {
-  begin_simulation();
+  begin_simulation(max_cycles);
 
   m_syscalls.clear();
   m_regs[REG_PC] = start_addr;
@@ -1378,13 +834,49 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
   m_vector_loop_count = 0u;
   m_total_cycle_count = 0u;
 
+  // Initialize the pipeline state.
+  if (m_pipeline != nullptr) {
+    m_pipeline->reset();
+  }
+
+  return run_loop();
+}
+
+uint32_t cpu_simple_t::resume() {
+  return run_loop();
+}
+
+uint32_t cpu_simple_t::run_loop() {
+  // The timing modes are separate instantiations of the run loop, so that the functional (untimed)
+  // simulation does not pay for the timing models.
+  // Likewise, the instrumentation hooks (e.g. cache simulation) are only present in the
+  // instrumented instantiations.
+  const bool instrumented = instrumentation_enabled();
+  if (m_pipeline != nullptr) {
+    return instrumented ? run_impl<timing_t::PIPELINE, true>()
+                        : run_impl<timing_t::PIPELINE, false>();
+  } else if (m_timing_enabled) {
+    return instrumented ? run_impl<timing_t::LATENCY, true>()
+                        : run_impl<timing_t::LATENCY, false>();
+  }
+  return instrumented ? run_impl<timing_t::NONE, true>() : run_impl<timing_t::NONE, false>();
+}
+
+template <cpu_simple_t::timing_t TIMING, bool INSTRUMENTED>
+uint32_t cpu_simple_t::run_impl() {
   // Initialize the pipeline state.
   vector_state_t vector = vector_state_t();
   decode_t decode = decode_t();
 
+  // Register slot numbering for the pipeline model: Scalar registers followed by vector elements.
+  const auto reg_slot = [](const reg_id_t& reg, const uint32_t idx) {
+    return reg.is_vector ? (NUM_REGS + reg.no * NUM_VECTOR_ELEMENTS + idx) : reg.no;
+  };
+
   try {
     while (!m_syscalls.terminate() && !m_terminate_requested) {
       uint32_t next_pc;
+      uint32_t mem_stall_cycles = 0u;
       debug_trace_t trace;
 
       // Simulator routine call handling.
@@ -1392,18 +884,56 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
       if ((m_regs[REG_PC] & 0xffff0000u) == 0xffff0000u) {
         // Call the routine.
         const uint32_t routine_no = (m_regs[REG_PC] - 0xffff0000u) >> 2u;
-        m_syscalls.call(routine_no, m_regs);
+        if (INSTRUMENTED && m_history) {
+          // System calls can not be re-executed.
+          m_history->barrier();
+        }
+        if (INSTRUMENTED && m_verifier) {
+          m_verifier->syscall(*this, routine_no);
+        } else {
+          m_syscalls.call(routine_no, m_regs);
+        }
 
         // Simulate jmp lr.
         m_regs[REG_PC] = m_regs[REG_LR];
       }
 
+      // Execution history snapshots.
+      if (INSTRUMENTED && m_history && m_fetched_instr_count >= m_history->next_snapshot()) {
+        m_history->take_snapshot(*this);
+      }
+
+      // Debugger stops (breakpoints, single-stepping, watchpoints and interrupts).
+      if (INSTRUMENTED && m_gdb_stub &&
+          m_gdb_stub->should_stop(m_regs[REG_PC], m_fetched_instr_count) &&
+          !m_syscalls.terminate() && !m_gdb_stub->stop(*this)) {
+        break;
+      }
+
       // IF/ID
       {
         // Read the instruction from the current PC.
+        // Note: The instruction is counted before the fetch, so that the instruction count is the
+        // same for all faults (the execution history relies on this).
         const uint32_t pc = m_regs[REG_PC];
-        const uint32_t iword = m_ram.load32(pc);
         ++m_fetched_instr_count;
+        const uint32_t iword = m_ram.load32(pc);
+        bool fetch_reaches_memory = true;
+        if (INSTRUMENTED && m_icache) {
+          const auto result = m_icache->read(pc);
+          if (result.miss) {
+            m_perf_symbols.add_icache_miss(pc);
+          }
+          mem_stall_cycles = result.cycles;
+          fetch_reaches_memory = result.reaches_memory;
+        }
+        if (INSTRUMENTED && m_memory_regions) {
+          mem_stall_cycles += m_memory_regions->fetch(pc, fetch_reaches_memory);
+        }
+        if (INSTRUMENTED && m_heap_profiler && m_heap_profiler->is_hook(pc)) {
+          m_heap_profiler->hook(
+              pc, m_regs[1], m_regs[2], m_regs[REG_LR], m_regs[REG_SP], m_total_cycle_count);
+        }
 
         // Detect encoding class (A, B, C, D or E).
         const bool op_class_B = ((iword & 0xfc00007cu) == 0x0000007cu);
@@ -1437,9 +967,9 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
         const bool is_subroutine_branch = ((iword & 0xfc000000u) == 0xc4000000u);
         const bool is_branch = is_bcc || is_j;
 
+        bool branch_taken = false;
         if (is_bcc) {
           // b[cc]: Evaluate condition (for b[cc]).
-          bool branch_taken = false;
           const uint32_t branch_condition_value = m_regs[reg1];
           const uint32_t condition = (iword >> 18u) & 0x00000007u;
           switch (condition) {
@@ -1475,6 +1005,7 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
           // j/jl
           const uint32_t base_address = (reg1 == 31 ? pc : m_regs[reg1]);
           next_pc = base_address + imm21;
+          branch_taken = true;
 
           // JL implicitly writes to LR (we do it here instead of putting it through the EX+WB
           // machinery).
@@ -1486,6 +1017,43 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
           next_pc = pc + 4u;
         }
 
+        // Stack profiling (function calls and returns).
+        if (INSTRUMENTED && is_j && m_stack_profiler) {
+          m_stack_profiler->jump(next_pc, pc + 4u, is_subroutine_branch, m_regs[REG_SP]);
+        }
+        if (INSTRUMENTED && is_j && m_watchpoints) {
+          m_watchpoints->jump(next_pc, pc, is_subroutine_branch);
+        }
+        if (INSTRUMENTED && is_j && m_heap_profiler) {
+          m_heap_profiler->jump(next_pc, pc, is_subroutine_branch);
+        }
+
+        // Loop profiling (backward conditional branches, and branches that leave loops).
+        if (INSTRUMENTED && m_loop_profiler) {
+          if (branch_taken && !is_subroutine_branch) {
+            m_loop_profiler->jump(pc, next_pc);
+          }
+          if (is_bcc && (pc + imm18) < pc) {
+            m_loop_profiler->back_edge(pc, pc + imm18, branch_taken, m_total_cycle_count);
+          }
+        }
+
+        // Branch prediction.
+        bool is_mispredicted = false;
+        if (INSTRUMENTED && is_branch && m_branch_predictor) {
+          is_mispredicted = m_branch_predictor->predict(pc,
+                                                        is_bcc ? (pc + imm18) : next_pc,
+                                                        branch_taken,
+                                                        is_bcc,
+                                                        is_j && (reg1 != 31u));
+        } else if (TIMING == timing_t::PIPELINE && is_branch) {
+          is_mispredicted = m_pipeline->predict_branch(pc,
+                                                       is_bcc ? (pc + imm18) : next_pc,
+                                                       branch_taken,
+                                                       is_bcc,
+                                                       is_j && (reg1 != 31u));
+        }
+
         // == DECODE ==
 
         // Is this a mem load/store operation?
@@ -1587,6 +1155,18 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
         decode.packed_mode = packed_mode;
         decode.mem_op = mem_op;
 
+        if (TIMING != timing_t::NONE) {
+          decode.latency = m_latency_model.latency(ex_op, packed_mode, mem_op);
+          decode.interval = m_latency_model.interval(ex_op, packed_mode, mem_op);
+        }
+        if (TIMING == timing_t::PIPELINE) {
+          decode.src_a_used = reg2_is_src;
+          decode.src_b_used = reg3_is_src;
+          decode.src_c_used = reg1_is_src;
+          decode.is_load = is_mem_load && (mem_op != MEM_OP_LDEA);
+          decode.is_mispredicted = is_mispredicted;
+        }
+
         // Vector operation parameters.
 
         // == VECTOR STATE INITIALIZATION ==
@@ -1613,8 +1193,24 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
       // The vector loop.
       const auto num_vector_loops = vector.is_vector_op ? vector.vector_len : 1;
       for (uint32_t vec_idx = 0u; vec_idx < num_vector_loops; ++vec_idx) {
-        // Perf stats.
-        m_perf_symbols.add_ref(m_regs[REG_PC]);
+        // Number of cycles for this element.
+        uint32_t cycles = 1u;
+        if (TIMING == timing_t::LATENCY) {
+          cycles = (vec_idx == 0u) ? decode.latency : decode.interval;
+        } else if (TIMING == timing_t::PIPELINE) {
+          const auto idx_a = vector.folding ? (vector.vector_len + vec_idx) : vec_idx;
+          pipeline_t::op_t op;
+          op.src[0] = decode.src_a_used ? reg_slot(decode.src_reg_a, idx_a) : pipeline_t::NO_SLOT;
+          op.src[1] = decode.src_b_used ? reg_slot(decode.src_reg_b, vec_idx) : pipeline_t::NO_SLOT;
+          op.src[2] = decode.src_c_used ? reg_slot(decode.src_reg_c, vec_idx) : pipeline_t::NO_SLOT;
+          op.dst = (decode.dst_reg.no != REG_Z) ? reg_slot(decode.dst_reg, vec_idx)
+                                                : pipeline_t::NO_SLOT;
+          op.latency = decode.latency;
+          op.interval = decode.interval;
+          op.is_load = decode.is_load;
+          op.is_mispredicted = decode.is_mispredicted;
+          cycles = m_pipeline->issue(op);
+        }
 
         // RF
 
@@ -1644,6 +1240,9 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
           trace.src_a = src_a;
           trace.src_b = src_b;
           trace.src_c = src_c;
+          if (TIMING == timing_t::PIPELINE) {
+            append_debug_trace_bubbles(trace.pc, cycles - 1u);
+          }
           append_debug_trace(trace);
         }
 
@@ -1742,11 +1341,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_SEQ:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = set8x4(src_a, src_b, [](uint8_t a, uint8_t b) { return a == b; });
+                    ex_result = seq8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result =
-                        set16x2(src_a, src_b, [](uint16_t a, uint16_t b) { return a == b; });
+                    ex_result = seq16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = set32(src_a, src_b, [](uint32_t a, uint32_t b) { return a == b; });
@@ -1755,11 +1353,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_SNE:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = set8x4(src_a, src_b, [](uint8_t a, uint8_t b) { return a != b; });
+                    ex_result = sne8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result =
-                        set16x2(src_a, src_b, [](uint16_t a, uint16_t b) { return a != b; });
+                    ex_result = sne16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = set32(src_a, src_b, [](uint32_t a, uint32_t b) { return a != b; });
@@ -1768,14 +1365,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_SLT:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = set8x4(src_a, src_b, [](uint8_t a, uint8_t b) {
-                      return static_cast<int8_t>(a) < static_cast<int8_t>(b);
-                    });
+                    ex_result = slt8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result = set16x2(src_a, src_b, [](uint16_t a, uint16_t b) {
-                      return static_cast<int16_t>(a) < static_cast<int16_t>(b);
-                    });
+                    ex_result = slt16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = set32(src_a, src_b, [](uint32_t a, uint32_t b) {
@@ -1786,10 +1379,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_SLTU:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = set8x4(src_a, src_b, [](uint8_t a, uint8_t b) { return a < b; });
+                    ex_result = sltu8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result = set16x2(src_a, src_b, [](uint16_t a, uint16_t b) { return a < b; });
+                    ex_result = sltu16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = set32(src_a, src_b, [](uint32_t a, uint32_t b) { return a < b; });
@@ -1798,14 +1391,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_SLE:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = set8x4(src_a, src_b, [](uint8_t a, uint8_t b) {
-                      return static_cast<int8_t>(a) <= static_cast<int8_t>(b);
-                    });
+                    ex_result = sle8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result = set16x2(src_a, src_b, [](uint16_t a, uint16_t b) {
-                      return static_cast<int16_t>(a) <= static_cast<int16_t>(b);
-                    });
+                    ex_result = sle16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = set32(src_a, src_b, [](uint32_t a, uint32_t b) {
@@ -1816,11 +1405,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_SLEU:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = set8x4(src_a, src_b, [](uint8_t a, uint8_t b) { return a <= b; });
+                    ex_result = sleu8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result =
-                        set16x2(src_a, src_b, [](uint16_t a, uint16_t b) { return a <= b; });
+                    ex_result = sleu16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = set32(src_a, src_b, [](uint32_t a, uint32_t b) { return a <= b; });
@@ -1829,15 +1417,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_MIN:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = sel32(src_a, src_b, set8x4(src_a, src_b, [](uint8_t x, uint8_t y) {
-                                        return static_cast<int8_t>(x) < static_cast<int8_t>(y);
-                                      }));
+                    ex_result = min8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result =
-                        sel32(src_a, src_b, set16x2(src_a, src_b, [](uint16_t x, uint16_t y) {
-                                return static_cast<int16_t>(x) < static_cast<int16_t>(y);
-                              }));
+                    ex_result = min16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = sel32(src_a, src_b, set32(src_a, src_b, [](uint32_t x, uint32_t y) {
@@ -1848,15 +1431,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_MAX:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = sel32(src_a, src_b, set8x4(src_a, src_b, [](uint8_t x, uint8_t y) {
-                                        return static_cast<int8_t>(x) > static_cast<int8_t>(y);
-                                      }));
+                    ex_result = max8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result =
-                        sel32(src_a, src_b, set16x2(src_a, src_b, [](uint16_t x, uint16_t y) {
-                                return static_cast<int16_t>(x) > static_cast<int16_t>(y);
-                              }));
+                    ex_result = max16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = sel32(src_a, src_b, set32(src_a, src_b, [](uint32_t x, uint32_t y) {
@@ -1867,15 +1445,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_MINU:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = sel32(src_a, src_b, set8x4(src_a, src_b, [](uint8_t x, uint8_t y) {
-                                        return x < y;
-                                      }));
+                    ex_result = minu8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result =
-                        sel32(src_a, src_b, set16x2(src_a, src_b, [](uint16_t x, uint16_t y) {
-                                return x < y;
-                              }));
+                    ex_result = minu16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = sel32(src_a, src_b, set32(src_a, src_b, [](uint32_t x, uint32_t y) {
@@ -1886,15 +1459,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_MAXU:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = sel32(src_a, src_b, set8x4(src_a, src_b, [](uint8_t x, uint8_t y) {
-                                        return x > y;
-                                      }));
+                    ex_result = maxu8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result =
-                        sel32(src_a, src_b, set16x2(src_a, src_b, [](uint16_t x, uint16_t y) {
-                                return x > y;
-                              }));
+                    ex_result = maxu16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = sel32(src_a, src_b, set32(src_a, src_b, [](uint32_t x, uint32_t y) {
@@ -2081,12 +1649,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_ADDS:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = saturating_op_8x4(
-                        src_a, src_b, [](int16_t x, int16_t y) -> int16_t { return x + y; });
+                    ex_result = adds8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result = saturating_op_16x2(
-                        src_a, src_b, [](int32_t x, int32_t y) -> int32_t { return x + y; });
+                    ex_result = adds16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = saturating_op_32(
@@ -2096,12 +1662,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_ADDSU:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = saturating_op_u8x4(
-                        src_a, src_b, [](uint16_t x, uint16_t y) -> uint16_t { return x + y; });
+                    ex_result = addsu8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result = saturating_op_u16x2(
-                        src_a, src_b, [](uint32_t x, uint32_t y) -> uint32_t { return x + y; });
+                    ex_result = addsu16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = saturating_op_u32(
@@ -2111,12 +1675,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_ADDH:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = halving_op_8x4(
-                        src_a, src_b, [](int16_t x, int16_t y) -> int16_t { return x + y; });
+                    ex_result = addh8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result = halving_op_16x2(
-                        src_a, src_b, [](int32_t x, int32_t y) -> int32_t { return x + y; });
+                    ex_result = addh16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = halving_op_32(
@@ -2126,12 +1688,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_ADDHU:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = halving_op_u8x4(
-                        src_a, src_b, [](uint16_t x, uint16_t y) -> uint16_t { return x + y; });
+                    ex_result = addhu8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result = halving_op_u16x2(
-                        src_a, src_b, [](uint32_t x, uint32_t y) -> uint32_t { return x + y; });
+                    ex_result = addhu16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = halving_op_u32(
@@ -2141,12 +1701,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_ADDHR:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = halving_op_8x4(
-                        src_a, src_b, [](int16_t x, int16_t y) -> int16_t { return x + y + 1; });
+                    ex_result = addhr8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result = halving_op_16x2(
-                        src_a, src_b, [](int32_t x, int32_t y) -> int32_t { return x + y + 1; });
+                    ex_result = addhr16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = halving_op_32(
@@ -2156,12 +1714,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_ADDHUR:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = halving_op_u8x4(
-                        src_a, src_b, [](uint16_t x, uint16_t y) -> uint16_t { return x + y + 1; });
+                    ex_result = addhur8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result = halving_op_u16x2(
-                        src_a, src_b, [](uint32_t x, uint32_t y) -> uint32_t { return x + y + 1; });
+                    ex_result = addhur16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = halving_op_u32(
@@ -2171,12 +1727,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_SUBS:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = saturating_op_8x4(
-                        src_a, src_b, [](int16_t x, int16_t y) -> int16_t { return x - y; });
+                    ex_result = subs8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result = saturating_op_16x2(
-                        src_a, src_b, [](int32_t x, int32_t y) -> int32_t { return x - y; });
+                    ex_result = subs16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = saturating_op_32(
@@ -2186,12 +1740,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_SUBSU:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = saturating_op_u8x4(
-                        src_a, src_b, [](uint16_t x, uint16_t y) -> uint16_t { return x - y; });
+                    ex_result = subsu8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result = saturating_op_u16x2(
-                        src_a, src_b, [](uint32_t x, uint32_t y) -> uint32_t { return x - y; });
+                    ex_result = subsu16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = saturating_op_u32(
@@ -2201,12 +1753,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_SUBH:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = halving_op_8x4(
-                        src_a, src_b, [](int16_t x, int16_t y) -> int16_t { return x - y; });
+                    ex_result = subh8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result = halving_op_16x2(
-                        src_a, src_b, [](int32_t x, int32_t y) -> int32_t { return x - y; });
+                    ex_result = subh16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = halving_op_32(
@@ -2216,12 +1766,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_SUBHU:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = halving_op_u8x4(
-                        src_a, src_b, [](uint16_t x, uint16_t y) -> uint16_t { return x - y; });
+                    ex_result = subhu8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result = halving_op_u16x2(
-                        src_a, src_b, [](uint32_t x, uint32_t y) -> uint32_t { return x - y; });
+                    ex_result = subhu16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = halving_op_u32(
@@ -2231,12 +1779,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_SUBHR:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = halving_op_8x4(
-                        src_a, src_b, [](int16_t x, int16_t y) -> int16_t { return x - y + 1; });
+                    ex_result = subhr8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result = halving_op_16x2(
-                        src_a, src_b, [](int32_t x, int32_t y) -> int32_t { return x - y + 1; });
+                    ex_result = subhr16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = halving_op_32(
@@ -2246,12 +1792,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_SUBHUR:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = halving_op_u8x4(
-                        src_a, src_b, [](uint16_t x, uint16_t y) -> uint16_t { return x - y + 1; });
+                    ex_result = subhur8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result = halving_op_u16x2(
-                        src_a, src_b, [](uint32_t x, uint32_t y) -> uint32_t { return x - y + 1; });
+                    ex_result = subhur16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = halving_op_u32(
@@ -2298,14 +1842,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_MULQ:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result = saturating_op_8x4(
-                        src_a, src_b, [](int16_t x, int16_t y) -> int16_t { return (x * y) >> 7; });
+                    ex_result = mulq8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result =
-                        saturating_op_16x2(src_a, src_b, [](int32_t x, int32_t y) -> int32_t {
-                          return (x * y) >> 15;
-                        });
+                    ex_result = mulq16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = saturating_op_32(src_a, src_b, [](int64_t x, int64_t y) -> int64_t {
@@ -2316,16 +1856,10 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               case EX_OP_MULQR:
                 switch (decode.packed_mode) {
                   case PACKED_BYTE:
-                    ex_result =
-                        saturating_op_8x4(src_a, src_b, [](int16_t x, int16_t y) -> int16_t {
-                          return (x * y + (1 << 6)) >> 7;
-                        });
+                    ex_result = mulqr8x4(src_a, src_b);
                     break;
                   case PACKED_HALF_WORD:
-                    ex_result =
-                        saturating_op_16x2(src_a, src_b, [](int32_t x, int32_t y) -> int32_t {
-                          return (x * y + (1 << 14)) >> 15;
-                        });
+                    ex_result = mulqr16x2(src_a, src_b);
                     break;
                   default:
                     ex_result = saturating_op_32(src_a, src_b, [](int64_t x, int64_t y) -> int64_t {
@@ -2676,7 +2210,8 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
                 ex_result = 0U;
                 break;
               case EX_OP_SYNC:
-                // Not much to do here.
+                // Make memory operations visible to other cores (that run in other host threads).
+                std::atomic_thread_fence(std::memory_order_seq_cst);
                 ex_result = 0U;
                 break;
               case EX_OP_CCTRL:
@@ -2712,6 +2247,27 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
             }
           }
 
+          // Watchpoints (checked before the access, to get the old value of stores).
+          if (INSTRUMENTED && m_watchpoints && decode.mem_op != MEM_OP_NONE &&
+              decode.mem_op != MEM_OP_LDEA && m_watchpoints->is_watched_page(ex_result)) {
+            m_watchpoints->access(m_regs[REG_PC],
+                                  ex_result,
+                                  1u << ((decode.mem_op & 3u) - 1u),
+                                  decode.mem_op >= MEM_OP_STORE8,
+                                  src_c,
+                                  m_total_cycle_count);
+          }
+          if (INSTRUMENTED && m_gdb_stub && decode.mem_op != MEM_OP_NONE &&
+              decode.mem_op != MEM_OP_LDEA && m_gdb_stub->is_watched_page(ex_result)) {
+            m_gdb_stub->data_access(ex_result,
+                                    1u << ((decode.mem_op & 3u) - 1u),
+                                    decode.mem_op >= MEM_OP_STORE8,
+                                    m_fetched_instr_count - 1u);
+          }
+          if (INSTRUMENTED && m_history && decode.mem_op >= MEM_OP_STORE8) {
+            m_history->store(ex_result);
+          }
+
           // MEM
           uint32_t mem_result = 0u;
           switch (decode.mem_op) {
@@ -2743,6 +2299,35 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               m_ram.store32(ex_result, src_c);
               break;
           }
+          if (INSTRUMENTED && decode.mem_op != MEM_OP_NONE && decode.mem_op != MEM_OP_LDEA) {
+            const bool is_store = (decode.mem_op >= MEM_OP_STORE8);
+            // The two lowest bits of the memory operation give the access size (1, 2 or 4).
+            const uint32_t size = 1u << ((decode.mem_op & 3u) - 1u);
+            bool reaches_memory = true;
+            if (m_dcache) {
+              const auto result = is_store ? m_dcache->write(ex_result) : m_dcache->read(ex_result);
+              if (result.miss) {
+                m_perf_symbols.add_dcache_miss(m_regs[REG_PC]);
+              }
+              mem_stall_cycles += result.cycles;
+              reaches_memory = result.reaches_memory;
+            }
+            if (m_memory_regions) {
+              mem_stall_cycles +=
+                  m_memory_regions->data_access(ex_result, size, is_store, reaches_memory);
+            }
+            if (m_mem_profiler) {
+              m_mem_profiler->access(m_regs[REG_PC],
+                                     ex_result,
+                                     size,
+                                     is_store,
+                                     vector.is_vector_op,
+                                     m_total_cycle_count);
+            }
+            if (m_verifier && is_store) {
+              log_store(ex_result, src_c, size);
+            }
+          }
 
           // WB
           if (decode.dst_reg.no != REG_Z) {
@@ -2751,6 +2336,9 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
               m_vregs[decode.dst_reg.no][vec_idx] = dst_data;
             } else {
               m_regs[decode.dst_reg.no] = dst_data;
+              if (INSTRUMENTED && decode.dst_reg.no == REG_SP && m_stack_profiler) {
+                m_stack_profiler->set_sp(dst_data);
+              }
             }
           }
         }
@@ -2758,8 +2346,21 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
         // Do vector offset increments in the ID/RF stage.
         vector.addr_offset += vector.stride;
 
-        ++m_total_cycle_count;
-        if (max_cycles >= 0 && static_cast<int64_t>(m_total_cycle_count) >= max_cycles) {
+        // Memory stalls (e.g. cache misses).
+        if (INSTRUMENTED && mem_stall_cycles > 0u) {
+          if (TIMING == timing_t::PIPELINE) {
+            m_pipeline->add_memory_stall(mem_stall_cycles);
+            append_debug_trace_bubbles(m_regs[REG_PC], mem_stall_cycles);
+          }
+          cycles += mem_stall_cycles;
+          mem_stall_cycles = 0u;
+        }
+
+        // Perf stats.
+        m_perf_symbols.add_ref(m_regs[REG_PC], cycles);
+
+        m_total_cycle_count += cycles;
+        if (!check_cycle_events()) {
           m_terminate_requested = true;
           break;
         }
@@ -2771,7 +2372,13 @@ uint32_t cpu_simple_t::run(const uint32_t start_addr, const int64_t max_cycles)
       }
 
       // Update the PC.
+      const bool is_block_end = (next_pc != m_regs[REG_PC] + 4u);
       m_regs[REG_PC] = next_pc;
+
+      // Engine verification (at the end of each basic block).
+      if (INSTRUMENTED && m_verifier && is_block_end) {
+        m_verifier->block_end(*this);
+      }
     }
   } catch (std::exception& e) {
     std::string dump("\n");
@@ -22,20 +22,42 @@
 
 #include "cpu.hpp"
 
+class pipeline_t;
+
 /// @brief A simple implementation of a CPU core.
 ///
-/// This implementation is not pipelined. It executes each instruction in a single CPU cycle.
+/// This implementation is not pipelined. By default it executes each instruction (or vector
+/// element) in a single CPU cycle. When timing is enabled, each instruction is instead charged the
+/// number of cycles given by the latency model (or by the pipeline model, see cpu_pipelined_t).
 class cpu_simple_t : public cpu_t {
 public:
   /// @brief Constructor for cpu_simple_t.
   ///
   /// @param ram The RAM to use for this CPU instance.
   /// @param perf_symbols Performance symbols for profiling.
-  cpu_simple_t(ram_t& ram, perf_symbols_t& perf_symbols);
+  /// @param core_id The core ID (for multi-core simulation).
+  /// @param configure Set up tracing, timing and instrumentation from the configuration (false
+  /// gives a plain functional core, e.g. the reference core for engine verification).
+  cpu_simple_t(ram_t& ram,
+               perf_symbols_t& perf_symbols,
+               const uint32_t core_id = 0u,
+               const bool configure = true);
 
   uint32_t run(uint32_t start_addr, int64_t max_cycles) override;
+  uint32_t resume() override;
+
+protected:
+  // Pipeline timing model (set by derived classes to enable pipelined timing).
+  pipeline_t* m_pipeline = nullptr;
 
 private:
+  enum class timing_t { NONE, LATENCY, PIPELINE };
+
+  uint32_t run_loop();
+
+  template <timing_t TIMING, bool INSTRUMENTED>
+  uint32_t run_impl();
+
   uint32_t xchgsr(uint32_t a, uint32_t b, bool a_is_z_reg);
   void update_mc1_clkcnt();
 
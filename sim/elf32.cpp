@@ -31,6 +31,7 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <vector>
 
 namespace elf32 {
 namespace {
@@ -139,4 +140,56 @@ status_t load(const char* file_name, ram_t& ram, info_t& info) {
   return status_t::OK;
 }
 
+status_t load_symbols(const char* file_name, std::map<std::string, uint32_t>& symbols) {
+  std::ifstream f(file_name, std::fstream::in | std::fstream::binary);
+  if (f.bad()) {
+    return status_t::FILE_NOT_FOUND;
+  }
+
+  // Read elf header.
+  Elf32_Ehdr elf_header;
+  f.read(reinterpret_cast<char*>(&elf_header), sizeof(elf_header));
+  if (f.bad()) {
+    return status_t::READ_ERROR;
+  }
+  if (elf_header.e_ehsize != sizeof(elf_header) ||
+      elf_header.e_shentsize != sizeof(Elf32_Shdr)) {
+    return status_t::HEADER_SIZE_MISMATCH;
+  }
+
+  // Read all section headers.
+  std::vector<Elf32_Shdr> sec_headers(elf_header.e_shnum);
+  f.seekg(elf_header.e_shoff);
+  f.read(reinterpret_cast<char*>(sec_headers.data()), sec_headers.size() * sizeof(Elf32_Shdr));
+  if (!f.good()) {
+    return status_t::READ_ERROR;
+  }
+
+  for (const auto& sec_header : sec_headers) {
+    if (sec_header.sh_type != SHT_SYMTAB || sec_header.sh_link >= sec_headers.size()) {
+      continue;
+    }
+
+    // Read the symbol table and the associated string table.
+    const auto& str_header = sec_headers[sec_header.sh_link];
+    std::vector<Elf32_Sym> syms(sec_header.sh_size / sizeof(Elf32_Sym));
+    std::vector<char> strings(str_header.sh_size + 1u, 0);
+    f.seekg(sec_header.sh_offset);
+    f.read(reinterpret_cast<char*>(syms.data()), syms.size() * sizeof(Elf32_Sym));
+    f.seekg(str_header.sh_offset);
+    f.read(strings.data(), str_header.sh_size);
+    if (!f.good()) {
+      return status_t::READ_ERROR;
+    }
+
+    for (const auto& sym : syms) {
+      if (ELF32_ST_TYPE(sym.st_info) == STT_FUNC && sym.st_name < str_header.sh_size) {
+        symbols[std::string(&strings[sym.st_name])] = sym.st_value;
+      }
+    }
+  }
+
+  return status_t::OK;
+}
+
 }  // namespace elf32
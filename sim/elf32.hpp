@@ -31,6 +31,8 @@
 #include "ram.hpp"
 
 #include <cstdint>
+#include <map>
+#include <string>
 
 namespace elf32 {
 
@@ -54,6 +56,12 @@ enum class status_t {
 /// @return OK or an error code.
 status_t load(const char* file_name, ram_t& ram, info_t& info);
 
+/// @brief Reads the function symbols of an ELF executable.
+/// @param[in] file_name the name of the file that contains the ELF executable.
+/// @param[out] symbols a map from function names to addresses.
+/// @return OK or an error code.
+status_t load_symbols(const char* file_name, std::map<std::string, uint32_t>& symbols);
+
 }  // namespace elf32
 
 #endif  // SIM_ELF32_HPP_
@@ -71,6 +71,7 @@ struct Elf32_Shdr {
 
 // Elf32_Shdr.sh_type
 #define SHT_PROGBITS 1
+#define SHT_SYMTAB 2
 #define SHT_NOBITS 8
 #define SHT_INIT_ARRAY 14
 #define SHT_FINI_ARRAY 15
@@ -78,4 +79,21 @@ struct Elf32_Shdr {
 // Elf32_Shdr.sh_flags
 #define SHF_ALLOC 0x2
 
+//--------------------------------------------------------------------------------------------------
+// Symbol table entry
+//--------------------------------------------------------------------------------------------------
+
+struct Elf32_Sym {
+  uint32_t st_name;
+  uint32_t st_value;
+  uint32_t st_size;
+  uint8_t st_info;
+  uint8_t st_other;
+  uint16_t st_shndx;
+};
+
+// Elf32_Sym.st_info
+#define ELF32_ST_TYPE(i) ((i)&0xf)
+#define STT_FUNC 2
+
 #endif  // SIM_ELF32_DEFS_HPP_
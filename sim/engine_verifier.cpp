@@ -0,0 +1,290 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "engine_verifier.hpp"
+
+#include "cpu_simple.hpp"
+#include "syscalls.hpp"
+
+#include <cstdarg>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+std::string error_message(const std::exception_ptr& error) {
+  if (!error) {
+    return std::string();
+  }
+  try {
+    std::rethrow_exception(error);
+  } catch (std::exception& e) {
+    return e.what();
+  } catch (...) {
+    return "Unknown error";
+  }
+}
+
+// Append a formatted line to the divergence report.
+void add_line(std::string& report, const char* fmt, ...) {
+  char line[256];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(line, sizeof(line), fmt, args);
+  va_end(args);
+  report += line;
+  report += "\n";
+}
+}  // namespace
+
+engine_verifier_t::engine_verifier_t(cpu_t& engine, ram_t& reference_ram) : m_engine(engine) {
+  m_reference.reset(
+      new cpu_simple_t(reference_ram, m_reference_perf_symbols, engine.core_id(), false));
+  m_engine.m_verifier = this;
+  m_reference->m_verifier = this;
+}
+
+engine_verifier_t::~engine_verifier_t() {
+  m_engine.m_verifier = nullptr;
+}
+
+uint32_t engine_verifier_t::run(const uint32_t start_addr, const int64_t max_cycles) {
+  m_barrier.reset(new barrier_t(2u));
+  m_engine_side.finished = false;
+  m_reference_side.finished = false;
+  m_num_blocks = 0u;
+  m_num_syscalls = 0u;
+  m_last_pc = start_addr;
+  m_last_instr_count = 0u;
+  m_diverged = false;
+  m_report.clear();
+
+  // The reference core runs in a separate thread, without a cycle limit (it is stopped when the
+  // verified core stops).
+  std::exception_ptr reference_error;
+  std::thread reference_thread([this, start_addr, &reference_error] {
+    try {
+      m_reference->run(start_addr, -1);
+    } catch (...) {
+      reference_error = std::current_exception();
+    }
+    finish(m_reference_side);
+  });
+
+  std::exception_ptr engine_error;
+  uint32_t exit_code = 1u;
+  try {
+    exit_code = m_engine.run(start_addr, max_cycles);
+  } catch (...) {
+    engine_error = std::current_exception();
+  }
+  finish(m_engine_side);
+  reference_thread.join();
+
+  // Both cores must fail in the same way (e.g. on the same invalid memory access).
+  const auto engine_message = error_message(engine_error);
+  const auto reference_message = error_message(reference_error);
+  if (!m_diverged && engine_message != reference_message) {
+    m_diverged = true;
+    add_line(m_report,
+             "Engine verification failed after %lu blocks (last match at PC 0x%08x, after %lu "
+             "instructions):",
+             static_cast<unsigned long>(m_num_blocks),
+             m_last_pc,
+             static_cast<unsigned long>(m_last_instr_count));
+    add_line(
+        m_report, " Engine error:    %s", engine_message.empty() ? "-" : engine_message.c_str());
+    add_line(m_report,
+             " Reference error: %s",
+             reference_message.empty() ? "-" : reference_message.c_str());
+  }
+
+  if (m_diverged) {
+    m_report.pop_back();  // Drop the trailing newline.
+    throw std::runtime_error(m_report);
+  }
+  if (engine_error) {
+    std::rethrow_exception(engine_error);
+  }
+  return exit_code;
+}
+
+void engine_verifier_t::syscall(cpu_t& cpu, const uint32_t routine_no) {
+  // Only the verified core calls the routine (the reference core takes over the results during
+  // the synchronization). Invalid routines raise the same error in both cores.
+  if (&cpu == &m_engine || routine_no >= static_cast<uint32_t>(syscalls_t::routine_t::LAST_)) {
+    cpu.m_syscalls.call(routine_no, cpu.m_regs);
+  }
+  sync(cpu, event_t::SYSCALL, routine_no);
+}
+
+void engine_verifier_t::print_stats() const {
+  std::cout << "Engine verification:\n";
+  std::cout << " Verified blocks:      " << m_num_blocks << "\n";
+  std::cout << " Verified syscalls:    " << m_num_syscalls << "\n";
+}
+
+void engine_verifier_t::sync(cpu_t& cpu, const event_t event, const uint32_t routine_no) {
+  const bool is_reference = (&cpu == m_reference.get());
+  auto& self = is_reference ? m_reference_side : m_engine_side;
+  const auto& other = is_reference ? m_engine_side : m_reference_side;
+  self.event = event;
+  self.routine_no = routine_no;
+
+  // Wait for the other core.
+  m_barrier->wait();
+  if (other.finished) {
+    // The other core has stopped (e.g. at the cycle limit or due to an error).
+    cpu.terminate();
+    return;
+  }
+
+  // The reference thread checks the state while the verified core waits.
+  if (is_reference) {
+    check();
+  }
+  m_barrier->wait();
+  if (m_diverged) {
+    cpu.terminate();
+  }
+}
+
+void engine_verifier_t::check() {
+  const auto& engine = m_engine;
+  const auto& reference = *m_reference;
+  const bool is_syscall = (m_engine_side.event == event_t::SYSCALL);
+  const bool is_same_event = (m_engine_side.event == m_reference_side.event) &&
+                             (m_engine_side.routine_no == m_reference_side.routine_no);
+
+  // The registers of a syscall event have already been updated by the verified core, but they were
+  // checked at the end of the preceding block (the call to the routine).
+  const bool regs_match = is_syscall || (engine.m_regs == reference.m_regs);
+  const bool vregs_match = (engine.m_vregs == reference.m_vregs);
+  const bool stores_match = (engine.m_store_log_hash == reference.m_store_log_hash) &&
+                            (engine.m_store_log_size == reference.m_store_log_size);
+  const bool instr_count_match = (engine.m_fetched_instr_count == reference.m_fetched_instr_count);
+
+  if (is_same_event && regs_match && vregs_match && stores_match && instr_count_match) {
+    if (is_syscall) {
+      take_over_syscall(m_engine_side.routine_no);
+      ++m_num_syscalls;
+    } else {
+      ++m_num_blocks;
+    }
+    m_last_pc = engine.m_regs[cpu_t::REG_PC];
+    m_last_instr_count = engine.m_fetched_instr_count;
+    return;
+  }
+
+  // Describe the divergence.
+  m_diverged = true;
+  add_line(m_report,
+           "Engine verification failed after %lu blocks (last match at PC 0x%08x, after %lu "
+           "instructions):",
+           static_cast<unsigned long>(m_num_blocks),
+           m_last_pc,
+           static_cast<unsigned long>(m_last_instr_count));
+  add_line(m_report, "                  Engine              Reference");
+  add_line(m_report,
+           " Event:           %-19s %s",
+           describe_event(m_engine_side).c_str(),
+           describe_event(m_reference_side).c_str());
+  add_line(m_report,
+           " Instructions:    %-19lu %lu",
+           static_cast<unsigned long>(engine.m_fetched_instr_count),
+           static_cast<unsigned long>(reference.m_fetched_instr_count));
+  add_line(m_report,
+           " Stores:          %-19lu %lu",
+           static_cast<unsigned long>(engine.m_store_log_size),
+           static_cast<unsigned long>(reference.m_store_log_size));
+  add_line(m_report,
+           " Store log hash:  0x%016lx  0x%016lx",
+           static_cast<unsigned long>(engine.m_store_log_hash),
+           static_cast<unsigned long>(reference.m_store_log_hash));
+  for (uint32_t i = 1u; i < cpu_t::NUM_REGS; ++i) {
+    if (i == cpu_t::REG_PC || engine.m_regs[i] != reference.m_regs[i]) {
+      const auto name = (i == cpu_t::REG_PC) ? std::string("PC:") : "R" + std::to_string(i) + ":";
+      add_line(m_report,
+               " %-16s 0x%08x          0x%08x",
+               name.c_str(),
+               engine.m_regs[i],
+               reference.m_regs[i]);
+    }
+  }
+  for (uint32_t i = 0u; i < cpu_t::NUM_VECTOR_REGS; ++i) {
+    for (uint32_t k = 0u; k < cpu_t::NUM_VECTOR_ELEMENTS; ++k) {
+      if (engine.m_vregs[i][k] != reference.m_vregs[i][k]) {
+        char name[16];
+        snprintf(name, sizeof(name), "V%u[%u]:", i, k);
+        add_line(m_report,
+                 " %-16s 0x%08x          0x%08x",
+                 name,
+                 engine.m_vregs[i][k],
+                 reference.m_vregs[i][k]);
+      }
+    }
+  }
+}
+
+std::string engine_verifier_t::describe_event(const side_t& side) {
+  if (side.event == event_t::SYSCALL) {
+    return "syscall " + std::to_string(side.routine_no);
+  }
+  return "block end";
+}
+
+void engine_verifier_t::take_over_syscall(const uint32_t routine_no) {
+  auto& reference = *m_reference;
+  switch (static_cast<syscalls_t::routine_t>(routine_no)) {
+    case syscalls_t::routine_t::EXIT:
+    case syscalls_t::routine_t::FSTAT:
+    case syscalls_t::routine_t::STAT:
+    case syscalls_t::routine_t::GETARGUMENTS:
+      // These routines only read host state, but they update the guest state (the exit status or
+      // memory), so the reference core calls them too.
+      reference.m_syscalls.call(routine_no, reference.m_regs);
+      return;
+
+    case syscalls_t::routine_t::READ: {
+      // Copy the data that was read to the reference RAM.
+      const auto addr = reference.m_regs[2];
+      const auto count = static_cast<int32_t>(m_engine.m_regs[1]);
+      for (int32_t i = 0; i < count; ++i) {
+        const auto byte_addr = addr + static_cast<uint32_t>(i);
+        reference.m_ram.store8(byte_addr, m_engine.m_ram.load8(byte_addr));
+      }
+    } break;
+
+    default:
+      break;
+  }
+
+  // Take over the return values.
+  reference.m_regs[1] = m_engine.m_regs[1];
+  reference.m_regs[2] = m_engine.m_regs[2];
+}
+
+void engine_verifier_t::finish(side_t& side) {
+  // Do not keep the other core waiting for us.
+  side.finished = true;
+  m_barrier->leave();
+}
@@ -0,0 +1,108 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_ENGINE_VERIFIER_HPP_
+#define SIM_ENGINE_VERIFIER_HPP_
+
+#include "barrier.hpp"
+#include "cpu.hpp"
+#include "perf_symbols.hpp"
+#include "ram.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/// @brief Differential lock-step verification of a CPU core against a reference core.
+///
+/// The reference is a plain functional cpu_simple_t (without timing models and instrumentation)
+/// with a RAM of its own, which must be initialized exactly like the RAM of the verified core. The
+/// two cores run in separate host threads and meet at the end of every basic block (i.e. after
+/// each taken branch or jump), where the scalar registers, the vector registers and the hashed logs
+/// of all memory stores of the two cores are compared. The verification stops at the first
+/// divergence.
+///
+/// Only the verified core performs the simulator syscalls (so that no I/O is duplicated), and the
+/// reference core takes over the results.
+///
+/// Note: Programs that read the cycle counter (CLKCNT) or the video frame counter can diverge
+/// legitimately when timing or simulated vertical blanking is enabled, since the reference core
+/// does not model time.
+class engine_verifier_t {
+public:
+  /// @brief Constructor.
+  /// @param engine The CPU core to verify.
+  /// @param reference_ram The RAM for the reference core.
+  engine_verifier_t(cpu_t& engine, ram_t& reference_ram);
+  ~engine_verifier_t();
+
+  /// @brief Run the verified core and the reference core until the program exits.
+  /// @param start_addr The program start address.
+  /// @param max_cycles The maximum number of cycles to simulate (-1 = no limit).
+  /// @returns The program return code (from the verified core).
+  /// @throws std::runtime_error if the cores diverge (with a description of the divergence).
+  uint32_t run(const uint32_t start_addr, const int64_t max_cycles);
+
+  /// @brief Synchronize the cores at the end of a basic block (called from the CPU threads).
+  /// @param cpu The calling core.
+  void block_end(cpu_t& cpu) {
+    sync(cpu, event_t::BLOCK_END, 0u);
+  }
+
+  /// @brief Call a simulator routine (called from the CPU threads instead of syscalls_t::call).
+  /// @param cpu The calling core.
+  /// @param routine_no Syscall routine ID.
+  void syscall(cpu_t& cpu, const uint32_t routine_no);
+
+  /// @brief Print the verification statistics.
+  void print_stats() const;
+
+private:
+  enum class event_t { BLOCK_END, SYSCALL };
+
+  struct side_t {
+    event_t event;
+    uint32_t routine_no;
+    std::atomic_bool finished;
+  };
+
+  void sync(cpu_t& cpu, const event_t event, const uint32_t routine_no);
+  void check();
+  static std::string describe_event(const side_t& side);
+  void take_over_syscall(const uint32_t routine_no);
+  void finish(side_t& side);
+
+  cpu_t& m_engine;
+  perf_symbols_t m_reference_perf_symbols;
+  std::unique_ptr<cpu_t> m_reference;
+  std::unique_ptr<barrier_t> m_barrier;
+  side_t m_engine_side;
+  side_t m_reference_side;
+
+  // Verification state (only accessed by the reference thread while the cores are synchronized).
+  uint64_t m_num_blocks = 0u;
+  uint64_t m_num_syscalls = 0u;
+  uint32_t m_last_pc = 0u;
+  uint64_t m_last_instr_count = 0u;
+  bool m_diverged = false;
+  std::string m_report;
+};
+
+#endif  // SIM_ENGINE_VERIFIER_HPP_
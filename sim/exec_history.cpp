@@ -0,0 +1,223 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "exec_history.hpp"
+
+#include "mmio.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+// Maximum number of page buffers to keep for reuse.
+const std::size_t MAX_FREE_BUFFERS = 1024u;
+
+uint64_t parse_number(const std::string& key, const std::string& value) {
+  std::size_t pos = 0;
+  unsigned long long result = 0u;
+  try {
+    result = std::stoull(value, &pos, 0);
+  } catch (...) {
+    pos = 0;
+  }
+  if (pos == 0 || pos != value.size() || result == 0u) {
+    throw std::runtime_error("Invalid execution history " + key + ": " + value);
+  }
+  return static_cast<uint64_t>(result);
+}
+}  // namespace
+
+exec_history_t::params_t exec_history_t::parse_params(const std::string& spec) {
+  params_t params;
+  if (spec == "default") {
+    return params;
+  }
+  std::istringstream ss(spec);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.empty()) {
+      continue;
+    }
+    const auto eq_pos = item.find('=');
+    if (eq_pos == std::string::npos) {
+      throw std::runtime_error("Invalid execution history parameter (expected key=value): " + item);
+    }
+    const auto key = item.substr(0, eq_pos);
+    const auto value = item.substr(eq_pos + 1);
+    if (key == "interval") {
+      params.interval = parse_number(key, value);
+    } else if (key == "count") {
+      const auto count = parse_number(key, value);
+      if (count > 0x10000u) {
+        throw std::runtime_error("Invalid execution history " + key + ": " + value);
+      }
+      params.count = static_cast<uint32_t>(count);
+    } else {
+      throw std::runtime_error("Unknown execution history parameter: " + key);
+    }
+  }
+  return params;
+}
+
+exec_history_t::exec_history_t(const params_t& params, ram_t& ram)
+    : m_params(params), m_ram(ram), m_saved_pages(1u << (32u - LOG2_PAGE_SIZE), 0u) {
+}
+
+void exec_history_t::reset() {
+  barrier();
+  m_num_snapshots = 0u;
+  m_num_saved_pages = 0u;
+  m_num_barriers = 0u;
+  m_num_restores = 0u;
+}
+
+void exec_history_t::take_snapshot(const cpu_t& cpu) {
+  // The saved page flags only apply to the latest snapshot.
+  if (!m_snapshots.empty()) {
+    for (const auto& page : m_snapshots.back().pages) {
+      m_saved_pages[page.page_no] = 0u;
+    }
+  }
+
+  // Drop the oldest snapshot when the ring is full.
+  if (m_snapshots.size() >= m_params.count) {
+    release_pages(m_snapshots.front());
+    m_snapshots.pop_front();
+  }
+
+  m_snapshots.emplace_back();
+  auto& snapshot = m_snapshots.back();
+  snapshot.position = cpu.m_fetched_instr_count;
+  snapshot.vector_loop_count = cpu.m_vector_loop_count;
+  snapshot.cycle = cpu.m_total_cycle_count;
+  snapshot.next_vblank_cycle = cpu.m_next_vblank_cycle;
+  snapshot.next_gdb_poll_cycle = cpu.m_next_gdb_poll_cycle;
+  snapshot.frame_no = cpu.m_frame_no;
+  snapshot.regs = cpu.m_regs;
+  snapshot.vregs = cpu.m_vregs;
+  m_next_snapshot = snapshot.position + m_params.interval;
+  ++m_num_snapshots;
+
+  // The MC1 clock counter and frame number registers are written without going through the store
+  // hook, so the MMIO page is always saved.
+  if (m_ram.valid_range(MMIO_START, 64u)) {
+    save_page(MMIO_START >> LOG2_PAGE_SIZE);
+  }
+}
+
+void exec_history_t::barrier() {
+  if (!m_snapshots.empty()) {
+    for (const auto& page : m_snapshots.back().pages) {
+      m_saved_pages[page.page_no] = 0u;
+    }
+  }
+  for (auto& snapshot : m_snapshots) {
+    release_pages(snapshot);
+  }
+  m_snapshots.clear();
+  m_next_snapshot = 0u;
+  ++m_num_barriers;
+}
+
+uint64_t exec_history_t::restore(cpu_t& cpu, const uint64_t position) {
+  // Write back the saved pages, newest first.
+  while (true) {
+    auto& snapshot = m_snapshots.back();
+    for (const auto& page : snapshot.pages) {
+      const auto addr = page.page_no << LOG2_PAGE_SIZE;
+      std::memcpy(&m_ram.at(addr), page.data.data(), page.data.size());
+      m_saved_pages[page.page_no] = 0u;
+    }
+    release_pages(snapshot);
+    if (snapshot.position <= position || m_snapshots.size() == 1u) {
+      break;
+    }
+    m_snapshots.pop_back();
+  }
+
+  const auto& snapshot = m_snapshots.back();
+  cpu.m_fetched_instr_count = snapshot.position;
+  cpu.m_vector_loop_count = snapshot.vector_loop_count;
+  cpu.m_total_cycle_count = snapshot.cycle;
+  cpu.m_next_vblank_cycle = snapshot.next_vblank_cycle;
+  cpu.m_next_gdb_poll_cycle = snapshot.next_gdb_poll_cycle;
+  cpu.m_frame_no = snapshot.frame_no;
+  cpu.m_regs = snapshot.regs;
+  cpu.m_vregs = snapshot.vregs;
+
+  // Recalculate the next cycle event.
+  cpu.m_next_event_cycle = 0u;
+
+  m_next_snapshot = snapshot.position + m_params.interval;
+  ++m_num_restores;
+
+  // Keep the MMIO page of the restored snapshot.
+  if (m_ram.valid_range(MMIO_START, 64u)) {
+    save_page(MMIO_START >> LOG2_PAGE_SIZE);
+  }
+
+  return snapshot.position;
+}
+
+void exec_history_t::print_stats() const {
+  std::size_t num_pages = 0u;
+  for (const auto& snapshot : m_snapshots) {
+    num_pages += snapshot.pages.size();
+  }
+  std::cout << "Execution history:\n";
+  std::cout << " Snapshots:   " << m_num_snapshots << " (every " << m_params.interval
+            << " instructions)\n";
+  std::cout << " Saved pages: " << m_num_saved_pages << "\n";
+  std::cout << " Barriers:    " << m_num_barriers << " (system calls)\n";
+  std::cout << " Restores:    " << m_num_restores << "\n";
+  std::cout << " Kept:        " << m_snapshots.size() << " of " << m_params.count << " snapshots ("
+            << (num_pages * PAGE_SIZE) / 1024u << " KiB of saved pages)\n";
+}
+
+void exec_history_t::save_page(const uint32_t page) {
+  const auto start = static_cast<uint64_t>(page) << LOG2_PAGE_SIZE;
+  if (m_snapshots.empty() || start >= m_ram.size()) {
+    // Nothing to restore to, or an invalid address (the store will fail).
+    return;
+  }
+  const auto size = static_cast<std::size_t>(std::min<uint64_t>(PAGE_SIZE, m_ram.size() - start));
+  const auto* src = &m_ram.at(static_cast<uint32_t>(start));
+
+  std::vector<uint8_t> data;
+  if (!m_free_buffers.empty()) {
+    data = std::move(m_free_buffers.back());
+    m_free_buffers.pop_back();
+  }
+  data.assign(src, src + size);
+  m_snapshots.back().pages.push_back(page_t{page, std::move(data)});
+  m_saved_pages[page] = 1u;
+  ++m_num_saved_pages;
+}
+
+void exec_history_t::release_pages(snapshot_t& snapshot) {
+  for (auto& page : snapshot.pages) {
+    if (m_free_buffers.size() < MAX_FREE_BUFFERS) {
+      m_free_buffers.push_back(std::move(page.data));
+    }
+  }
+  snapshot.pages.clear();
+}
@@ -0,0 +1,157 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_EXEC_HISTORY_HPP_
+#define SIM_EXEC_HISTORY_HPP_
+
+#include "cpu.hpp"
+#include "ram.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+/// @brief Execution history, for reverse execution.
+///
+/// Snapshots of a core are taken at a fixed instruction interval and kept in a bounded ring (the
+/// oldest snapshot is dropped when the ring is full). A snapshot only holds the registers and the
+/// run state. Memory is copy-on-write: The first store to a page after a snapshot saves the old
+/// page contents in that snapshot, so restoring a snapshot writes back the saved pages of all
+/// later snapshots (newest first).
+///
+/// Since the simulation is deterministic, any earlier instruction in the history can be reached by
+/// restoring the closest snapshot before it and executing forward. System calls have side effects
+/// outside of the simulated machine (e.g. file I/O), and can not be re-executed, so each system
+/// call clears the history and starts a new one.
+///
+/// The store hook is a flag table lookup (only present in the instrumented run loop), and a page
+/// is copied at most once per snapshot interval.
+class exec_history_t {
+public:
+  /// @brief Execution history configuration.
+  struct params_t {
+    uint64_t interval = 100000u;  ///< Number of instructions between snapshots.
+    uint32_t count = 64u;         ///< Maximum number of snapshots.
+  };
+
+  /// @brief Parse an execution history specification string.
+  ///
+  /// The specification is a comma separated list of key=value pairs, where the keys are: interval
+  /// (instructions between snapshots) and count (maximum number of snapshots). The string
+  /// "default" gives the default configuration.
+  /// @throws std::runtime_error if the specification is invalid.
+  static params_t parse_params(const std::string& spec);
+
+  /// @brief Constructor.
+  exec_history_t(const params_t& params, ram_t& ram);
+
+  /// @brief Clear the history and the statistics.
+  void reset();
+
+  /// @brief Get the instruction count at which the next snapshot is due.
+  uint64_t next_snapshot() const {
+    return m_next_snapshot;
+  }
+
+  /// @brief Take a snapshot of the core (before the next instruction).
+  void take_snapshot(const cpu_t& cpu);
+
+  /// @brief Clear the history (e.g. at a system call). The next snapshot is due immediately.
+  void barrier();
+
+  /// @brief Record a memory store (before it is performed).
+  /// @param addr The data address.
+  void store(const uint32_t addr) {
+    const auto page = addr >> LOG2_PAGE_SIZE;
+    if (m_saved_pages[page] == 0u) {
+      save_page(page);
+    }
+  }
+
+  /// @brief Check if the history is empty.
+  bool empty() const {
+    return m_snapshots.empty();
+  }
+
+  /// @brief Get the instruction count of the oldest snapshot (the history must not be empty).
+  uint64_t first_position() const {
+    return m_snapshots.front().position;
+  }
+
+  /// @brief Restore the latest snapshot at (or before) an instruction count.
+  ///
+  /// All later snapshots are dropped. If the instruction count is before the oldest snapshot, the
+  /// oldest snapshot is restored. The history must not be empty.
+  /// @param cpu The core.
+  /// @param position The instruction count.
+  /// @returns the instruction count of the restored snapshot.
+  uint64_t restore(cpu_t& cpu, const uint64_t position);
+
+  /// @brief Print the execution history statistics.
+  void print_stats() const;
+
+private:
+  static const uint32_t LOG2_PAGE_SIZE = 12u;
+  static const uint32_t PAGE_SIZE = 1u << LOG2_PAGE_SIZE;
+
+  using regs_t = decltype(cpu_t::m_regs);
+  using vregs_t = decltype(cpu_t::m_vregs);
+
+  // The old contents of a page.
+  struct page_t {
+    uint32_t page_no;
+    std::vector<uint8_t> data;
+  };
+
+  struct snapshot_t {
+    uint64_t position;  // Fetched instruction count.
+    uint64_t vector_loop_count;
+    uint64_t cycle;
+    uint64_t next_vblank_cycle;
+    uint64_t next_gdb_poll_cycle;
+    uint32_t frame_no;
+    regs_t regs;
+    vregs_t vregs;
+    std::vector<page_t> pages;  // Pages stored to after this snapshot.
+  };
+
+  void save_page(const uint32_t page);
+  void release_pages(snapshot_t& snapshot);
+
+  const params_t m_params;
+  ram_t& m_ram;
+
+  std::deque<snapshot_t> m_snapshots;
+  uint64_t m_next_snapshot = 0u;
+
+  // Per-page flags: The page has been saved in the latest snapshot.
+  std::vector<uint8_t> m_saved_pages;
+
+  // Page buffers that can be reused.
+  std::vector<std::vector<uint8_t>> m_free_buffers;
+
+  // Statistics.
+  uint64_t m_num_snapshots = 0u;
+  uint64_t m_num_saved_pages = 0u;
+  uint64_t m_num_barriers = 0u;
+  uint64_t m_num_restores = 0u;
+};
+
+#endif  // SIM_EXEC_HISTORY_HPP_
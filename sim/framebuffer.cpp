@@ -0,0 +1,289 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "framebuffer.hpp"
+
+#include "config.hpp"
+#include "hash.hpp"
+#include "mmio.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __x86_64__
+#include <emmintrin.h>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif  // __SSSE3__
+#endif  // __x86_64__
+
+namespace {
+const uint32_t PALETTE_SIZE = 256u * 4u;
+
+uint32_t mem32_or_default(ram_t& ram, const uint32_t addr, const uint32_t default_value) {
+  // Note: The MMIO registers are not available if the RAM is too small.
+  const auto value = ram.valid_range(addr, 4u) ? ram.load32(addr) : 0u;
+  return (value == 0u) ? default_value : value;
+}
+
+uint32_t make_rgbx(const uint8_t r, const uint8_t g, const uint8_t b) {
+  // The RGBX words are stored with R in the first byte, regardless of host endianity.
+  const uint8_t bytes[4] = {r, g, b, 0u};
+  uint32_t rgbx;
+  std::memcpy(&rgbx, &bytes[0], sizeof(rgbx));
+  return rgbx;
+}
+
+// Expand a 5-bit color component to 8 bits the same way as OpenGL normalizes
+// GL_UNSIGNED_SHORT_1_5_5_5_REV texels, i.e. round(x * 255 / 31) (exact for x in [0, 31]).
+uint8_t expand_5_to_8(const uint32_t x) {
+  return static_cast<uint8_t>((x * 527u + 23u) >> 6);
+}
+
+void convert_rgb555_row(const uint8_t* src, uint32_t* dst, const uint32_t width) {
+  uint32_t x = 0u;
+#ifdef __x86_64__
+  // Convert eight pixels at a time.
+  const __m128i mask5 = _mm_set1_epi16(0x1f);
+  const __m128i scale = _mm_set1_epi16(527);
+  const __m128i bias = _mm_set1_epi16(23);
+  for (; x + 8u <= width; x += 8u) {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[x * 2u]));
+    __m128i r = _mm_and_si128(v, mask5);
+    __m128i g = _mm_and_si128(_mm_srli_epi16(v, 5), mask5);
+    __m128i b = _mm_and_si128(_mm_srli_epi16(v, 10), mask5);
+    r = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(r, scale), bias), 6);
+    g = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(g, scale), bias), 6);
+    b = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(b, scale), bias), 6);
+    const __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&dst[x]), _mm_unpacklo_epi16(rg, b));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&dst[x + 4u]), _mm_unpackhi_epi16(rg, b));
+  }
+#endif  // __x86_64__
+  for (; x < width; ++x) {
+    const uint32_t v =
+        static_cast<uint32_t>(src[x * 2u]) | (static_cast<uint32_t>(src[x * 2u + 1u]) << 8);
+    dst[x] = make_rgbx(expand_5_to_8(v & 0x1fu),
+                       expand_5_to_8((v >> 5) & 0x1fu),
+                       expand_5_to_8((v >> 10) & 0x1fu));
+  }
+}
+
+void pack_rgbx_row(const uint8_t* src, uint8_t* dst, const uint32_t width) {
+  uint32_t x = 0u;
+#if defined(__x86_64__) && defined(__SSSE3__)
+  // Pack 16 pixels (64 bytes) into 48 bytes at a time.
+  const __m128i shuf = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  for (; x + 16u <= width; x += 16u) {
+    const auto* s = reinterpret_cast<const __m128i*>(&src[x * 4u]);
+    auto* d = reinterpret_cast<__m128i*>(&dst[x * 3u]);
+    const __m128i p0 = _mm_shuffle_epi8(_mm_loadu_si128(&s[0]), shuf);
+    const __m128i p1 = _mm_shuffle_epi8(_mm_loadu_si128(&s[1]), shuf);
+    const __m128i p2 = _mm_shuffle_epi8(_mm_loadu_si128(&s[2]), shuf);
+    const __m128i p3 = _mm_shuffle_epi8(_mm_loadu_si128(&s[3]), shuf);
+    _mm_storeu_si128(&d[0], _mm_or_si128(p0, _mm_slli_si128(p1, 12)));
+    _mm_storeu_si128(&d[1], _mm_or_si128(_mm_srli_si128(p1, 4), _mm_slli_si128(p2, 8)));
+    _mm_storeu_si128(&d[2], _mm_or_si128(_mm_srli_si128(p2, 8), _mm_slli_si128(p3, 4)));
+  }
+#endif  // __x86_64__ && __SSSE3__
+  for (; x < width; ++x) {
+    dst[x * 3u + 0u] = src[x * 4u + 0u];
+    dst[x * 3u + 1u] = src[x * 4u + 1u];
+    dst[x * 3u + 2u] = src[x * 4u + 2u];
+  }
+}
+}  // namespace
+
+fb_mode_t read_fb_mode(ram_t& ram) {
+  fb_mode_t mode;
+  mode.addr = mem32_or_default(ram, MMIO_GPU_ADDR, config_t::instance().gfx_addr());
+  mode.pal_addr = mem32_or_default(ram, MMIO_GPU_PAL_ADDR, config_t::instance().gfx_pal_addr());
+  mode.width = mem32_or_default(ram, MMIO_GPU_WIDTH, config_t::instance().gfx_width());
+  mode.height = mem32_or_default(ram, MMIO_GPU_HEIGHT, config_t::instance().gfx_height());
+  mode.depth = mem32_or_default(ram, MMIO_GPU_DEPTH, config_t::instance().gfx_depth());
+  return mode;
+}
+
+framebuffer_t::framebuffer_t(ram_t& ram) : m_ram(ram) {
+  m_pal_lut.resize(256u);
+}
+
+void framebuffer_t::configure() {
+  const auto mode = read_fb_mode(m_ram);
+  switch (mode.depth) {
+    case 32u:
+    case 16u:
+    case 8u:
+    case 4u:
+    case 2u:
+    case 1u:
+      break;
+    default:
+      throw std::runtime_error("Invalid pixel format.");
+  }
+  const auto bytes_per_row = (static_cast<uint64_t>(mode.width) * mode.depth + 7u) / 8u;
+  const auto fb_size = bytes_per_row * static_cast<uint64_t>(mode.height);
+  if (fb_size > 0xffffffffu || !m_ram.valid_range(mode.addr, static_cast<uint32_t>(fb_size))) {
+    throw std::runtime_error("Invalid gfx RAM configuration (does not fit in CPU RAM).");
+  }
+
+  // The palette lookup tables depend on the pixel depth.
+  if (mode.depth != m_mode.depth) {
+    m_pal_valid = false;
+  }
+
+  m_mode = mode;
+  m_bytes_per_row = static_cast<uint32_t>(bytes_per_row);
+  m_row.resize(m_mode.width);
+}
+
+void framebuffer_t::update_palette() {
+  // A palette that lies outside of the CPU RAM is treated as undefined (all zeros).
+  static const uint8_t s_zero_palette[PALETTE_SIZE] = {};
+  const auto* palette = m_ram.valid_range(m_mode.pal_addr, PALETTE_SIZE)
+                            ? &m_ram.at(m_mode.pal_addr)
+                            : &s_zero_palette[0];
+
+  // Only rebuild the lookup tables when the palette has changed.
+  if (m_pal_valid && std::memcmp(m_pal_shadow.data(), palette, PALETTE_SIZE) == 0) {
+    return;
+  }
+  m_pal_shadow.assign(palette, palette + PALETTE_SIZE);
+  m_pal_valid = true;
+
+  bool defined_palette = false;
+  for (auto x : m_pal_shadow) {
+    if (x != 0) {
+      defined_palette = true;
+      break;
+    }
+  }
+
+  if (defined_palette) {
+    for (uint32_t i = 0u; i < 256u; ++i) {
+      m_pal_lut[i] = make_rgbx(palette[i * 4u], palette[i * 4u + 1u], palette[i * 4u + 2u]);
+    }
+  } else {
+    // Use a default grayscale palette (same as gpu_t), scaled so that the highest pixel value is
+    // white (255).
+    const auto scale = m_mode.depth >= 8u ? 1u : (255u / ((1u << m_mode.depth) - 1u));
+    for (uint32_t i = 0u; i < 256u; ++i) {
+      const auto gray = static_cast<uint8_t>(i * scale);
+      m_pal_lut[i] = make_rgbx(gray, gray, gray);
+    }
+  }
+
+  // Expand the palette to a byte -> pixels table for packed pixel formats.
+  if (m_mode.depth < 8u) {
+    const auto bits = m_mode.depth;
+    const auto pixels_per_byte = 8u / bits;
+    const auto mask = (1u << bits) - 1u;
+    m_packed_lut.resize(256u * pixels_per_byte);
+    for (uint32_t byte = 0u; byte < 256u; ++byte) {
+      for (uint32_t i = 0u; i < pixels_per_byte; ++i) {
+        m_packed_lut[byte * pixels_per_byte + i] = m_pal_lut[(byte >> (i * bits)) & mask];
+      }
+    }
+  }
+}
+
+void framebuffer_t::convert_row(const uint8_t* src, uint8_t* dst_rgbx) {
+  auto* dst = reinterpret_cast<uint32_t*>(dst_rgbx);
+  const auto width = m_mode.width;
+  switch (m_mode.depth) {
+    case 16u:
+      convert_rgb555_row(src, dst, width);
+      break;
+
+    case 8u:
+      for (uint32_t x = 0u; x < width; ++x) {
+        dst[x] = m_pal_lut[src[x]];
+      }
+      break;
+
+    case 4u:
+    case 2u:
+    case 1u: {
+      // Packed pixels are stored with the first pixel in the least significant bits.
+      const auto pixels_per_byte = 8u / m_mode.depth;
+      const auto full_bytes = width / pixels_per_byte;
+      for (uint32_t i = 0u; i < full_bytes; ++i) {
+        std::memcpy(&dst[i * pixels_per_byte],
+                    &m_packed_lut[src[i] * pixels_per_byte],
+                    pixels_per_byte * sizeof(uint32_t));
+      }
+      const auto remaining = width - full_bytes * pixels_per_byte;
+      if (remaining > 0u) {
+        std::memcpy(&dst[full_bytes * pixels_per_byte],
+                    &m_packed_lut[src[full_bytes] * pixels_per_byte],
+                    remaining * sizeof(uint32_t));
+      }
+      break;
+    }
+
+    default:
+      break;
+  }
+}
+
+void framebuffer_t::convert_to_rgb(std::vector<uint8_t>& rgb) {
+  const auto width = m_mode.width;
+  const auto height = m_mode.height;
+  rgb.resize(static_cast<size_t>(width) * static_cast<size_t>(height) * 3u);
+  if (rgb.empty()) {
+    return;
+  }
+
+  if (m_mode.depth <= 8u) {
+    update_palette();
+  }
+
+  const auto* src = &m_ram.at(m_mode.addr);
+  auto* dst = rgb.data();
+  for (uint32_t y = 0u; y < height; ++y) {
+    if (m_mode.depth == 32u) {
+      // 32-bit pixels are already in RGBX byte order.
+      pack_rgbx_row(src, dst, width);
+    } else {
+      auto* row = reinterpret_cast<uint8_t*>(m_row.data());
+      convert_row(src, row);
+      pack_rgbx_row(row, dst, width);
+    }
+    src += m_bytes_per_row;
+    dst += static_cast<size_t>(width) * 3u;
+  }
+}
+
+uint64_t framebuffer_t::hash() {
+  // Hash the video mode as little endian words, to get the same hash on all hosts.
+  const uint32_t mode_words[3] = {m_mode.width, m_mode.height, m_mode.depth};
+  uint8_t mode[12];
+  for (int i = 0; i < 12; ++i) {
+    mode[i] = static_cast<uint8_t>(mode_words[i / 4] >> (8 * (i % 4)));
+  }
+  auto h = hash64(&mode[0], sizeof(mode));
+  const auto fb_size = static_cast<size_t>(m_bytes_per_row) * m_mode.height;
+  if (fb_size > 0u) {
+    h = hash64(&m_ram.at(m_mode.addr), fb_size, h);
+  }
+  if (m_mode.depth <= 8u && m_ram.valid_range(m_mode.pal_addr, PALETTE_SIZE)) {
+    h = hash64(&m_ram.at(m_mode.pal_addr), PALETTE_SIZE, h);
+  }
+  return h;
+}
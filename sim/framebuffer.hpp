@@ -0,0 +1,99 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_FRAMEBUFFER_HPP_
+#define SIM_FRAMEBUFFER_HPP_
+
+#include "ram.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/// @brief Framebuffer video mode, as defined by the GPU MMIO registers.
+struct fb_mode_t {
+  uint32_t addr;
+  uint32_t pal_addr;
+  uint32_t width;
+  uint32_t height;
+  uint32_t depth;
+};
+
+/// @brief Read the current video mode from the GPU MMIO registers.
+///
+/// Registers that have not been set (i.e. that are zero) are replaced by the corresponding
+/// configuration defaults.
+fb_mode_t read_fb_mode(ram_t& ram);
+
+/// @brief Software framebuffer converter.
+///
+/// This interprets the framebuffer in the same way as gpu_t, but all pixel format conversions are
+/// done on the host CPU, so no OpenGL context is required.
+class framebuffer_t {
+public:
+  framebuffer_t(ram_t& ram);
+
+  /// @brief Configure the framebuffer.
+  ///
+  /// This method should be called each frame, before calling @c convert_to_rgb(). An exception is
+  /// thrown if the video mode is not valid.
+  void configure();
+
+  /// @brief Convert the framebuffer to 24-bit RGB pixels.
+  /// @param rgb The target buffer (resized to width * height * 3 bytes).
+  void convert_to_rgb(std::vector<uint8_t>& rgb);
+
+  /// @brief Calculate a 64-bit hash of the framebuffer.
+  ///
+  /// The hash covers the video mode, the framebuffer memory and (for palettized modes) the palette
+  /// memory, so that any change to the displayed image changes the hash.
+  uint64_t hash();
+
+  uint32_t width() const {
+    return m_mode.width;
+  }
+
+  uint32_t height() const {
+    return m_mode.height;
+  }
+
+  uint32_t depth() const {
+    return m_mode.depth;
+  }
+
+private:
+  void update_palette();
+  void convert_row(const uint8_t* src, uint8_t* dst_rgbx);
+
+  ram_t& m_ram;
+
+  fb_mode_t m_mode = fb_mode_t();
+  uint32_t m_bytes_per_row = 0u;
+
+  // Palette lookup tables (RGBX words). For packed pixel formats, the packed LUT maps each byte to
+  // all the pixels that it contains.
+  std::vector<uint8_t> m_pal_shadow;
+  bool m_pal_valid = false;
+  std::vector<uint32_t> m_pal_lut;
+  std::vector<uint32_t> m_packed_lut;
+
+  // Intermediate RGBX row buffer.
+  std::vector<uint32_t> m_row;
+};
+
+#endif  // SIM_FRAMEBUFFER_HPP_
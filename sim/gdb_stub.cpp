@@ -0,0 +1,851 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "gdb_stub.hpp"
+
+#include "exec_history.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+// Register numbers: Z, R1-R31 (including TP, FP, SP, LR and VL) and PC.
+const uint32_t NUM_GDB_REGS = 33u;
+
+const char* const HEX_DIGITS = "0123456789abcdef";
+
+std::string to_hex(const uint8_t* data, const std::size_t size) {
+  std::string result;
+  for (std::size_t i = 0u; i < size; ++i) {
+    result += HEX_DIGITS[data[i] >> 4];
+    result += HEX_DIGITS[data[i] & 15u];
+  }
+  return result;
+}
+
+// Registers are sent in target (little endian) byte order.
+std::string reg_to_hex(const uint32_t x) {
+  const uint8_t bytes[4] = {static_cast<uint8_t>(x),
+                            static_cast<uint8_t>(x >> 8),
+                            static_cast<uint8_t>(x >> 16),
+                            static_cast<uint8_t>(x >> 24)};
+  return to_hex(&bytes[0], sizeof(bytes));
+}
+
+int hex_value(const char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  } else if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  } else if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// Parse a hex number, and advance pos to the first character after the number.
+bool parse_hex(const std::string& str, std::size_t& pos, uint32_t& value) {
+  const auto start = pos;
+  value = 0u;
+  while (pos < str.size() && hex_value(str[pos]) >= 0) {
+    value = (value << 4) | static_cast<uint32_t>(hex_value(str[pos]));
+    ++pos;
+  }
+  return pos > start;
+}
+
+bool hex_to_reg(const std::string& str, const std::size_t pos, uint32_t& value) {
+  if (pos + 8u > str.size()) {
+    return false;
+  }
+  value = 0u;
+  for (std::size_t i = 0u; i < 4u; ++i) {
+    const auto hi = hex_value(str[pos + 2u * i]);
+    const auto lo = hex_value(str[pos + 2u * i + 1u]);
+    if (hi < 0 || lo < 0) {
+      return false;
+    }
+    value |= static_cast<uint32_t>((hi << 4) | lo) << (8u * i);
+  }
+  return true;
+}
+
+std::string target_xml() {
+  static const char* const REG_NAMES[NUM_GDB_REGS] = {
+      "z",   "r1",  "r2",  "r3",  "r4",  "r5",  "r6",  "r7",  "r8",  "r9",  "r10",
+      "r11", "r12", "r13", "r14", "r15", "r16", "r17", "r18", "r19", "r20", "r21",
+      "r22", "r23", "r24", "r25", "r26", "tp",  "fp",  "sp",  "lr",  "vl",  "pc"};
+  std::string xml =
+      "<?xml version=\"1.0\"?>\n"
+      "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">\n"
+      "<target version=\"1.0\">\n"
+      "  <feature name=\"org.gnu.gdb.mrisc32.cpu\">\n";
+  for (uint32_t i = 0u; i < NUM_GDB_REGS; ++i) {
+    const char* type = "uint32";
+    if (i == 27u || i == 28u || i == 29u) {
+      type = "data_ptr";
+    } else if (i == 30u || i == 32u) {
+      type = "code_ptr";
+    }
+    xml += "    <reg name=\"" + std::string(REG_NAMES[i]) +
+           "\" bitsize=\"32\" type=\"" + type + "\"/>\n";
+  }
+  xml += "  </feature>\n</target>\n";
+  return xml;
+}
+
+#if !defined(_WIN32)
+bool is_readable(const int fd) {
+  struct pollfd pfd;
+  pfd.fd = fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+  return ::poll(&pfd, 1, 0) > 0;
+}
+#endif
+}  // namespace
+
+gdb_stub_t::gdb_stub_t(const std::string& address)
+    : m_address(address), m_pages(1u << (32u - LOG2_PAGE_SIZE), 0u) {
+#if defined(_WIN32)
+  throw std::runtime_error("The GDB stub is not supported on this platform");
+#else
+  // TCP addresses are given as PORT or [HOST]:PORT (as for gdbserver), anything else is a path.
+  const auto colon = address.rfind(':');
+  const bool is_port =
+      !address.empty() && address.find_first_not_of("0123456789") == std::string::npos;
+  const bool is_tcp =
+      address.find('/') == std::string::npos && (is_port || colon != std::string::npos);
+  if (is_tcp) {
+    const auto host = (colon != std::string::npos) ? address.substr(0u, colon) : std::string();
+    const auto port_str = (colon != std::string::npos) ? address.substr(colon + 1u) : address;
+    if (port_str.empty() || port_str.size() > 5u ||
+        port_str.find_first_not_of("0123456789") != std::string::npos) {
+      throw std::runtime_error("Invalid GDB port: " + address);
+    }
+    const auto port = std::stoul(port_str);
+    if (port == 0u || port > 65535u) {
+      throw std::runtime_error("Invalid GDB port: " + address);
+    }
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (host.empty() || host == "localhost") {
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    } else if (::inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+      throw std::runtime_error("Invalid GDB host (expected an IPv4 address): " + host);
+    }
+    m_listen_fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (m_listen_fd < 0) {
+      throw std::runtime_error("Unable to create a socket");
+    }
+    int one = 1;
+    ::setsockopt(m_listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (::bind(m_listen_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+      ::close(m_listen_fd);
+      throw std::runtime_error("Unable to listen on " + address);
+    }
+  } else {
+    struct sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    if (address.empty() || address.size() >= sizeof(addr.sun_path)) {
+      throw std::runtime_error("Invalid GDB socket path: " + address);
+    }
+
+    // Only replace stale sockets (e.g. from an earlier run), never other files.
+    struct stat st;
+    if (::lstat(address.c_str(), &st) == 0) {
+      if (!S_ISSOCK(st.st_mode)) {
+        throw std::runtime_error("Not a socket (refusing to replace it): " + address);
+      }
+      ::unlink(address.c_str());
+    }
+
+    m_listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_listen_fd < 0) {
+      throw std::runtime_error("Unable to create a socket");
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, address.c_str(), sizeof(addr.sun_path) - 1u);
+    if (::bind(m_listen_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0) {
+      ::close(m_listen_fd);
+      throw std::runtime_error("Unable to create the socket " + address);
+    }
+    m_socket_path = address;
+  }
+  if (::listen(m_listen_fd, 1) != 0) {
+    ::close(m_listen_fd);
+    throw std::runtime_error("Unable to listen on " + address);
+  }
+#endif
+}
+
+gdb_stub_t::~gdb_stub_t() {
+#if !defined(_WIN32)
+  disconnect();
+  if (m_listen_fd >= 0) {
+    ::close(m_listen_fd);
+  }
+  if (!m_socket_path.empty()) {
+    ::unlink(m_socket_path.c_str());
+  }
+#endif
+}
+
+uint32_t gdb_stub_t::run(cpu_t& cpu, const uint32_t start_addr, const int64_t max_cycles) {
+  accept_connection();
+
+  // Stop at the first instruction.
+  m_stop_requested = true;
+  m_stop_reply = "S05";
+  m_running = false;
+  m_replay = replay_t::NONE;
+  m_stop_position = NO_POSITION;
+  m_fast_continue = false;
+  m_switch_loop = false;
+
+  cpu.m_gdb_stub = this;
+  uint32_t exit_code = 0u;
+  bool resume = false;
+  while (true) {
+    try {
+      exit_code = resume ? cpu.resume() : cpu.run(start_addr, max_cycles);
+
+      // Continue in the other run loop, unless the program has exited.
+      if (m_switch_loop && !cpu.m_syscalls.terminate()) {
+        m_switch_loop = false;
+        cpu.m_terminate_requested = false;
+        resume = true;
+        continue;
+      }
+      break;
+    } catch (std::exception& e) {
+      m_fast_continue = false;
+      m_switch_loop = false;
+
+      // Report the error, and let GDB inspect the state before terminating.
+      if (m_fd >= 0) {
+        const auto message = std::string("Simulation error: ") + e.what() + "\n";
+        const auto* data = reinterpret_cast<const uint8_t*>(message.data());
+        write_packet("O" + to_hex(data, message.size()));
+        m_stop_reply = "S0b";
+        m_position = (cpu.m_fetched_instr_count > 0u) ? cpu.m_fetched_instr_count - 1u : 0u;
+        m_restored = false;
+        const bool resumed = serve(cpu);
+
+        // Continue the run if GDB went back in the execution history.
+        if (resumed && m_restored) {
+          resume = true;
+          continue;
+        }
+        if (resumed && m_fd >= 0) {
+          write_packet("X0b");
+        }
+      }
+      disconnect();
+      cpu.m_gdb_stub = nullptr;
+      throw;
+    }
+  }
+  if (m_fd >= 0) {
+    const uint8_t code = static_cast<uint8_t>(exit_code);
+    write_packet("W" + to_hex(&code, 1u));
+  }
+  disconnect();
+  cpu.m_gdb_stub = nullptr;
+  return exit_code;
+}
+
+bool gdb_stub_t::stop(cpu_t& cpu) {
+  const bool is_breakpoint = m_breakpoints.find(cpu.m_regs[cpu_t::REG_PC]) != m_breakpoints.end();
+  if (m_replay != replay_t::NONE) {
+    return replay(cpu, is_breakpoint);
+  }
+  if (!m_stop_requested) {
+    // The page contains a breakpoint, but maybe not at this instruction.
+    if (!is_breakpoint) {
+      return true;
+    }
+    m_stop_reply = "S05";
+  }
+  m_stop_requested = false;
+  m_position = cpu.m_fetched_instr_count;
+  return serve(cpu);
+}
+
+void gdb_stub_t::data_access(const uint32_t addr,
+                             const uint32_t size,
+                             const bool is_store,
+                             const uint64_t position) {
+  if (m_replay == replay_t::STEP) {
+    return;
+  }
+  for (const auto& watchpoint : m_watchpoints) {
+    const bool overlaps = (static_cast<uint64_t>(addr) + size > watchpoint.addr) &&
+                          (addr < static_cast<uint64_t>(watchpoint.addr) + watchpoint.size);
+    if (!overlaps || (watchpoint.type == watch_t::WRITE && !is_store) ||
+        (watchpoint.type == watch_t::READ && is_store)) {
+      continue;
+    }
+    const char* kind = (watchpoint.type == watch_t::WRITE)
+                           ? "watch"
+                           : ((watchpoint.type == watch_t::READ) ? "rwatch" : "awatch");
+    char reply[32];
+    std::snprintf(reply, sizeof(reply), "T05%s:%x;", kind, addr);
+    if (m_replay == replay_t::SCAN) {
+      // Stop before the memory instruction, if this is the last hit.
+      m_hit_position = position;
+      m_hit_reply = reply;
+    } else {
+      m_stop_reply = reply;
+      m_stop_requested = true;
+    }
+    return;
+  }
+}
+
+void gdb_stub_t::poll(cpu_t& cpu) {
+#if !defined(_WIN32)
+  while (m_fd >= 0 && (m_read_pos < m_read_buffer.size() || is_readable(m_fd))) {
+    const int c = read_char();
+    if (c < 0) {
+      disconnect();
+    } else if (c == 0x03) {
+      m_stop_requested = true;
+      m_stop_reply = "S02";
+      if (m_fast_continue) {
+        // Only the instrumented run loop can stop.
+        switch_run_loop(cpu, false);
+      }
+    }
+  }
+#else
+  (void)cpu;
+#endif
+}
+
+void gdb_stub_t::switch_run_loop(cpu_t& cpu, const bool fast) {
+  // The run loop is selected when it is entered (see cpu_simple_t::run_loop()), so leave the
+  // current run loop (like terminate()), and let run() enter the other one.
+  m_fast_continue = fast;
+  m_switch_loop = true;
+  cpu.m_terminate_requested = true;
+}
+
+void gdb_stub_t::accept_connection() {
+#if !defined(_WIN32)
+  std::cout << "Waiting for GDB to connect on " << m_address << "...\n" << std::flush;
+  m_fd = ::accept(m_listen_fd, nullptr, nullptr);
+  if (m_fd < 0) {
+    throw std::runtime_error("Unable to accept a GDB connection");
+  }
+  if (m_socket_path.empty()) {
+    int one = 1;
+    ::setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  }
+  m_no_ack = false;
+  m_read_buffer.clear();
+  m_read_pos = 0u;
+#endif
+}
+
+void gdb_stub_t::disconnect() {
+#if !defined(_WIN32)
+  if (m_fd >= 0) {
+    ::close(m_fd);
+    m_fd = -1;
+  }
+#endif
+
+  // Let the program run freely.
+  m_stop_requested = false;
+  m_replay = replay_t::NONE;
+  m_stop_position = NO_POSITION;
+  m_breakpoints.clear();
+  m_watchpoints.clear();
+  std::fill(m_pages.begin(), m_pages.end(), 0u);
+}
+
+int gdb_stub_t::read_char() {
+#if !defined(_WIN32)
+  if (m_read_pos >= m_read_buffer.size()) {
+    m_read_buffer.resize(4096u);
+    const auto count = ::recv(m_fd, m_read_buffer.data(), m_read_buffer.size(), 0);
+    if (count <= 0) {
+      m_read_buffer.clear();
+      m_read_pos = 0u;
+      return -1;
+    }
+    m_read_buffer.resize(static_cast<std::size_t>(count));
+    m_read_pos = 0u;
+  }
+  return static_cast<uint8_t>(m_read_buffer[m_read_pos++]);
+#else
+  return -1;
+#endif
+}
+
+bool gdb_stub_t::read_packet(std::string& packet) {
+  while (true) {
+    // Skip everything up to the start of the packet (e.g. acks and interrupt requests).
+    int c;
+    do {
+      c = read_char();
+    } while (c >= 0 && c != '$');
+    if (c < 0) {
+      return false;
+    }
+
+    packet.clear();
+    uint8_t checksum = 0u;
+    while ((c = read_char()) >= 0 && c != '#') {
+      checksum += static_cast<uint8_t>(c);
+      if (c == '}') {
+        c = read_char();
+        if (c < 0) {
+          return false;
+        }
+        checksum += static_cast<uint8_t>(c);
+        c ^= 0x20;
+      }
+      packet += static_cast<char>(c);
+    }
+    const int hi = read_char();
+    const int lo = read_char();
+    if (c < 0 || hi < 0 || lo < 0) {
+      return false;
+    }
+    if (m_no_ack) {
+      return true;
+    }
+    const bool ok = (hex_value(static_cast<char>(hi)) << 4 | hex_value(static_cast<char>(lo))) ==
+                    static_cast<int>(checksum);
+#if !defined(_WIN32)
+    const char ack = ok ? '+' : '-';
+    ::send(m_fd, &ack, 1u, 0);
+#endif
+    if (ok) {
+      return true;
+    }
+  }
+}
+
+void gdb_stub_t::write_packet(const std::string& data) {
+#if !defined(_WIN32)
+  std::string packet("$");
+  uint8_t checksum = 0u;
+  for (const auto c : data) {
+    if (c == '$' || c == '#' || c == '}' || c == '*') {
+      packet += '}';
+      checksum += static_cast<uint8_t>('}');
+      packet += static_cast<char>(c ^ 0x20);
+      checksum += static_cast<uint8_t>(c ^ 0x20);
+    } else {
+      packet += c;
+      checksum += static_cast<uint8_t>(c);
+    }
+  }
+  packet += '#';
+  packet += HEX_DIGITS[checksum >> 4];
+  packet += HEX_DIGITS[checksum & 15u];
+
+  while (m_fd >= 0) {
+    if (::send(m_fd, packet.data(), packet.size(), 0) != static_cast<ssize_t>(packet.size())) {
+      disconnect();
+      return;
+    }
+    if (m_no_ack) {
+      return;
+    }
+    int c;
+    do {
+      c = read_char();
+    } while (c >= 0 && c != '+' && c != '-');
+    if (c < 0) {
+      disconnect();
+      return;
+    }
+    if (c == '+') {
+      return;
+    }
+  }
+#else
+  (void)data;
+#endif
+}
+
+bool gdb_stub_t::serve(cpu_t& cpu) {
+  if (m_running) {
+    write_packet(m_stop_reply);
+    m_running = false;
+  }
+
+  std::string packet;
+  while (m_fd >= 0 && read_packet(packet)) {
+    std::string reply;
+    std::size_t pos = 1u;
+    uint32_t value = 0u;
+    switch (packet.empty() ? 0 : packet[0]) {
+      case '?':
+        reply = m_stop_reply;
+        break;
+      case 'g':
+        reply = read_registers(cpu);
+        break;
+      case 'G':
+        for (uint32_t i = 1u; i < NUM_GDB_REGS; ++i) {
+          if (hex_to_reg(packet, 1u + 8u * i, value)) {
+            cpu.m_regs[i] = value;
+          }
+        }
+        reply = "OK";
+        break;
+      case 'p':
+        if (parse_hex(packet, pos, value) && value < NUM_GDB_REGS) {
+          reply = reg_to_hex(cpu.m_regs[value]);
+        } else {
+          reply = "E00";
+        }
+        break;
+      case 'P': {
+        uint32_t reg_value;
+        if (parse_hex(packet, pos, value) && value < NUM_GDB_REGS && pos < packet.size() &&
+            packet[pos] == '=' && hex_to_reg(packet, pos + 1u, reg_value)) {
+          if (value != cpu_t::REG_Z) {
+            cpu.m_regs[value] = reg_value;
+          }
+          reply = "OK";
+        } else {
+          reply = "E00";
+        }
+        break;
+      }
+      case 'm':
+        reply = read_memory(cpu, packet.substr(1));
+        break;
+      case 'M':
+        reply = write_memory(cpu, packet.substr(1));
+        break;
+      case 'c':
+      case 's':
+        // Optionally resume at a new address.
+        if (parse_hex(packet, pos, value)) {
+          cpu.m_regs[cpu_t::REG_PC] = value;
+        }
+        if (packet[0] == 's') {
+          m_stop_requested = true;
+          m_stop_reply = "S05";
+        } else if (m_breakpoints.empty() && m_watchpoints.empty() && m_replay == replay_t::NONE) {
+          // Nothing to stop at, so run at full speed if the core has no other instrumentation.
+          m_fast_continue = true;
+          if (cpu.instrumentation_enabled()) {
+            m_fast_continue = false;
+          } else {
+            switch_run_loop(cpu, true);
+          }
+        }
+        m_running = true;
+        return true;
+      case 'b':
+        // Reverse step (bs) and reverse continue (bc).
+        if (!cpu.m_history || (packet != "bs" && packet != "bc")) {
+          break;
+        }
+        if (packet == "bs" ? reverse_step(cpu) : reverse_continue(cpu, m_position)) {
+          m_running = true;
+          return true;
+        }
+        reply = m_stop_reply;
+        break;
+      case 'k':
+        disconnect();
+        return false;
+      case 'D':
+        write_packet("OK");
+        disconnect();
+        return true;
+      case 'Z':
+      case 'z':
+        reply = set_point(packet.substr(1), packet[0] == 'Z');
+        break;
+      case 'H':
+      case 'T':
+        reply = "OK";
+        break;
+      case 'q':
+        if (packet.compare(0, 10, "qSupported") == 0) {
+          reply = "PacketSize=4000;qXfer:features:read+;QStartNoAckMode+";
+          if (cpu.m_history) {
+            reply += ";ReverseStep+;ReverseContinue+";
+          }
+        } else if (packet == "qAttached") {
+          reply = "1";
+        } else if (packet == "qC") {
+          reply = "QC1";
+        } else if (packet == "qfThreadInfo") {
+          reply = "m1";
+        } else if (packet == "qsThreadInfo") {
+          reply = "l";
+        } else if (packet.compare(0, 31, "qXfer:features:read:target.xml:") == 0) {
+          pos = 31u;
+          uint32_t offset;
+          uint32_t length;
+          if (parse_hex(packet, pos, offset) && pos < packet.size() && packet[pos++] == ',' &&
+              parse_hex(packet, pos, length)) {
+            const auto xml = target_xml();
+            if (offset >= xml.size()) {
+              reply = "l";
+            } else {
+              reply = (offset + length < xml.size() ? "m" : "l") + xml.substr(offset, length);
+            }
+          } else {
+            reply = "E00";
+          }
+        }
+        break;
+      case 'Q':
+        if (packet == "QStartNoAckMode") {
+          write_packet("OK");
+          m_no_ack = true;
+          continue;
+        }
+        break;
+      case 'v':
+        if (packet == "vKill" || packet.compare(0, 6, "vKill;") == 0) {
+          write_packet("OK");
+          disconnect();
+          return false;
+        }
+        break;
+    }
+    write_packet(reply);
+  }
+
+  // The connection was lost: Let the program run freely.
+  disconnect();
+  return true;
+}
+
+bool gdb_stub_t::replay(cpu_t& cpu, const bool is_breakpoint) {
+  if (cpu.m_fetched_instr_count != m_stop_position) {
+    // Not there yet. Record the breakpoint hits when scanning for the last one.
+    if (m_replay == replay_t::SCAN && is_breakpoint) {
+      m_hit_position = cpu.m_fetched_instr_count;
+      m_hit_reply = "S05";
+    }
+    return true;
+  }
+
+  if (m_replay == replay_t::SCAN) {
+    if (m_hit_position == NO_POSITION) {
+      // No hits in this snapshot interval: Scan the previous one.
+      if (reverse_continue(cpu, m_scan_start)) {
+        return true;
+      }
+    } else {
+      // Go to the last hit.
+      m_replay = replay_t::STEP;
+      m_stop_position = m_hit_position;
+      m_stop_reply = m_hit_reply;
+      if (cpu.m_history->restore(cpu, m_hit_position) != m_hit_position) {
+        return true;
+      }
+    }
+  }
+
+  m_replay = replay_t::NONE;
+  m_stop_position = NO_POSITION;
+  m_stop_requested = false;
+  m_position = cpu.m_fetched_instr_count;
+  return serve(cpu);
+}
+
+bool gdb_stub_t::reverse_step(cpu_t& cpu) {
+  auto& history = *cpu.m_history;
+  if (history.empty() || m_position <= history.first_position()) {
+    m_stop_reply = "T05replaylog:begin;";
+    return false;
+  }
+  const auto target = m_position - 1u;
+  m_stop_reply = "S05";
+  m_restored = true;
+  if (history.restore(cpu, target) == target) {
+    m_position = target;
+    return false;
+  }
+  m_replay = replay_t::STEP;
+  m_stop_position = target;
+  return true;
+}
+
+bool gdb_stub_t::reverse_continue(cpu_t& cpu, const uint64_t end) {
+  auto& history = *cpu.m_history;
+  if (history.empty() || end <= history.first_position()) {
+    // Stop at the beginning of the history.
+    if (!history.empty()) {
+      m_position = history.restore(cpu, history.first_position());
+      m_restored = true;
+    }
+    m_replay = replay_t::NONE;
+    m_stop_position = NO_POSITION;
+    m_stop_reply = "T05replaylog:begin;";
+    return false;
+  }
+
+  // Execute the snapshot interval before the end position, and record the hits.
+  m_scan_start = history.restore(cpu, end - 1u);
+  m_restored = true;
+  m_replay = replay_t::SCAN;
+  m_stop_position = end;
+  m_hit_position = NO_POSITION;
+  return true;
+}
+
+std::string gdb_stub_t::read_registers(cpu_t& cpu) {
+  std::string reply;
+  for (uint32_t i = 0u; i < NUM_GDB_REGS; ++i) {
+    reply += reg_to_hex(cpu.m_regs[i]);
+  }
+  return reply;
+}
+
+std::string gdb_stub_t::read_memory(cpu_t& cpu, const std::string& args) {
+  std::size_t pos = 0u;
+  uint32_t addr;
+  uint32_t length;
+  if (!parse_hex(args, pos, addr) || pos >= args.size() || args[pos++] != ',' ||
+      !parse_hex(args, pos, length)) {
+    return "E00";
+  }
+  if (length == 0u || !cpu.m_ram.valid_range(addr, length)) {
+    return "E14";
+  }
+  std::string reply;
+  for (uint32_t i = 0u; i < length; ++i) {
+    const auto byte = static_cast<uint8_t>(cpu.m_ram.load8(addr + i));
+    reply += to_hex(&byte, 1u);
+  }
+  return reply;
+}
+
+std::string gdb_stub_t::write_memory(cpu_t& cpu, const std::string& args) {
+  std::size_t pos = 0u;
+  uint32_t addr;
+  uint32_t length;
+  if (!parse_hex(args, pos, addr) || pos >= args.size() || args[pos++] != ',' ||
+      !parse_hex(args, pos, length) || pos >= args.size() || args[pos++] != ':' ||
+      args.size() - pos != 2u * static_cast<std::size_t>(length)) {
+    return "E00";
+  }
+  if (length > 0u && !cpu.m_ram.valid_range(addr, length)) {
+    return "E14";
+  }
+  for (uint32_t i = 0u; i < length; ++i) {
+    const auto hi = hex_value(args[pos + 2u * i]);
+    const auto lo = hex_value(args[pos + 2u * i + 1u]);
+    if (hi < 0 || lo < 0) {
+      return "E00";
+    }
+    if (cpu.m_history) {
+      cpu.m_history->store(addr + i);
+    }
+    cpu.m_ram.store8(addr + i, static_cast<uint32_t>((hi << 4) | lo));
+  }
+  return "OK";
+}
+
+std::string gdb_stub_t::set_point(const std::string& args, const bool insert) {
+  std::size_t pos = 0u;
+  uint32_t type;
+  uint32_t addr;
+  uint32_t kind;
+  if (!parse_hex(args, pos, type) || pos >= args.size() || args[pos++] != ',' ||
+      !parse_hex(args, pos, addr) || pos >= args.size() || args[pos++] != ',' ||
+      !parse_hex(args, pos, kind)) {
+    return "E00";
+  }
+  if (type > 4u) {
+    // Unsupported type.
+    return "";
+  }
+  uint32_t size = 1u;
+  if (type <= 1u) {
+    // Software and hardware breakpoints are handled the same way.
+    if (insert) {
+      m_breakpoints.insert(addr);
+    } else {
+      m_breakpoints.erase(addr);
+    }
+  } else {
+    size = (kind > 0u) ? kind : 1u;
+    if (static_cast<uint64_t>(addr) + size > 0x100000000ull) {
+      return "E00";
+    }
+    const auto watch_type = static_cast<watch_t>(type);
+    auto it = m_watchpoints.begin();
+    while (it != m_watchpoints.end() &&
+           !(it->type == watch_type && it->addr == addr && it->size == size)) {
+      ++it;
+    }
+    if (insert && it == m_watchpoints.end()) {
+      m_watchpoints.push_back(watchpoint_t{watch_type, addr, size});
+    } else if (!insert && it != m_watchpoints.end()) {
+      m_watchpoints.erase(it);
+    }
+  }
+
+  const auto first_page = addr >> LOG2_PAGE_SIZE;
+  const auto last_page = (addr + (size - 1u)) >> LOG2_PAGE_SIZE;
+  for (auto page = first_page; page <= last_page; ++page) {
+    update_page(page);
+  }
+  return "OK";
+}
+
+void gdb_stub_t::update_page(const uint32_t page) {
+  const auto page_start = static_cast<uint64_t>(page) << LOG2_PAGE_SIZE;
+  const auto page_end = page_start + (1u << LOG2_PAGE_SIZE);
+  uint8_t flags = 0u;
+  const auto it = m_breakpoints.lower_bound(static_cast<uint32_t>(page_start));
+  if (it != m_breakpoints.end() && *it < page_end) {
+    flags |= BREAKPOINT_PAGE;
+  }
+  for (const auto& watchpoint : m_watchpoints) {
+    if (watchpoint.addr < page_end &&
+        static_cast<uint64_t>(watchpoint.addr) + watchpoint.size > page_start) {
+      flags |= WATCHPOINT_PAGE;
+    }
+  }
+  m_pages[page] = flags;
+}
@@ -0,0 +1,180 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_GDB_STUB_HPP_
+#define SIM_GDB_STUB_HPP_
+
+#include "cpu.hpp"
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <vector>
+
+/// @brief A GDB remote serial protocol stub.
+///
+/// The stub listens on a local TCP port or a Unix domain socket, and lets GDB control a single CPU
+/// core: Read and write registers and memory, set breakpoints and watchpoints, single-step,
+/// continue and interrupt (Ctrl-C) the execution. The program is stopped at the first instruction
+/// until GDB resumes it.
+///
+/// Breakpoints and watchpoints mark their pages in a per-page flag table, so the run loop only
+/// pays for a flag and table lookup per instruction (and per memory access). The interrupt
+/// requests from GDB are polled at a fixed cycle interval.
+///
+/// When GDB continues the execution without any breakpoints or watchpoints (and the core has no
+/// other instrumentation), the core switches to the non-instrumented run loop, which runs at full
+/// speed. An interrupt request (Ctrl-C) from the cycle interval poll makes the core switch back to
+/// the instrumented run loop, which stops at the next instruction.
+///
+/// When the execution history is enabled (see exec_history_t), GDB can also step and continue
+/// backwards. An earlier instruction is reached by restoring the closest snapshot before it and
+/// executing forward (without stopping at breakpoints) until the instruction count is reached.
+/// Reverse continue executes one snapshot interval at a time (newest first) and stops at the last
+/// breakpoint or watchpoint hit, or at the beginning of the history.
+class gdb_stub_t {
+public:
+  /// @brief Constructor.
+  /// @param address A TCP address, PORT (on localhost) or HOST:PORT (HOST is an IPv4 address or
+  /// localhost, and may be empty), or a Unix domain socket path (an existing file is only replaced
+  /// if it is a socket).
+  /// @throws std::runtime_error if the socket can not be created.
+  explicit gdb_stub_t(const std::string& address);
+  ~gdb_stub_t();
+
+  /// @brief Wait for GDB to connect, and run the core under GDB control until the program exits.
+  /// @param cpu The CPU core.
+  /// @param start_addr The program start address.
+  /// @param max_cycles The maximum number of cycles to simulate (-1 = no limit).
+  /// @returns The program return code.
+  uint32_t run(cpu_t& cpu, const uint32_t start_addr, const int64_t max_cycles);
+
+  /// @brief Check if the execution may need to stop before the instruction at pc.
+  /// @param pc The instruction address.
+  /// @param position The instruction count (the number of instructions before this one).
+  bool should_stop(const uint32_t pc, const uint64_t position) const {
+    return m_stop_requested || position == m_stop_position ||
+           (m_pages[pc >> LOG2_PAGE_SIZE] & BREAKPOINT_PAGE) != 0u;
+  }
+
+  /// @brief Stop before the current instruction (if requested or at a breakpoint), and serve GDB
+  /// requests until the execution is resumed.
+  /// @param cpu The CPU core.
+  /// @returns false if the program was killed.
+  bool stop(cpu_t& cpu);
+
+  /// @brief Check if an address is in a page that contains a watched address.
+  bool is_watched_page(const uint32_t addr) const {
+    return (m_pages[addr >> LOG2_PAGE_SIZE] & WATCHPOINT_PAGE) != 0u;
+  }
+
+  /// @brief Record a data memory access (stops before the next instruction on a watchpoint hit).
+  /// @param addr The data address.
+  /// @param size The access size (in bytes).
+  /// @param is_store True for stores.
+  /// @param position The instruction count of the memory instruction.
+  void data_access(const uint32_t addr,
+                   const uint32_t size,
+                   const bool is_store,
+                   const uint64_t position);
+
+  /// @brief Check for an interrupt request (Ctrl-C) from GDB.
+  /// @param cpu The CPU core.
+  void poll(cpu_t& cpu);
+
+  /// @brief Check if the core is continuing without debugger hooks (see cpu_t::run_loop()).
+  bool fast_continue() const {
+    return m_fast_continue;
+  }
+
+  /// @brief Number of cycles between interrupt request polls.
+  static const uint64_t POLL_INTERVAL = 100000u;
+
+private:
+  static const uint32_t LOG2_PAGE_SIZE = 12u;
+  static const uint8_t BREAKPOINT_PAGE = 1u;
+  static const uint8_t WATCHPOINT_PAGE = 2u;
+  static const uint64_t NO_POSITION = ~uint64_t(0);
+
+  // Reverse execution modes: Execute forward to the stop position, or scan for the last
+  // breakpoint or watchpoint hit before the stop position.
+  enum class replay_t { NONE, STEP, SCAN };
+
+  // Watchpoint types, as numbered by the Z packets.
+  enum class watch_t { WRITE = 2, READ = 3, ACCESS = 4 };
+
+  struct watchpoint_t {
+    watch_t type;
+    uint32_t addr;
+    uint32_t size;
+  };
+
+  void accept_connection();
+  void disconnect();
+  int read_char();
+  bool read_packet(std::string& packet);
+  void write_packet(const std::string& data);
+  bool serve(cpu_t& cpu);
+  bool replay(cpu_t& cpu, const bool is_breakpoint);
+  bool reverse_step(cpu_t& cpu);
+  bool reverse_continue(cpu_t& cpu, const uint64_t end);
+  std::string read_registers(cpu_t& cpu);
+  std::string read_memory(cpu_t& cpu, const std::string& args);
+  std::string write_memory(cpu_t& cpu, const std::string& args);
+  std::string set_point(const std::string& args, const bool insert);
+  void update_page(const uint32_t page);
+  void switch_run_loop(cpu_t& cpu, const bool fast);
+
+  std::string m_address;
+  std::string m_socket_path;  // Unix domain socket path (empty for TCP).
+  int m_listen_fd = -1;
+  int m_fd = -1;
+  bool m_no_ack = false;
+  std::vector<char> m_read_buffer;
+  std::size_t m_read_pos = 0u;
+
+  // Execution state.
+  bool m_stop_requested = false;
+  bool m_running = false;
+  std::string m_stop_reply;
+  uint64_t m_position = 0u;  // Instruction count of the stopped instruction.
+
+  // Continuing in the non-instrumented run loop (see switch_run_loop()).
+  bool m_fast_continue = false;
+  bool m_switch_loop = false;
+
+  // Reverse execution state.
+  replay_t m_replay = replay_t::NONE;
+  uint64_t m_stop_position = NO_POSITION;
+  uint64_t m_scan_start = 0u;
+  uint64_t m_hit_position = NO_POSITION;
+  std::string m_hit_reply;
+  bool m_restored = false;
+
+  // Breakpoints, watchpoints and the per-page flags.
+  std::set<uint32_t> m_breakpoints;
+  std::vector<watchpoint_t> m_watchpoints;
+  std::vector<uint8_t> m_pages;
+
+  // The stub is non-copyable.
+  gdb_stub_t(const gdb_stub_t&) = delete;
+  gdb_stub_t& operator=(const gdb_stub_t&) = delete;
+};
+
+#endif  // SIM_GDB_STUB_HPP_
@@ -20,21 +20,15 @@
 #include "gpu.hpp"
 
 #include "config.hpp"
+#include "framebuffer.hpp"
+#include "mmio.hpp"
 
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <stdexcept>
 
 namespace {
-// Memory mapped I/O: GPU configuration registers.
-const uint32_t MMIO_GPU_BASE = 0xc0000100u;
-const uint32_t MMIO_GPU_ADDR = MMIO_GPU_BASE + 0u;       // Start of the framebuffer memory area.
-const uint32_t MMIO_GPU_WIDTH = MMIO_GPU_BASE + 4u;      // Width of the framebuffer (in pixels).
-const uint32_t MMIO_GPU_HEIGHT = MMIO_GPU_BASE + 8u;     // Height of the framebuffer (in pixels).
-const uint32_t MMIO_GPU_DEPTH = MMIO_GPU_BASE + 12u;     // Number of bits per pixel.
-const uint32_t MMIO_GPU_FRAME_NO = MMIO_GPU_BASE + 32u;  // Current frame number (32 bits).
-const uint32_t MMIO_GPU_PAL_ADDR = MMIO_GPU_BASE + 36u;  // Start of the palette memory area.
-
 const GLchar* VERTEX_SRC =
     "#version 150\n"
     "in vec2 a_pos;"
@@ -49,13 +43,22 @@ const GLchar* VERTEX_SRC =
 const GLchar* FRAGMENT_SRC =
     "#version 150\n"
     "uniform sampler2DRect u_fb_sampler;"
+    "uniform usampler2DRect u_packed_sampler;"
     "uniform sampler2D u_pal_sampler;"
     "uniform bool u_monochrome;"
+    "uniform int u_packed_bits;"
     "in vec2 v_uv;"
     "out vec3 color;"
     "void main(void)"
     "{"
-    "  if (u_monochrome) {"
+    "  if (u_packed_bits > 0) {"
+    "    int pixels_per_byte = 8 / u_packed_bits;"
+    "    ivec2 pos = ivec2(v_uv);"
+    "    uint byte = texelFetch(u_packed_sampler, ivec2(pos.x / pixels_per_byte, pos.y)).r;"
+    "    int shift = (pos.x % pixels_per_byte) * u_packed_bits;"
+    "    uint idx = (byte >> uint(shift)) & uint((1 << u_packed_bits) - 1);"
+    "    color = texelFetch(u_pal_sampler, ivec2(int(idx), 0), 0).bgr;"
+    "  } else if (u_monochrome) {"
     "    float m = texture(u_fb_sampler, v_uv).r;"
     "    color = texture(u_pal_sampler, vec2(m, 1.0)).bgr;"
     "  } else {"
@@ -133,11 +136,6 @@ gpu_t::gpu_t(ram_t& ram) : m_ram(ram) {
   configure();
 }
 
-uint32_t gpu_t::mem32_or_default(const uint32_t addr, const uint32_t default_value) {
-  const auto value = m_ram.load32(addr);
-  return (value == 0u) ? default_value : value;
-}
-
 void gpu_t::check_gfx_config() {
   const auto video_ram_end = static_cast<uint64_t>(m_gfx_ram_start) +
                              static_cast<uint64_t>(m_width * m_height * m_bits_per_pixel * 8);
@@ -188,8 +186,10 @@ void gpu_t::compile_shader() {
   }
   m_resolution_uniform = glGetUniformLocation(m_program, "u_resolution");
   m_fb_sampler_uniform = glGetUniformLocation(m_program, "u_fb_sampler");
+  m_packed_sampler_uniform = glGetUniformLocation(m_program, "u_packed_sampler");
   m_pal_sampler_uniform = glGetUniformLocation(m_program, "u_pal_sampler");
   m_monochrome_uniform = glGetUniformLocation(m_program, "u_monochrome");
+  m_packed_bits_uniform = glGetUniformLocation(m_program, "u_packed_bits");
   check_gl_error();
 }
 
@@ -218,11 +218,12 @@ void gpu_t::cleanup() {
 
 void gpu_t::configure() {
   // Update framebuffer parameters.
-  m_gfx_ram_start = mem32_or_default(MMIO_GPU_ADDR, config_t::instance().gfx_addr());
-  m_gfx_pal_start = mem32_or_default(MMIO_GPU_PAL_ADDR, config_t::instance().gfx_pal_addr());
-  const auto width = mem32_or_default(MMIO_GPU_WIDTH, config_t::instance().gfx_width());
-  const auto height = mem32_or_default(MMIO_GPU_HEIGHT, config_t::instance().gfx_height());
-  const auto depth = mem32_or_default(MMIO_GPU_DEPTH, config_t::instance().gfx_depth());
+  const auto mode = read_fb_mode(m_ram);
+  m_gfx_ram_start = mode.addr;
+  m_gfx_pal_start = mode.pal_addr;
+  const auto width = mode.width;
+  const auto height = mode.height;
+  const auto depth = mode.depth;
   if (width == m_width && height == m_height && depth == m_depth) {
     // No changes to the video mode, so do not re-create the texture.
     return;
@@ -257,9 +258,10 @@ void gpu_t::configure() {
     case 4u:
     case 2u:
     case 1u:
+      // Packed pixels are uploaded as-is (one texel per byte) and unpacked by the fragment shader.
       m_bits_per_pixel = m_depth;
-      m_tex_internalformat = GL_RED;
-      m_tex_format = GL_RED;
+      m_tex_internalformat = GL_R8UI;
+      m_tex_format = GL_RED_INTEGER;
       m_tex_type = GL_UNSIGNED_BYTE;
       break;
 
@@ -274,22 +276,25 @@ void gpu_t::configure() {
   // Make sure that we can use the current GFX configuration.
   check_gfx_config();
 
-  // Create the framebuffer texture.
+  // Create the framebuffer texture. Packed pixel formats (less than 8 bits per pixel) use an
+  // integer texture, which needs to be bound to a separate texture unit.
   if (m_fb_tex != 0u) {
     glDeleteTextures(1, &m_fb_tex);
   }
+  m_fb_tex_unit = (m_bits_per_pixel < 8u) ? 2 : 0;
+  m_fb_tex_width = (m_bits_per_pixel < 8u) ? ((m_width * m_bits_per_pixel) / 8u) : m_width;
   glGenTextures(1, &m_fb_tex);
-  glActiveTexture(GL_TEXTURE0);
+  glActiveTexture(GL_TEXTURE0 + m_fb_tex_unit);
   glBindTexture(GL_TEXTURE_RECTANGLE, m_fb_tex);
   glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_RECTANGLE, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
   glTexImage2D(GL_TEXTURE_RECTANGLE,
                0,
                m_tex_internalformat,
-               static_cast<GLsizei>(m_width),
+               static_cast<GLsizei>(m_fb_tex_width),
                static_cast<GLsizei>(m_height),
                0,
                m_tex_format,
@@ -324,126 +329,78 @@ void gpu_t::configure() {
       }
     }
   }
-}
 
-void gpu_t::paint(const int actual_fb_width, const int actual_fb_height) {
-  // Set the viewport.
-  glViewport(0, 0, static_cast<GLsizei>(actual_fb_width), static_cast<GLsizei>(actual_fb_height));
+  // The new palette texture is undefined, so force an upload during the next paint().
+  m_pal_uploaded = false;
+}
 
-  // Create a (reusable) conversion buffer if necessary.
-  if (m_bits_per_pixel < 8u) {
-    const auto buf_size = m_width * m_height;
-    if (m_conv_buffer.size() != buf_size) {
-      m_conv_buffer.resize(buf_size);
-    }
+void gpu_t::update_palette() {
+  // Compare the palette memory against the last uploaded copy. This is much cheaper than
+  // re-uploading the palette texture every frame, and the palette rarely changes.
+  const auto* palette_buffer = &m_ram.at(m_gfx_pal_start);
+  const auto pal_size = m_default_palette.size();
+  if (m_pal_uploaded && std::memcmp(m_pal_shadow.data(), palette_buffer, pal_size) == 0) {
+    return;
   }
-
-  // Convert pixel formats from N bpp to 8 bpp when N < 8.
-  // TODO(m): Optimize these routines (or implement the conversion on the GPU instead).
-  const auto* pixel_buffer = &m_ram.at(m_gfx_ram_start);
-  switch (m_bits_per_pixel) {
-    case 1: {
-      // This routine assumes that the width is divisable by 8 (which it ought to be in 1bpp mode).
-      const auto width_div_8 = m_width >> 3;
-      const auto* src = &pixel_buffer[0];
-      auto* dst = &m_conv_buffer[0];
-      for (uint32_t y = 0; y < m_height; ++y) {
-        for (uint32_t x = 0; x < width_div_8; ++x) {
-          const auto byte = *src++;
-          *dst++ = static_cast<uint8_t>(byte & 0x01u);
-          *dst++ = static_cast<uint8_t>((byte >> 1) & 0x01u);
-          *dst++ = static_cast<uint8_t>((byte >> 2) & 0x01u);
-          *dst++ = static_cast<uint8_t>((byte >> 3) & 0x01u);
-          *dst++ = static_cast<uint8_t>((byte >> 4) & 0x01u);
-          *dst++ = static_cast<uint8_t>((byte >> 5) & 0x01u);
-          *dst++ = static_cast<uint8_t>((byte >> 6) & 0x01u);
-          *dst++ = static_cast<uint8_t>(byte >> 7);
-        }
-      }
-      pixel_buffer = &m_conv_buffer[0];
-      break;
-    }
-
-    case 2: {
-      // This routine assumes that the width is divisable by 4 (which it ought to be in 2bpp mode).
-      const auto width_div_4 = m_width >> 2;
-      const auto* src = &pixel_buffer[0];
-      auto* dst = &m_conv_buffer[0];
-      for (uint32_t y = 0; y < m_height; ++y) {
-        for (uint32_t x = 0; x < width_div_4; ++x) {
-          const auto byte = *src++;
-          *dst++ = static_cast<uint8_t>(byte & 0x03u);
-          *dst++ = static_cast<uint8_t>((byte >> 2) & 0x03u);
-          *dst++ = static_cast<uint8_t>((byte >> 4) & 0x03u);
-          *dst++ = static_cast<uint8_t>(byte >> 6);
-        }
-      }
-      pixel_buffer = &m_conv_buffer[0];
+  m_pal_shadow.assign(palette_buffer, palette_buffer + pal_size);
+  m_pal_uploaded = true;
+
+  // An all-zero palette is treated as undefined, in which case the default palette is used. Note:
+  // This only has to be determined when the palette memory has changed.
+  bool defined_palette = false;
+  for (auto x : m_pal_shadow) {
+    if (x != 0) {
+      defined_palette = true;
       break;
     }
+  }
+  if (!defined_palette) {
+    palette_buffer = m_default_palette.data();
+  }
 
-    case 4: {
-      // This routine assumes that the width is divisable by 2 (which it ought to be in 4bpp mode).
-      const auto width_div_2 = m_width >> 1;
-      const auto* src = &pixel_buffer[0];
-      auto* dst = &m_conv_buffer[0];
-      for (uint32_t y = 0; y < m_height; ++y) {
-        for (uint32_t x = 0; x < width_div_2; ++x) {
-          const auto byte = *src++;
-          *dst++ = static_cast<uint8_t>(byte & 0x0fu);
-          *dst++ = static_cast<uint8_t>(byte >> 4);
-        }
-      }
-      pixel_buffer = &m_conv_buffer[0];
-      break;
-    }
+  // Upload the palette buffer to the palette texture.
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, m_pal_tex);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 256, 1, GL_BGRA, GL_UNSIGNED_BYTE, palette_buffer);
+  check_gl_error();
+}
 
-    default:
-      // Should never happen.
-      break;
-  }
+void gpu_t::paint(const int actual_fb_width, const int actual_fb_height) {
+  // Set the viewport.
+  glViewport(0, 0, static_cast<GLsizei>(actual_fb_width), static_cast<GLsizei>(actual_fb_height));
 
-  // Analyze the palette.
-  const auto* palette_buffer = &m_ram.at(m_gfx_pal_start);
-  {
-    bool defined_palette = false;
-    for (int i = 0; i < 256 * 4; ++i) {
-      if (palette_buffer[i] != 0) {
-        defined_palette = true;
-        break;
-      }
-    }
-    if (!defined_palette) {
-      palette_buffer = m_default_palette.data();
-    }
-  }
+  // Note: Packed pixel formats are unpacked by the fragment shader, so the framebuffer memory can
+  // always be uploaded as-is.
+  const auto* pixel_buffer = &m_ram.at(m_gfx_ram_start);
 
   // Upload the frame buffer from ram to the framebuffer texture.
-  glActiveTexture(GL_TEXTURE0);
+  glActiveTexture(GL_TEXTURE0 + m_fb_tex_unit);
   glBindTexture(GL_TEXTURE_RECTANGLE, m_fb_tex);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
   glTexSubImage2D(GL_TEXTURE_RECTANGLE,
                   0,
                   0,
                   0,
-                  static_cast<GLsizei>(m_width),
+                  static_cast<GLsizei>(m_fb_tex_width),
                   static_cast<GLsizei>(m_height),
                   m_tex_format,
                   m_tex_type,
                   pixel_buffer);
   check_gl_error();
 
-  // Upload the palette buffer from ram to the palette texture.
-  glActiveTexture(GL_TEXTURE1);
-  glBindTexture(GL_TEXTURE_2D, m_pal_tex);
-  glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 256, 1, GL_BGRA, GL_UNSIGNED_BYTE, palette_buffer);
-  check_gl_error();
+  // Upload the palette to the palette texture (if it has changed).
+  update_palette();
 
   // Set up the shader.
   glUseProgram(m_program);
   glUniform2f(m_resolution_uniform, static_cast<GLfloat>(m_width), static_cast<GLfloat>(m_height));
   glUniform1i(m_fb_sampler_uniform, 0);
+  glUniform1i(m_packed_sampler_uniform, 2);
   glUniform1i(m_pal_sampler_uniform, 1);
   glUniform1i(m_monochrome_uniform, m_bits_per_pixel <= 8 ? 1 : 0);
+  glUniform1i(m_packed_bits_uniform,
+              m_bits_per_pixel < 8 ? static_cast<GLint>(m_bits_per_pixel) : 0);
   check_gl_error();
 
   // Draw the frame buffer texture to the screen.
@@ -58,14 +58,15 @@ public:
   }
 
 private:
-  uint32_t mem32_or_default(const uint32_t addr, const uint32_t default_value);
   void check_gfx_config();
   void compile_shader();
+  void update_palette();
 
   ram_t& m_ram;
 
-  std::vector<uint8_t> m_conv_buffer;
   std::vector<uint8_t> m_default_palette;
+  std::vector<uint8_t> m_pal_shadow;
+  bool m_pal_uploaded = false;
 
   uint32_t m_gfx_ram_start = 0u;
   uint32_t m_gfx_pal_start = 0u;
@@ -78,6 +79,8 @@ private:
   GLint m_tex_internalformat;
   GLenum m_tex_format;
   GLenum m_tex_type;
+  GLint m_fb_tex_unit = 0;
+  uint32_t m_fb_tex_width = 0u;
 
   GLuint m_program = 0u;
   GLuint m_fb_tex = 0u;
@@ -86,8 +89,10 @@ private:
   GLuint m_vertex_buffer = 0u;
   GLint m_resolution_uniform = 0;
   GLint m_fb_sampler_uniform = 0;
+  GLint m_packed_sampler_uniform = 0;
   GLint m_pal_sampler_uniform = 0;
   GLint m_monochrome_uniform = 0;
+  GLint m_packed_bits_uniform = 0;
 };
 
 #endif  // SIM_GPU_HPP_
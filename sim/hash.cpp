@@ -0,0 +1,111 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "hash.hpp"
+
+namespace {
+const uint64_t PRIME64_1 = 0x9e3779b185ebca87ull;
+const uint64_t PRIME64_2 = 0xc2b2ae3d27d4eb4full;
+const uint64_t PRIME64_3 = 0x165667b19e3779f9ull;
+const uint64_t PRIME64_4 = 0x85ebca77c2b2ae63ull;
+const uint64_t PRIME64_5 = 0x27d4eb2f165667c5ull;
+
+inline uint64_t rotl64(const uint64_t x, const int n) {
+  return (x << n) | (x >> (64 - n));
+}
+
+// Note: Compilers turn these into plain loads on little endian hosts.
+inline uint64_t read64le(const uint8_t* p) {
+  return static_cast<uint64_t>(p[0]) | (static_cast<uint64_t>(p[1]) << 8) |
+         (static_cast<uint64_t>(p[2]) << 16) | (static_cast<uint64_t>(p[3]) << 24) |
+         (static_cast<uint64_t>(p[4]) << 32) | (static_cast<uint64_t>(p[5]) << 40) |
+         (static_cast<uint64_t>(p[6]) << 48) | (static_cast<uint64_t>(p[7]) << 56);
+}
+
+inline uint64_t read32le(const uint8_t* p) {
+  return static_cast<uint64_t>(p[0]) | (static_cast<uint64_t>(p[1]) << 8) |
+         (static_cast<uint64_t>(p[2]) << 16) | (static_cast<uint64_t>(p[3]) << 24);
+}
+
+inline uint64_t xxh64_round(uint64_t acc, const uint64_t input) {
+  acc += input * PRIME64_2;
+  acc = rotl64(acc, 31);
+  return acc * PRIME64_1;
+}
+
+inline uint64_t xxh64_merge_round(uint64_t acc, const uint64_t val) {
+  acc ^= xxh64_round(0u, val);
+  return acc * PRIME64_1 + PRIME64_4;
+}
+}  // namespace
+
+uint64_t hash64(const void* data, const size_t size, const uint64_t seed) {
+  const auto* p = static_cast<const uint8_t*>(data);
+  const auto* end = p + size;
+  uint64_t h;
+
+  if (size >= 32u) {
+    // Process 32-byte stripes as four independent lanes.
+    uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+    uint64_t v2 = seed + PRIME64_2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - PRIME64_1;
+    const auto* limit = end - 32;
+    do {
+      v1 = xxh64_round(v1, read64le(p));
+      v2 = xxh64_round(v2, read64le(p + 8));
+      v3 = xxh64_round(v3, read64le(p + 16));
+      v4 = xxh64_round(v4, read64le(p + 24));
+      p += 32;
+    } while (p <= limit);
+
+    h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+    h = xxh64_merge_round(h, v1);
+    h = xxh64_merge_round(h, v2);
+    h = xxh64_merge_round(h, v3);
+    h = xxh64_merge_round(h, v4);
+  } else {
+    h = seed + PRIME64_5;
+  }
+
+  h += static_cast<uint64_t>(size);
+
+  // Process the tail.
+  for (; p + 8 <= end; p += 8) {
+    h ^= xxh64_round(0u, read64le(p));
+    h = rotl64(h, 27) * PRIME64_1 + PRIME64_4;
+  }
+  if (p + 4 <= end) {
+    h ^= read32le(p) * PRIME64_1;
+    h = rotl64(h, 23) * PRIME64_2 + PRIME64_3;
+    p += 4;
+  }
+  for (; p < end; ++p) {
+    h ^= static_cast<uint64_t>(*p) * PRIME64_5;
+    h = rotl64(h, 11) * PRIME64_1;
+  }
+
+  // Final avalanche.
+  h ^= h >> 33;
+  h *= PRIME64_2;
+  h ^= h >> 29;
+  h *= PRIME64_3;
+  h ^= h >> 32;
+  return h;
+}
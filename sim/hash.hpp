@@ -0,0 +1,36 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_HASH_HPP_
+#define SIM_HASH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+/// @brief Calculate a 64-bit hash of a block of memory.
+///
+/// The hash function is XXH64, which processes the data as four independent 64-bit lanes and is
+/// therefore very fast on modern CPUs (typically limited by memory bandwidth).
+/// @param data The data to hash.
+/// @param size The number of bytes to hash.
+/// @param seed The hash seed (can be used for chaining hashes).
+/// @returns the hash value.
+uint64_t hash64(const void* data, size_t size, uint64_t seed = 0u);
+
+#endif  // SIM_HASH_HPP_
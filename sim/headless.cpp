@@ -0,0 +1,408 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "headless.hpp"
+
+#include "config.hpp"
+#include "mmio.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+// Maximum size of a stored (uncompressed) deflate block.
+const size_t MAX_STORED_BLOCK_SIZE = 65535u;
+
+class crc32_table_t {
+public:
+  crc32_table_t() {
+    for (uint32_t n = 0u; n < 256u; ++n) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; ++k) {
+        c = (c & 1u) ? (0xedb88320u ^ (c >> 1)) : (c >> 1);
+      }
+      m_table[n] = c;
+    }
+  }
+
+  uint32_t update(uint32_t crc, const uint8_t* data, const size_t size) const {
+    crc = ~crc;
+    for (size_t i = 0u; i < size; ++i) {
+      crc = m_table[(crc ^ data[i]) & 0xffu] ^ (crc >> 8);
+    }
+    return ~crc;
+  }
+
+private:
+  uint32_t m_table[256];
+};
+
+uint32_t adler32(const uint8_t* data, const size_t size) {
+  // Note: 5552 is the largest block size for which the sums can not overflow.
+  const uint32_t MOD_ADLER = 65521u;
+  uint32_t a = 1u;
+  uint32_t b = 0u;
+  for (size_t i = 0u; i < size;) {
+    const auto block_end = std::min(size, i + 5552u);
+    for (; i < block_end; ++i) {
+      a += data[i];
+      b += a;
+    }
+    a %= MOD_ADLER;
+    b %= MOD_ADLER;
+  }
+  return (b << 16) | a;
+}
+
+void append_be32(std::vector<uint8_t>& buf, const uint32_t x) {
+  buf.push_back(static_cast<uint8_t>(x >> 24));
+  buf.push_back(static_cast<uint8_t>(x >> 16));
+  buf.push_back(static_cast<uint8_t>(x >> 8));
+  buf.push_back(static_cast<uint8_t>(x));
+}
+
+void write_png_chunk(std::ofstream& f, const char* type, const std::vector<uint8_t>& data) {
+  static const crc32_table_t s_crc32;
+  std::vector<uint8_t> chunk;
+  chunk.reserve(data.size() + 12u);
+  append_be32(chunk, static_cast<uint32_t>(data.size()));
+  chunk.insert(chunk.end(), type, type + 4);
+  chunk.insert(chunk.end(), data.begin(), data.end());
+  append_be32(chunk, s_crc32.update(0u, &chunk[4], chunk.size() - 4u));
+  f.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+}
+
+void write_png(const std::string& file_name,
+               const uint32_t width,
+               const uint32_t height,
+               const uint8_t* rgb) {
+  std::ofstream f(file_name, std::ios::out | std::ios::binary);
+  if (!f.good()) {
+    throw std::runtime_error("Unable to open " + file_name + " for writing.");
+  }
+
+  // PNG signature.
+  static const uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  f.write(reinterpret_cast<const char*>(&SIGNATURE[0]), sizeof(SIGNATURE));
+
+  // IHDR: 8 bits per channel, RGB, no interlacing.
+  {
+    std::vector<uint8_t> ihdr;
+    append_be32(ihdr, width);
+    append_be32(ihdr, height);
+    ihdr.push_back(8u);  // Bit depth.
+    ihdr.push_back(2u);  // Color type (RGB).
+    ihdr.push_back(0u);  // Compression method.
+    ihdr.push_back(0u);  // Filter method.
+    ihdr.push_back(0u);  // Interlace method.
+    write_png_chunk(f, "IHDR", ihdr);
+  }
+
+  // Prepend each row with a filter type byte (0 = none).
+  const size_t row_size = static_cast<size_t>(width) * 3u;
+  std::vector<uint8_t> raw;
+  raw.reserve((row_size + 1u) * height);
+  for (uint32_t y = 0u; y < height; ++y) {
+    raw.push_back(0u);
+    raw.insert(raw.end(), &rgb[y * row_size], &rgb[y * row_size] + row_size);
+  }
+
+  // IDAT: A zlib stream with stored (uncompressed) deflate blocks. This avoids a dependency on a
+  // compression library, and snapshots are small anyway.
+  {
+    std::vector<uint8_t> idat;
+    const auto num_blocks = std::max<size_t>(1u, (raw.size() + MAX_STORED_BLOCK_SIZE - 1u) /
+                                                     MAX_STORED_BLOCK_SIZE);
+    idat.reserve(raw.size() + num_blocks * 5u + 6u);
+    idat.push_back(0x78u);  // CMF: deflate, 32K window.
+    idat.push_back(0x01u);  // FLG: no dictionary, fastest compression (check bits).
+    size_t pos = 0u;
+    do {
+      const auto len = std::min(raw.size() - pos, MAX_STORED_BLOCK_SIZE);
+      const bool is_final = (pos + len) == raw.size();
+      idat.push_back(is_final ? 1u : 0u);
+      idat.push_back(static_cast<uint8_t>(len));
+      idat.push_back(static_cast<uint8_t>(len >> 8));
+      idat.push_back(static_cast<uint8_t>(~len));
+      idat.push_back(static_cast<uint8_t>(~len >> 8));
+      idat.insert(idat.end(), raw.begin() + pos, raw.begin() + pos + len);
+      pos += len;
+    } while (pos < raw.size());
+    append_be32(idat, adler32(raw.data(), raw.size()));
+    write_png_chunk(f, "IDAT", idat);
+  }
+
+  write_png_chunk(f, "IEND", std::vector<uint8_t>());
+  if (!f.good()) {
+    throw std::runtime_error("Unable to write " + file_name + ".");
+  }
+}
+
+bool ends_with(const std::string& str, const std::string& suffix) {
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+uint32_t gcd(uint32_t a, uint32_t b) {
+  while (b != 0u) {
+    const auto t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+}  // namespace
+
+headless_display_t::headless_display_t(ram_t& ram) : m_fb(ram) {
+  m_snapshot_frames = config_t::instance().snapshot_frames();
+  std::sort(m_snapshot_frames.begin(), m_snapshot_frames.end());
+
+  const auto& video_file_name = config_t::instance().video_file_name();
+  if (!video_file_name.empty()) {
+    m_video_file.open(video_file_name, std::ios::out | std::ios::binary);
+    if (!m_video_file.good()) {
+      throw std::runtime_error("Unable to open " + video_file_name + " for writing.");
+    }
+    m_video_enabled = true;
+    m_video_y4m = ends_with(video_file_name, ".y4m");
+    m_video_fps = ram.valid_range(MMIO_VIDFPS, 4u) ? ram.load32(MMIO_VIDFPS) : 0u;
+    m_video_fps = (m_video_fps != 0u) ? m_video_fps : DEFAULT_VIDFPS;
+  }
+
+  const auto& hash_file_name = config_t::instance().frame_hashes_file_name();
+  if (!hash_file_name.empty()) {
+    m_hash_file.open(hash_file_name, std::ios::out);
+    if (!m_hash_file.good()) {
+      throw std::runtime_error("Unable to open " + hash_file_name + " for writing.");
+    }
+    m_hash_interval = config_t::instance().frame_hash_interval();
+  }
+
+  m_encoder_thread = std::thread(&headless_display_t::encoder_loop, this);
+}
+
+headless_display_t::~headless_display_t() {
+  finish();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_cond.notify_all();
+  m_encoder_thread.join();
+}
+
+bool headless_display_t::configure_fb() {
+  try {
+    m_fb.configure();
+    m_last_error.clear();
+    return true;
+  } catch (std::exception& e) {
+    // Report invalid video modes once, and don't stop the simulation.
+    if (m_last_error != e.what()) {
+      m_last_error = e.what();
+      std::cerr << "Headless display: " << m_last_error << "\n";
+    }
+    return false;
+  }
+}
+
+void headless_display_t::vblank(const uint32_t frame_no, const uint64_t cycle) {
+  const bool hash = m_hash_file.is_open() && (frame_no % m_hash_interval) == 0u;
+
+  // Skip past snapshot frames that we have missed.
+  while (m_next_snapshot < m_snapshot_frames.size() &&
+         m_snapshot_frames[m_next_snapshot] < frame_no) {
+    ++m_next_snapshot;
+  }
+  const bool snapshot = m_next_snapshot < m_snapshot_frames.size() &&
+                        m_snapshot_frames[m_next_snapshot] == frame_no;
+  if (!hash && !snapshot && !m_video_enabled) {
+    return;
+  }
+
+  const bool valid_mode = configure_fb();
+
+  // Write the frame hash (an invalid video mode is given the hash zero).
+  if (hash) {
+    const auto h = valid_mode ? m_fb.hash() : 0u;
+    m_hash_file << std::dec << frame_no << " " << cycle << " " << std::hex << std::setw(16)
+                << std::setfill('0') << h << "\n";
+  }
+  if (!snapshot && !m_video_enabled) {
+    return;
+  }
+
+  frame_t frame;
+  frame.frame_no = frame_no;
+  frame.width = 0u;
+  frame.height = 0u;
+  frame.snapshot = snapshot;
+  frame.video = m_video_enabled;
+
+  // Wait for the encoder to catch up, and reuse a previously allocated frame buffer if possible.
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cond.wait(lock, [this] { return m_queue.size() < MAX_QUEUED_FRAMES; });
+    if (!m_free_buffers.empty()) {
+      frame.rgb.swap(m_free_buffers.back());
+      m_free_buffers.pop_back();
+    }
+  }
+
+  if (valid_mode) {
+    m_fb.convert_to_rgb(frame.rgb);
+    frame.width = m_fb.width();
+    frame.height = m_fb.height();
+  } else {
+    frame.rgb.clear();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.push_back(std::move(frame));
+  }
+  m_cond.notify_all();
+}
+
+void headless_display_t::finish() {
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_cond.wait(lock, [this] { return m_queue.empty() && !m_busy; });
+  if (m_video_file.is_open()) {
+    m_video_file.flush();
+  }
+  if (m_hash_file.is_open()) {
+    m_hash_file.flush();
+  }
+}
+
+void headless_display_t::encoder_loop() {
+  while (true) {
+    frame_t frame;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cond.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+      if (m_queue.empty()) {
+        break;
+      }
+      frame = std::move(m_queue.front());
+      m_queue.pop_front();
+      m_busy = true;
+    }
+    m_cond.notify_all();
+
+    try {
+      if (frame.snapshot) {
+        write_snapshot(frame);
+      }
+      if (frame.video) {
+        write_video_frame(frame);
+      }
+    } catch (std::exception& e) {
+      std::cerr << "Headless display: " << e.what() << "\n";
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_free_buffers.push_back(std::move(frame.rgb));
+      m_busy = false;
+    }
+    m_cond.notify_all();
+  }
+}
+
+void headless_display_t::write_snapshot(const frame_t& frame) {
+  if (frame.rgb.empty()) {
+    return;
+  }
+
+  char frame_no_str[16];
+  std::snprintf(&frame_no_str[0], sizeof(frame_no_str), "%06u", frame.frame_no);
+  const auto file_name = config_t::instance().snapshot_prefix() + frame_no_str + ".png";
+  write_png(file_name, frame.width, frame.height, frame.rgb.data());
+  if (config_t::instance().verbose()) {
+    std::cerr << "Wrote frame " << frame.frame_no << " to " << file_name << "\n";
+  }
+}
+
+void headless_display_t::write_video_frame(const frame_t& frame) {
+  // The video stream dimensions are defined by the first frame.
+  if (m_video_width == 0u) {
+    if (frame.rgb.empty()) {
+      return;
+    }
+    m_video_width = frame.width;
+    m_video_height = frame.height;
+    if (m_video_y4m) {
+      const auto fps_gcd = gcd(m_video_fps, 65536u);
+      std::ostringstream header;
+      header << "YUV4MPEG2 W" << m_video_width << " H" << m_video_height << " F"
+             << (m_video_fps / fps_gcd) << ":" << (65536u / fps_gcd) << " Ip A1:1 C444\n";
+      m_video_file << header.str();
+    } else if (config_t::instance().verbose()) {
+      std::cerr << "Video format: raw rgb24, " << m_video_width << "x" << m_video_height << ", "
+                << (static_cast<double>(m_video_fps) / 65536.0) << " fps\n";
+    }
+  }
+
+  // Fit the frame into the video stream dimensions (frames from other video modes are cropped or
+  // padded with black).
+  const size_t row_size = static_cast<size_t>(m_video_width) * 3u;
+  const uint8_t* rgb = frame.rgb.data();
+  if (frame.width != m_video_width || frame.height != m_video_height) {
+    m_video_buf.assign(row_size * m_video_height, 0u);
+    const auto copy_w = std::min(frame.width, m_video_width);
+    const auto copy_h = std::min(frame.height, m_video_height);
+    for (uint32_t y = 0u; y < copy_h; ++y) {
+      std::copy(&frame.rgb[y * frame.width * 3u],
+                &frame.rgb[y * frame.width * 3u] + copy_w * 3u,
+                &m_video_buf[y * row_size]);
+    }
+    rgb = m_video_buf.data();
+  }
+
+  const size_t num_pixels = static_cast<size_t>(m_video_width) * m_video_height;
+  if (m_video_y4m) {
+    // Convert to planar YCbCr 4:4:4 (BT.601, limited range).
+    m_yuv_buf.resize(num_pixels * 3u);
+    auto* y_plane = &m_yuv_buf[0];
+    auto* cb_plane = &m_yuv_buf[num_pixels];
+    auto* cr_plane = &m_yuv_buf[num_pixels * 2u];
+    for (size_t i = 0u; i < num_pixels; ++i) {
+      const int r = rgb[i * 3u];
+      const int g = rgb[i * 3u + 1u];
+      const int b = rgb[i * 3u + 2u];
+      y_plane[i] = static_cast<uint8_t>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+      cb_plane[i] = static_cast<uint8_t>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+      cr_plane[i] = static_cast<uint8_t>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+    m_video_file << "FRAME\n";
+    m_video_file.write(reinterpret_cast<const char*>(m_yuv_buf.data()),
+                       static_cast<std::streamsize>(m_yuv_buf.size()));
+  } else {
+    m_video_file.write(reinterpret_cast<const char*>(rgb),
+                       static_cast<std::streamsize>(num_pixels * 3u));
+  }
+  if (!m_video_file.good()) {
+    throw std::runtime_error("Unable to write the video file.");
+  }
+}
@@ -0,0 +1,107 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_HEADLESS_HPP_
+#define SIM_HEADLESS_HPP_
+
+#include "framebuffer.hpp"
+#include "ram.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// @brief A display backend that does not need a window or OpenGL.
+///
+/// Frames are produced at the simulated vertical blanking intervals (i.e. driven by the simulated
+/// CPU clock rather than by the host display), converted to RGB in software, and handed over to a
+/// background encoder thread that writes PNG snapshots and/or a video stream. Frame hashes (for
+/// visual regression tests) are calculated directly in the CPU thread.
+class headless_display_t {
+public:
+  /// @brief Constructor for headless_display_t.
+  ///
+  /// The snapshot frames and the video file are taken from the configuration.
+  /// @param ram The RAM that holds the framebuffer and the MMIO registers.
+  headless_display_t(ram_t& ram);
+  ~headless_display_t();
+
+  /// @brief Produce a frame.
+  ///
+  /// This is called at each simulated vertical blanking interval, from the CPU thread.
+  /// @param frame_no The frame number.
+  /// @param cycle The CPU cycle count.
+  void vblank(uint32_t frame_no, uint64_t cycle);
+
+  /// @brief Wait for all pending frames to be written.
+  void finish();
+
+private:
+  struct frame_t {
+    uint32_t frame_no;
+    uint32_t width;
+    uint32_t height;
+    bool snapshot;
+    bool video;
+    std::vector<uint8_t> rgb;
+  };
+
+  bool configure_fb();
+  void encoder_loop();
+  void write_snapshot(const frame_t& frame);
+  void write_video_frame(const frame_t& frame);
+
+  // Maximum number of frames that may be waiting for the encoder before the CPU is stalled.
+  static const size_t MAX_QUEUED_FRAMES = 4u;
+
+  framebuffer_t m_fb;
+  std::vector<uint32_t> m_snapshot_frames;
+  size_t m_next_snapshot = 0u;
+  bool m_video_enabled = false;
+  std::string m_last_error;
+
+  // Frame hashes.
+  std::ofstream m_hash_file;
+  uint32_t m_hash_interval = 1u;
+
+  // Encoder thread state.
+  std::thread m_encoder_thread;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  std::deque<frame_t> m_queue;
+  std::vector<std::vector<uint8_t>> m_free_buffers;
+  bool m_busy = false;
+  bool m_stop = false;
+
+  // Video stream state (only accessed by the encoder thread once it has been started).
+  std::ofstream m_video_file;
+  bool m_video_y4m = false;
+  uint32_t m_video_fps = 0u;
+  uint32_t m_video_width = 0u;
+  uint32_t m_video_height = 0u;
+  std::vector<uint8_t> m_video_buf;
+  std::vector<uint8_t> m_yuv_buf;
+};
+
+#endif  // SIM_HEADLESS_HPP_
@@ -0,0 +1,298 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "heap_profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <unordered_map>
+
+namespace {
+struct site_stats_t {
+  uint64_t allocs = 0u;
+  uint64_t bytes = 0u;
+  uint64_t frees = 0u;
+  uint64_t total_lifetime = 0u;  // Sum of the lifetimes (in cycles) of the freed blocks.
+  uint64_t leaked_blocks = 0u;
+  uint64_t leaked_bytes = 0u;
+};
+
+std::string site_name(perf_symbols_t& perf_symbols, const uint32_t caller) {
+  char addr[16];
+  snprintf(addr, sizeof(addr), "0x%08x", caller);
+  const auto name = perf_symbols.symbol_name(caller);
+  return name.empty() ? std::string(addr) : (name + " (" + addr + ")");
+}
+}  // namespace
+
+bool heap_profiler_t::functions_t::find(const std::map<std::string, uint32_t>& symbols) {
+  const auto lookup = [&symbols](const char* name) {
+    const auto it = symbols.find(name);
+    return (it != symbols.end()) ? it->second : NO_ADDR;
+  };
+  malloc_addr = lookup("malloc");
+  free_addr = lookup("free");
+  realloc_addr = lookup("realloc");
+  calloc_addr = lookup("calloc");
+  return malloc_addr != NO_ADDR && free_addr != NO_ADDR;
+}
+
+heap_profiler_t::heap_profiler_t(const functions_t& functions) : m_functions(functions) {
+}
+
+void heap_profiler_t::reset() {
+  m_call = call_t::NONE;
+  m_return_addr = NO_ADDR;
+  m_calls.clear();
+  m_events.clear();
+}
+
+void heap_profiler_t::record_callers(const uint32_t lr) {
+  m_callers.fill(NO_ADDR);
+  m_callers[0] = lr - 4u;
+
+  // The innermost frame is usually the call to the intercepted function itself (but not for tail
+  // calls).
+  const auto& frames = m_calls.frames();
+  auto it = frames.rbegin();
+  if (it != frames.rend() && it->data == m_callers[0]) {
+    ++it;
+  }
+  for (std::size_t i = 1u; i < CALL_CHAIN_LENGTH && it != frames.rend(); ++i, ++it) {
+    m_callers[i] = it->data;
+  }
+}
+
+void heap_profiler_t::hook(const uint32_t pc,
+                           const uint32_t r1,
+                           const uint32_t r2,
+                           const uint32_t lr,
+                           const uint32_t sp,
+                           const uint64_t cycle) {
+  if (m_call != call_t::NONE) {
+    // Return from the intercepted call? (The stack pointer check handles recursion.)
+    if (pc != m_return_addr || sp != m_call_sp) {
+      return;
+    }
+    const auto& caller = m_callers;
+    switch (m_call) {
+      case call_t::MALLOC:
+        if (r1 != 0u) {
+          m_events.push_back(event_t{cycle, r1, m_arg1, caller, true});
+        }
+        break;
+      case call_t::CALLOC:
+        if (r1 != 0u) {
+          m_events.push_back(event_t{cycle, r1, m_arg1 * m_arg2, caller, true});
+        }
+        break;
+      case call_t::FREE:
+        if (m_arg1 != 0u) {
+          m_events.push_back(event_t{cycle, m_arg1, 0u, caller, false});
+        }
+        break;
+      case call_t::REALLOC:
+        // A successful realloc frees the old block (if any) and allocates a new block. A failed
+        // realloc leaves the old block untouched.
+        if (r1 != 0u || m_arg2 == 0u) {
+          if (m_arg1 != 0u) {
+            m_events.push_back(event_t{cycle, m_arg1, 0u, caller, false});
+          }
+          if (r1 != 0u) {
+            m_events.push_back(event_t{cycle, r1, m_arg2, caller, true});
+          }
+        }
+        break;
+      default:
+        break;
+    }
+    m_call = call_t::NONE;
+    m_return_addr = NO_ADDR;
+    return;
+  }
+
+  // Function entry.
+  if (pc == m_functions.malloc_addr) {
+    m_call = call_t::MALLOC;
+  } else if (pc == m_functions.free_addr) {
+    m_call = call_t::FREE;
+  } else if (pc == m_functions.realloc_addr) {
+    m_call = call_t::REALLOC;
+  } else if (pc == m_functions.calloc_addr) {
+    m_call = call_t::CALLOC;
+  } else {
+    return;
+  }
+  m_return_addr = lr;
+  m_call_sp = sp;
+  record_callers(lr);
+  m_arg1 = r1;
+  m_arg2 = r2;
+}
+
+void heap_profiler_t::print_report(const std::vector<const heap_profiler_t*>& profilers,
+                                   perf_symbols_t& perf_symbols) {
+  struct live_block_t {
+    uint32_t size;
+    call_chain_t callers;
+    uint64_t cycle;
+  };
+  using site_t = std::pair<call_chain_t, site_stats_t>;
+
+  const auto chain_name = [&perf_symbols](const call_chain_t& callers) {
+    std::string name = site_name(perf_symbols, callers[0]);
+    for (std::size_t i = 1u; i < CALL_CHAIN_LENGTH && callers[i] != NO_ADDR; ++i) {
+      name += " <- " + site_name(perf_symbols, callers[i]);
+    }
+    return name;
+  };
+
+  // Merge the event logs of all the cores (in cycle order).
+  std::vector<event_t> events;
+  for (const auto* profiler : profilers) {
+    events.insert(events.end(), profiler->m_events.begin(), profiler->m_events.end());
+  }
+  std::stable_sort(events.begin(), events.end(), [](const event_t& a, const event_t& b) {
+    return a.cycle < b.cycle;
+  });
+
+  // Replay the events.
+  std::unordered_map<uint32_t, live_block_t> live_blocks;
+  std::map<call_chain_t, site_stats_t> sites;
+  uint64_t num_allocs = 0u;
+  uint64_t num_frees = 0u;
+  uint64_t num_unknown_frees = 0u;
+  uint64_t num_missed_frees = 0u;
+  uint64_t total_bytes = 0u;
+  uint64_t live_bytes = 0u;
+  uint64_t peak_bytes = 0u;
+  uint64_t peak_cycle = 0u;
+  const auto free_block = [&](std::unordered_map<uint32_t, live_block_t>::iterator it,
+                              const uint64_t cycle) {
+    auto& site = sites[it->second.callers];
+    ++site.frees;
+    site.total_lifetime += cycle - it->second.cycle;
+    live_bytes -= it->second.size;
+    live_blocks.erase(it);
+  };
+  for (const auto& event : events) {
+    if (event.is_alloc) {
+      // A block that is handed out again must have been freed without us noticing (e.g. by a free
+      // call that is nested inside realloc).
+      const auto it = live_blocks.find(event.ptr);
+      if (it != live_blocks.end()) {
+        ++num_missed_frees;
+        free_block(it, event.cycle);
+      }
+
+      ++num_allocs;
+      total_bytes += event.size;
+      auto& site = sites[event.callers];
+      ++site.allocs;
+      site.bytes += event.size;
+      live_blocks[event.ptr] = live_block_t{event.size, event.callers, event.cycle};
+      live_bytes += event.size;
+      if (live_bytes > peak_bytes) {
+        peak_bytes = live_bytes;
+        peak_cycle = event.cycle;
+      }
+    } else {
+      ++num_frees;
+      const auto it = live_blocks.find(event.ptr);
+      if (it == live_blocks.end()) {
+        ++num_unknown_frees;
+        continue;
+      }
+      free_block(it, event.cycle);
+    }
+  }
+  for (const auto& block : live_blocks) {
+    auto& site = sites[block.second.callers];
+    ++site.leaked_blocks;
+    site.leaked_bytes += block.second.size;
+  }
+
+  printf("Heap profile:\n");
+  printf(" Allocations:          %lu (%lu bytes)\n",
+         static_cast<unsigned long>(num_allocs),
+         static_cast<unsigned long>(total_bytes));
+  printf(" Frees:                %lu\n", static_cast<unsigned long>(num_frees));
+  if (num_unknown_frees > 0u) {
+    printf(" Unknown frees:        %lu\n", static_cast<unsigned long>(num_unknown_frees));
+  }
+  if (num_missed_frees > 0u) {
+    printf(" Missed frees:         %lu\n", static_cast<unsigned long>(num_missed_frees));
+  }
+  printf(" Peak heap usage:      %lu bytes (at cycle %lu)\n",
+         static_cast<unsigned long>(peak_bytes),
+         static_cast<unsigned long>(peak_cycle));
+  printf(" Live at exit:         %lu blocks (%lu bytes)\n",
+         static_cast<unsigned long>(live_blocks.size()),
+         static_cast<unsigned long>(live_bytes));
+
+  // Allocation hot spots (by number of allocations).
+  const std::size_t MAX_SITES = 10u;
+  std::vector<site_t> hot(sites.begin(), sites.end());
+  std::sort(hot.begin(), hot.end(), [](const site_t& a, const site_t& b) {
+    return (a.second.allocs != b.second.allocs) ? (a.second.allocs > b.second.allocs)
+                                                : (a.first < b.first);
+  });
+  hot.resize(std::min(hot.size(), MAX_SITES));
+  if (!hot.empty() && hot[0].second.allocs > 0u) {
+    printf(" Allocation hot spots:\n");
+    printf("  Allocs       Bytes        Avg. lifetime  Callers\n");
+    for (const auto& site : hot) {
+      if (site.second.allocs == 0u) {
+        break;
+      }
+      const auto avg_lifetime = (site.second.frees > 0u)
+                                    ? (site.second.total_lifetime / site.second.frees)
+                                    : uint64_t(0);
+      printf("  %-12lu %-12lu %-14lu %s\n",
+             static_cast<unsigned long>(site.second.allocs),
+             static_cast<unsigned long>(site.second.bytes),
+             static_cast<unsigned long>(avg_lifetime),
+             chain_name(site.first).c_str());
+    }
+  }
+
+  // Leaks (by number of leaked bytes).
+  std::vector<site_t> leaks;
+  for (const auto& site : sites) {
+    if (site.second.leaked_blocks > 0u) {
+      leaks.emplace_back(site);
+    }
+  }
+  std::sort(leaks.begin(), leaks.end(), [](const site_t& a, const site_t& b) {
+    return (a.second.leaked_bytes != b.second.leaked_bytes)
+               ? (a.second.leaked_bytes > b.second.leaked_bytes)
+               : (a.first < b.first);
+  });
+  leaks.resize(std::min(leaks.size(), MAX_SITES));
+  if (!leaks.empty()) {
+    printf(" Leaks:\n");
+    printf("  Blocks       Bytes        Callers\n");
+    for (const auto& site : leaks) {
+      printf("  %-12lu %-12lu %s\n",
+             static_cast<unsigned long>(site.second.leaked_blocks),
+             static_cast<unsigned long>(site.second.leaked_bytes),
+             chain_name(site.first).c_str());
+    }
+  }
+}
@@ -0,0 +1,135 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_HEAP_PROFILER_HPP_
+#define SIM_HEAP_PROFILER_HPP_
+
+#include "call_stack.hpp"
+#include "perf_symbols.hpp"
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+/// @brief A guest heap profiler.
+///
+/// The profiler intercepts calls to the guest malloc, free, realloc and calloc functions (at the
+/// function entry and at the return to the caller), and records the allocations and frees. The
+/// events are appended to a per core log (no locking is required), and are analyzed when the
+/// report is printed: peak heap usage, allocation hot spots and leaks.
+///
+/// Each allocation is attributed to a short call chain: the calling instruction and the call sites
+/// of the enclosing calls (from a shadow call stack of jl calls, see call_stack_t).
+class heap_profiler_t {
+public:
+  /// @brief Sentinel for functions that are not present in the program.
+  static const uint32_t NO_ADDR = ~0u;
+
+  /// @brief Number of call sites that are recorded per allocation.
+  static const std::size_t CALL_CHAIN_LENGTH = 4u;
+
+  /// @brief Addresses of the intercepted functions.
+  struct functions_t {
+    uint32_t malloc_addr = NO_ADDR;
+    uint32_t free_addr = NO_ADDR;
+    uint32_t realloc_addr = NO_ADDR;
+    uint32_t calloc_addr = NO_ADDR;
+
+    /// @brief Look up the functions in a symbol table.
+    /// @returns true if at least malloc and free were found.
+    bool find(const std::map<std::string, uint32_t>& symbols);
+  };
+
+  explicit heap_profiler_t(const functions_t& functions);
+
+  /// @brief Clear the event log.
+  void reset();
+
+  /// @brief Check if an instruction address needs to be handled by the profiler.
+  bool is_hook(const uint32_t pc) const {
+    return pc == m_return_addr || pc == m_functions.malloc_addr || pc == m_functions.free_addr ||
+           pc == m_functions.realloc_addr || pc == m_functions.calloc_addr;
+  }
+
+  /// @brief Handle a function entry or return (call this when is_hook() returns true).
+  /// @param pc The instruction address.
+  /// @param r1 The value of R1 (first argument or return value).
+  /// @param r2 The value of R2 (second argument).
+  /// @param lr The link register (return address).
+  /// @param sp The stack pointer.
+  /// @param cycle The current cycle.
+  void hook(const uint32_t pc,
+            const uint32_t r1,
+            const uint32_t r2,
+            const uint32_t lr,
+            const uint32_t sp,
+            const uint64_t cycle);
+
+  /// @brief Record a j/jl instruction (for the call stack).
+  /// @param target The branch target address.
+  /// @param pc The address of the branch instruction.
+  /// @param is_call True for jl (subroutine call).
+  void jump(const uint32_t target, const uint32_t pc, const bool is_call) {
+    if (m_calls.jump(target, pc + 4u, is_call, pc)) {
+      m_calls.pop();
+    }
+  }
+
+  /// @brief Print the heap report.
+  /// @param profilers The profilers of all the cores.
+  /// @param perf_symbols Symbols for attributing the allocations to functions.
+  static void print_report(const std::vector<const heap_profiler_t*>& profilers,
+                           perf_symbols_t& perf_symbols);
+
+private:
+  enum class call_t : uint8_t { NONE, MALLOC, FREE, REALLOC, CALLOC };
+
+  // The calling instruction, followed by the enclosing call sites (NO_ADDR if unknown).
+  using call_chain_t = std::array<uint32_t, CALL_CHAIN_LENGTH>;
+
+  struct event_t {
+    uint64_t cycle;
+    uint32_t ptr;
+    uint32_t size;  // Zero for frees.
+    call_chain_t callers;
+    bool is_alloc;
+  };
+
+  void record_callers(const uint32_t lr);
+
+  const functions_t m_functions;
+
+  // The intercepted call that is in progress (nested calls, e.g. calloc calling malloc, are not
+  // intercepted).
+  call_t m_call = call_t::NONE;
+  uint32_t m_return_addr = NO_ADDR;
+  uint32_t m_call_sp = 0u;
+  uint32_t m_arg1 = 0u;
+  uint32_t m_arg2 = 0u;
+  call_chain_t m_callers;
+
+  // Shadow call stack (the frame data is the address of the jl instruction).
+  call_stack_t<uint32_t> m_calls;
+
+  std::vector<event_t> m_events;
+};
+
+#endif  // SIM_HEAP_PROFILER_HPP_
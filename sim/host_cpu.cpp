@@ -0,0 +1,145 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "host_cpu.hpp"
+
+#if defined(__GNUC__) && defined(SIM_HOST_X86)
+#include <cpuid.h>
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#define SIM_HOST_X86_INTRINSICS 1
+#endif
+
+namespace {
+
+// Table driven CRC implementations (one table lookup per byte), used when there is no hardware
+// support.
+class crc_tables_t {
+public:
+  crc_tables_t() {
+    for (uint32_t i = 0u; i < 256u; ++i) {
+      m_crc32c[i] = make_entry(i, 0x82f63b78u);
+      m_crc32[i] = make_entry(i, 0xedb88320u);
+    }
+  }
+
+  uint32_t crc32c(uint32_t crc, uint32_t data, const int bytes) const {
+    for (int i = 0; i < bytes; ++i) {
+      crc = m_crc32c[(crc ^ data) & 0xffu] ^ (crc >> 8);
+      data >>= 8;
+    }
+    return crc;
+  }
+
+  uint32_t crc32(uint32_t crc, uint32_t data, const int bytes) const {
+    for (int i = 0; i < bytes; ++i) {
+      crc = m_crc32[(crc ^ data) & 0xffu] ^ (crc >> 8);
+      data >>= 8;
+    }
+    return crc;
+  }
+
+private:
+  static uint32_t make_entry(const uint32_t byte, const uint32_t poly) {
+    uint32_t crc = byte;
+    for (int k = 0; k < 8; ++k) {
+      crc = (crc >> 1) ^ ((crc & 1u) != 0u ? poly : 0u);
+    }
+    return crc;
+  }
+
+  uint32_t m_crc32c[256];
+  uint32_t m_crc32[256];
+};
+
+const crc_tables_t s_crc_tables;
+
+#ifdef SIM_HOST_X86_INTRINSICS
+__attribute__((target("sse4.2"))) uint32_t crc32c_sse42(const uint32_t crc,
+                                                        const uint32_t data,
+                                                        const int bytes) {
+  switch (bytes) {
+    case 1:
+      return _mm_crc32_u8(crc, static_cast<uint8_t>(data));
+    case 2:
+      return _mm_crc32_u16(crc, static_cast<uint16_t>(data));
+    default:
+      return _mm_crc32_u32(crc, data);
+  }
+}
+
+__attribute__((target("pclmul"))) uint32_t crc32_pclmul(const uint32_t crc,
+                                                        const uint32_t data,
+                                                        const int bytes) {
+  // Processing the N least significant bits of a word is the same as processing the full 32-bit
+  // word with the N bits moved to the top (the zero bits just shift the CRC register). The bits of
+  // the CRC register that are not consumed are simply shifted down.
+  const int bits = 8 * bytes;
+  const uint32_t word = (crc ^ data) << (32 - bits);
+  const uint32_t rest = (bits < 32) ? (crc >> bits) : 0u;
+
+  // Barrett reduction of word * x^32 modulo the (bit reflected) CRC-32 polynomial.
+  const __m128i MU = _mm_cvtsi64_si128(INT64_C(0x00000000f7011641));
+  const __m128i POLY = _mm_cvtsi64_si128(INT64_C(0x00000001db710641));
+  const __m128i LOW32 = _mm_cvtsi32_si128(-1);
+  __m128i t = _mm_clmulepi64_si128(_mm_cvtsi32_si128(static_cast<int>(word)), MU, 0x00);
+  t = _mm_clmulepi64_si128(_mm_and_si128(t, LOW32), POLY, 0x00);
+  return rest ^ static_cast<uint32_t>(_mm_cvtsi128_si64(t) >> 32);
+}
+#endif  // SIM_HOST_X86_INTRINSICS
+
+}  // namespace
+
+const host_cpu_t::features_t host_cpu_t::s_features = host_cpu_t::detect();
+
+host_cpu_t::features_t host_cpu_t::detect() {
+  features_t features = features_t();
+#ifdef SIM_HOST_X86_INTRINSICS
+  unsigned eax, ebx, ecx, edx;
+  if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) != 0) {
+    features.pclmul = ((ecx & bit_PCLMUL) != 0u);
+    features.sse42 = ((ecx & bit_SSE4_2) != 0u);
+    features.popcnt = ((ecx & bit_POPCNT) != 0u);
+  }
+  if (__get_cpuid(0x80000001u, &eax, &ebx, &ecx, &edx) != 0) {
+    // LZCNT is reported as ABM (advanced bit manipulation) on both AMD and Intel CPUs.
+    features.lzcnt = ((ecx & bit_LZCNT) != 0u);
+  }
+#endif
+  return features;
+}
+
+uint32_t host_crc32c(const uint32_t crc, const uint32_t data, const int bytes) {
+#ifdef SIM_HOST_X86_INTRINSICS
+  if (host_cpu_t::has_sse42()) {
+    return crc32c_sse42(crc, data, bytes);
+  }
+#endif
+  return s_crc_tables.crc32c(crc, data, bytes);
+}
+
+uint32_t host_crc32(const uint32_t crc, const uint32_t data, const int bytes) {
+#ifdef SIM_HOST_X86_INTRINSICS
+  // A single table lookup is faster than the multiplication latency for a single byte.
+  if (bytes > 1 && host_cpu_t::has_pclmul()) {
+    return crc32_pclmul(crc, data, bytes);
+  }
+#endif
+  return s_crc_tables.crc32(crc, data, bytes);
+}
@@ -0,0 +1,148 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_HOST_CPU_HPP_
+#define SIM_HOST_CPU_HPP_
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SIM_HOST_X86 1
+#endif
+
+/// @brief Capabilities of the host CPU.
+///
+/// The capabilities are detected once at startup, and are used for selecting between host
+/// specific instructions and portable fallback implementations of some of the simulator helper
+/// routines.
+class host_cpu_t {
+public:
+  static bool has_popcnt() {
+    return s_features.popcnt;
+  }
+
+  static bool has_lzcnt() {
+    return s_features.lzcnt;
+  }
+
+  static bool has_sse42() {
+    return s_features.sse42;
+  }
+
+  static bool has_pclmul() {
+    return s_features.pclmul;
+  }
+
+private:
+  struct features_t {
+    bool popcnt;
+    bool lzcnt;
+    bool sse42;
+    bool pclmul;
+  };
+
+  static features_t detect();
+
+  static const features_t s_features;
+};
+
+/// @brief Count the number of set bits in a 32-bit word.
+inline uint32_t host_popcnt32(const uint32_t x) {
+#if defined(__GNUC__) && defined(__POPCNT__)
+  return static_cast<uint32_t>(__builtin_popcount(x));
+#else
+#if defined(__GNUC__) && defined(SIM_HOST_X86)
+  if (host_cpu_t::has_popcnt()) {
+    uint32_t count;
+    __asm__("popcntl %1, %0" : "=r"(count) : "rm"(x) : "cc");
+    return count;
+  }
+#endif
+  uint32_t y = x - ((x >> 1u) & 0x55555555u);
+  y = (y & 0x33333333u) + ((y >> 2u) & 0x33333333u);
+  y = (y + (y >> 4u)) & 0x0f0f0f0fu;
+  return (y * 0x01010101u) >> 24u;
+#endif
+}
+
+/// @brief Count the number of leading zero bits in a 32-bit word.
+/// @returns 32 if @c x is zero.
+inline uint32_t host_clz32(const uint32_t x) {
+#if defined(__GNUC__) && defined(__LZCNT__)
+  // The compiler emits LZCNT for this.
+  return (x == 0u) ? 32u : static_cast<uint32_t>(__builtin_clz(x));
+#else
+#if defined(__GNUC__) && defined(SIM_HOST_X86)
+  if (host_cpu_t::has_lzcnt()) {
+    uint32_t count;
+    __asm__("lzcntl %1, %0" : "=r"(count) : "rm"(x) : "cc");
+    return count;
+  }
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+  return (x == 0u) ? 32u : static_cast<uint32_t>(__builtin_clz(x));
+#else
+  if (x == 0u) {
+    return 32u;
+  }
+  uint32_t count = 0u;
+  uint32_t y = x;
+  if ((y & 0xffff0000u) == 0u) {
+    count += 16u;
+    y <<= 16u;
+  }
+  if ((y & 0xff000000u) == 0u) {
+    count += 8u;
+    y <<= 8u;
+  }
+  if ((y & 0xf0000000u) == 0u) {
+    count += 4u;
+    y <<= 4u;
+  }
+  if ((y & 0xc0000000u) == 0u) {
+    count += 2u;
+    y <<= 2u;
+  }
+  if ((y & 0x80000000u) == 0u) {
+    count += 1u;
+  }
+  return count;
+#endif
+#endif
+}
+
+/// @brief Update a CRC-32C (Castagnoli) checksum.
+///
+/// This uses the SSE4.2 CRC32 instruction when available.
+/// @param crc The current CRC value.
+/// @param data The data to process (the least significant byte is processed first).
+/// @param bytes The number of bytes of @c data to process (1, 2 or 4).
+/// @returns the updated CRC value.
+uint32_t host_crc32c(const uint32_t crc, const uint32_t data, const int bytes);
+
+/// @brief Update a CRC-32 (IEEE 802.3) checksum.
+///
+/// This uses carry-less multiplication (PCLMULQDQ) for 16-bit and 32-bit data when available.
+/// @param crc The current CRC value.
+/// @param data The data to process (the least significant byte is processed first).
+/// @param bytes The number of bytes of @c data to process (1, 2 or 4).
+/// @returns the updated CRC value.
+uint32_t host_crc32(const uint32_t crc, const uint32_t data, const int bytes);
+
+#endif  // SIM_HOST_CPU_HPP_
@@ -0,0 +1,283 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "latency_model.hpp"
+
+#include "cpu.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+struct op_name_t {
+  const char* name;
+  uint32_t op;
+};
+
+// Parse a cycle count (returns zero for invalid counts).
+uint32_t parse_cycles(const std::string& str) {
+  if (str.empty() || str.find_first_not_of("0123456789") != std::string::npos || str.size() > 6) {
+    return 0u;
+  }
+  return static_cast<uint32_t>(std::stoul(str));
+}
+
+bool find_op(const op_name_t* names, const size_t count, const std::string& name, uint32_t& op) {
+  for (size_t i = 0; i < count; ++i) {
+    if (name == names[i].name) {
+      op = names[i].op;
+      return true;
+    }
+  }
+  return false;
+}
+}  // namespace
+
+latency_model_t::latency_model_t() {
+  // By default all operations take a single cycle.
+  m_ex_entries.fill(entry_t{1u, 1u});
+  m_mem_entries.fill(entry_t{1u, 1u});
+
+  // Pipelined integer multiplication.
+  set_ex_all(cpu_t::EX_OP_MUL, 3u, 1u);
+  set_ex_all(cpu_t::EX_OP_MADD, 3u, 1u);
+  set_ex_all(cpu_t::EX_OP_MULHI, 3u, 1u);
+  set_ex_all(cpu_t::EX_OP_MULHIU, 3u, 1u);
+  set_ex_all(cpu_t::EX_OP_MULQ, 3u, 1u);
+  set_ex_all(cpu_t::EX_OP_MULQR, 3u, 1u);
+
+  // Pipelined floating-point arithmetic and conversion.
+  set_ex_all(cpu_t::EX_OP_FADD, 4u, 1u);
+  set_ex_all(cpu_t::EX_OP_FSUB, 4u, 1u);
+  set_ex_all(cpu_t::EX_OP_FMUL, 4u, 1u);
+  set_ex_all(cpu_t::EX_OP_ITOF, 4u, 1u);
+  set_ex_all(cpu_t::EX_OP_UTOF, 4u, 1u);
+  set_ex_all(cpu_t::EX_OP_FTOI, 4u, 1u);
+  set_ex_all(cpu_t::EX_OP_FTOU, 4u, 1u);
+  set_ex_all(cpu_t::EX_OP_FTOIR, 4u, 1u);
+  set_ex_all(cpu_t::EX_OP_FTOUR, 4u, 1u);
+
+  // Iterative (non-pipelined) division and square root. The number of iterations depends on the
+  // number of significant bits per packed element.
+  const uint32_t INT_DIV_CYCLES[] = {34u, 10u, 18u, 34u};
+  const uint32_t FLOAT_DIV_CYCLES[] = {26u, 8u, 14u, 26u};
+  for (uint32_t packed_mode = 0u; packed_mode < NUM_PACKED_MODES; ++packed_mode) {
+    const auto int_cycles = INT_DIV_CYCLES[packed_mode];
+    const auto float_cycles = FLOAT_DIV_CYCLES[packed_mode];
+    set_ex(cpu_t::EX_OP_DIV, packed_mode, int_cycles, int_cycles);
+    set_ex(cpu_t::EX_OP_DIVU, packed_mode, int_cycles, int_cycles);
+    set_ex(cpu_t::EX_OP_REM, packed_mode, int_cycles, int_cycles);
+    set_ex(cpu_t::EX_OP_REMU, packed_mode, int_cycles, int_cycles);
+    set_ex(cpu_t::EX_OP_FDIV, packed_mode, float_cycles, float_cycles);
+    set_ex(cpu_t::EX_OP_FSQRT, packed_mode, float_cycles, float_cycles);
+  }
+
+  // Loads have a one cycle load-use penalty.
+  m_mem_entries[cpu_t::MEM_OP_LOAD8] = entry_t{2u, 1u};
+  m_mem_entries[cpu_t::MEM_OP_LOAD16] = entry_t{2u, 1u};
+  m_mem_entries[cpu_t::MEM_OP_LOAD32] = entry_t{2u, 1u};
+  m_mem_entries[cpu_t::MEM_OP_LOADU8] = entry_t{2u, 1u};
+  m_mem_entries[cpu_t::MEM_OP_LOADU16] = entry_t{2u, 1u};
+}
+
+void latency_model_t::load(const std::string& file_name) {
+  std::ifstream file(file_name);
+  if (!file.is_open()) {
+    throw std::runtime_error("Unable to open " + file_name);
+  }
+
+  std::string line;
+  int line_no = 0;
+  while (std::getline(file, line)) {
+    ++line_no;
+    std::istringstream ss(line);
+    std::string name;
+    if (!(ss >> name) || name[0] == '#') {
+      continue;
+    }
+    const auto error = [&file_name, line_no](const std::string& msg) {
+      return std::runtime_error(file_name + ":" + std::to_string(line_no) + ": " + msg);
+    };
+
+    // Parse the cycle counts.
+    std::string latency_str;
+    std::string interval_str = "1";
+    std::string trailing;
+    ss >> latency_str >> interval_str >> trailing;
+    const auto latency = parse_cycles(latency_str);
+    const auto interval = parse_cycles(interval_str);
+    if (latency == 0u || interval == 0u || (!trailing.empty() && trailing[0] != '#')) {
+      throw error("Expected: mnemonic latency [interval]");
+    }
+
+    // Split the packed mode suffix from the mnemonic.
+    uint32_t packed_mode = NUM_PACKED_MODES;  // All packed modes.
+    const auto dot_pos = name.find('.');
+    if (dot_pos != std::string::npos) {
+      const auto suffix = name.substr(dot_pos + 1);
+      name = name.substr(0, dot_pos);
+      if (suffix == "b") {
+        packed_mode = 1u;
+      } else if (suffix == "h") {
+        packed_mode = 2u;
+      } else {
+        throw error("Invalid packed mode suffix: ." + suffix);
+      }
+    }
+
+    const auto new_entry = entry_t{latency, interval};
+    uint32_t op;
+    if (find_ex_op(name, op)) {
+      if (packed_mode == NUM_PACKED_MODES) {
+        set_ex_all(op, new_entry.latency, new_entry.interval);
+      } else {
+        set_ex(op, packed_mode, new_entry.latency, new_entry.interval);
+      }
+    } else if (find_mem_op(name, op)) {
+      if (packed_mode != NUM_PACKED_MODES) {
+        throw error("Packed mode suffixes are not supported for memory operations");
+      }
+      m_mem_entries[op] = new_entry;
+    } else {
+      throw error("Unknown instruction: " + name);
+    }
+  }
+}
+
+void latency_model_t::set_ex(const uint32_t ex_op,
+                             const uint32_t packed_mode,
+                             const uint32_t latency,
+                             const uint32_t interval) {
+  m_ex_entries[ex_index(ex_op) * NUM_PACKED_MODES + packed_mode] = entry_t{latency, interval};
+}
+
+void latency_model_t::set_ex_all(const uint32_t ex_op,
+                                 const uint32_t latency,
+                                 const uint32_t interval) {
+  for (uint32_t packed_mode = 0u; packed_mode < NUM_PACKED_MODES; ++packed_mode) {
+    set_ex(ex_op, packed_mode, latency, interval);
+  }
+}
+
+bool latency_model_t::find_ex_op(const std::string& name, uint32_t& op) {
+  // EX operations (by assembler mnemonic).
+  static const op_name_t EX_OP_NAMES[] = {
+      {"ldi", cpu_t::EX_OP_LDI},
+      {"addpc", cpu_t::EX_OP_ADDPC},
+      {"addpchi", cpu_t::EX_OP_ADDPCHI},
+      {"and", cpu_t::EX_OP_AND},
+      {"or", cpu_t::EX_OP_OR},
+      {"xor", cpu_t::EX_OP_XOR},
+      {"ebf", cpu_t::EX_OP_EBF},
+      {"ebfu", cpu_t::EX_OP_EBFU},
+      {"mkbf", cpu_t::EX_OP_MKBF},
+      {"add", cpu_t::EX_OP_ADD},
+      {"sub", cpu_t::EX_OP_SUB},
+      {"min", cpu_t::EX_OP_MIN},
+      {"max", cpu_t::EX_OP_MAX},
+      {"minu", cpu_t::EX_OP_MINU},
+      {"maxu", cpu_t::EX_OP_MAXU},
+      {"seq", cpu_t::EX_OP_SEQ},
+      {"sne", cpu_t::EX_OP_SNE},
+      {"slt", cpu_t::EX_OP_SLT},
+      {"sltu", cpu_t::EX_OP_SLTU},
+      {"sle", cpu_t::EX_OP_SLE},
+      {"sleu", cpu_t::EX_OP_SLEU},
+      {"shuf", cpu_t::EX_OP_SHUF},
+      {"xchgsr", cpu_t::EX_OP_XCHGSR},
+      {"mul", cpu_t::EX_OP_MUL},
+      {"div", cpu_t::EX_OP_DIV},
+      {"divu", cpu_t::EX_OP_DIVU},
+      {"rem", cpu_t::EX_OP_REM},
+      {"remu", cpu_t::EX_OP_REMU},
+      {"madd", cpu_t::EX_OP_MADD},
+      {"sel", cpu_t::EX_OP_SEL},
+      {"ibf", cpu_t::EX_OP_IBF},
+      {"mulhi", cpu_t::EX_OP_MULHI},
+      {"mulhiu", cpu_t::EX_OP_MULHIU},
+      {"mulq", cpu_t::EX_OP_MULQ},
+      {"mulqr", cpu_t::EX_OP_MULQR},
+      {"pack", cpu_t::EX_OP_PACK},
+      {"packs", cpu_t::EX_OP_PACKS},
+      {"packsu", cpu_t::EX_OP_PACKSU},
+      {"packhi", cpu_t::EX_OP_PACKHI},
+      {"packhir", cpu_t::EX_OP_PACKHIR},
+      {"packhiur", cpu_t::EX_OP_PACKHIUR},
+      {"fmin", cpu_t::EX_OP_FMIN},
+      {"fmax", cpu_t::EX_OP_FMAX},
+      {"fseq", cpu_t::EX_OP_FSEQ},
+      {"fsne", cpu_t::EX_OP_FSNE},
+      {"fslt", cpu_t::EX_OP_FSLT},
+      {"fsle", cpu_t::EX_OP_FSLE},
+      {"fsunord", cpu_t::EX_OP_FSUNORD},
+      {"fsord", cpu_t::EX_OP_FSORD},
+      {"itof", cpu_t::EX_OP_ITOF},
+      {"utof", cpu_t::EX_OP_UTOF},
+      {"ftoi", cpu_t::EX_OP_FTOI},
+      {"ftou", cpu_t::EX_OP_FTOU},
+      {"ftoir", cpu_t::EX_OP_FTOIR},
+      {"ftour", cpu_t::EX_OP_FTOUR},
+      {"fpack", cpu_t::EX_OP_FPACK},
+      {"fadd", cpu_t::EX_OP_FADD},
+      {"fsub", cpu_t::EX_OP_FSUB},
+      {"fmul", cpu_t::EX_OP_FMUL},
+      {"fdiv", cpu_t::EX_OP_FDIV},
+      {"adds", cpu_t::EX_OP_ADDS},
+      {"addsu", cpu_t::EX_OP_ADDSU},
+      {"addh", cpu_t::EX_OP_ADDH},
+      {"addhu", cpu_t::EX_OP_ADDHU},
+      {"addhr", cpu_t::EX_OP_ADDHR},
+      {"addhur", cpu_t::EX_OP_ADDHUR},
+      {"subs", cpu_t::EX_OP_SUBS},
+      {"subsu", cpu_t::EX_OP_SUBSU},
+      {"subh", cpu_t::EX_OP_SUBH},
+      {"subhu", cpu_t::EX_OP_SUBHU},
+      {"subhr", cpu_t::EX_OP_SUBHR},
+      {"subhur", cpu_t::EX_OP_SUBHUR},
+      {"rev", cpu_t::EX_OP_REV},
+      {"clz", cpu_t::EX_OP_CLZ},
+      {"popcnt", cpu_t::EX_OP_POPCNT},
+      {"funpl", cpu_t::EX_OP_FUNPL},
+      {"funph", cpu_t::EX_OP_FUNPH},
+      {"fsqrt", cpu_t::EX_OP_FSQRT},
+      {"wait", cpu_t::EX_OP_WAIT},
+      {"sync", cpu_t::EX_OP_SYNC},
+      {"cctrl", cpu_t::EX_OP_CCTRL},
+      {"crc32c", cpu_t::EX_OP_CRC32C},
+      {"crc32", cpu_t::EX_OP_CRC32},
+  };
+  return find_op(EX_OP_NAMES, sizeof(EX_OP_NAMES) / sizeof(EX_OP_NAMES[0]), name, op);
+}
+
+bool latency_model_t::find_mem_op(const std::string& name, uint32_t& op) {
+  // MEM operations (by assembler mnemonic).
+  static const op_name_t MEM_OP_NAMES[] = {
+      {"ldb", cpu_t::MEM_OP_LOAD8},
+      {"ldh", cpu_t::MEM_OP_LOAD16},
+      {"ldw", cpu_t::MEM_OP_LOAD32},
+      {"ldub", cpu_t::MEM_OP_LOADU8},
+      {"lduh", cpu_t::MEM_OP_LOADU16},
+      {"ldea", cpu_t::MEM_OP_LDEA},
+      {"stb", cpu_t::MEM_OP_STORE8},
+      {"sth", cpu_t::MEM_OP_STORE16},
+      {"stw", cpu_t::MEM_OP_STORE32},
+  };
+  return find_op(MEM_OP_NAMES, sizeof(MEM_OP_NAMES) / sizeof(MEM_OP_NAMES[0]), name, op);
+}
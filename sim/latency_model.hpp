@@ -0,0 +1,101 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_LATENCY_MODEL_HPP_
+#define SIM_LATENCY_MODEL_HPP_
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/// @brief Instruction cost model.
+///
+/// The model assigns a latency (in cycles) and an issue interval (the number of cycles before the
+/// next vector element can start) to each combination of EX operation, packed mode and MEM
+/// operation. A scalar instruction costs its latency, and a vector instruction costs its latency
+/// for the first element plus the issue interval for each subsequent element.
+///
+/// The default values approximate the MRISC32-A1 implementation. They can be overridden by a
+/// latency file, where each line has the form:
+///
+///   mnemonic[.b|.h] latency [interval]
+///
+/// The mnemonic is an instruction name as used in assembly language (e.g. "fdiv", "mulhi.h" or
+/// "ldw"). Packed mode suffixes only apply to the EX operations. If the interval is omitted, the
+/// operation is assumed to be fully pipelined (interval = 1). Empty lines and lines starting with
+/// '#' are ignored.
+class latency_model_t {
+public:
+  latency_model_t();
+
+  /// @brief Load latency overrides from a file.
+  /// @param file_name The name of the latency file.
+  /// @throws std::runtime_error if the file can not be read or parsed.
+  void load(const std::string& file_name);
+
+  /// @brief Get the number of cycles for the first element of an instruction.
+  uint32_t latency(const uint32_t ex_op, const uint32_t packed_mode, const uint32_t mem_op) const {
+    return entry(ex_op, packed_mode, mem_op).latency;
+  }
+
+  /// @brief Get the number of cycles for each subsequent element of a vector instruction.
+  uint32_t interval(const uint32_t ex_op, const uint32_t packed_mode, const uint32_t mem_op) const {
+    return entry(ex_op, packed_mode, mem_op).interval;
+  }
+
+private:
+  struct entry_t {
+    uint32_t latency;
+    uint32_t interval;
+  };
+
+  // EX operations are mapped to a compact index. Type A and C operations use the low seven bits,
+  // and the type B operations (0x7c-0x7e) are mapped to 0x80 + 64 * (op - 0x7c) + sub-op.
+  static const uint32_t NUM_EX_INDICES = 0x80u + 3u * 64u;
+  static const uint32_t NUM_PACKED_MODES = 4u;
+  static const uint32_t NUM_MEM_OPS = 16u;
+
+  static uint32_t ex_index(const uint32_t ex_op) {
+    const auto op = ex_op & 0x7fu;
+    return (op < 0x7cu) ? op : (0x80u + ((op - 0x7cu) << 6) + ((ex_op >> 8) & 0x3fu));
+  }
+
+  const entry_t& entry(const uint32_t ex_op,
+                       const uint32_t packed_mode,
+                       const uint32_t mem_op) const {
+    if (mem_op != 0u) {
+      return m_mem_entries[mem_op & (NUM_MEM_OPS - 1u)];
+    }
+    return m_ex_entries[ex_index(ex_op) * NUM_PACKED_MODES + (packed_mode & 3u)];
+  }
+
+  static bool find_ex_op(const std::string& name, uint32_t& op);
+  static bool find_mem_op(const std::string& name, uint32_t& op);
+
+  void set_ex(const uint32_t ex_op,
+              const uint32_t packed_mode,
+              const uint32_t latency,
+              const uint32_t interval);
+  void set_ex_all(const uint32_t ex_op, const uint32_t latency, const uint32_t interval);
+
+  std::array<entry_t, NUM_EX_INDICES * NUM_PACKED_MODES> m_ex_entries;
+  std::array<entry_t, NUM_MEM_OPS> m_mem_entries;
+};
+
+#endif  // SIM_LATENCY_MODEL_HPP_
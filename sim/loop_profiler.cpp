@@ -0,0 +1,119 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "loop_profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+// Number of loops to report.
+const std::size_t MAX_LOOPS = 20u;
+
+struct loop_summary_t {
+  uint32_t header;
+  uint32_t pc;
+  uint64_t entries;
+  uint64_t iterations;
+  double cycles;
+};
+}  // namespace
+
+void loop_profiler_t::reset() {
+  m_loops.clear();
+  m_active_loops.clear();
+  m_last_loop = nullptr;
+}
+
+loop_profiler_t::loop_t& loop_profiler_t::find_loop(const uint32_t pc, const uint32_t target) {
+  auto it = m_loops.find(pc);
+  if (it == m_loops.end()) {
+    it = m_loops.emplace(pc, loop_t{target, pc, 0u, 0u, 0u, 0u, 0u, 0u, false}).first;
+  }
+  return it->second;
+}
+
+void loop_profiler_t::deactivate(loop_t& loop) {
+  loop.active = false;
+  m_active_loops.erase(std::find(m_active_loops.begin(), m_active_loops.end(), &loop));
+}
+
+void loop_profiler_t::leave_loops(const uint32_t pc, const uint32_t target) {
+  // Jumps from code outside of a loop (e.g. returns from called functions) do not leave the loop.
+  for (auto it = m_active_loops.begin(); it != m_active_loops.end();) {
+    auto& loop = **it;
+    const bool from_loop = (pc >= loop.header && pc <= loop.branch);
+    const bool to_loop = (target >= loop.header && target <= loop.branch);
+    if (from_loop && !to_loop) {
+      loop.active = false;
+      it = m_active_loops.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void loop_profiler_t::print_stats(perf_symbols_t& perf_symbols) const {
+  // Summarize the loops. The cycles of the first iteration of each loop entry are not measured
+  // (there is no previous back-edge), so they are estimated from the average iteration time.
+  std::vector<loop_summary_t> loops;
+  for (const auto& item : m_loops) {
+    const auto& loop = item.second;
+    loop_summary_t summary;
+    summary.header = loop.header;
+    summary.pc = item.first;
+    summary.entries = loop.entries;
+    summary.iterations = loop.taken + loop.entries;
+    summary.cycles = static_cast<double>(loop.cycles);
+    if (loop.measured > 0u) {
+      summary.cycles += static_cast<double>(loop.entries) * static_cast<double>(loop.cycles) /
+                        static_cast<double>(loop.measured);
+    }
+    loops.push_back(summary);
+  }
+  std::sort(loops.begin(), loops.end(), [](const loop_summary_t& a, const loop_summary_t& b) {
+    return (a.cycles != b.cycles) ? (a.cycles > b.cycles) : (a.pc < b.pc);
+  });
+  loops.resize(std::min(loops.size(), MAX_LOOPS));
+
+  printf("Hot loops (%lu detected):\n", static_cast<unsigned long>(m_loops.size()));
+  if (loops.empty()) {
+    return;
+  }
+  printf(" Cycles       Iterations   Entries      Avg. trip  Header      Branch      Function\n");
+  for (const auto& loop : loops) {
+    auto name = perf_symbols.symbol_name(loop.header);
+    if (name.empty()) {
+      name = "-";
+    }
+    const auto avg_trip = (loop.entries > 0u) ? static_cast<double>(loop.iterations) /
+                                                    static_cast<double>(loop.entries)
+                                              : 0.0;
+    printf(" %-12.0f %-12lu %-12lu %-10.1f 0x%08x  0x%08x  %s\n",
+           loop.cycles,
+           static_cast<unsigned long>(loop.iterations),
+           static_cast<unsigned long>(loop.entries),
+           avg_trip,
+           loop.header,
+           loop.pc,
+           name.c_str());
+  }
+}
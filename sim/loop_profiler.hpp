@@ -0,0 +1,121 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_LOOP_PROFILER_HPP_
+#define SIM_LOOP_PROFILER_HPP_
+
+#include "perf_symbols.hpp"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// @brief A hot-loop detector.
+///
+/// Loops are detected at run time as backward conditional branches (b[cc] instructions with a
+/// target address below the branch address). The branch target is the loop header, and the branch
+/// itself closes the loop. For each loop, the profiler counts the number of times the loop was
+/// entered, the number of iterations and the number of cycles spent in the loop (including any
+/// called functions and inner loops).
+///
+/// A loop is left when its back-edge branch is not taken, or when a taken branch or jump (other
+/// than a subroutine call) inside the loop goes to an address outside of the loop (e.g. a break or
+/// a return). The next back-edge then starts a new entry of the loop.
+class loop_profiler_t {
+public:
+  /// @brief Clear the statistics.
+  void reset();
+
+  /// @brief Record the execution of a backward conditional branch.
+  /// @param pc The branch address.
+  /// @param target The branch target address (the loop header).
+  /// @param taken True if the branch was taken (i.e. the loop continues).
+  /// @param cycle The current cycle.
+  void back_edge(const uint32_t pc,
+                 const uint32_t target,
+                 const bool taken,
+                 const uint64_t cycle) {
+    if (m_last_loop == nullptr || pc != m_last_pc) {
+      m_last_loop = &find_loop(pc, target);
+      m_last_pc = pc;
+    }
+    auto& loop = *m_last_loop;
+    if (loop.active) {
+      loop.cycles += cycle - loop.last_cycle;
+      ++loop.measured;
+    } else {
+      ++loop.entries;
+    }
+    if (taken) {
+      ++loop.taken;
+      loop.last_cycle = cycle;
+      if (!loop.active) {
+        loop.active = true;
+        m_active_loops.push_back(&loop);
+      }
+    } else {
+      ++loop.not_taken;
+      if (loop.active) {
+        deactivate(loop);
+      }
+    }
+  }
+
+  /// @brief Record a taken branch or jump (excluding subroutine calls).
+  /// @param pc The branch address.
+  /// @param target The branch target address.
+  void jump(const uint32_t pc, const uint32_t target) {
+    if (!m_active_loops.empty()) {
+      leave_loops(pc, target);
+    }
+  }
+
+  /// @brief Print the hottest loops.
+  /// @param perf_symbols Symbols for function names.
+  void print_stats(perf_symbols_t& perf_symbols) const;
+
+private:
+  struct loop_t {
+    uint32_t header;
+    uint32_t branch;
+    uint64_t taken;      // Number of times the loop continued.
+    uint64_t not_taken;  // Number of times the loop was exited through the back-edge branch.
+    uint64_t entries;    // Number of times the loop was entered.
+    uint64_t cycles;     // Cycles of the measured (all but the first) iterations.
+    uint64_t measured;   // Number of measured iterations.
+    uint64_t last_cycle;
+    bool active;
+  };
+
+  loop_t& find_loop(const uint32_t pc, const uint32_t target);
+  void deactivate(loop_t& loop);
+  void leave_loops(const uint32_t pc, const uint32_t target);
+
+  // Loops, by back-edge branch address.
+  std::unordered_map<uint32_t, loop_t> m_loops;
+
+  // The loops that are currently active (usually only a few nested loops).
+  std::vector<loop_t*> m_active_loops;
+
+  // Cache for the most recently executed loop.
+  loop_t* m_last_loop = nullptr;
+  uint32_t m_last_pc = 0u;
+};
+
+#endif  // SIM_LOOP_PROFILER_HPP_
@@ -0,0 +1,299 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "mem_profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+uint64_t parse_number(const std::string& key, const std::string& value) {
+  std::size_t pos = 0;
+  unsigned long long result = 0u;
+  try {
+    result = std::stoull(value, &pos, 0);
+  } catch (...) {
+    pos = 0;
+  }
+  if (pos == 0 || pos != value.size()) {
+    throw std::runtime_error("Invalid memory profiler " + key + ": " + value);
+  }
+  return static_cast<uint64_t>(result);
+}
+
+bool is_pow2(const uint64_t x) {
+  return x != 0u && (x & (x - 1u)) == 0u;
+}
+
+uint32_t log2_u32(uint32_t x) {
+  uint32_t result = 0u;
+  while (x > 1u) {
+    x >>= 1;
+    ++result;
+  }
+  return result;
+}
+
+double percent(const uint64_t part, const uint64_t total) {
+  return (total > 0u) ? (100.0 * static_cast<double>(part) / static_cast<double>(total)) : 0.0;
+}
+}  // namespace
+
+mem_profiler_t::params_t mem_profiler_t::parse_params(const std::string& spec) {
+  params_t params;
+  if (spec == "default") {
+    return params;
+  }
+  std::istringstream ss(spec);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.empty()) {
+      continue;
+    }
+    const auto eq_pos = item.find('=');
+    if (eq_pos == std::string::npos) {
+      throw std::runtime_error("Invalid memory profiler parameter (expected key=value): " + item);
+    }
+    const auto key = item.substr(0, eq_pos);
+    const auto value = item.substr(eq_pos + 1);
+    if (key == "file") {
+      params.file_name = value;
+    } else if (key == "block") {
+      const auto block_size = parse_number(key, value);
+      if (!is_pow2(block_size) || block_size < 4u || block_size > 0x10000000u) {
+        throw std::runtime_error("The memory profiler block size must be a power of 2");
+      }
+      params.block_size = static_cast<uint32_t>(block_size);
+    } else if (key == "window") {
+      params.window = parse_number(key, value);
+      if (params.window == 0u) {
+        throw std::runtime_error("The memory profiler window must be at least one cycle");
+      }
+    } else if (key == "top") {
+      params.top_n = static_cast<uint32_t>(parse_number(key, value));
+    } else {
+      throw std::runtime_error("Unknown memory profiler parameter: " + key);
+    }
+  }
+  return params;
+}
+
+mem_profiler_t::mem_profiler_t(const params_t& params)
+    : m_params(params), m_block_shift(log2_u32(params.block_size)) {
+  if (!m_params.file_name.empty()) {
+    m_file.open(m_params.file_name, std::ios::out);
+    if (!m_file.is_open()) {
+      throw std::runtime_error("Unable to create file " + m_params.file_name);
+    }
+    m_file << "cycle,address,loads,stores\n";
+  }
+  reset();
+}
+
+void mem_profiler_t::reset() {
+  m_window_start = 0u;
+  m_window_blocks.clear();
+  m_instr_stats.clear();
+  m_blocks.clear();
+  std::fill(&m_patterns[0][0], &m_patterns[0][0] + 2 * NUM_PATTERNS, 0u);
+}
+
+void mem_profiler_t::access(const uint32_t pc,
+                            const uint32_t addr,
+                            const uint32_t size,
+                            const bool is_store,
+                            const bool is_vector,
+                            const uint64_t cycle) {
+  // Heatmap.
+  if (cycle >= m_window_start + m_params.window) {
+    flush_window();
+    m_window_start = cycle - (cycle % m_params.window);
+  }
+  const auto block = addr >> m_block_shift;
+  auto& window_block = m_window_blocks[block];
+  auto& total_block = m_blocks[block];
+  if (is_store) {
+    ++window_block.stores;
+    ++total_block.stores;
+  } else {
+    ++window_block.loads;
+    ++total_block.loads;
+  }
+
+  // Classify the access pattern, based on the previous access by the same instruction (for vector
+  // operations that is usually the previous element).
+  auto& instr = m_instr_stats[pc];
+  if (instr.has_last) {
+    const auto delta = static_cast<int64_t>(addr) - static_cast<int64_t>(instr.last_addr);
+    pattern_t pattern;
+    if (delta >= -static_cast<int64_t>(size) && delta <= static_cast<int64_t>(size)) {
+      pattern = SEQUENTIAL;
+    } else if (delta == instr.last_delta) {
+      pattern = STRIDED;
+    } else {
+      pattern = RANDOM;
+    }
+    ++instr.patterns[pattern];
+    ++m_patterns[is_vector ? 1 : 0][pattern];
+    instr.last_delta = delta;
+  }
+  instr.last_addr = addr;
+  instr.has_last = true;
+  if (is_store) {
+    ++instr.stores;
+  } else {
+    ++instr.loads;
+  }
+  if (is_vector) {
+    ++instr.vector_accesses;
+  }
+}
+
+void mem_profiler_t::finish() {
+  flush_window();
+  if (m_file.is_open()) {
+    m_file.flush();
+  }
+}
+
+void mem_profiler_t::flush_window() {
+  if (m_file.is_open() && !m_window_blocks.empty()) {
+    std::vector<std::pair<uint32_t, block_stats_t>> blocks(m_window_blocks.begin(),
+                                                           m_window_blocks.end());
+    std::sort(blocks.begin(),
+              blocks.end(),
+              [](const std::pair<uint32_t, block_stats_t>& a,
+                 const std::pair<uint32_t, block_stats_t>& b) { return a.first < b.first; });
+    for (const auto& block : blocks) {
+      char addr[16];
+      snprintf(addr, sizeof(addr), "0x%08x", static_cast<uint32_t>(block.first << m_block_shift));
+      m_file << m_window_start << "," << addr << "," << block.second.loads << ","
+             << block.second.stores << "\n";
+    }
+  }
+  m_window_blocks.clear();
+}
+
+void mem_profiler_t::print_stats(perf_symbols_t& perf_symbols) const {
+  static const char* PATTERN_NAMES[NUM_PATTERNS] = {"Sequential", "Strided", "Random"};
+
+  uint64_t loads = 0u;
+  uint64_t stores = 0u;
+  for (const auto& block : m_blocks) {
+    loads += block.second.loads;
+    stores += block.second.stores;
+  }
+  printf("Memory profile (%u byte blocks):\n", m_params.block_size);
+  printf(" Loads:                %lu\n", static_cast<unsigned long>(loads));
+  printf(" Stores:               %lu\n", static_cast<unsigned long>(stores));
+  printf(" Blocks touched:       %lu\n", static_cast<unsigned long>(m_blocks.size()));
+
+  // Access pattern summary.
+  printf(" Pattern      Scalar       Vector\n");
+  uint64_t totals[2] = {0u, 0u};
+  for (int p = 0; p < NUM_PATTERNS; ++p) {
+    totals[0] += m_patterns[0][p];
+    totals[1] += m_patterns[1][p];
+  }
+  for (int p = 0; p < NUM_PATTERNS; ++p) {
+    printf(" %-10s   %6.2f%%      %6.2f%%\n",
+           PATTERN_NAMES[p],
+           percent(m_patterns[0][p], totals[0]),
+           percent(m_patterns[1][p], totals[1]));
+  }
+
+  // Aggregate the instruction statistics per function (or per instruction if there are no symbols
+  // for the address).
+  std::map<std::string, instr_stats_t> functions;
+  for (const auto& item : m_instr_stats) {
+    auto name = perf_symbols.symbol_name(item.first);
+    if (name.empty()) {
+      char buf[16];
+      snprintf(buf, sizeof(buf), "0x%08x", item.first);
+      name = buf;
+    }
+    auto it = functions.find(name);
+    if (it == functions.end()) {
+      it = functions.emplace(name, instr_stats_t()).first;
+    }
+    auto& stats = it->second;
+    stats.loads += item.second.loads;
+    stats.stores += item.second.stores;
+    stats.vector_accesses += item.second.vector_accesses;
+    for (int p = 0; p < NUM_PATTERNS; ++p) {
+      stats.patterns[p] += item.second.patterns[p];
+    }
+  }
+
+  std::vector<std::pair<std::string, instr_stats_t>> sorted(functions.begin(), functions.end());
+  const auto num_functions = std::min(sorted.size(), static_cast<std::size_t>(m_params.top_n));
+  std::partial_sort(sorted.begin(),
+                    sorted.begin() + num_functions,
+                    sorted.end(),
+                    [](const std::pair<std::string, instr_stats_t>& a,
+                       const std::pair<std::string, instr_stats_t>& b) {
+                      const auto a_count = a.second.loads + a.second.stores;
+                      const auto b_count = b.second.loads + b.second.stores;
+                      return a_count > b_count;
+                    });
+  if (num_functions > 0u) {
+    printf(" Function                         Loads        Stores       Vector   Seq      "
+           "Strided  Random\n");
+  }
+  for (std::size_t i = 0u; i < num_functions; ++i) {
+    const auto& stats = sorted[i].second;
+    const auto accesses = stats.loads + stats.stores;
+    const auto classified = stats.patterns[SEQUENTIAL] + stats.patterns[STRIDED] +
+                            stats.patterns[RANDOM];
+    printf(" %-32s %-12lu %-12lu %6.2f%%  %6.2f%%  %6.2f%%  %6.2f%%\n",
+           sorted[i].first.c_str(),
+           static_cast<unsigned long>(stats.loads),
+           static_cast<unsigned long>(stats.stores),
+           percent(stats.vector_accesses, accesses),
+           percent(stats.patterns[SEQUENTIAL], classified),
+           percent(stats.patterns[STRIDED], classified),
+           percent(stats.patterns[RANDOM], classified));
+  }
+
+  // List the hottest blocks.
+  std::vector<std::pair<uint32_t, block_stats_t>> blocks(m_blocks.begin(), m_blocks.end());
+  const auto num_blocks = std::min(blocks.size(), static_cast<std::size_t>(m_params.top_n));
+  std::partial_sort(blocks.begin(),
+                    blocks.begin() + num_blocks,
+                    blocks.end(),
+                    [](const std::pair<uint32_t, block_stats_t>& a,
+                       const std::pair<uint32_t, block_stats_t>& b) {
+                      const auto a_count = a.second.loads + a.second.stores;
+                      const auto b_count = b.second.loads + b.second.stores;
+                      return (a_count != b_count) ? (a_count > b_count) : (a.first < b.first);
+                    });
+  if (num_blocks > 0u) {
+    printf(" Block        Loads        Stores\n");
+  }
+  for (std::size_t i = 0u; i < num_blocks; ++i) {
+    printf(" 0x%08x   %-12lu %lu\n",
+           static_cast<uint32_t>(uint64_t(blocks[i].first) << m_block_shift),
+           static_cast<unsigned long>(blocks[i].second.loads),
+           static_cast<unsigned long>(blocks[i].second.stores));
+  }
+}
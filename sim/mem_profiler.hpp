@@ -0,0 +1,122 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_MEM_PROFILER_HPP_
+#define SIM_MEM_PROFILER_HPP_
+
+#include "perf_symbols.hpp"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+
+/// @brief A data memory access profiler.
+///
+/// The profiler counts loads and stores per memory block (e.g. a 64-byte cache line or a 4 KiB
+/// page), and classifies the access pattern of each memory instruction as sequential, strided or
+/// random (for scalar and vector accesses separately).
+///
+/// The block counts can be dumped to a CSV file as a heatmap over time windows, and the access
+/// patterns are attributed to functions when perf symbols are available.
+class mem_profiler_t {
+public:
+  /// @brief Memory profiler configuration.
+  struct params_t {
+    std::string file_name;       ///< Heatmap CSV file (empty for no heatmap).
+    uint32_t block_size = 64u;   ///< Block size (bytes).
+    uint64_t window = 1000000u;  ///< Heatmap time window (cycles).
+    uint32_t top_n = 20u;        ///< Number of functions and blocks to report.
+  };
+
+  /// @brief Parse a memory profiler specification string.
+  ///
+  /// The specification is "default" or a comma separated list of key=value pairs, where the keys
+  /// are: file (heatmap CSV file), block (block size in bytes), window (heatmap time window in
+  /// cycles) and top (number of functions and blocks to report).
+  /// @throws std::runtime_error if the specification is invalid.
+  static params_t parse_params(const std::string& spec);
+
+  /// @brief Constructor.
+  /// @throws std::runtime_error if the heatmap file can not be created.
+  explicit mem_profiler_t(const params_t& params);
+
+  /// @brief Clear the statistics.
+  void reset();
+
+  /// @brief Record a data memory access.
+  /// @param pc The address of the memory instruction.
+  /// @param addr The data address.
+  /// @param size The access size (in bytes).
+  /// @param is_store True for stores.
+  /// @param is_vector True for vector element accesses.
+  /// @param cycle The current cycle (for the heatmap time windows).
+  void access(const uint32_t pc,
+              const uint32_t addr,
+              const uint32_t size,
+              const bool is_store,
+              const bool is_vector,
+              const uint64_t cycle);
+
+  /// @brief Write the last (partial) heatmap time window.
+  void finish();
+
+  /// @brief Print the access pattern statistics.
+  /// @param perf_symbols Symbols for per function attribution.
+  void print_stats(perf_symbols_t& perf_symbols) const;
+
+private:
+  enum pattern_t { SEQUENTIAL = 0, STRIDED = 1, RANDOM = 2, NUM_PATTERNS = 3 };
+
+  struct block_stats_t {
+    uint64_t loads;
+    uint64_t stores;
+  };
+
+  struct instr_stats_t {
+    uint32_t last_addr;
+    int64_t last_delta;
+    bool has_last;
+    uint64_t loads;
+    uint64_t stores;
+    uint64_t vector_accesses;
+    uint64_t patterns[NUM_PATTERNS];
+  };
+
+  void flush_window();
+
+  const params_t m_params;
+  uint32_t m_block_shift;
+  std::ofstream m_file;
+
+  // Current heatmap time window.
+  uint64_t m_window_start = 0u;
+  std::unordered_map<uint32_t, block_stats_t> m_window_blocks;
+
+  // Per instruction statistics.
+  std::unordered_map<uint32_t, instr_stats_t> m_instr_stats;
+
+  // Access pattern totals, indexed by [is_vector][pattern].
+  uint64_t m_patterns[2][NUM_PATTERNS];
+
+  // Per block totals.
+  std::unordered_map<uint32_t, block_stats_t> m_blocks;
+};
+
+#endif  // SIM_MEM_PROFILER_HPP_
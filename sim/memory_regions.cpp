@@ -0,0 +1,191 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "memory_regions.hpp"
+
+#include "mmio.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+uint32_t parse_number(const std::string& key, const std::string& value) {
+  std::size_t pos = 0;
+  unsigned long result = 0u;
+  try {
+    result = std::stoul(value, &pos, 0);
+  } catch (...) {
+    pos = 0;
+  }
+  if (pos == 0 || pos != value.size() || result > 0xffffffffu) {
+    throw std::runtime_error("Invalid memory region " + key + ": " + value);
+  }
+  return static_cast<uint32_t>(result);
+}
+
+std::string hex32(const uint64_t x) {
+  std::ostringstream ss;
+  ss << "0x" << std::hex << std::setw(8) << std::setfill('0') << x;
+  return ss.str();
+}
+}  // namespace
+
+memory_regions_t::params_t memory_regions_t::parse_params(const std::string& spec) {
+  params_t params;
+  if (spec == "default") {
+    return params;
+  }
+  std::istringstream ss(spec);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.empty()) {
+      continue;
+    }
+    const auto eq_pos = item.find('=');
+    if (eq_pos == std::string::npos) {
+      throw std::runtime_error("Invalid memory region parameter (expected key=value): " + item);
+    }
+    const auto key = item.substr(0, eq_pos);
+    const auto value = item.substr(eq_pos + 1);
+    if (key == "rom") {
+      params.rom_cycles = parse_number(key, value);
+    } else if (key == "vram") {
+      params.vram_cycles = parse_number(key, value);
+    } else if (key == "xram") {
+      params.xram_cycles = parse_number(key, value);
+    } else if (key == "mmio") {
+      params.mmio_cycles = parse_number(key, value);
+    } else if (key == "pages") {
+      params.top_n = parse_number(key, value);
+    } else {
+      throw std::runtime_error("Unknown memory region parameter: " + key);
+    }
+  }
+  return params;
+}
+
+memory_regions_t::memory_regions_t(const params_t& params) : m_params(params) {
+}
+
+void memory_regions_t::configure(ram_t& ram) {
+  // Get the RAM sizes from the MC1 system registers (if they have been populated).
+  uint32_t vram_size = 0u;
+  uint32_t xram_size = 0u;
+  if (ram.valid_range(MMIO_START, 64u)) {
+    vram_size = ram.load32(MMIO_VRAMSIZE);
+    xram_size = ram.load32(MMIO_XRAMSIZE);
+  }
+  vram_size = (vram_size != 0u) ? std::min(vram_size, XRAM_START - VRAM_START) : DEFAULT_VRAMSIZE;
+  xram_size = (xram_size != 0u) ? std::min(xram_size, MMIO_START - XRAM_START) : DEFAULT_XRAMSIZE;
+
+  // Note: The first region is the fallback for unmapped addresses.
+  m_regions.clear();
+  add_region("Unmapped", 0u, 0u, 0u);
+  add_region("ROM", ROM_START, VRAM_START, m_params.rom_cycles);
+  add_region("VRAM", VRAM_START, uint64_t(VRAM_START) + vram_size, m_params.vram_cycles);
+  add_region("XRAM", XRAM_START, uint64_t(XRAM_START) + xram_size, m_params.xram_cycles);
+  add_region("MMIO", MMIO_START, uint64_t(1) << 32, m_params.mmio_cycles);
+  m_last_region = 0u;
+}
+
+uint32_t memory_regions_t::data_access(const uint32_t addr,
+                                       const uint32_t size,
+                                       const bool is_write,
+                                       const bool reaches_memory) {
+  auto& region = find_region(addr);
+  auto& page = region.pages[addr >> LOG2_PAGE_SIZE];
+  if (is_write) {
+    ++region.writes;
+    region.bytes_written += size;
+    ++page.writes;
+  } else {
+    ++region.reads;
+    region.bytes_read += size;
+    ++page.reads;
+  }
+  return charge(region, reaches_memory);
+}
+
+memory_regions_t::region_t& memory_regions_t::find_region_slow(const uint32_t addr) {
+  for (std::size_t i = 1u; i < m_regions.size(); ++i) {
+    if (addr >= m_regions[i].start && addr < m_regions[i].end) {
+      m_last_region = i;
+      return m_regions[i];
+    }
+  }
+  return m_regions[0];
+}
+
+void memory_regions_t::add_region(const std::string& name,
+                                  const uint32_t start,
+                                  const uint64_t end,
+                                  const uint32_t cycles) {
+  region_t region = region_t();
+  region.name = name;
+  region.start = start;
+  region.end = end;
+  region.cycles = cycles;
+  m_regions.push_back(region);
+}
+
+void memory_regions_t::print_stats() const {
+  std::cout << "Memory regions:\n";
+  std::cout << " Region    Start       End         Cycles  Fetches     Reads       Writes      "
+               "Bytes read  Bytes written  Stall cycles\n";
+  for (const auto& region : m_regions) {
+    if (region.fetches == 0u && region.reads == 0u && region.writes == 0u) {
+      continue;
+    }
+    std::cout << " " << std::left << std::setfill(' ') << std::setw(10) << region.name
+              << std::setw(12) << hex32(region.start) << std::setw(12) << hex32(region.end)
+              << std::setw(8) << region.cycles << std::setw(12) << region.fetches << std::setw(12)
+              << region.reads << std::setw(12) << region.writes << std::setw(12)
+              << region.bytes_read << std::setw(15) << region.bytes_written << region.stall_cycles
+              << std::right << "\n";
+  }
+
+  // List the hottest data pages of each region.
+  for (const auto& region : m_regions) {
+    if (region.pages.empty() || m_params.top_n == 0u) {
+      continue;
+    }
+    std::vector<std::pair<uint32_t, page_stats_t>> pages(region.pages.begin(),
+                                                         region.pages.end());
+    const auto num_pages = std::min(pages.size(), static_cast<std::size_t>(m_params.top_n));
+    std::partial_sort(
+        pages.begin(), pages.begin() + num_pages, pages.end(),
+        [](const std::pair<uint32_t, page_stats_t>& a, const std::pair<uint32_t, page_stats_t>& b) {
+          const auto a_count = a.second.reads + a.second.writes;
+          const auto b_count = b.second.reads + b.second.writes;
+          return (a_count != b_count) ? (a_count > b_count) : (a.first < b.first);
+        });
+    std::cout << "Hottest data pages in " << region.name << " (" << region.pages.size()
+              << " pages touched):\n";
+    std::cout << " Page        Reads       Writes\n";
+    for (std::size_t i = 0u; i < num_pages; ++i) {
+      const auto& page = pages[i];
+      const auto page_addr = uint64_t(page.first) << LOG2_PAGE_SIZE;
+      std::cout << " " << std::left << std::setfill(' ') << std::setw(12) << hex32(page_addr)
+                << std::setw(12) << page.second.reads << page.second.writes << std::right << "\n";
+    }
+  }
+}
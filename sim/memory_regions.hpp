@@ -0,0 +1,139 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_MEMORY_REGIONS_HPP_
+#define SIM_MEMORY_REGIONS_HPP_
+
+#include "ram.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// @brief A model of the memory regions of the MC1 computer.
+///
+/// The address space is divided into regions (ROM, VRAM, XRAM and MMIO), as given by the MC1
+/// memory map and the VRAMSIZE and XRAMSIZE registers. Each region has a cost (in cycles) per
+/// memory access, and traffic statistics are collected per region and per data page.
+///
+/// When a cache is simulated, only the accesses that reach the memory are charged, i.e. cache
+/// misses and (with a write-through data cache) all stores.
+class memory_regions_t {
+public:
+  /// @brief Memory region configuration.
+  struct params_t {
+    uint32_t rom_cycles = 0u;   ///< Extra cycles per ROM access.
+    uint32_t vram_cycles = 0u;  ///< Extra cycles per VRAM access.
+    uint32_t xram_cycles = 3u;  ///< Extra cycles per XRAM access.
+    uint32_t mmio_cycles = 0u;  ///< Extra cycles per MMIO access.
+    uint32_t top_n = 8u;        ///< Number of hot pages to report per region.
+  };
+
+  /// @brief Parse a memory region specification string.
+  ///
+  /// The specification is a comma separated list of key=value pairs, where the keys are: rom,
+  /// vram, xram and mmio (extra cycles per access), and pages (the number of hot pages to report
+  /// per region). The string "default" gives the default configuration.
+  /// @throws std::runtime_error if the specification is invalid.
+  static params_t parse_params(const std::string& spec);
+
+  explicit memory_regions_t(const params_t& params);
+
+  /// @brief Set up the memory regions from the MC1 memory map, and clear the statistics.
+  /// @param ram The RAM (for reading the MMIO registers).
+  void configure(ram_t& ram);
+
+  /// @brief Account for an instruction fetch.
+  /// @param addr The instruction address.
+  /// @param reaches_memory False if the access was served by a cache.
+  /// @returns the number of stall cycles.
+  uint32_t fetch(const uint32_t addr, const bool reaches_memory) {
+    auto& region = find_region(addr);
+    ++region.fetches;
+    return charge(region, reaches_memory);
+  }
+
+  /// @brief Account for a data access.
+  /// @param addr The data address.
+  /// @param size The access size (in bytes).
+  /// @param is_write True for stores.
+  /// @param reaches_memory False if the access was served by a cache (write-through stores always
+  /// reach the memory).
+  /// @returns the number of stall cycles.
+  uint32_t data_access(const uint32_t addr,
+                       const uint32_t size,
+                       const bool is_write,
+                       const bool reaches_memory);
+
+  /// @brief Print the traffic statistics and the hottest data pages in each region.
+  void print_stats() const;
+
+private:
+  static const uint32_t LOG2_PAGE_SIZE = 12u;  // 4 KiB pages.
+
+  struct page_stats_t {
+    uint64_t reads;
+    uint64_t writes;
+  };
+
+  struct region_t {
+    std::string name;
+    uint32_t start;
+    uint64_t end;  // One past the last byte.
+    uint32_t cycles;
+
+    uint64_t fetches;
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint64_t stall_cycles;
+    std::unordered_map<uint32_t, page_stats_t> pages;
+  };
+
+  region_t& find_region(const uint32_t addr) {
+    auto* region = &m_regions[m_last_region];
+    if (addr < region->start || addr >= region->end) {
+      region = &find_region_slow(addr);
+    }
+    return *region;
+  }
+
+  region_t& find_region_slow(const uint32_t addr);
+
+  uint32_t charge(region_t& region, const bool reaches_memory) {
+    if (reaches_memory && region.cycles > 0u) {
+      region.stall_cycles += region.cycles;
+      return region.cycles;
+    }
+    return 0u;
+  }
+
+  void add_region(const std::string& name,
+                  const uint32_t start,
+                  const uint64_t end,
+                  const uint32_t cycles);
+
+  const params_t m_params;
+  std::vector<region_t> m_regions;
+  std::size_t m_last_region = 0u;
+};
+
+#endif  // SIM_MEMORY_REGIONS_HPP_
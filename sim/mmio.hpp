@@ -0,0 +1,53 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_MMIO_HPP_
+#define SIM_MMIO_HPP_
+
+#include <cstdint>
+
+// MC1 memory map.
+const uint32_t ROM_START = 0x00000000u;   // On-chip ROM.
+const uint32_t VRAM_START = 0x40000000u;  // On-chip video RAM.
+const uint32_t XRAM_START = 0x80000000u;  // External RAM.
+
+// Memory mapped I/O: MC1 system registers.
+const uint32_t MMIO_START = 0xc0000000u;
+const uint32_t MMIO_CPUCLK = MMIO_START + 8u;       // CPU clock frequency (Hz).
+const uint32_t MMIO_VRAMSIZE = MMIO_START + 12u;    // VRAM size (bytes).
+const uint32_t MMIO_XRAMSIZE = MMIO_START + 16u;    // XRAM size (bytes).
+const uint32_t MMIO_VIDFPS = MMIO_START + 28u;      // Video refresh rate (FPS * 65536).
+const uint32_t MMIO_VIDFRAMENO = MMIO_START + 32u;  // Current video frame number.
+
+// Memory mapped I/O: GPU configuration registers.
+const uint32_t MMIO_GPU_BASE = 0xc0000100u;
+const uint32_t MMIO_GPU_ADDR = MMIO_GPU_BASE + 0u;       // Start of the framebuffer memory area.
+const uint32_t MMIO_GPU_WIDTH = MMIO_GPU_BASE + 4u;      // Width of the framebuffer (in pixels).
+const uint32_t MMIO_GPU_HEIGHT = MMIO_GPU_BASE + 8u;     // Height of the framebuffer (in pixels).
+const uint32_t MMIO_GPU_DEPTH = MMIO_GPU_BASE + 12u;     // Number of bits per pixel.
+const uint32_t MMIO_GPU_FRAME_NO = MMIO_GPU_BASE + 32u;  // Current frame number (32 bits).
+const uint32_t MMIO_GPU_PAL_ADDR = MMIO_GPU_BASE + 36u;  // Start of the palette memory area.
+
+// Default values for MC1 system registers that have not been populated.
+const uint32_t DEFAULT_CPUCLK = 50000000u;
+const uint32_t DEFAULT_VIDFPS = 60u * 65536u;
+const uint32_t DEFAULT_VRAMSIZE = 512u * 1024u;
+const uint32_t DEFAULT_XRAMSIZE = 256u * 1024u * 1024u;
+
+#endif  // SIM_MMIO_HPP_
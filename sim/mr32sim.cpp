@@ -17,17 +17,30 @@
 //  3. This notice may not be removed or altered from any source distribution.
 //--------------------------------------------------------------------------------------------------
 
+#include "branch_predictor.hpp"
+#include "cache.hpp"
 #include "config.hpp"
-#include "cpu_simple.hpp"
+#include "cpu_cluster.hpp"
 #include "elf32.hpp"
+#include "exec_history.hpp"
+#include "gdb_stub.hpp"
 #include "gpu.hpp"
+#include "headless.hpp"
+#include "heap_profiler.hpp"
+#include "mem_profiler.hpp"
+#include "memory_regions.hpp"
+#include "packed_int.hpp"
 #include "perf_symbols.hpp"
 #include "ram.hpp"
+#include "soft_float.hpp"
+#include "stress_test.hpp"
+#include "watchpoints.hpp"
 
 #include <glad/glad.h>
 // Note: Keep this comment to convince clang-format to include glad.h before glfw3.h.
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cmath>
 #include <cstdint>
@@ -37,7 +50,11 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
 #include <thread>
+#include <vector>
 
 namespace {
 // Address of the start of the simulator program arguments.
@@ -172,6 +189,14 @@ ram_t* s_ram;
 
 uint32_t s_key_event_count;
 
+// Display refresh state.
+std::atomic<uint32_t> s_sim_frame_count(0u);
+std::atomic_bool s_display_wakeup(false);
+bool s_refresh_requested;
+
+// Maximum time to wait for window events or new frames in the display loop (in seconds).
+const double MAX_DISPLAY_WAIT = 0.1;
+
 uint32_t translate_key(int glfw_key) {
   // TODO(m): Add all the keys...
   switch (glfw_key) {
@@ -330,6 +355,21 @@ void mousebtnhandler(GLFWwindow* window, int button, int action, int mods) {
   s_ram->store32(0xc0000038, state);
 }
 
+void refreshhandler(GLFWwindow* window) {
+  // Unused.
+  (void)window;
+
+  // The window contents need to be repainted (e.g. after being resized or exposed).
+  s_refresh_requested = true;
+}
+
+void wake_display() {
+  // Note: glfwPostEmptyEvent() may be called from any thread.
+  if (s_display_wakeup) {
+    glfwPostEmptyEvent();
+  }
+}
+
 int adaptive_window_scale(GLFWwindow* window, int width, int height) {
   auto* monitor = window ? glfwGetWindowMonitor(window) : glfwGetPrimaryMonitor();
   if (monitor) {
@@ -384,6 +424,24 @@ uint32_t read_executable_file(const char* file_name, ram_t& ram, const uint32_t
   return start_addr;
 }
 
+heap_profiler_t::functions_t find_heap_functions(const char* file_name,
+                                                 const perf_symbols_t& perf_symbols) {
+  // Use the ELF symbol table, and fall back to the perf symbols (e.g. for raw binary files).
+  std::map<std::string, uint32_t> symbols;
+  elf32::load_symbols(file_name, symbols);
+  for (const auto* name : {"malloc", "free", "realloc", "calloc"}) {
+    uint32_t addr;
+    if (symbols.find(name) == symbols.end() && perf_symbols.symbol_address(name, addr)) {
+      symbols[name] = addr;
+    }
+  }
+  heap_profiler_t::functions_t functions;
+  if (!functions.find(symbols)) {
+    std::cerr << "Warning: No malloc/free symbols found, the heap profile will be empty\n";
+  }
+  return functions;
+}
+
 uint64_t str_to_uint64(const char* str) {
   return static_cast<uint64_t>(std::stoull(std::string(str), nullptr, 0));
 }
@@ -396,6 +454,16 @@ uint32_t str_to_uint32(const char* str) {
   return static_cast<uint32_t>(str_to_uint64(str));
 }
 
+std::vector<uint32_t> str_to_uint32_list(const char* str) {
+  std::vector<uint32_t> result;
+  std::istringstream ss(str);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    result.push_back(str_to_uint32(item.c_str()));
+  }
+  return result;
+}
+
 void set_simulator_args(ram_t& ram, const int argc, const char** argv) {
   ram.store32(SIM_ARGS_START, argc);
   uint32_t argv_addr = SIM_ARGS_START + 4;
@@ -421,6 +489,20 @@ void set_simulator_args(ram_t& ram, const int argc, const char** argv) {
   }
 }
 
+void set_mc1_mmio(ram_t& ram) {
+  // HACK: Populate MMIO memory with MC1 fields.
+  const uint32_t MMIO_START = 0xc0000000u;
+  if (config_t::instance().ram_size() >= (MMIO_START + 64)) {
+    ram.store32(MMIO_START + 8, 50000000);            // CPUCLK
+    ram.store32(MMIO_START + 12, 512 * 1024);         // VRAMSIZE
+    ram.store32(MMIO_START + 16, 256 * 1024 * 1024);  // XRAMSIZE
+    ram.store32(MMIO_START + 20, 1920);               // VIDWIDTH
+    ram.store32(MMIO_START + 24, 1080);               // VIDHEIGHT
+    ram.store32(MMIO_START + 28, 60 * 65536);         // VIDFPS
+    ram.store32(MMIO_START + 40, 4);                  // SWITCHES
+  }
+}
+
 void print_help(const char* prg_name) {
   std::cout << "mr32sim - An MRISC32 CPU simulator\n";
   std::cout << "\n";
@@ -440,14 +522,68 @@ void print_help(const char* prg_name) {
   std::cout << "  -gd DEPTH, --gfx-depth DEPTH     Set framebuffer depht.\n";
   std::cout << "  -f, --fullscreen                 Use fullscreen video mode.\n";
   std::cout << "  --no-scale                       Don't scale window size.\n";
+  std::cout << "  --present-rate HZ                Limit display updates to HZ (0 = vsync).\n";
   std::cout << "  -nc, --no-auto-close             Don't auto-close window on exit().\n";
+  std::cout << "  --headless                       Simulate the display without a window.\n";
+  std::cout << "  --snapshot N[,N...]              Write PNG snapshots of the given frames.\n";
+  std::cout << "  --snapshot-prefix PREFIX         Set the snapshot file name prefix.\n";
+  std::cout << "  --video FILE                     Write all frames to a .y4m or raw video.\n";
+  std::cout << "  --frame-hashes FILE              Write a hash of each frame to FILE.\n";
+  std::cout << "  --frame-hash-interval N          Only hash every Nth frame.\n";
   std::cout << "  -t FILE, --trace FILE            Enable debug trace.\n";
   std::cout << "  -R N, --ram-size N               Set the RAM size (in bytes).\n";
   std::cout << "  -A ADDR, --addr ADDR             Set the program (ROM) start address.\n";
   std::cout << "  -c CYCLES, --cycles CYCLES       Maximum number of CPU cycles to simulate.\n";
+  std::cout << "  --cores N                        Simulate N CPU cores (default: 1).\n";
+  std::cout << "  --quantum CYCLES                 Synchronize the cores every CYCLES cycles.\n";
+  std::cout << "  --deterministic                  Run one core at a time (reproducible).\n";
   std::cout << "  -P FILE, --perf-syms FILE        Do perf counting using symbols in FILE.\n";
+  std::cout << "  --heap-profile                   Profile guest malloc/free calls.\n";
+  std::cout << "  --stack-profile                  Track the stack usage per function.\n";
+  std::cout << "  --loop-profile                   Detect hot loops and count their trip counts.\n";
+  std::cout << "  --timing                         Count cycles using instruction latencies.\n";
+  std::cout << "  --latency FILE                   Load instruction latencies from FILE.\n";
+  std::cout << "  --pipeline                       Count cycles using a pipeline model.\n";
+  std::cout << "  --icache SPEC                    Simulate an instruction cache (see below).\n";
+  std::cout << "  --dcache SPEC                    Simulate a data cache (see below).\n";
+  std::cout << "  --branch-predictor SPEC          Simulate a branch predictor (see below).\n";
+  std::cout << "  --mem-regions SPEC               Simulate MC1 memory region costs (see below).\n";
+  std::cout << "  --mem-profile SPEC               Profile data memory accesses (see below).\n";
+  std::cout << "  --watch ADDR[:LEN][:MODE]        Log accesses to guest memory (see below).\n";
+  std::cout << "  --gdb ADDR                       Debug with GDB ([HOST:]PORT or socket path).\n";
+  std::cout << "  --history SPEC                   Record history for reverse debugging.\n";
+  std::cout << "  --verify-engine                  Verify the execution against a reference core.\n";
+  std::cout << "  --verify-float                   Verify packed float ops against a reference.\n";
+  std::cout << "  --verify-packed-int              Verify packed integer ops against a reference.\n";
+  std::cout << "  --stress-test N                  Stress test the engines with N instructions.\n";
   std::cout << "\n";
   std::cout << "Additional arguments are passed to the simulated program.\n";
+  std::cout << "\n";
+  std::cout << "Cache specifications are comma separated key=value lists, with the keys size,\n";
+  std::cout << "ways, line, policy (lru/fifo/random), write (back/through) and penalty (miss\n";
+  std::cout << "cycles). Example: --dcache size=16k,ways=2,line=32,penalty=10\n";
+  std::cout << "\n";
+  std::cout << "Branch predictor specifications are a predictor type (static, bimodal, gshare or\n";
+  std::cout << "btb) optionally followed by key=value pairs, with the keys entries, history, btb\n";
+  std::cout << "(BTB entries) and top (number of branches to report). Example:\n";
+  std::cout << "--branch-predictor gshare,entries=4096,history=12,btb=64\n";
+  std::cout << "\n";
+  std::cout << "Memory region specifications are \"default\" or comma separated key=value lists,\n";
+  std::cout << "with the keys rom, vram, xram, mmio (extra cycles per memory access) and pages\n";
+  std::cout << "(number of hot pages to report). Example: --mem-regions xram=6,pages=16\n";
+  std::cout << "\n";
+  std::cout << "Memory profile specifications are \"default\" or comma separated key=value lists,\n";
+  std::cout << "with the keys file (heatmap CSV file), block (block size in bytes), window\n";
+  std::cout << "(heatmap time window in cycles) and top (number of functions and blocks to\n";
+  std::cout << "report). Example: --mem-profile file=heatmap.csv,block=4096,window=100000\n";
+  std::cout << "\n";
+  std::cout << "Watchpoints cover LEN bytes (default 4), and MODE is a combination of r (loads),\n";
+  std::cout << "w (stores, the default) and s (stop the simulation on a hit). --watch can be\n";
+  std::cout << "given several times. Example: --watch 0x1234:8:rw\n";
+  std::cout << "\n";
+  std::cout << "Execution history specifications are \"default\" or comma separated key=value\n";
+  std::cout << "lists, with the keys interval (instructions between snapshots) and count (max\n";
+  std::cout << "number of snapshots). Example: --gdb 1234 --history interval=10000,count=100\n";
   return;
 }
 }  // namespace
@@ -458,6 +594,9 @@ int main(const int argc, const char** argv) {
   uint32_t bin_addr = 0x00000200u;
   int64_t max_cycles = -1;
   std::string perf_syms_file;
+  bool heap_profile = false;
+  bool verify_engine = false;
+  std::string gdb_address;
   bool fullscreen = false;
   bool scale_window = true;
   int first_sim_argno = 0;
@@ -517,9 +656,56 @@ int main(const int argc, const char** argv) {
           fullscreen = true;
         } else if (std::strcmp(argv[k], "--no-scale") == 0) {
           scale_window = false;
+        } else if (std::strcmp(argv[k], "--present-rate") == 0) {
+          if (k >= (argc - 1)) {
+            std::cerr << "Missing option for " << argv[k] << "\n";
+            print_help(argv[0]);
+            exit(1);
+          }
+          config_t::instance().set_present_rate(str_to_uint32(argv[++k]));
         } else if ((std::strcmp(argv[k], "-nc") == 0) ||
                    (std::strcmp(argv[k], "--no-auto-close") == 0)) {
           config_t::instance().set_auto_close(false);
+        } else if (std::strcmp(argv[k], "--headless") == 0) {
+          config_t::instance().set_headless_enabled(true);
+        } else if (std::strcmp(argv[k], "--snapshot") == 0) {
+          if (k >= (argc - 1)) {
+            std::cerr << "Missing option for " << argv[k] << "\n";
+            print_help(argv[0]);
+            exit(1);
+          }
+          config_t::instance().set_snapshot_frames(str_to_uint32_list(argv[++k]));
+          config_t::instance().set_headless_enabled(true);
+        } else if (std::strcmp(argv[k], "--snapshot-prefix") == 0) {
+          if (k >= (argc - 1)) {
+            std::cerr << "Missing option for " << argv[k] << "\n";
+            print_help(argv[0]);
+            exit(1);
+          }
+          config_t::instance().set_snapshot_prefix(std::string(argv[++k]));
+        } else if (std::strcmp(argv[k], "--video") == 0) {
+          if (k >= (argc - 1)) {
+            std::cerr << "Missing option for " << argv[k] << "\n";
+            print_help(argv[0]);
+            exit(1);
+          }
+          config_t::instance().set_video_file_name(std::string(argv[++k]));
+          config_t::instance().set_headless_enabled(true);
+        } else if (std::strcmp(argv[k], "--frame-hashes") == 0) {
+          if (k >= (argc - 1)) {
+            std::cerr << "Missing option for " << argv[k] << "\n";
+            print_help(argv[0]);
+            exit(1);
+          }
+          config_t::instance().set_frame_hashes_file_name(std::string(argv[++k]));
+          config_t::instance().set_headless_enabled(true);
+        } else if (std::strcmp(argv[k], "--frame-hash-interval") == 0) {
+          if (k >= (argc - 1)) {
+            std::cerr << "Missing option for " << argv[k] << "\n";
+            print_help(argv[0]);
+            exit(1);
+          }
+          config_t::instance().set_frame_hash_interval(str_to_uint32(argv[++k]));
         } else if ((std::strcmp(argv[k], "-t") == 0) || (std::strcmp(argv[k], "--trace") == 0)) {
           if (k >= (argc - 1)) {
             std::cerr << "Missing option for " << argv[k] << "\n";
@@ -549,6 +735,27 @@ int main(const int argc, const char** argv) {
             exit(1);
           }
           max_cycles = str_to_int64(argv[++k]);
+        } else if (std::strcmp(argv[k], "--cores") == 0) {
+          if (k >= (argc - 1)) {
+            std::cerr << "Missing option for " << argv[k] << "\n";
+            print_help(argv[0]);
+            exit(1);
+          }
+          const auto num_cores = str_to_uint32(argv[++k]);
+          if (num_cores < 1u || num_cores > 256u) {
+            std::cerr << "Error: The number of cores must be in the range 1-256\n";
+            exit(1);
+          }
+          config_t::instance().set_num_cores(num_cores);
+        } else if (std::strcmp(argv[k], "--quantum") == 0) {
+          if (k >= (argc - 1)) {
+            std::cerr << "Missing option for " << argv[k] << "\n";
+            print_help(argv[0]);
+            exit(1);
+          }
+          config_t::instance().set_quantum(str_to_uint64(argv[++k]));
+        } else if (std::strcmp(argv[k], "--deterministic") == 0) {
+          config_t::instance().set_deterministic(true);
         } else if ((std::strcmp(argv[k], "-P") == 0) ||
                    (std::strcmp(argv[k], "--perf-syms") == 0)) {
           if (k >= (argc - 1)) {
@@ -558,6 +765,146 @@ int main(const int argc, const char** argv) {
           }
           perf_syms_file = std::string(argv[++k]);
           config_t::instance().set_verbose(true);
+        } else if (std::strcmp(argv[k], "--heap-profile") == 0) {
+          heap_profile = true;
+          config_t::instance().set_verbose(true);
+        } else if (std::strcmp(argv[k], "--stack-profile") == 0) {
+          config_t::instance().set_stack_profile_enabled(true);
+          config_t::instance().set_verbose(true);
+        } else if (std::strcmp(argv[k], "--loop-profile") == 0) {
+          config_t::instance().set_loop_profile_enabled(true);
+          config_t::instance().set_verbose(true);
+        } else if (std::strcmp(argv[k], "--timing") == 0) {
+          config_t::instance().set_timing_enabled(true);
+        } else if (std::strcmp(argv[k], "--latency") == 0) {
+          if (k >= (argc - 1)) {
+            std::cerr << "Missing option for " << argv[k] << "\n";
+            print_help(argv[0]);
+            exit(1);
+          }
+          config_t::instance().set_latency_file_name(std::string(argv[++k]));
+          config_t::instance().set_timing_enabled(true);
+        } else if (std::strcmp(argv[k], "--pipeline") == 0) {
+          config_t::instance().set_pipeline_enabled(true);
+          config_t::instance().set_timing_enabled(true);
+        } else if ((std::strcmp(argv[k], "--icache") == 0) ||
+                   (std::strcmp(argv[k], "--dcache") == 0)) {
+          if (k >= (argc - 1)) {
+            std::cerr << "Missing option for " << argv[k] << "\n";
+            print_help(argv[0]);
+            exit(1);
+          }
+          const bool is_icache = (std::strcmp(argv[k], "--icache") == 0);
+          const auto spec = std::string(argv[++k]);
+          try {
+            cache_t::parse_params(spec);
+          } catch (std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            exit(1);
+          }
+          if (is_icache) {
+            config_t::instance().set_icache_spec(spec);
+          } else {
+            config_t::instance().set_dcache_spec(spec);
+          }
+        } else if (std::strcmp(argv[k], "--branch-predictor") == 0) {
+          if (k >= (argc - 1)) {
+            std::cerr << "Missing option for " << argv[k] << "\n";
+            print_help(argv[0]);
+            exit(1);
+          }
+          const auto spec = std::string(argv[++k]);
+          try {
+            branch_predictor_t::parse_params(spec);
+          } catch (std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            exit(1);
+          }
+          config_t::instance().set_branch_predictor_spec(spec);
+        } else if (std::strcmp(argv[k], "--mem-regions") == 0) {
+          if (k >= (argc - 1)) {
+            std::cerr << "Missing option for " << argv[k] << "\n";
+            print_help(argv[0]);
+            exit(1);
+          }
+          const auto spec = std::string(argv[++k]);
+          try {
+            memory_regions_t::parse_params(spec);
+          } catch (std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            exit(1);
+          }
+          config_t::instance().set_memory_regions_spec(spec);
+        } else if (std::strcmp(argv[k], "--mem-profile") == 0) {
+          if (k >= (argc - 1)) {
+            std::cerr << "Missing option for " << argv[k] << "\n";
+            print_help(argv[0]);
+            exit(1);
+          }
+          const auto spec = std::string(argv[++k]);
+          try {
+            mem_profiler_t::parse_params(spec);
+          } catch (std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            exit(1);
+          }
+          config_t::instance().set_mem_profile_spec(spec);
+        } else if (std::strcmp(argv[k], "--watch") == 0) {
+          if (k >= (argc - 1)) {
+            std::cerr << "Missing option for " << argv[k] << "\n";
+            print_help(argv[0]);
+            exit(1);
+          }
+          const auto spec = std::string(argv[++k]);
+          try {
+            watchpoints_t::parse_spec(spec);
+          } catch (std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            exit(1);
+          }
+          config_t::instance().add_watch_spec(spec);
+        } else if (std::strcmp(argv[k], "--gdb") == 0) {
+          if (k >= (argc - 1)) {
+            std::cerr << "Missing option for " << argv[k] << "\n";
+            print_help(argv[0]);
+            exit(1);
+          }
+          gdb_address = std::string(argv[++k]);
+        } else if (std::strcmp(argv[k], "--history") == 0) {
+          if (k >= (argc - 1)) {
+            std::cerr << "Missing option for " << argv[k] << "\n";
+            print_help(argv[0]);
+            exit(1);
+          }
+          const auto spec = std::string(argv[++k]);
+          try {
+            exec_history_t::parse_params(spec);
+          } catch (std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            exit(1);
+          }
+          config_t::instance().set_history_spec(spec);
+        } else if (std::strcmp(argv[k], "--verify-engine") == 0) {
+          verify_engine = true;
+        } else if (std::strcmp(argv[k], "--verify-float") == 0) {
+          // Compare the fast (host f32 based) packed float operations against the bit-exact
+          // soft-float reference implementation.
+          const bool ok = verify_packed_float(1000000u);
+          exit(ok ? 0 : 1);
+        } else if (std::strcmp(argv[k], "--verify-packed-int") == 0) {
+          // Compare the SIMD implementations of the packed integer operations against the
+          // portable reference implementations.
+          const bool ok = verify_packed_int(1000000u);
+          exit(ok ? 0 : 1);
+        } else if (std::strcmp(argv[k], "--stress-test") == 0) {
+          if (k >= (argc - 1)) {
+            std::cerr << "Missing option for " << argv[k] << "\n";
+            print_help(argv[0]);
+            exit(1);
+          }
+          // Compare all the run loop variants against a plain functional core.
+          const bool ok = stress_tester_t::run(str_to_uint64(argv[++k]));
+          exit(ok ? 0 : 1);
         } else {
           std::cerr << "Error: Unknown option: " << argv[k] << "\n";
           print_help(argv[0]);
@@ -602,21 +949,53 @@ int main(const int argc, const char** argv) {
 
     // Load the program file into RAM.
     const auto start_addr = read_executable_file(bin_file, ram, bin_addr);
+    set_mc1_mmio(ram);
+
+    // The reference core for engine verification has a RAM of its own (initialized identically).
+    std::unique_ptr<ram_t> reference_ram;
+    if (verify_engine) {
+      reference_ram.reset(new ram_t(config_t::instance().ram_size()));
+      set_simulator_args(*reference_ram, sim_argc, sim_argv);
+      read_executable_file(bin_file, *reference_ram, bin_addr);
+      set_mc1_mmio(*reference_ram);
+    }
 
-    // HACK: Populate MMIO memory with MC1 fields.
-    const uint32_t MMIO_START = 0xc0000000u;
-    if (config_t::instance().ram_size() >= (MMIO_START + 64)) {
-      ram.store32(MMIO_START + 8, 50000000);            // CPUCLK
-      ram.store32(MMIO_START + 12, 512 * 1024);         // VRAMSIZE
-      ram.store32(MMIO_START + 16, 256 * 1024 * 1024);  // XRAMSIZE
-      ram.store32(MMIO_START + 20, 1920);               // VIDWIDTH
-      ram.store32(MMIO_START + 24, 1080);               // VIDHEIGHT
-      ram.store32(MMIO_START + 28, 60 * 65536);         // VIDFPS
-      ram.store32(MMIO_START + 40, 4);                  // SWITCHES
+    // Open the GDB socket (the program waits for GDB to connect when the simulation starts).
+    std::unique_ptr<gdb_stub_t> gdb_stub;
+    if (!gdb_address.empty()) {
+      gdb_stub.reset(new gdb_stub_t(gdb_address));
     }
 
-    // Initialize the CPU.
-    cpu_simple_t cpu(ram, perf_symbols);
+    // Initialize the CPU core(s).
+    cpu_cluster_t cpus(ram, perf_symbols, config_t::instance().num_cores());
+    if (reference_ram) {
+      cpus.enable_engine_verification(*reference_ram);
+    }
+    if (gdb_stub) {
+      cpus.enable_gdb_stub(*gdb_stub);
+    }
+    if (heap_profile) {
+      cpus.enable_heap_profiler(find_heap_functions(bin_file, perf_symbols));
+    }
+
+    // Initialize the headless display.
+    std::unique_ptr<headless_display_t> headless_display;
+    if (config_t::instance().headless_enabled()) {
+      headless_display.reset(new headless_display_t(ram));
+    }
+
+    // Frames are produced at the simulated vertical blanking intervals, which are driven by the
+    // simulated CPU clock (this also drives the MC1 frame counter).
+    if (headless_display || config_t::instance().gfx_enabled()) {
+      auto* display = headless_display.get();
+      cpus.core(0).enable_vblank([display](const uint32_t frame_no, const uint64_t cycle) {
+        if (display != nullptr) {
+          display->vblank(frame_no, cycle);
+        }
+        s_sim_frame_count = frame_no + 1u;
+        wake_display();
+      });
+    }
 
     if (config_t::instance().verbose()) {
       std::cout << "------------------------------------------------------------------------\n";
@@ -625,15 +1004,18 @@ int main(const int argc, const char** argv) {
     // Run the CPU in a separate thread.
     std::atomic_bool cpu_done(false);
     uint32_t cpu_exit_code = 0u;
-    std::thread cpu_thread([&cpu_exit_code, &cpu, &cpu_done, start_addr, max_cycles] {
+    uint32_t presented_frames = 0u;
+    uint32_t skipped_frames = 0u;
+    std::thread cpu_thread([&cpu_exit_code, &cpus, &cpu_done, start_addr, max_cycles] {
       try {
         // Run until the program returns.
-        cpu_exit_code = cpu.run(start_addr, max_cycles);
+        cpu_exit_code = cpus.run(start_addr, max_cycles);
       } catch (std::exception& e) {
         std::cerr << "Exception in CPU thread: " << e.what() << "\n";
         cpu_exit_code = 1u;
       }
       cpu_done = true;
+      wake_display();
     });
 
     if (config_t::instance().gfx_enabled()) {
@@ -704,46 +1086,74 @@ int main(const int argc, const char** argv) {
           glfwSetKeyCallback(window, keyhandler);
           glfwSetCursorPosCallback(window, mousehandler);
           glfwSetMouseButtonCallback(window, mousebtnhandler);
+          glfwSetWindowRefreshCallback(window, refreshhandler);
 
           // Init the "GPU".
           gpu_t gpu(ram);
 
-          // Enable vsync.
-          glfwSwapInterval(1);
+          // The display is only updated when the simulated CPU has produced a new frame. Updates
+          // are paced by vsync, or by the configured present rate (in which case vsync is
+          // disabled). Frames that are produced faster than they can be presented are skipped.
+          const auto present_rate = config_t::instance().present_rate();
+          const auto present_interval = present_rate > 0u ? 1.0 / present_rate : 0.0;
+          glfwSwapInterval(present_rate > 0u ? 0 : 1);
+          s_display_wakeup = true;
+          s_refresh_requested = true;
 
           // Main loop.
           bool simulation_finished = false;
-          uint32_t frame_no = 0;
+          uint32_t presented_frame_count = s_sim_frame_count;
+          auto next_present_time = glfwGetTime();
           while (!glfwWindowShouldClose(window)) {
-            // Update the video mode.
-            gpu.configure();
-            if (!fullscreen && (window_width != gpu.width() || window_height != gpu.height())) {
-              window_width = gpu.width();
-              window_height = gpu.height();
-              if (scale_window) {
-                window_scale = adaptive_window_scale(window, window_width, window_height);
+            const uint32_t sim_frame_count = s_sim_frame_count;
+            const bool has_new_frame = sim_frame_count != presented_frame_count;
+            const auto now = glfwGetTime();
+            if ((has_new_frame && now >= next_present_time) || s_refresh_requested) {
+              // Update the video mode.
+              gpu.configure();
+              if (!fullscreen && (window_width != gpu.width() || window_height != gpu.height())) {
+                window_width = gpu.width();
+                window_height = gpu.height();
+                if (scale_window) {
+                  window_scale = adaptive_window_scale(window, window_width, window_height);
+                }
+                glfwSetWindowSize(window,
+                                  static_cast<int>(window_width) * window_scale,
+                                  static_cast<int>(window_height) * window_scale);
               }
-              glfwSetWindowSize(window,
-                                static_cast<int>(window_width) * window_scale,
-                                static_cast<int>(window_height) * window_scale);
-            }
 
-            // Update the frame number (MC1 compat).
-            ram.store32(0xc0000020, frame_no);
-            frame_no += 1u;
+              // Get the actual window framebuffer size (note: this is important on systems that
+              // use coordinate scaling, such as on macos with retina display).
+              int actual_fb_width;
+              int actual_fb_height;
+              glfwGetFramebufferSize(window, &actual_fb_width, &actual_fb_height);
 
-            // Get the actual window framebuffer size (note: this is important on systems that use
-            // coordinate scaling, such as on macos with retina display).
-            int actual_fb_width;
-            int actual_fb_height;
-            glfwGetFramebufferSize(window, &actual_fb_width, &actual_fb_height);
+              // Paint the CPU RAM framebuffer contents to the window.
+              gpu.paint(actual_fb_width, actual_fb_height);
 
-            // Paint the CPU RAM framebuffer contents to the window.
-            gpu.paint(actual_fb_width, actual_fb_height);
+              // Swap front/back buffers and poll window events.
+              glfwSwapBuffers(window);
+              glfwPollEvents();
 
-            // Swap front/back buffers and poll window events.
-            glfwSwapBuffers(window);
-            glfwPollEvents();
+              s_refresh_requested = false;
+              if (has_new_frame) {
+                skipped_frames += sim_frame_count - presented_frame_count - 1u;
+                ++presented_frames;
+                presented_frame_count = sim_frame_count;
+              }
+              next_present_time = std::max(next_present_time + present_interval, now);
+            } else {
+              // Nothing to present yet, so sleep until there is a new frame or a window event.
+              auto timeout = MAX_DISPLAY_WAIT;
+              if (has_new_frame) {
+                timeout = std::min(timeout, next_present_time - now);
+              }
+              if (timeout > 0.0) {
+                glfwWaitEventsTimeout(timeout);
+              } else {
+                glfwPollEvents();
+              }
+            }
 
             // Simulation finished?
             if (cpu_done && !simulation_finished) {
@@ -756,6 +1166,12 @@ int main(const int argc, const char** argv) {
             }
           }
 
+          // Stop the CPU thread before tearing down GLFW, since it may call glfwPostEmptyEvent()
+          // (via wake_display()) at any time while it is running.
+          cpus.terminate();
+          cpu_thread.join();
+          s_display_wakeup = false;
+
           // Clean up GPU resources before we close the window.
           gpu.cleanup();
 
@@ -767,18 +1183,29 @@ int main(const int argc, const char** argv) {
         std::cerr << "Graphics error: " << e.what() << "\n";
       }
 
-      cpu.terminate();
+      cpus.terminate();
     }
 
     // Wait for the cpu thread to finish.
-    cpu_thread.join();
+    if (cpu_thread.joinable()) {
+      cpu_thread.join();
+    }
+
+    // Write any pending headless display frames.
+    headless_display.reset();
     const int exit_code = static_cast<int>(cpu_exit_code);
 
     if (config_t::instance().verbose()) {
       // Show some stats.
       std::cout << "------------------------------------------------------------------------\n";
       std::cout << "Exit code: " << exit_code << "\n";
-      cpu.dump_stats();
+      cpus.dump_stats();
+
+      if (config_t::instance().gfx_enabled()) {
+        std::cout << "Display:\n";
+        std::cout << " Presented frames:     " << presented_frames << "\n";
+        std::cout << " Skipped frames:       " << skipped_frames << "\n";
+      }
 
       // Dump perf stats.
       if (perf_symbols.has_symbols()) {
@@ -789,7 +1216,7 @@ int main(const int argc, const char** argv) {
 
     // Dump some RAM (we use the same range as the MC1 VRAM).
     // TODO(m): Control this with command line arguments.
-    cpu.dump_ram(0x40000000u, 0x40040000u, "/tmp/mrisc32_sim_vram.bin");
+    cpus.core(0).dump_ram(0x40000000u, 0x40040000u, "/tmp/mrisc32_sim_vram.bin");
 
     std::exit(exit_code);
   } catch (std::exception& e) {
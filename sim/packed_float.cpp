@@ -0,0 +1,40 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "packed_float.hpp"
+
+float f16x2_t::s_f16_to_f32_lut[65536];
+const bool f16x2_t::s_lut_initialized = f16x2_t::init_lut();
+
+float f8x4_t::s_f8_to_f32_lut[256];
+const bool f8x4_t::s_lut_initialized = f8x4_t::init_lut();
+
+bool f16x2_t::init_lut() {
+  for (uint32_t x = 0u; x < 65536u; ++x) {
+    s_f16_to_f32_lut[x] = f16_to_f32_calc(x);
+  }
+  return true;
+}
+
+bool f8x4_t::init_lut() {
+  for (uint32_t x = 0u; x < 256u; ++x) {
+    s_f8_to_f32_lut[x] = f8_to_f32_calc(x);
+  }
+  return true;
+}
@@ -25,6 +25,12 @@
 // NOTE: This implementation is not 100% compatible with the MRISC32-A1 hardware implementation, nor
 // is it 100% IEEE 754 compatible. Its main purpose is to make it possible to run programs in the
 // simulator and get reasonable (but not necessarily correct) results.
+//
+// Decoding to 32-bit floating point is done with lookup tables (256 entries for 8-bit and 65536
+// entries for 16-bit floating point), which are built at startup (see packed_float.cpp).
+//
+// The exact semantics are defined by the integer-only reference implementation in soft_float.hpp.
+// The results of this implementation are identical to the reference (use --verify-float to check).
 //--------------------------------------------------------------------------------------------------
 
 #ifndef SIM_PACKED_FLOAT_HPP_
@@ -200,6 +206,41 @@ private:
   }
 
   static inline float f16_to_f32(const uint32_t x) {
+    return s_f16_to_f32_lut[x];
+  }
+
+  static inline uint32_t f32_to_f16(const float x) {
+    uint32_t f32u;
+    std::memcpy(&f32u, &x, sizeof(f32u));
+    const uint32_t sign = ((f32u & 0x80000000u) >> 16);
+    const uint32_t abs_x = f32u & 0x7fffffffu;
+    if (abs_x > 0x7f800000u) {
+      // NaN (canonical)
+      return 0x7c00u;
+    } else if (abs_x == 0x7f800000u) {
+      // Inf
+      return sign | 0x7fffu;
+    }
+
+    // Re-bias the exponent and round the significand (round half up). A rounding carry propagates
+    // into the exponent field.
+    const int32_t rebiased = static_cast<int32_t>(abs_x) - ((127 - 15) << 23);
+    if (rebiased < 0) {
+      // Zero (we flush denormals to zero)
+      return sign | 0u;
+    }
+    const uint32_t h = (static_cast<uint32_t>(rebiased) + 0x00001000u) >> 13;
+    if (h < 0x0400u) {
+      // Zero
+      return sign | 0u;
+    } else if (h >= 0x7c00u) {
+      // Inf
+      return sign | 0x7fffu;
+    }
+    return sign | h;
+  }
+
+  static inline float f16_to_f32_calc(const uint32_t x) {
     if ((x & 0xfc00u) == 0u) {
       return 0.0f;
     } else if ((x & 0xfc00u) == 0x8000u) {
@@ -220,37 +261,10 @@ private:
     return f32;
   }
 
-  static inline uint32_t f32_to_f16(const float x) {
-    uint32_t f32u;
-    std::memcpy(&f32u, &x, sizeof(f32u));
-    const uint32_t sign = ((f32u & 0x80000000u) >> 16);
-    if ((f32u & 0x7f800000u) == 0u) {
-      // Zero (we flush denormals to zero)
-      return sign | 0u;
-    } else if (std::isnan(x)) {
-      // NaN
-      return sign | 0x7c00u;
-    } else if (std::isinf(x)) {
-      // Inf
-      return sign | 0x7fffu;
-    }
-    int32_t exp = static_cast<int32_t>((f32u >> 23) & 0x00ffu) - 127 + 15;
-    uint32_t significand = (f32u & 0x007fffffu) + 0x00801000u;
-    if ((significand & 0x01000000u) != 0u) {
-      significand = significand >> 14;
-      exp += 1;
-    } else {
-      significand = significand >> 13;
-    }
-    if (exp >= 31) {
-      // Inf
-      return sign | 0x7fffu;
-    } else if (exp <= 0) {
-      // Zero
-      return sign | 0u;
-    }
-    return sign | (static_cast<uint32_t>(exp) << 10) | (significand & 0x3ffu);
-  }
+  static bool init_lut();
+
+  static float s_f16_to_f32_lut[65536];
+  static const bool s_lut_initialized;
 
   float m_values[2];
 };
@@ -315,6 +329,10 @@ public:
     return f8x4_t(a[0], b[0], a[1], b[1]);
   }
 
+  static inline f8x4_t from_f32x4(const float a, const float b, const float c, const float d) {
+    return f8x4_t(a, b, c, d);
+  }
+
   static inline f8x4_t itof(const uint32_t x, const uint32_t scale) {
     return f8x4_t(i8_to_f32(x & 0x000000ffu, scale),
                   i8_to_f32((x >> 8) & 0x000000ffu, scale),
@@ -501,6 +519,41 @@ private:
   }
 
   static inline float f8_to_f32(const uint32_t x) {
+    return s_f8_to_f32_lut[x];
+  }
+
+  static inline uint32_t f32_to_f8(const float x) {
+    uint32_t f32u;
+    std::memcpy(&f32u, &x, sizeof(f32u));
+    const uint32_t sign = ((f32u & 0x80000000u) >> 24);
+    const uint32_t abs_x = f32u & 0x7fffffffu;
+    if (abs_x > 0x7f800000u) {
+      // NaN (canonical)
+      return 0x78u;
+    } else if (abs_x == 0x7f800000u) {
+      // Inf
+      return sign | 0x7fu;
+    }
+
+    // Re-bias the exponent and round the significand (round half up). A rounding carry propagates
+    // into the exponent field.
+    const int32_t rebiased = static_cast<int32_t>(abs_x) - ((127 - 7) << 23);
+    if (rebiased < 0) {
+      // Zero (we flush denormals to zero)
+      return sign | 0u;
+    }
+    const uint32_t h = (static_cast<uint32_t>(rebiased) + 0x00080000u) >> 20;
+    if (h < 0x08u) {
+      // Zero
+      return sign | 0u;
+    } else if (h >= 0x78u) {
+      // Inf
+      return sign | 0x7fu;
+    }
+    return sign | h;
+  }
+
+  static inline float f8_to_f32_calc(const uint32_t x) {
     if ((x & 0xf8u) == 0u) {
       return 0.0f;
     } else if ((x & 0xf8u) == 0x80u) {
@@ -521,37 +574,10 @@ private:
     return f32;
   }
 
-  static inline uint32_t f32_to_f8(const float x) {
-    uint32_t f32u;
-    std::memcpy(&f32u, &x, sizeof(f32u));
-    const uint32_t sign = ((f32u & 0x80000000u) >> 24);
-    if ((f32u & 0x7f800000u) == 0u) {
-      // Zero (we flush denormals to zero)
-      return sign | 0u;
-    } else if (std::isnan(x)) {
-      // NaN
-      return sign | 0x78u;
-    } else if (std::isinf(x)) {
-      // Inf
-      return sign | 0x7fu;
-    }
-    int32_t exp = static_cast<int32_t>((f32u >> 23) & 0x00ffu) - 127 + 7;
-    uint32_t significand = (f32u & 0x007fffffu) + 0x00880000u;
-    if ((significand & 0x01000000u) != 0u) {
-      significand = significand >> 21;
-      exp += 1;
-    } else {
-      significand = significand >> 20;
-    }
-    if (exp >= 15) {
-      // Inf
-      return sign | 0x7fu;
-    } else if (exp <= 0) {
-      // Zero
-      return sign | 0u;
-    }
-    return sign | (static_cast<uint32_t>(exp) << 3) | (significand & 0x07u);
-  }
+  static bool init_lut();
+
+  static float s_f8_to_f32_lut[256];
+  static const bool s_lut_initialized;
 
   float m_values[4];
 };
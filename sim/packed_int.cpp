@@ -0,0 +1,159 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "packed_int.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+namespace {
+// Maximum number of reported mismatches per operation.
+const uint64_t MAX_REPORTED = 5u;
+
+struct op_t {
+  const char* name;
+  uint32_t (*fast)(const uint32_t a, const uint32_t b, const uint32_t c);
+  uint32_t (*ref)(const uint32_t a, const uint32_t b, const uint32_t c);
+};
+
+#define BINARY_OP(name)                                                                 \
+  {                                                                                     \
+    #name, [](uint32_t a, uint32_t b, uint32_t) { return packed_int::name(a, b); },     \
+        [](uint32_t a, uint32_t b, uint32_t) { return packed_int_ref::name(a, b); }     \
+  }
+#define TERNARY_OP(name)                                                                \
+  {                                                                                     \
+    #name, [](uint32_t a, uint32_t b, uint32_t c) { return packed_int::name(a, b, c); }, \
+        [](uint32_t a, uint32_t b, uint32_t c) { return packed_int_ref::name(a, b, c); } \
+  }
+
+// All the operations that have a SIMD implementation.
+const op_t OPS[] = {
+    BINARY_OP(seq8x4),     BINARY_OP(seq16x2),    BINARY_OP(sne8x4),     BINARY_OP(sne16x2),
+    BINARY_OP(slt8x4),     BINARY_OP(slt16x2),    BINARY_OP(sltu8x4),    BINARY_OP(sltu16x2),
+    BINARY_OP(sle8x4),     BINARY_OP(sle16x2),    BINARY_OP(sleu8x4),    BINARY_OP(sleu16x2),
+    BINARY_OP(min8x4),     BINARY_OP(min16x2),    BINARY_OP(max8x4),     BINARY_OP(max16x2),
+    BINARY_OP(minu8x4),    BINARY_OP(minu16x2),   BINARY_OP(maxu8x4),    BINARY_OP(maxu16x2),
+    BINARY_OP(adds8x4),    BINARY_OP(adds16x2),   BINARY_OP(addsu8x4),   BINARY_OP(addsu16x2),
+    BINARY_OP(subs8x4),    BINARY_OP(subs16x2),   BINARY_OP(subsu8x4),   BINARY_OP(subsu16x2),
+    BINARY_OP(addh8x4),    BINARY_OP(addh16x2),   BINARY_OP(addhu8x4),   BINARY_OP(addhu16x2),
+    BINARY_OP(addhr8x4),   BINARY_OP(addhr16x2),  BINARY_OP(addhur8x4),  BINARY_OP(addhur16x2),
+    BINARY_OP(subh8x4),    BINARY_OP(subh16x2),   BINARY_OP(subhu8x4),   BINARY_OP(subhu16x2),
+    BINARY_OP(subhr8x4),   BINARY_OP(subhr16x2),  BINARY_OP(subhur8x4),  BINARY_OP(subhur16x2),
+    BINARY_OP(mulq8x4),    BINARY_OP(mulq16x2),   BINARY_OP(mulqr8x4),   BINARY_OP(mulqr16x2),
+    BINARY_OP(mul8x4),     BINARY_OP(mul16x2),    BINARY_OP(mulhi8x4),   BINARY_OP(mulhi16x2),
+    BINARY_OP(mulhiu8x4),  BINARY_OP(mulhiu16x2), TERNARY_OP(madd8x4),   TERNARY_OP(madd16x2),
+    BINARY_OP(div8x4),     BINARY_OP(div16x2),    BINARY_OP(divu8x4),    BINARY_OP(divu16x2),
+    BINARY_OP(rem8x4),     BINARY_OP(rem16x2),    BINARY_OP(remu8x4),    BINARY_OP(remu16x2),
+    BINARY_OP(shuf32)};
+
+#undef BINARY_OP
+#undef TERNARY_OP
+
+// Lane values that are likely to trigger corner cases in the 16-bit operations.
+const uint32_t BOUNDARY_VALUES_16[] = {0x0000u, 0x0001u, 0x0002u, 0x007fu, 0x0080u,
+                                       0x00ffu, 0x0100u, 0x7ffeu, 0x7fffu, 0x8000u,
+                                       0x8001u, 0xff00u, 0xff80u, 0xfffeu, 0xffffu};
+
+// The third operand (the accumulator of MADD) is derived from the first two operands.
+inline uint32_t third_operand(const uint32_t a, const uint32_t b) {
+  return a ^ ((b << 16) | (b >> 16));
+}
+}  // namespace
+
+uint64_t compare_packed_int(const std::vector<uint32_t>& a_ops,
+                            const std::vector<uint32_t>& b_ops) {
+  uint64_t mismatches = 0u;
+  for (const auto& op : OPS) {
+    uint64_t op_mismatches = 0u;
+    for (size_t i = 0u; i < a_ops.size(); ++i) {
+      const auto a = a_ops[i];
+      const auto b = b_ops[i];
+      const auto c = third_operand(a, b);
+      const auto fast = op.fast(a, b, c);
+      const auto ref = op.ref(a, b, c);
+      if (fast != ref) {
+        if (op_mismatches < MAX_REPORTED) {
+          std::cout << "  " << op.name << std::hex << std::setfill('0') << " a=0x" << std::setw(8)
+                    << a << " b=0x" << std::setw(8) << b << " c=0x" << std::setw(8) << c
+                    << ": 0x" << std::setw(8) << fast << " (expected 0x" << std::setw(8) << ref
+                    << ")\n"
+                    << std::dec << std::setfill(' ');
+        }
+        ++op_mismatches;
+      }
+    }
+    mismatches += op_mismatches;
+  }
+  return mismatches;
+}
+
+bool verify_packed_int(const uint64_t samples) {
+  std::cout << "Verifying packed integer operations against the portable reference:\n";
+  const auto num_ops = sizeof(OPS) / sizeof(OPS[0]);
+
+  // All 8-bit operand pairs (in all lanes).
+  uint64_t mismatches_8;
+  {
+    std::vector<uint32_t> a_ops;
+    std::vector<uint32_t> b_ops;
+    for (uint32_t a = 0u; a < 256u; ++a) {
+      for (uint32_t b = 0u; b < 256u; ++b) {
+        a_ops.push_back(a | (b << 8) | (a << 16) | (b << 24));
+        b_ops.push_back(b | (a << 8) | (b << 16) | (a << 24));
+      }
+    }
+    mismatches_8 = compare_packed_int(a_ops, b_ops);
+    std::cout << "  " << std::left << std::setw(12) << "8-bit" << std::right << std::setw(12)
+              << a_ops.size() * num_ops << " checks, " << mismatches_8 << " mismatches\n";
+  }
+
+  // 16-bit operand pairs: all combinations of boundary values, plus random values.
+  uint64_t mismatches_16;
+  {
+    std::vector<uint32_t> values;
+    for (const uint32_t x : BOUNDARY_VALUES_16) {
+      for (const uint32_t y : {0x0000u, 0x0001u, 0x7fffu, 0x8000u, 0xffffu}) {
+        values.push_back(x | (y << 16));
+        values.push_back(y | (x << 16));
+      }
+    }
+    std::vector<uint32_t> a_ops;
+    std::vector<uint32_t> b_ops;
+    for (const auto a : values) {
+      for (const auto b : values) {
+        a_ops.push_back(a);
+        b_ops.push_back(b);
+      }
+    }
+    std::mt19937 rnd(12345u);
+    for (uint64_t i = 0u; i < samples; ++i) {
+      a_ops.push_back(static_cast<uint32_t>(rnd()));
+      b_ops.push_back(static_cast<uint32_t>(rnd()));
+    }
+    mismatches_16 = compare_packed_int(a_ops, b_ops);
+    std::cout << "  " << std::left << std::setw(12) << "16-bit" << std::right << std::setw(12)
+              << a_ops.size() * num_ops << " checks, " << mismatches_16 << " mismatches\n";
+  }
+
+  const auto mismatches = mismatches_8 + mismatches_16;
+  std::cout << (mismatches == 0u ? "All results are identical.\n" : "Found mismatches!\n");
+  return mismatches == 0u;
+}
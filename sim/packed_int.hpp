@@ -0,0 +1,79 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+// The integer ALU operations (see packed_int_ops.hpp) come in two variants:
+//
+//  - packed_int:     Used by the simulator. The packed 8x4 and 16x2 operations use SSE2 (and SSSE3
+//                    for SHUF) on x86-64 hosts, unless MR32_PORTABLE_REF is defined.
+//  - packed_int_ref: The portable implementations, which define the exact semantics.
+//
+// The results of the two variants are identical (use --verify-packed-int to check).
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_PACKED_INT_HPP_
+#define SIM_PACKED_INT_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#ifdef __x86_64__
+#include <emmintrin.h>
+#endif  // __x86_64__
+#if defined(__x86_64__) && defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif  // __x86_64__ && __SSSE3__
+
+#if defined(__x86_64__) && !defined(MR32_PORTABLE_REF)
+#define PACKED_INT_SIMD 1
+#else
+#define PACKED_INT_SIMD 0
+#endif
+
+namespace packed_int {
+#include "packed_int_ops.hpp"
+}  // namespace packed_int
+
+#undef PACKED_INT_SIMD
+#define PACKED_INT_SIMD 0
+
+namespace packed_int_ref {
+#include "packed_int_ops.hpp"
+}  // namespace packed_int_ref
+
+#undef PACKED_INT_SIMD
+
+/// @brief Compare the packed integer operations against the portable reference implementation.
+///
+/// Every operation that has a SIMD implementation is checked for all the given operand pairs. The
+/// first few mismatches are reported to stdout.
+/// @param a_ops The first operand of each check.
+/// @param b_ops The second operand of each check (same length as a_ops).
+/// @returns the number of mismatching results.
+uint64_t compare_packed_int(const std::vector<uint32_t>& a_ops, const std::vector<uint32_t>& b_ops);
+
+/// @brief Verify the SIMD implementation of the packed integer operations.
+///
+/// All 8-bit operand pairs are checked exhaustively (in all lanes). The 16-bit operations are
+/// checked for all combinations of boundary values, plus a number of random operand pairs.
+/// @param samples The number of random operand pairs to check.
+/// @returns true if no mismatches were found.
+bool verify_packed_int(const uint64_t samples);
+
+#endif  // SIM_PACKED_INT_HPP_
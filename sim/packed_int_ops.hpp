@@ -0,0 +1,1156 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+//--------------------------------------------------------------------------------------------------
+// Integer ALU operations, including the packed (8x4 and 16x2) SIMD operations.
+//
+// NOTE: This file has no include guard. It is included twice by packed_int.hpp: once with
+// PACKED_INT_SIMD set to 1 (the x86 SIMD implementations, where available), and once with
+// PACKED_INT_SIMD set to 0 (the portable implementations, which serve as the reference).
+//--------------------------------------------------------------------------------------------------
+
+#if PACKED_INT_SIMD
+// The packed integer operations are implemented with SSE2 instructions, operating on the lowest 32
+// bits of an XMM register.
+inline __m128i to_m128(const uint32_t x) {
+  return _mm_cvtsi32_si128(static_cast<int>(x));
+}
+
+inline uint32_t from_m128(const __m128i x) {
+  return static_cast<uint32_t>(_mm_cvtsi128_si32(x));
+}
+
+// Widen the four signed/unsigned bytes of a word to 16-bit lanes.
+inline __m128i widen_i8(const uint32_t x) {
+  const auto v = to_m128(x);
+  return _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+}
+
+inline __m128i widen_u8(const uint32_t x) {
+  return _mm_unpacklo_epi8(to_m128(x), _mm_setzero_si128());
+}
+
+// Widen the two signed/unsigned half-words of a word to 32-bit lanes.
+inline __m128i widen_i16(const uint32_t x) {
+  const auto v = to_m128(x);
+  return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+
+inline __m128i widen_u16(const uint32_t x) {
+  return _mm_unpacklo_epi16(to_m128(x), _mm_setzero_si128());
+}
+
+// Widen the four signed/unsigned bytes of a word to 32-bit lanes.
+inline __m128i widen_i8_to_32(const uint32_t x) {
+  const auto v = widen_i8(x);
+  return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+
+inline __m128i widen_u8_to_32(const uint32_t x) {
+  return _mm_unpacklo_epi16(widen_u8(x), _mm_setzero_si128());
+}
+
+// Narrow 16-bit lanes to bytes (keeping the eight least significant bits of each lane).
+inline uint32_t narrow_16_to_8(const __m128i x) {
+  const auto v = _mm_and_si128(x, _mm_set1_epi16(0x00ff));
+  return from_m128(_mm_packus_epi16(v, v));
+}
+
+// Narrow 32-bit lanes to half-words (keeping the 16 least significant bits of each lane).
+inline uint32_t narrow_32_to_16(const __m128i x) {
+  const auto v = _mm_srai_epi32(_mm_slli_epi32(x, 16), 16);
+  return from_m128(_mm_packs_epi32(v, v));
+}
+
+// Narrow 32-bit lanes to bytes (keeping the eight least significant bits of each lane).
+inline uint32_t narrow_32_to_8(const __m128i x) {
+  const auto v = _mm_and_si128(x, _mm_set1_epi32(0x000000ff));
+  const auto w = _mm_packs_epi32(v, v);
+  return from_m128(_mm_packus_epi16(w, w));
+}
+
+// Flip the sign bits of bytes/half-words, which maps unsigned order to signed order.
+inline __m128i flip_sign_8(const uint32_t x) {
+  return to_m128(x ^ 0x80808080u);
+}
+
+inline __m128i flip_sign_16(const uint32_t x) {
+  return to_m128(x ^ 0x80008000u);
+}
+
+// Truncating division of 32-bit integer lanes, using single precision floating point. This is exact
+// for operands that fit in 17 bits (the rounded quotient never crosses an integer boundary).
+// Division by zero gives -1.
+inline __m128i div_lanes(const __m128i a, const __m128i b) {
+  const auto q = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(a), _mm_cvtepi32_ps(b)));
+  return _mm_or_si128(q, _mm_cmpeq_epi32(b, _mm_setzero_si128()));
+}
+
+// Remainder of truncating division of 32-bit integer lanes (see div_lanes()). Division by zero
+// gives the dividend.
+inline __m128i rem_lanes(const __m128i a, const __m128i b) {
+  const auto af = _mm_cvtepi32_ps(a);
+  const auto bf = _mm_cvtepi32_ps(b);
+  const auto qf = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_div_ps(af, bf)));
+  const auto r = _mm_cvttps_epi32(_mm_sub_ps(af, _mm_mul_ps(qf, bf)));
+  const auto b_is_zero = _mm_cmpeq_epi32(b, _mm_setzero_si128());
+  return _mm_or_si128(_mm_and_si128(b_is_zero, a), _mm_andnot_si128(b_is_zero, r));
+}
+#endif  // PACKED_INT_SIMD
+
+inline uint32_t add32(const uint32_t a, const uint32_t b) {
+  return a + b;
+}
+
+inline uint32_t add16x2(const uint32_t a, const uint32_t b) {
+  const uint32_t hi = (a & 0xffff0000u) + (b & 0xffff0000u);
+  const uint32_t lo = (a + b) & 0x0000ffffu;
+  return hi | lo;
+}
+
+inline uint32_t add8x4(const uint32_t a, const uint32_t b) {
+  const uint32_t hi = ((a & 0xff00ff00u) + (b & 0xff00ff00u)) & 0xff00ff00u;
+  const uint32_t lo = ((a & 0x00ff00ffu) + (b & 0x00ff00ffu)) & 0x00ff00ffu;
+  return hi | lo;
+}
+
+inline uint32_t sub32(const uint32_t a, const uint32_t b) {
+  return add32((~a) + 1u, b);
+}
+
+inline uint32_t sub16x2(const uint32_t a, const uint32_t b) {
+  return add16x2(add16x2(~a, 0x00010001u), b);
+}
+
+inline uint32_t sub8x4(const uint32_t a, const uint32_t b) {
+  return add8x4(add8x4(~a, 0x01010101u), b);
+}
+
+inline uint32_t set32(const uint32_t a, const uint32_t b, bool (*cmp)(uint32_t, uint32_t)) {
+  return cmp(a, b) ? 0xffffffffu : 0u;
+}
+
+inline uint32_t set16x2(const uint32_t a, const uint32_t b, bool (*cmp)(uint16_t, uint16_t)) {
+  const uint32_t h1 =
+      (cmp(static_cast<uint16_t>(a >> 16), static_cast<uint16_t>(b >> 16)) ? 0xffff0000u : 0u);
+  const uint32_t h0 = (cmp(static_cast<uint16_t>(a), static_cast<uint16_t>(b)) ? 0x0000ffffu : 0u);
+  return h1 | h0;
+}
+
+inline uint32_t set8x4(const uint32_t a, const uint32_t b, bool (*cmp)(uint8_t, uint8_t)) {
+  const uint32_t b3 =
+      (cmp(static_cast<uint8_t>(a >> 24), static_cast<uint8_t>(b >> 24)) ? 0xff000000u : 0u);
+  const uint32_t b2 =
+      (cmp(static_cast<uint8_t>(a >> 16), static_cast<uint8_t>(b >> 16)) ? 0x00ff0000u : 0u);
+  const uint32_t b1 =
+      (cmp(static_cast<uint8_t>(a >> 8), static_cast<uint8_t>(b >> 8)) ? 0x0000ff00u : 0u);
+  const uint32_t b0 = (cmp(static_cast<uint8_t>(a), static_cast<uint8_t>(b)) ? 0x000000ffu : 0u);
+  return b3 | b2 | b1 | b0;
+}
+
+inline uint32_t sel32(const uint32_t a, const uint32_t b, const uint32_t mask) {
+  return (a & mask) | (b & ~mask);
+}
+
+inline uint32_t seq8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_cmpeq_epi8(to_m128(a), to_m128(b)));
+#else
+  return set8x4(a, b, [](uint8_t x, uint8_t y) { return x == y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t seq16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_cmpeq_epi16(to_m128(a), to_m128(b)));
+#else
+  return set16x2(a, b, [](uint16_t x, uint16_t y) { return x == y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t sne8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return ~from_m128(_mm_cmpeq_epi8(to_m128(a), to_m128(b)));
+#else
+  return set8x4(a, b, [](uint8_t x, uint8_t y) { return x != y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t sne16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return ~from_m128(_mm_cmpeq_epi16(to_m128(a), to_m128(b)));
+#else
+  return set16x2(a, b, [](uint16_t x, uint16_t y) { return x != y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t slt8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_cmplt_epi8(to_m128(a), to_m128(b)));
+#else
+  return set8x4(a, b, [](uint8_t x, uint8_t y) {
+    return static_cast<int8_t>(x) < static_cast<int8_t>(y);
+  });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t slt16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_cmplt_epi16(to_m128(a), to_m128(b)));
+#else
+  return set16x2(a, b, [](uint16_t x, uint16_t y) {
+    return static_cast<int16_t>(x) < static_cast<int16_t>(y);
+  });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t sltu8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_cmplt_epi8(flip_sign_8(a), flip_sign_8(b)));
+#else
+  return set8x4(a, b, [](uint8_t x, uint8_t y) { return x < y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t sltu16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_cmplt_epi16(flip_sign_16(a), flip_sign_16(b)));
+#else
+  return set16x2(a, b, [](uint16_t x, uint16_t y) { return x < y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t sle8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return ~from_m128(_mm_cmpgt_epi8(to_m128(a), to_m128(b)));
+#else
+  return set8x4(a, b, [](uint8_t x, uint8_t y) {
+    return static_cast<int8_t>(x) <= static_cast<int8_t>(y);
+  });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t sle16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return ~from_m128(_mm_cmpgt_epi16(to_m128(a), to_m128(b)));
+#else
+  return set16x2(a, b, [](uint16_t x, uint16_t y) {
+    return static_cast<int16_t>(x) <= static_cast<int16_t>(y);
+  });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t sleu8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return ~from_m128(_mm_cmpgt_epi8(flip_sign_8(a), flip_sign_8(b)));
+#else
+  return set8x4(a, b, [](uint8_t x, uint8_t y) { return x <= y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t sleu16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return ~from_m128(_mm_cmpgt_epi16(flip_sign_16(a), flip_sign_16(b)));
+#else
+  return set16x2(a, b, [](uint16_t x, uint16_t y) { return x <= y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t min8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_min_epu8(flip_sign_8(a), flip_sign_8(b))) ^ 0x80808080u;
+#else
+  return sel32(a, b, set8x4(a, b, [](uint8_t x, uint8_t y) {
+           return static_cast<int8_t>(x) < static_cast<int8_t>(y);
+         }));
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t min16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_min_epi16(to_m128(a), to_m128(b)));
+#else
+  return sel32(a, b, set16x2(a, b, [](uint16_t x, uint16_t y) {
+           return static_cast<int16_t>(x) < static_cast<int16_t>(y);
+         }));
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t max8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_max_epu8(flip_sign_8(a), flip_sign_8(b))) ^ 0x80808080u;
+#else
+  return sel32(a, b, set8x4(a, b, [](uint8_t x, uint8_t y) {
+           return static_cast<int8_t>(x) > static_cast<int8_t>(y);
+         }));
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t max16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_max_epi16(to_m128(a), to_m128(b)));
+#else
+  return sel32(a, b, set16x2(a, b, [](uint16_t x, uint16_t y) {
+           return static_cast<int16_t>(x) > static_cast<int16_t>(y);
+         }));
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t minu8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_min_epu8(to_m128(a), to_m128(b)));
+#else
+  return sel32(a, b, set8x4(a, b, [](uint8_t x, uint8_t y) { return x < y; }));
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t minu16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_min_epi16(flip_sign_16(a), flip_sign_16(b))) ^ 0x80008000u;
+#else
+  return sel32(a, b, set16x2(a, b, [](uint16_t x, uint16_t y) { return x < y; }));
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t maxu8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_max_epu8(to_m128(a), to_m128(b)));
+#else
+  return sel32(a, b, set8x4(a, b, [](uint8_t x, uint8_t y) { return x > y; }));
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t maxu16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_max_epi16(flip_sign_16(a), flip_sign_16(b))) ^ 0x80008000u;
+#else
+  return sel32(a, b, set16x2(a, b, [](uint16_t x, uint16_t y) { return x > y; }));
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t saturate32(const int64_t x) {
+  return (x > INT64_C(0x000000007fffffff))
+             ? 0x7fffffffu
+             : ((x < INT64_C(-0x0000000080000000)) ? 0x80000000u : static_cast<uint32_t>(x));
+}
+
+inline uint32_t saturate16(const int32_t x) {
+  return (x > 0x00007fff)
+             ? 0x7fffu
+             : ((x < -0x00008000) ? 0x8000u : (static_cast<uint32_t>(x) & 0x0000ffffu));
+}
+
+inline uint32_t saturate8(const int16_t x) {
+  return (x > 0x007f) ? 0x7fu : ((x < -0x0080) ? 0x80u : (static_cast<uint32_t>(x) & 0x00ffu));
+}
+
+inline uint32_t saturate4(const int8_t x) {
+  return (x > 0x07) ? 0x7u : ((x < -0x08) ? 0x8u : (static_cast<uint32_t>(x) & 0x0fu));
+}
+
+inline uint32_t saturateu32(const uint64_t x) {
+  return (x > UINT64_C(0x8000000000000000))
+             ? 0x00000000u
+             : ((x > UINT64_C(0x00000000ffffffff)) ? 0xffffffffu : static_cast<uint32_t>(x));
+}
+
+inline uint32_t saturateu16(const uint32_t x) {
+  return (x > 0x80000000u) ? 0x0000u : ((x > 0x0000ffffu) ? 0xffffu : static_cast<uint32_t>(x));
+}
+
+inline uint32_t saturateu8(const uint16_t x) {
+  return (x > 0x8000u) ? 0x00u : ((x > 0x00ffu) ? 0xffu : static_cast<uint32_t>(x));
+}
+
+inline uint32_t saturateu16_no_uf(const uint32_t x) {
+  return (x > 0x0000ffffu) ? 0xffffu : static_cast<uint32_t>(x);
+}
+
+inline uint32_t saturateu8_no_uf(const uint16_t x) {
+  return (x > 0x00ffu) ? 0xffu : static_cast<uint32_t>(x);
+}
+
+inline uint32_t saturateu4_no_uf(const uint8_t x) {
+  return (x > 0x0fu) ? 0xfu : static_cast<uint32_t>(x);
+}
+
+inline uint32_t saturating_op_32(const uint32_t a,
+                                 const uint32_t b,
+                                 int64_t (*op)(int64_t, int64_t)) {
+  const auto a64 = static_cast<int64_t>(static_cast<int32_t>(a));
+  const auto b64 = static_cast<int64_t>(static_cast<int32_t>(b));
+  return saturate32(op(a64, b64));
+}
+
+inline uint32_t saturating_op_16x2(const uint32_t a,
+                                   const uint32_t b,
+                                   int32_t (*op)(int32_t, int32_t)) {
+  const auto a1 = static_cast<int32_t>(static_cast<int16_t>(a >> 16));
+  const auto a2 = static_cast<int32_t>(static_cast<int16_t>(a));
+  const auto b1 = static_cast<int32_t>(static_cast<int16_t>(b >> 16));
+  const auto b2 = static_cast<int32_t>(static_cast<int16_t>(b));
+  const auto c1 = saturate16(op(a1, b1));
+  const auto c2 = saturate16(op(a2, b2));
+  return (c1 << 16) | c2;
+}
+
+inline uint32_t saturating_op_8x4(const uint32_t a,
+                                  const uint32_t b,
+                                  int16_t (*op)(int16_t, int16_t)) {
+  const auto a1 = static_cast<int16_t>(static_cast<int8_t>(a >> 24));
+  const auto a2 = static_cast<int16_t>(static_cast<int8_t>(a >> 16));
+  const auto a3 = static_cast<int16_t>(static_cast<int8_t>(a >> 8));
+  const auto a4 = static_cast<int16_t>(static_cast<int8_t>(a));
+  const auto b1 = static_cast<int16_t>(static_cast<int8_t>(b >> 24));
+  const auto b2 = static_cast<int16_t>(static_cast<int8_t>(b >> 16));
+  const auto b3 = static_cast<int16_t>(static_cast<int8_t>(b >> 8));
+  const auto b4 = static_cast<int16_t>(static_cast<int8_t>(b));
+  const auto c1 = saturate8(op(a1, b1));
+  const auto c2 = saturate8(op(a2, b2));
+  const auto c3 = saturate8(op(a3, b3));
+  const auto c4 = saturate8(op(a4, b4));
+  return (c1 << 24) | (c2 << 16) | (c3 << 8) | c4;
+}
+
+inline uint32_t saturating_op_u32(const uint32_t a,
+                                  const uint32_t b,
+                                  uint64_t (*op)(uint64_t, uint64_t)) {
+  return saturateu32(op(static_cast<uint64_t>(a), static_cast<uint64_t>(b)));
+}
+
+inline uint32_t saturating_op_u16x2(const uint32_t a,
+                                    const uint32_t b,
+                                    uint32_t (*op)(uint32_t, uint32_t)) {
+  const auto a1 = static_cast<uint32_t>(static_cast<uint16_t>(a >> 16));
+  const auto a2 = static_cast<uint32_t>(static_cast<uint16_t>(a));
+  const auto b1 = static_cast<uint32_t>(static_cast<uint16_t>(b >> 16));
+  const auto b2 = static_cast<uint32_t>(static_cast<uint16_t>(b));
+  const auto c1 = saturateu16(op(a1, b1));
+  const auto c2 = saturateu16(op(a2, b2));
+  return (c1 << 16) | c2;
+}
+
+inline uint32_t saturating_op_u8x4(const uint32_t a,
+                                   const uint32_t b,
+                                   uint16_t (*op)(uint16_t, uint16_t)) {
+  const auto a1 = static_cast<uint16_t>(static_cast<uint8_t>(a >> 24));
+  const auto a2 = static_cast<uint16_t>(static_cast<uint8_t>(a >> 16));
+  const auto a3 = static_cast<uint16_t>(static_cast<uint8_t>(a >> 8));
+  const auto a4 = static_cast<uint16_t>(static_cast<uint8_t>(a));
+  const auto b1 = static_cast<uint16_t>(static_cast<uint8_t>(b >> 24));
+  const auto b2 = static_cast<uint16_t>(static_cast<uint8_t>(b >> 16));
+  const auto b3 = static_cast<uint16_t>(static_cast<uint8_t>(b >> 8));
+  const auto b4 = static_cast<uint16_t>(static_cast<uint8_t>(b));
+  const auto c1 = saturateu8(op(a1, b1));
+  const auto c2 = saturateu8(op(a2, b2));
+  const auto c3 = saturateu8(op(a3, b3));
+  const auto c4 = saturateu8(op(a4, b4));
+  return (c1 << 24) | (c2 << 16) | (c3 << 8) | c4;
+}
+
+inline uint32_t halve32(const int64_t x) {
+  return static_cast<uint32_t>(x >> 1);
+}
+
+inline uint32_t halve16(const int32_t x) {
+  return static_cast<uint32_t>(static_cast<uint16_t>(x >> 1));
+}
+
+inline uint32_t halve8(const int16_t x) {
+  return static_cast<uint32_t>(static_cast<uint8_t>(x >> 1));
+}
+
+inline uint32_t halveu32(const uint64_t x) {
+  return static_cast<uint32_t>(x >> 1);
+}
+
+inline uint32_t halveu16(const uint32_t x) {
+  return static_cast<uint32_t>(static_cast<uint16_t>(x >> 1));
+}
+
+inline uint32_t halveu8(const uint16_t x) {
+  return static_cast<uint32_t>(static_cast<uint8_t>(x >> 1));
+}
+
+inline uint32_t halving_op_32(const uint32_t a, const uint32_t b, int64_t (*op)(int64_t, int64_t)) {
+  const auto a64 = static_cast<int64_t>(static_cast<int32_t>(a));
+  const auto b64 = static_cast<int64_t>(static_cast<int32_t>(b));
+  return halve32(op(a64, b64));
+}
+
+inline uint32_t halving_op_16x2(const uint32_t a,
+                                const uint32_t b,
+                                int32_t (*op)(int32_t, int32_t)) {
+  const auto a1 = static_cast<int32_t>(static_cast<int16_t>(a >> 16));
+  const auto a2 = static_cast<int32_t>(static_cast<int16_t>(a));
+  const auto b1 = static_cast<int32_t>(static_cast<int16_t>(b >> 16));
+  const auto b2 = static_cast<int32_t>(static_cast<int16_t>(b));
+  const auto c1 = halve16(op(a1, b1));
+  const auto c2 = halve16(op(a2, b2));
+  return (c1 << 16) | c2;
+}
+
+inline uint32_t halving_op_8x4(const uint32_t a,
+                               const uint32_t b,
+                               int16_t (*op)(int16_t, int16_t)) {
+  const auto a1 = static_cast<int16_t>(static_cast<int8_t>(a >> 24));
+  const auto a2 = static_cast<int16_t>(static_cast<int8_t>(a >> 16));
+  const auto a3 = static_cast<int16_t>(static_cast<int8_t>(a >> 8));
+  const auto a4 = static_cast<int16_t>(static_cast<int8_t>(a));
+  const auto b1 = static_cast<int16_t>(static_cast<int8_t>(b >> 24));
+  const auto b2 = static_cast<int16_t>(static_cast<int8_t>(b >> 16));
+  const auto b3 = static_cast<int16_t>(static_cast<int8_t>(b >> 8));
+  const auto b4 = static_cast<int16_t>(static_cast<int8_t>(b));
+  const auto c1 = halve8(op(a1, b1));
+  const auto c2 = halve8(op(a2, b2));
+  const auto c3 = halve8(op(a3, b3));
+  const auto c4 = halve8(op(a4, b4));
+  return (c1 << 24) | (c2 << 16) | (c3 << 8) | c4;
+}
+
+inline uint32_t halving_op_u32(const uint32_t a,
+                               const uint32_t b,
+                               uint64_t (*op)(uint64_t, uint64_t)) {
+  return halveu32(op(static_cast<uint64_t>(a), static_cast<uint64_t>(b)));
+}
+
+inline uint32_t halving_op_u16x2(const uint32_t a,
+                                 const uint32_t b,
+                                 uint32_t (*op)(uint32_t, uint32_t)) {
+  const auto a1 = static_cast<uint32_t>(static_cast<uint16_t>(a >> 16));
+  const auto a2 = static_cast<uint32_t>(static_cast<uint16_t>(a));
+  const auto b1 = static_cast<uint32_t>(static_cast<uint16_t>(b >> 16));
+  const auto b2 = static_cast<uint32_t>(static_cast<uint16_t>(b));
+  const auto c1 = halveu16(op(a1, b1));
+  const auto c2 = halveu16(op(a2, b2));
+  return (c1 << 16) | c2;
+}
+
+inline uint32_t halving_op_u8x4(const uint32_t a,
+                                const uint32_t b,
+                                uint16_t (*op)(uint16_t, uint16_t)) {
+  const auto a1 = static_cast<uint16_t>(static_cast<uint8_t>(a >> 24));
+  const auto a2 = static_cast<uint16_t>(static_cast<uint8_t>(a >> 16));
+  const auto a3 = static_cast<uint16_t>(static_cast<uint8_t>(a >> 8));
+  const auto a4 = static_cast<uint16_t>(static_cast<uint8_t>(a));
+  const auto b1 = static_cast<uint16_t>(static_cast<uint8_t>(b >> 24));
+  const auto b2 = static_cast<uint16_t>(static_cast<uint8_t>(b >> 16));
+  const auto b3 = static_cast<uint16_t>(static_cast<uint8_t>(b >> 8));
+  const auto b4 = static_cast<uint16_t>(static_cast<uint8_t>(b));
+  const auto c1 = halveu8(op(a1, b1));
+  const auto c2 = halveu8(op(a2, b2));
+  const auto c3 = halveu8(op(a3, b3));
+  const auto c4 = halveu8(op(a4, b4));
+  return (c1 << 24) | (c2 << 16) | (c3 << 8) | c4;
+}
+
+inline uint32_t adds8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_adds_epi8(to_m128(a), to_m128(b)));
+#else
+  return saturating_op_8x4(a, b, [](int16_t x, int16_t y) -> int16_t { return x + y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t adds16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_adds_epi16(to_m128(a), to_m128(b)));
+#else
+  return saturating_op_16x2(a, b, [](int32_t x, int32_t y) -> int32_t { return x + y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t addsu8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_adds_epu8(to_m128(a), to_m128(b)));
+#else
+  return saturating_op_u8x4(a, b, [](uint16_t x, uint16_t y) -> uint16_t { return x + y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t addsu16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_adds_epu16(to_m128(a), to_m128(b)));
+#else
+  return saturating_op_u16x2(a, b, [](uint32_t x, uint32_t y) -> uint32_t { return x + y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t subs8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_subs_epi8(to_m128(a), to_m128(b)));
+#else
+  return saturating_op_8x4(a, b, [](int16_t x, int16_t y) -> int16_t { return x - y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t subs16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_subs_epi16(to_m128(a), to_m128(b)));
+#else
+  return saturating_op_16x2(a, b, [](int32_t x, int32_t y) -> int32_t { return x - y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t subsu8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_subs_epu8(to_m128(a), to_m128(b)));
+#else
+  return saturating_op_u8x4(a, b, [](uint16_t x, uint16_t y) -> uint16_t { return x - y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t subsu16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_subs_epu16(to_m128(a), to_m128(b)));
+#else
+  return saturating_op_u16x2(a, b, [](uint32_t x, uint32_t y) -> uint32_t { return x - y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t addh8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return narrow_16_to_8(_mm_srai_epi16(_mm_add_epi16(widen_i8(a), widen_i8(b)), 1));
+#else
+  return halving_op_8x4(a, b, [](int16_t x, int16_t y) -> int16_t { return x + y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t addh16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return narrow_32_to_16(_mm_srai_epi32(_mm_add_epi32(widen_i16(a), widen_i16(b)), 1));
+#else
+  return halving_op_16x2(a, b, [](int32_t x, int32_t y) -> int32_t { return x + y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t addhu8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return narrow_16_to_8(_mm_srai_epi16(_mm_add_epi16(widen_u8(a), widen_u8(b)), 1));
+#else
+  return halving_op_u8x4(a, b, [](uint16_t x, uint16_t y) -> uint16_t { return x + y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t addhu16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return narrow_32_to_16(_mm_srai_epi32(_mm_add_epi32(widen_u16(a), widen_u16(b)), 1));
+#else
+  return halving_op_u16x2(a, b, [](uint32_t x, uint32_t y) -> uint32_t { return x + y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t addhr8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  const auto x = _mm_add_epi16(widen_i8(a), widen_i8(b));
+  return narrow_16_to_8(_mm_srai_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), 1));
+#else
+  return halving_op_8x4(a, b, [](int16_t x, int16_t y) -> int16_t { return x + y + 1; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t addhr16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  const auto x = _mm_add_epi32(widen_i16(a), widen_i16(b));
+  return narrow_32_to_16(_mm_srai_epi32(_mm_add_epi32(x, _mm_set1_epi32(1)), 1));
+#else
+  return halving_op_16x2(a, b, [](int32_t x, int32_t y) -> int32_t { return x + y + 1; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t addhur8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  const auto x = _mm_add_epi16(widen_u8(a), widen_u8(b));
+  return narrow_16_to_8(_mm_srai_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), 1));
+#else
+  return halving_op_u8x4(a, b, [](uint16_t x, uint16_t y) -> uint16_t { return x + y + 1; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t addhur16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  const auto x = _mm_add_epi32(widen_u16(a), widen_u16(b));
+  return narrow_32_to_16(_mm_srai_epi32(_mm_add_epi32(x, _mm_set1_epi32(1)), 1));
+#else
+  return halving_op_u16x2(a, b, [](uint32_t x, uint32_t y) -> uint32_t { return x + y + 1; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t subh8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return narrow_16_to_8(_mm_srai_epi16(_mm_sub_epi16(widen_i8(a), widen_i8(b)), 1));
+#else
+  return halving_op_8x4(a, b, [](int16_t x, int16_t y) -> int16_t { return x - y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t subh16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return narrow_32_to_16(_mm_srai_epi32(_mm_sub_epi32(widen_i16(a), widen_i16(b)), 1));
+#else
+  return halving_op_16x2(a, b, [](int32_t x, int32_t y) -> int32_t { return x - y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t subhu8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return narrow_16_to_8(_mm_srai_epi16(_mm_sub_epi16(widen_u8(a), widen_u8(b)), 1));
+#else
+  return halving_op_u8x4(a, b, [](uint16_t x, uint16_t y) -> uint16_t { return x - y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t subhu16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return narrow_32_to_16(_mm_srai_epi32(_mm_sub_epi32(widen_u16(a), widen_u16(b)), 1));
+#else
+  return halving_op_u16x2(a, b, [](uint32_t x, uint32_t y) -> uint32_t { return x - y; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t subhr8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  const auto x = _mm_sub_epi16(widen_i8(a), widen_i8(b));
+  return narrow_16_to_8(_mm_srai_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), 1));
+#else
+  return halving_op_8x4(a, b, [](int16_t x, int16_t y) -> int16_t { return x - y + 1; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t subhr16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  const auto x = _mm_sub_epi32(widen_i16(a), widen_i16(b));
+  return narrow_32_to_16(_mm_srai_epi32(_mm_add_epi32(x, _mm_set1_epi32(1)), 1));
+#else
+  return halving_op_16x2(a, b, [](int32_t x, int32_t y) -> int32_t { return x - y + 1; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t subhur8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  const auto x = _mm_sub_epi16(widen_u8(a), widen_u8(b));
+  return narrow_16_to_8(_mm_srai_epi16(_mm_add_epi16(x, _mm_set1_epi16(1)), 1));
+#else
+  return halving_op_u8x4(a, b, [](uint16_t x, uint16_t y) -> uint16_t { return x - y + 1; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t subhur16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  const auto x = _mm_sub_epi32(widen_u16(a), widen_u16(b));
+  return narrow_32_to_16(_mm_srai_epi32(_mm_add_epi32(x, _mm_set1_epi32(1)), 1));
+#else
+  return halving_op_u16x2(a, b, [](uint32_t x, uint32_t y) -> uint32_t { return x - y + 1; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t mulq8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  const auto p = _mm_srai_epi16(_mm_mullo_epi16(widen_i8(a), widen_i8(b)), 7);
+  return from_m128(_mm_packs_epi16(p, p));
+#else
+  return saturating_op_8x4(a, b, [](int16_t x, int16_t y) -> int16_t { return (x * y) >> 7; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t mulq16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  const auto x = to_m128(a);
+  const auto y = to_m128(b);
+  auto p = _mm_unpacklo_epi16(_mm_mullo_epi16(x, y), _mm_mulhi_epi16(x, y));
+  p = _mm_srai_epi32(p, 15);
+  return from_m128(_mm_packs_epi32(p, p));
+#else
+  return saturating_op_16x2(a, b, [](int32_t x, int32_t y) -> int32_t { return (x * y) >> 15; });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t mulqr8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  auto p = _mm_mullo_epi16(widen_i8(a), widen_i8(b));
+  p = _mm_srai_epi16(_mm_add_epi16(p, _mm_set1_epi16(1 << 6)), 7);
+  return from_m128(_mm_packs_epi16(p, p));
+#else
+  return saturating_op_8x4(a, b, [](int16_t x, int16_t y) -> int16_t {
+    return (x * y + (1 << 6)) >> 7;
+  });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t mulqr16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  const auto x = to_m128(a);
+  const auto y = to_m128(b);
+  auto p = _mm_unpacklo_epi16(_mm_mullo_epi16(x, y), _mm_mulhi_epi16(x, y));
+  p = _mm_srai_epi32(_mm_add_epi32(p, _mm_set1_epi32(1 << 14)), 15);
+  return from_m128(_mm_packs_epi32(p, p));
+#else
+  return saturating_op_16x2(a, b, [](int32_t x, int32_t y) -> int32_t {
+    return (x * y + (1 << 14)) >> 15;
+  });
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t mul32(const uint32_t a, const uint32_t b) {
+  return a * b;
+}
+
+inline uint32_t mul16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_mullo_epi16(to_m128(a), to_m128(b)));
+#else
+  const auto h1 = (a >> 16) * (b >> 16) << 16;
+  const auto h0 = (a * b) & 0x0000ffffu;
+  return h1 | h0;
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t mul8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return narrow_16_to_8(_mm_mullo_epi16(widen_u8(a), widen_u8(b)));
+#else
+  const auto b3 = (a >> 24) * (b >> 24) << 24;
+  const auto b2 = (((a >> 16) * (b >> 16)) & 0x000000ffu) << 16;
+  const auto b1 = (((a >> 8) * (b >> 8)) & 0x000000ffu) << 8;
+  const auto b0 = (a * b) & 0x000000ffu;
+  return b3 | b2 | b1 | b0;
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t mulhi32(const uint32_t a, const uint32_t b) {
+  const int64_t p =
+      static_cast<int64_t>(static_cast<int32_t>(a)) * static_cast<int64_t>(static_cast<int32_t>(b));
+  return static_cast<uint32_t>(p >> 32u);
+}
+
+inline uint32_t mulhi16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_mulhi_epi16(to_m128(a), to_m128(b)));
+#else
+  const auto a1 = static_cast<int32_t>(static_cast<int16_t>(a >> 16u));
+  const auto a0 = static_cast<int32_t>(static_cast<int16_t>(a));
+  const auto b1 = static_cast<int32_t>(static_cast<int16_t>(b >> 16u));
+  const auto b0 = static_cast<int32_t>(static_cast<int16_t>(b));
+  const auto c1 = static_cast<uint32_t>(a1 * b1) & 0xffff0000u;
+  const auto c0 = static_cast<uint32_t>(a0 * b0) >> 16u;
+  return c1 | c0;
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t mulhi8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  const auto p = _mm_mullo_epi16(widen_i8(a), widen_i8(b));
+  return narrow_16_to_8(_mm_srli_epi16(p, 8));
+#else
+  const auto a3 = static_cast<int32_t>(static_cast<int8_t>(a >> 24u));
+  const auto a2 = static_cast<int32_t>(static_cast<int8_t>(a >> 16u));
+  const auto a1 = static_cast<int32_t>(static_cast<int8_t>(a >> 8u));
+  const auto a0 = static_cast<int32_t>(static_cast<int8_t>(a));
+  const auto b3 = static_cast<int32_t>(static_cast<int8_t>(b >> 24u));
+  const auto b2 = static_cast<int32_t>(static_cast<int8_t>(b >> 16u));
+  const auto b1 = static_cast<int32_t>(static_cast<int8_t>(b >> 8u));
+  const auto b0 = static_cast<int32_t>(static_cast<int8_t>(b));
+  const auto c3 = (static_cast<uint32_t>(a3 * b3) & 0x0000ff00u) << 16u;
+  const auto c2 = (static_cast<uint32_t>(a2 * b2) & 0x0000ff00u) << 8u;
+  const auto c1 = (static_cast<uint32_t>(a1 * b1) & 0x0000ff00u);
+  const auto c0 = (static_cast<uint32_t>(a0 * b0) & 0x0000ff00u) >> 8u;
+  return c3 | c2 | c1 | c0;
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t mulhiu32(const uint32_t a, const uint32_t b) {
+  const uint64_t p = static_cast<uint64_t>(a) * static_cast<uint64_t>(b);
+  return static_cast<uint32_t>(p >> 32u);
+}
+
+inline uint32_t mulhiu16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_mulhi_epu16(to_m128(a), to_m128(b)));
+#else
+  const auto h1 = (a >> 16) * (b >> 16) & 0xffff0000u;
+  const auto h0 = ((a & 0x0000ffffu) * (b & 0x0000ffffu)) >> 16;
+  return h1 | h0;
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t mulhiu8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  const auto p = _mm_mullo_epi16(widen_u8(a), widen_u8(b));
+  return narrow_16_to_8(_mm_srli_epi16(p, 8));
+#else
+  const auto b3 = ((a & 0xff000000u) >> 16u) * ((b & 0xff000000u) >> 16u) & 0xff000000u;
+  const auto b2 = (((a & 0x00ff0000u) >> 12u) * ((b & 0x00ff0000u) >> 12u)) & 0x00ff0000u;
+  const auto b1 = ((a & 0x0000ff00u) >> 8u) * ((b & 0x0000ff00u) >> 8u) & 0x0000ff00u;
+  const auto b0 = ((a & 0x000000ffu) * (b & 0x000000ffu)) >> 8u;
+  return b3 | b2 | b1 | b0;
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t madd32(const uint32_t a, const uint32_t b, const uint32_t c) {
+  return c + a * b;
+}
+
+inline uint32_t madd16x2(const uint32_t a, const uint32_t b, const uint32_t c) {
+#if PACKED_INT_SIMD
+  return from_m128(_mm_add_epi16(to_m128(c), _mm_mullo_epi16(to_m128(a), to_m128(b))));
+#else
+  const auto h1 = ((c >> 16) + (a >> 16) * (b >> 16)) << 16;
+  const auto h0 = (c + a * b) & 0x0000ffffu;
+  return h1 | h0;
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t madd8x4(const uint32_t a, const uint32_t b, const uint32_t c) {
+#if PACKED_INT_SIMD
+  return add8x4(c, narrow_16_to_8(_mm_mullo_epi16(widen_u8(a), widen_u8(b))));
+#else
+  const auto b3 = ((c >> 24) + (a >> 24) * (b >> 24)) << 24;
+  const auto b2 = (((c >> 16) + (a >> 16) * (b >> 16)) & 0x000000ffu) << 16;
+  const auto b1 = (((c >> 8) + (a >> 8) * (b >> 8)) & 0x000000ffu) << 8;
+  const auto b0 = (c + a * b) & 0x000000ffu;
+  return b3 | b2 | b1 | b0;
+#endif  // PACKED_INT_SIMD
+}
+
+template <typename T>
+inline T div_allow_zero(const T a, const T b) {
+  return b != static_cast<T>(0) ? (a / b) : static_cast<T>(-1);
+}
+
+template <typename T>
+inline T mod_allow_zero(const T a, const T b) {
+  return b != static_cast<T>(0) ? (a % b) : a;
+}
+
+inline uint32_t div32(const uint32_t a, const uint32_t b) {
+  // INT_MIN / -1 overflows (and traps on x86), so handle it explicitly (the result wraps).
+  if (a == 0x80000000u && b == 0xffffffffu) {
+    return a;
+  }
+  return static_cast<uint32_t>(div_allow_zero(static_cast<int32_t>(a), static_cast<int32_t>(b)));
+}
+
+inline uint32_t div16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return narrow_32_to_16(div_lanes(widen_i16(a), widen_i16(b)));
+#else
+  const auto a1 = static_cast<int32_t>(static_cast<int16_t>(a >> 16u));
+  const auto a0 = static_cast<int32_t>(static_cast<int16_t>(a));
+  const auto b1 = static_cast<int32_t>(static_cast<int16_t>(b >> 16u));
+  const auto b0 = static_cast<int32_t>(static_cast<int16_t>(b));
+  const auto c1 = (static_cast<uint32_t>(div_allow_zero(a1, b1)) & 0x0000ffffu) << 16u;
+  const auto c0 = static_cast<uint32_t>(div_allow_zero(a0, b0)) & 0x0000ffffu;
+  return c1 | c0;
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t div8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return narrow_32_to_8(div_lanes(widen_i8_to_32(a), widen_i8_to_32(b)));
+#else
+  const auto a3 = static_cast<int32_t>(static_cast<int8_t>(a >> 24u));
+  const auto a2 = static_cast<int32_t>(static_cast<int8_t>(a >> 16u));
+  const auto a1 = static_cast<int32_t>(static_cast<int8_t>(a >> 8u));
+  const auto a0 = static_cast<int32_t>(static_cast<int8_t>(a));
+  const auto b3 = static_cast<int32_t>(static_cast<int8_t>(b >> 24u));
+  const auto b2 = static_cast<int32_t>(static_cast<int8_t>(b >> 16u));
+  const auto b1 = static_cast<int32_t>(static_cast<int8_t>(b >> 8u));
+  const auto b0 = static_cast<int32_t>(static_cast<int8_t>(b));
+  const auto c3 = (static_cast<uint32_t>(div_allow_zero(a3, b3)) & 0x000000ffu) << 24u;
+  const auto c2 = (static_cast<uint32_t>(div_allow_zero(a2, b2)) & 0x000000ffu) << 16u;
+  const auto c1 = (static_cast<uint32_t>(div_allow_zero(a1, b1)) & 0x000000ffu) << 8u;
+  const auto c0 = static_cast<uint32_t>(div_allow_zero(a0, b0)) & 0x000000ffu;
+  return c3 | c2 | c1 | c0;
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t divu32(const uint32_t a, const uint32_t b) {
+  return div_allow_zero(a, b);
+}
+
+inline uint32_t divu16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return narrow_32_to_16(div_lanes(widen_u16(a), widen_u16(b)));
+#else
+  const auto a1 = a >> 16u;
+  const auto a0 = a & 0x0000ffff;
+  const auto b1 = b >> 16u;
+  const auto b0 = b & 0x0000ffff;
+  const auto c1 = (div_allow_zero(a1, b1) & 0x0000ffffu) << 16u;
+  const auto c0 = div_allow_zero(a0, b0) & 0x0000ffffu;
+  return c1 | c0;
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t divu8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return narrow_32_to_8(div_lanes(widen_u8_to_32(a), widen_u8_to_32(b)));
+#else
+  const auto a3 = a >> 24u;
+  const auto a2 = (a >> 16u) & 0x000000ff;
+  const auto a1 = (a >> 8u) & 0x000000ff;
+  const auto a0 = a & 0x000000ff;
+  const auto b3 = b >> 24u;
+  const auto b2 = (b >> 16u) & 0x000000ff;
+  const auto b1 = (b >> 8u) & 0x000000ff;
+  const auto b0 = b & 0x000000ff;
+  const auto c3 = (div_allow_zero(a3, b3) & 0x000000ffu) << 24u;
+  const auto c2 = (div_allow_zero(a2, b2) & 0x000000ffu) << 16u;
+  const auto c1 = (div_allow_zero(a1, b1) & 0x000000ffu) << 8u;
+  const auto c0 = div_allow_zero(a0, b0) & 0x000000ffu;
+  return c3 | c2 | c1 | c0;
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t rem32(const uint32_t a, const uint32_t b) {
+  // INT_MIN % -1 overflows (and traps on x86), but the remainder is zero.
+  if (a == 0x80000000u && b == 0xffffffffu) {
+    return 0u;
+  }
+  return static_cast<uint32_t>(mod_allow_zero(static_cast<int32_t>(a), static_cast<int32_t>(b)));
+}
+
+inline uint32_t rem16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return narrow_32_to_16(rem_lanes(widen_i16(a), widen_i16(b)));
+#else
+  const auto a1 = static_cast<int32_t>(static_cast<int16_t>(a >> 16u));
+  const auto a0 = static_cast<int32_t>(static_cast<int16_t>(a));
+  const auto b1 = static_cast<int32_t>(static_cast<int16_t>(b >> 16u));
+  const auto b0 = static_cast<int32_t>(static_cast<int16_t>(b));
+  const auto c1 = (static_cast<uint32_t>(mod_allow_zero(a1, b1)) & 0x0000ffffu) << 16u;
+  const auto c0 = static_cast<uint32_t>(mod_allow_zero(a0, b0)) & 0x0000ffffu;
+  return c1 | c0;
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t rem8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return narrow_32_to_8(rem_lanes(widen_i8_to_32(a), widen_i8_to_32(b)));
+#else
+  const auto a3 = static_cast<int32_t>(static_cast<int8_t>(a >> 24u));
+  const auto a2 = static_cast<int32_t>(static_cast<int8_t>(a >> 16u));
+  const auto a1 = static_cast<int32_t>(static_cast<int8_t>(a >> 8u));
+  const auto a0 = static_cast<int32_t>(static_cast<int8_t>(a));
+  const auto b3 = static_cast<int32_t>(static_cast<int8_t>(b >> 24u));
+  const auto b2 = static_cast<int32_t>(static_cast<int8_t>(b >> 16u));
+  const auto b1 = static_cast<int32_t>(static_cast<int8_t>(b >> 8u));
+  const auto b0 = static_cast<int32_t>(static_cast<int8_t>(b));
+  const auto c3 = (static_cast<uint32_t>(mod_allow_zero(a3, b3)) & 0x000000ffu) << 24u;
+  const auto c2 = (static_cast<uint32_t>(mod_allow_zero(a2, b2)) & 0x000000ffu) << 16u;
+  const auto c1 = (static_cast<uint32_t>(mod_allow_zero(a1, b1)) & 0x000000ffu) << 8u;
+  const auto c0 = static_cast<uint32_t>(mod_allow_zero(a0, b0)) & 0x000000ffu;
+  return c3 | c2 | c1 | c0;
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t remu32(const uint32_t a, const uint32_t b) {
+  return mod_allow_zero(a, b);
+}
+
+inline uint32_t remu16x2(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return narrow_32_to_16(rem_lanes(widen_u16(a), widen_u16(b)));
+#else
+  const auto a1 = a >> 16u;
+  const auto a0 = a & 0x0000ffff;
+  const auto b1 = b >> 16u;
+  const auto b0 = b & 0x0000ffff;
+  const auto c1 = mod_allow_zero(a1, b1) << 16u;
+  const auto c0 = mod_allow_zero(a0, b0);
+  return c1 | c0;
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint32_t remu8x4(const uint32_t a, const uint32_t b) {
+#if PACKED_INT_SIMD
+  return narrow_32_to_8(rem_lanes(widen_u8_to_32(a), widen_u8_to_32(b)));
+#else
+  const auto a3 = a >> 24u;
+  const auto a2 = (a >> 16u) & 0x000000ff;
+  const auto a1 = (a >> 8u) & 0x000000ff;
+  const auto a0 = a & 0x000000ff;
+  const auto b3 = b >> 24u;
+  const auto b2 = (b >> 16u) & 0x000000ff;
+  const auto b1 = (b >> 8u) & 0x000000ff;
+  const auto b0 = b & 0x000000ff;
+  const auto c3 = mod_allow_zero(a3, b3) << 24u;
+  const auto c2 = mod_allow_zero(a2, b2) << 16u;
+  const auto c1 = mod_allow_zero(a1, b1) << 8u;
+  const auto c0 = mod_allow_zero(a0, b0);
+  return c3 | c2 | c1 | c0;
+#endif  // PACKED_INT_SIMD
+}
+
+inline uint8_t shuf_op(const uint8_t x, const bool fill, const bool sign_fill) {
+  const uint8_t fill_bits = (sign_fill && ((x & 0x80u) != 0u)) ? 0xffu : 0x00u;
+  return fill ? fill_bits : x;
+}
+
+inline uint32_t shuf32(const uint32_t x, const uint32_t idx) {
+#if PACKED_INT_SIMD && defined(__SSSE3__)
+  // Spread the four 3-bit lane descriptors of idx into one byte each. Bits 0-1 are the source byte
+  // index and bit 2 is the fill flag.
+  const uint32_t desc = (idx & 0x00000007u) | ((idx & 0x00000038u) << 5u) |
+                        ((idx & 0x000001c0u) << 10u) | ((idx & 0x00000e00u) << 15u);
+  const uint32_t fill_mask = ((desc >> 2u) & 0x01010101u) * 0xffu;
+
+  // Shuffle the bytes, and zero-fill or sign-fill the lanes that have the fill flag set.
+  const auto y = _mm_shuffle_epi8(to_m128(x), to_m128(desc & 0x03030303u));
+  const bool sign_fill = (((idx >> 12u) & 1u) != 0u);
+  const uint32_t fill_bits =
+      sign_fill ? from_m128(_mm_cmplt_epi8(y, _mm_setzero_si128())) & fill_mask : 0u;
+  return (from_m128(y) & ~fill_mask) | fill_bits;
+#else
+  // Extract the four bytes from x.
+  uint8_t xv[4];
+  xv[0] = static_cast<uint8_t>(x);
+  xv[1] = static_cast<uint8_t>(x >> 8u);
+  xv[2] = static_cast<uint8_t>(x >> 16u);
+  xv[3] = static_cast<uint8_t>(x >> 24u);
+
+  // Extract the four indices from idx.
+  uint8_t idxv[4];
+  idxv[0] = static_cast<uint8_t>(idx & 3u);
+  idxv[1] = static_cast<uint8_t>((idx >> 3u) & 3u);
+  idxv[2] = static_cast<uint8_t>((idx >> 6u) & 3u);
+  idxv[3] = static_cast<uint8_t>((idx >> 9u) & 3u);
+
+  // Extract the four fill operation descriptions from idx.
+  bool fillv[4];
+  fillv[0] = ((idx & 4u) != 0u);
+  fillv[1] = ((idx & (4u << 3u)) != 0u);
+  fillv[2] = ((idx & (4u << 6u)) != 0u);
+  fillv[3] = ((idx & (4u << 9u)) != 0u);
+
+  // Sign-fill or zero-fill?
+  const bool sign_fill = (((idx >> 12u) & 1u) != 0u);
+
+  // Combine the parts into four new bytes.
+  uint8_t yv[4];
+  yv[0] = shuf_op(xv[idxv[0]], fillv[0], sign_fill);
+  yv[1] = shuf_op(xv[idxv[1]], fillv[1], sign_fill);
+  yv[2] = shuf_op(xv[idxv[2]], fillv[2], sign_fill);
+  yv[3] = shuf_op(xv[idxv[3]], fillv[3], sign_fill);
+
+  // Combine the four bytes into a 32-bit word.
+  return static_cast<uint32_t>(yv[0]) | (static_cast<uint32_t>(yv[1]) << 8u) |
+         (static_cast<uint32_t>(yv[2]) << 16u) | (static_cast<uint32_t>(yv[3]) << 24u);
+#endif  // PACKED_INT_SIMD && __SSSE3__
+}
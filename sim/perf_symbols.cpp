@@ -64,20 +64,71 @@ void perf_symbols_t::print() const {
   auto syms = m_symbols;
   std::sort(syms.begin(), syms.end(), cycles_gt);
 
-  // Print symbols & cycles.
-  printf("Address (hex)\tCycles\tFunction\n");
+  // Print symbols & cycles (and cache misses, if cache simulation is enabled).
+  if (m_has_cache_stats) {
+    printf("Address (hex)\tCycles\tI$ misses\tD$ misses\tFunction\n");
+  } else {
+    printf("Address (hex)\tCycles\tFunction\n");
+  }
   for (const auto& sym : syms) {
     if (sym.cycles > 0u) {
-      printf("0x%08x\t%ld\t%s\n", sym.addr, sym.cycles, sym.name.c_str());
+      if (m_has_cache_stats) {
+        printf("0x%08x\t%ld\t%ld\t%ld\t%s\n",
+               sym.addr,
+               sym.cycles,
+               sym.icache_misses,
+               sym.dcache_misses,
+               sym.name.c_str());
+      } else {
+        printf("0x%08x\t%ld\t%s\n", sym.addr, sym.cycles, sym.name.c_str());
+      }
+    }
+  }
+}
+
+void perf_symbols_t::add_ref_impl(const uint32_t addr, const uint32_t cycles) {
+  const auto idx = find_symbol(addr);
+  if (idx >= 0) {
+    m_symbols[idx].cycles += cycles;
+  }
+}
+
+void perf_symbols_t::merge(const perf_symbols_t& other) {
+  if (other.m_symbols.size() != m_symbols.size()) {
+    return;
+  }
+  for (std::size_t i = 0; i < m_symbols.size(); ++i) {
+    m_symbols[i].cycles += other.m_symbols[i].cycles;
+    m_symbols[i].icache_misses += other.m_symbols[i].icache_misses;
+    m_symbols[i].dcache_misses += other.m_symbols[i].dcache_misses;
+  }
+  m_has_cache_stats = m_has_cache_stats || other.m_has_cache_stats;
+}
+
+std::string perf_symbols_t::symbol_name(const uint32_t addr) {
+  if (m_has_symbols) {
+    const auto idx = find_symbol(addr);
+    if (idx >= 0) {
+      return m_symbols[idx].name;
     }
   }
+  return std::string();
 }
 
-void perf_symbols_t::add_ref_impl(const uint32_t addr) {
+bool perf_symbols_t::symbol_address(const std::string& name, uint32_t& addr) const {
+  for (const auto& symbol : m_symbols) {
+    if (symbol.name == name) {
+      addr = symbol.addr;
+      return true;
+    }
+  }
+  return false;
+}
+
+int perf_symbols_t::find_symbol(const uint32_t addr) {
   // This instruction is very likely to be in the same function as the previous instruction.
   if (m_symbols[m_last_sym_idx].addr <= addr && addr <= m_symbols[m_last_sym_idx + 1].addr) {
-    ++m_symbols[m_last_sym_idx].cycles;
-    return;
+    return m_last_sym_idx;
   }
 
   // Use binary search to find the symbol.
@@ -92,8 +143,8 @@ void perf_symbols_t::add_ref_impl(const uint32_t addr) {
       R = m - 1;
     } else {
       m_last_sym_idx = m;
-      ++m_symbols[m].cycles;
-      break;
+      return m;
     }
   }
+  return -1;
 }
@@ -29,9 +29,11 @@ public:
   struct symbol_t {
     symbol_t(const uint32_t addr_, const std::string& name_) : name(name_), addr(addr_) {
     }
-    uint64_t cycles = 0;  ///< Number of cycles spent in this function.
-    std::string name;     ///< Name of the function.
-    uint32_t addr;        ///< Starting (call) address of the function.
+    uint64_t cycles = 0;         ///< Number of cycles spent in this function.
+    uint64_t icache_misses = 0;  ///< Number of instruction cache misses in this function.
+    uint64_t dcache_misses = 0;  ///< Number of data cache misses in this function.
+    std::string name;            ///< Name of the function.
+    uint32_t addr;               ///< Starting (call) address of the function.
   };
 
   perf_symbols_t() {
@@ -45,18 +47,51 @@ public:
 
   void print() const;
 
-  void add_ref(const uint32_t addr) {
+  /// @brief Add the statistics from another instance (with the same symbols).
+  void merge(const perf_symbols_t& other);
+
+  void add_ref(const uint32_t addr, const uint32_t cycles = 1u) {
+    if (m_has_symbols) {
+      add_ref_impl(addr, cycles);
+    }
+  }
+
+  /// @brief Get the name of the function that contains the given address.
+  /// @returns the function name, or an empty string if no symbols are loaded.
+  std::string symbol_name(const uint32_t addr);
+
+  /// @brief Get the address of a named function.
+  /// @returns true if the function was found.
+  bool symbol_address(const std::string& name, uint32_t& addr) const;
+
+  void add_icache_miss(const uint32_t addr) {
+    if (m_has_symbols) {
+      const auto idx = find_symbol(addr);
+      if (idx >= 0) {
+        ++m_symbols[idx].icache_misses;
+        m_has_cache_stats = true;
+      }
+    }
+  }
+
+  void add_dcache_miss(const uint32_t addr) {
     if (m_has_symbols) {
-      add_ref_impl(addr);
+      const auto idx = find_symbol(addr);
+      if (idx >= 0) {
+        ++m_symbols[idx].dcache_misses;
+        m_has_cache_stats = true;
+      }
     }
   }
 
 private:
-  void add_ref_impl(const uint32_t addr);
+  void add_ref_impl(const uint32_t addr, const uint32_t cycles);
+  int find_symbol(const uint32_t addr);
 
   // List of symbols, sorted by address.
   std::vector<symbol_t> m_symbols;
   bool m_has_symbols = false;
+  bool m_has_cache_stats = false;
 
   // Simple temporal acceleration (assumes single threaded calls to add_ref).
   int m_last_sym_idx = 0;
@@ -0,0 +1,135 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "pipeline.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+pipeline_t::pipeline_t(const uint32_t num_slots) : m_ready_cycle(num_slots), m_producer(num_slots) {
+  reset();
+}
+
+void pipeline_t::reset() {
+  std::fill(m_ready_cycle.begin(), m_ready_cycle.end(), 0u);
+  std::fill(m_producer.begin(), m_producer.end(), producer_t::NONE);
+  m_last_issue_cycle = 0u;
+  m_unit_free_cycle = 0u;
+  m_fetch_ready_cycle = 0u;
+
+  m_num_ops = 0u;
+  m_num_branches = 0u;
+  m_num_mispredicts = 0u;
+  m_load_use_stalls = 0u;
+  m_multi_cycle_stalls = 0u;
+  m_structural_stalls = 0u;
+  m_branch_stalls = 0u;
+  m_memory_stalls = 0u;
+}
+
+bool pipeline_t::predict_branch(const uint32_t pc,
+                                const uint32_t target,
+                                const bool taken,
+                                const bool is_conditional,
+                                const bool is_indirect) {
+  bool mispredicted;
+  if (is_conditional) {
+    // Backward taken, forward not taken.
+    const bool predict_taken = (target <= pc);
+    mispredicted = (taken != predict_taken);
+  } else {
+    mispredicted = is_indirect;
+  }
+
+  ++m_num_branches;
+  if (mispredicted) {
+    ++m_num_mispredicts;
+  }
+  return mispredicted;
+}
+
+uint32_t pipeline_t::issue(const op_t& op) {
+  // Without any hazards the operation is issued in the cycle after the previous operation.
+  auto cycle = m_last_issue_cycle + 1u;
+
+  // Wait for the instruction to be fetched (after a branch misprediction).
+  if (m_fetch_ready_cycle > cycle) {
+    m_branch_stalls += m_fetch_ready_cycle - cycle;
+    cycle = m_fetch_ready_cycle;
+  }
+
+  // Wait for non-pipelined units.
+  if (m_unit_free_cycle > cycle) {
+    m_structural_stalls += m_unit_free_cycle - cycle;
+    cycle = m_unit_free_cycle;
+  }
+
+  // Wait for the source operands (the last one to be ready decides the type of stall).
+  auto operands_ready_cycle = cycle;
+  auto producer = producer_t::NONE;
+  for (const auto slot : op.src) {
+    if (slot != NO_SLOT && m_ready_cycle[slot] > operands_ready_cycle) {
+      operands_ready_cycle = m_ready_cycle[slot];
+      producer = m_producer[slot];
+    }
+  }
+  if (producer == producer_t::LOAD) {
+    m_load_use_stalls += operands_ready_cycle - cycle;
+  } else if (producer == producer_t::MULTI_CYCLE) {
+    m_multi_cycle_stalls += operands_ready_cycle - cycle;
+  }
+  cycle = operands_ready_cycle;
+
+  // Issue the operation.
+  if (op.dst != NO_SLOT) {
+    m_ready_cycle[op.dst] = cycle + op.latency;
+    m_producer[op.dst] = op.is_load ? producer_t::LOAD : producer_t::MULTI_CYCLE;
+  }
+  m_unit_free_cycle = cycle + op.interval;
+  if (op.is_mispredicted) {
+    m_fetch_ready_cycle = cycle + 1u + BRANCH_MISPREDICT_PENALTY;
+  }
+  ++m_num_ops;
+
+  const auto cycles = static_cast<uint32_t>(cycle - m_last_issue_cycle);
+  m_last_issue_cycle = cycle;
+  return cycles;
+}
+
+void pipeline_t::print_stats(const uint64_t num_instructions) const {
+  const auto total_stalls = m_load_use_stalls + m_multi_cycle_stalls + m_structural_stalls +
+                            m_branch_stalls + m_memory_stalls;
+  const auto ipc = (m_last_issue_cycle > 0u) ? static_cast<double>(num_instructions) /
+                                                   static_cast<double>(m_last_issue_cycle)
+                                             : 0.0;
+  std::cout << "Pipeline:\n";
+  std::cout << " Issued operations:    " << m_num_ops << "\n";
+  std::cout << " IPC:                  " << ipc << "\n";
+  if (m_num_branches > 0u) {
+    // Only with static prediction (the branch predictor model prints its own statistics).
+    std::cout << " Branches:             " << m_num_branches << "\n";
+    std::cout << " Mispredictions:       " << m_num_mispredicts << "\n";
+  }
+  std::cout << " Stall cycles:         " << total_stalls << "\n";
+  std::cout << "  Load-use:            " << m_load_use_stalls << "\n";
+  std::cout << "  Multi-cycle results: " << m_multi_cycle_stalls << "\n";
+  std::cout << "  Non-pipelined units: " << m_structural_stalls << "\n";
+  std::cout << "  Branch mispredicts:  " << m_branch_stalls << "\n";
+  std::cout << "  Memory:              " << m_memory_stalls << "\n";
+}
@@ -0,0 +1,125 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_PIPELINE_HPP_
+#define SIM_PIPELINE_HPP_
+
+#include <cstdint>
+#include <vector>
+
+/// @brief Timing model of an in-order pipeline (approximating MRISC32-A1).
+///
+/// The model does not execute anything. It is fed with the register dependencies and costs of each
+/// executed operation (one per vector element), and keeps track of when each operation can be
+/// issued to the first EX stage. The following pipeline effects are modeled:
+///
+///  - Operand forwarding: A result can be used by the next operation as soon as its latency has
+///    passed (e.g. single cycle ALU results can be used back-to-back without stalling).
+///  - Load-use and multi-cycle stalls: An operation that depends on a result that is not yet
+///    available (e.g. from a load, multiplication or FPU operation) is stalled.
+///  - Structural stalls: Non-pipelined units (e.g. the dividers) block the pipeline until they are
+///    done, as given by the issue interval of the operation.
+///  - Memory stalls: Cache misses stall the entire pipeline.
+///  - Branch mispredictions: Branches are resolved in the first EX stage, so a misprediction
+///    flushes the instructions in the fetch, decode and register fetch stages. The predictions are
+///    made with static prediction (see predict_branch()), unless a separate branch predictor model
+///    is configured (see branch_predictor_t).
+class pipeline_t {
+public:
+  /// @brief Register slot identifier for unused operands.
+  static const uint32_t NO_SLOT = ~0u;
+
+  /// @brief Number of cycles lost for each mispredicted branch.
+  static const uint32_t BRANCH_MISPREDICT_PENALTY = 3u;
+
+  /// @brief One operation (an instruction or a single vector element of an instruction).
+  struct op_t {
+    uint32_t src[3];       ///< Source register slots (NO_SLOT if unused).
+    uint32_t dst;          ///< Destination register slot (NO_SLOT if unused).
+    uint32_t latency;      ///< Number of cycles until the result can be used.
+    uint32_t interval;     ///< Number of cycles until the next operation can be issued.
+    bool is_load;          ///< True if this is a memory load operation.
+    bool is_mispredicted;  ///< True if this is a mispredicted branch.
+  };
+
+  /// @brief Constructor.
+  /// @param num_slots The number of register slots (scalar registers and vector elements).
+  explicit pipeline_t(const uint32_t num_slots);
+
+  /// @brief Clear the pipeline state and the statistics.
+  void reset();
+
+  /// @brief Predict a branch (using static prediction).
+  ///
+  /// Conditional branches are predicted taken if they branch backwards, and not taken otherwise.
+  /// PC-relative jumps are always predicted correctly, while register based jumps (e.g. returns)
+  /// are always mispredicted since their target is not known until the register has been read.
+  /// @param pc The branch instruction address.
+  /// @param target The branch target address.
+  /// @param taken True if the branch was taken.
+  /// @param is_conditional True for conditional branches.
+  /// @param is_indirect True for register based jumps.
+  /// @returns true if the branch was mispredicted.
+  bool predict_branch(const uint32_t pc,
+                      const uint32_t target,
+                      const bool taken,
+                      const bool is_conditional,
+                      const bool is_indirect);
+
+  /// @brief Issue an operation.
+  /// @param op The operation.
+  /// @returns the number of cycles since the previous operation was issued (one plus the number of
+  /// stall cycles).
+  uint32_t issue(const op_t& op);
+
+  /// @brief Stall the pipeline due to memory access latency (e.g. a cache miss).
+  /// @param cycles The number of stall cycles.
+  void add_memory_stall(const uint32_t cycles) {
+    m_last_issue_cycle += cycles;
+    m_memory_stalls += cycles;
+  }
+
+  /// @brief Print the pipeline statistics.
+  /// @param num_instructions The number of executed instructions (for IPC calculation).
+  void print_stats(const uint64_t num_instructions) const;
+
+private:
+  enum class producer_t : uint8_t { NONE, LOAD, MULTI_CYCLE };
+
+  // Per register slot state.
+  std::vector<uint64_t> m_ready_cycle;
+  std::vector<producer_t> m_producer;
+
+  // Pipeline state.
+  uint64_t m_last_issue_cycle = 0u;
+  uint64_t m_unit_free_cycle = 0u;
+  uint64_t m_fetch_ready_cycle = 0u;
+
+  // Statistics.
+  uint64_t m_num_ops = 0u;
+  uint64_t m_num_branches = 0u;
+  uint64_t m_num_mispredicts = 0u;
+  uint64_t m_load_use_stalls = 0u;
+  uint64_t m_multi_cycle_stalls = 0u;
+  uint64_t m_structural_stalls = 0u;
+  uint64_t m_branch_stalls = 0u;
+  uint64_t m_memory_stalls = 0u;
+};
+
+#endif  // SIM_PIPELINE_HPP_
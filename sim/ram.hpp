@@ -66,6 +66,18 @@ static inline uint16_t convert_endianity(const uint16_t x) {
 #define RAM_UNLIKELY(expr) (expr)
 #endif
 
+// The RAM is shared by the CPU cores, which run in separate host threads. All guest memory accesses
+// are done as relaxed atomic accesses, so that concurrent accesses to the same address are well
+// defined. Ordering between the cores is given by the SYNC instruction (a host memory fence). On
+// common hosts (e.g. x86 and ARM) relaxed atomic accesses compile to plain loads and stores.
+#if defined(__GNUC__) || defined(__llvm__)
+#define RAM_LOAD(ref) __atomic_load_n(&(ref), __ATOMIC_RELAXED)
+#define RAM_STORE(ref, value) __atomic_store_n(&(ref), (value), __ATOMIC_RELAXED)
+#else
+#define RAM_LOAD(ref) (ref)
+#define RAM_STORE(ref, value) ((ref) = (value))
+#endif
+
 /// @brief Simulated RAM.
 ///
 /// The memory is 32-bit addressable. All memory is allocated up front from the host machine.
@@ -81,7 +93,7 @@ public:
 
   uint32_t load8(const uint32_t addr) {
     check_addr(addr, sizeof(uint8_t));
-    return m_memory[addr];
+    return RAM_LOAD(m_memory[addr]);
   }
 
   uint32_t load8signed(const uint32_t addr) {
@@ -91,13 +103,13 @@ public:
   void store8(const uint32_t addr, const uint32_t value) {
     check_addr(addr, sizeof(uint8_t));
     check_align(addr, sizeof(uint8_t));
-    m_memory[addr] = static_cast<uint8_t>(value);
+    RAM_STORE(m_memory[addr], static_cast<uint8_t>(value));
   }
 
   uint32_t load16(const uint32_t addr) const {
     check_addr(addr, sizeof(uint16_t));
     check_align(addr, sizeof(uint16_t));
-    return convert_endianity(reinterpret_cast<const uint16_t&>(m_memory[addr]));
+    return convert_endianity(RAM_LOAD(reinterpret_cast<const uint16_t&>(m_memory[addr])));
   }
 
   uint32_t load16signed(const uint32_t addr) const {
@@ -107,19 +119,24 @@ public:
   void store16(const uint32_t addr, const uint32_t value) {
     check_addr(addr, sizeof(uint16_t));
     check_align(addr, sizeof(uint16_t));
-    reinterpret_cast<uint16_t&>(m_memory[addr]) = convert_endianity(static_cast<uint16_t>(value));
+    RAM_STORE(reinterpret_cast<uint16_t&>(m_memory[addr]),
+              convert_endianity(static_cast<uint16_t>(value)));
   }
 
   uint32_t load32(const uint32_t addr) {
     check_addr(addr, sizeof(uint32_t));
     check_align(addr, sizeof(uint32_t));
-    return convert_endianity(reinterpret_cast<const uint32_t&>(m_memory[addr]));
+    return convert_endianity(RAM_LOAD(reinterpret_cast<const uint32_t&>(m_memory[addr])));
   }
 
   void store32(const uint32_t addr, const uint32_t value) {
     check_addr(addr, sizeof(uint32_t));
     check_align(addr, sizeof(uint32_t));
-    reinterpret_cast<uint32_t&>(m_memory[addr]) = convert_endianity(value);
+    RAM_STORE(reinterpret_cast<uint32_t&>(m_memory[addr]), convert_endianity(value));
+  }
+
+  uint64_t size() const {
+    return m_size;
   }
 
   bool valid_range(const uint32_t addr, const uint32_t size) const {
@@ -164,5 +181,7 @@ private:
 #undef RAM_BIG_ENDIAN
 #undef RAM_LITTLE_ENDIAN
 #undef RAM_UNLIKELY
+#undef RAM_LOAD
+#undef RAM_STORE
 
 #endif  // SIM_RAM_HPP_
@@ -0,0 +1,415 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "soft_float.hpp"
+
+#include "packed_float.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+int msb_pos(uint64_t x) {
+  int pos = -1;
+  while (x != 0u) {
+    x >>= 1;
+    ++pos;
+  }
+  return pos;
+}
+
+uint64_t isqrt(const uint64_t x) {
+  uint64_t result = 0u;
+  uint64_t rem = x;
+  uint64_t bit = UINT64_C(1) << 62;
+  while (bit > x) {
+    bit >>= 2;
+  }
+  while (bit != 0u) {
+    if (rem >= result + bit) {
+      rem -= result + bit;
+      result = (result >> 1) + bit;
+    } else {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return result;
+}
+
+uint32_t f32_bits(const float x) {
+  uint32_t bits;
+  std::memcpy(&bits, &x, sizeof(bits));
+  return bits;
+}
+
+float bits_f32(const uint32_t x) {
+  float f;
+  std::memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+// Apply a per-element reference function to all the elements of a packed word.
+template <typename SF, typename OP>
+uint32_t ref_packed(const uint32_t a, const uint32_t b, OP op) {
+  const uint32_t mask = (1u << SF::BITS) - 1u;
+  uint32_t result = 0u;
+  for (int shift = 0; shift < 32; shift += SF::BITS) {
+    result |= op((a >> shift) & mask, (b >> shift) & mask) << shift;
+  }
+  return result;
+}
+
+class verifier_t {
+public:
+  verifier_t(const std::string& name) : m_name(name) {
+  }
+
+  void check(const uint32_t a, const uint32_t b, const uint32_t fast, const uint32_t ref) {
+    ++m_checks;
+    if (fast != ref) {
+      if (m_mismatches < MAX_REPORTED) {
+        std::cout << "  " << m_name << std::hex << std::setfill('0') << " a=0x" << std::setw(8) << a
+                  << " b=0x" << std::setw(8) << b << ": 0x" << std::setw(8) << fast
+                  << " (expected 0x" << std::setw(8) << ref << ")\n"
+                  << std::dec << std::setfill(' ');
+      }
+      ++m_mismatches;
+    }
+  }
+
+  // Print a summary line, and return the number of mismatches.
+  uint64_t report() const {
+    std::cout << "  " << std::left << std::setw(12) << m_name << std::right << std::setw(12)
+              << m_checks << " checks, " << m_mismatches << " mismatches\n";
+    return m_mismatches;
+  }
+
+private:
+  static const uint64_t MAX_REPORTED = 5u;
+
+  const std::string m_name;
+  uint64_t m_checks = 0u;
+  uint64_t m_mismatches = 0u;
+};
+
+// Verify the binary operations and the square root for a list of packed operand pairs.
+template <typename SF, typename PF>
+uint64_t verify_ops(const char* type,
+                    const std::vector<uint32_t>& a_ops,
+                    const std::vector<uint32_t>& b_ops) {
+  const std::string prefix(type);
+  verifier_t add(prefix + " add");
+  verifier_t sub(prefix + " sub");
+  verifier_t mul(prefix + " mul");
+  verifier_t div(prefix + " div");
+  verifier_t sqrt(prefix + " sqrt");
+  for (size_t i = 0u; i < a_ops.size(); ++i) {
+    const auto a = a_ops[i];
+    const auto b = b_ops[i];
+    add.check(a, b, (PF(a) + PF(b)).packf(), ref_packed<SF>(a, b, SF::add));
+    sub.check(a, b, (PF(a) - PF(b)).packf(), ref_packed<SF>(a, b, SF::sub));
+    mul.check(a, b, (PF(a) * PF(b)).packf(), ref_packed<SF>(a, b, SF::mul));
+    div.check(a, b, (PF(a) / PF(b)).packf(), ref_packed<SF>(a, b, SF::div));
+    sqrt.check(a, 0u, PF(a).sqrt().packf(), ref_packed<SF>(a, 0u, [](uint32_t x, uint32_t) {
+      return SF::sqrt(x);
+    }));
+  }
+  uint64_t mismatches = 0u;
+  for (const auto* verifier : {&add, &sub, &mul, &div, &sqrt}) {
+    mismatches += verifier->report();
+  }
+  return mismatches;
+}
+
+}  // namespace
+
+template <int EXP_BITS, int FRAC_BITS>
+typename soft_float_t<EXP_BITS, FRAC_BITS>::unpacked_t soft_float_t<EXP_BITS, FRAC_BITS>::unpack(
+    const uint32_t x) {
+  unpacked_t result;
+  result.negative = ((x & SIGN_BIT) != 0u);
+  const auto biased_exp = (x >> FRAC_BITS) & EXP_MAX;
+  const auto frac = x & FRAC_MASK;
+  result.exp = static_cast<int32_t>(biased_exp) - BIAS;
+  result.sig = static_cast<uint64_t>((1u << FRAC_BITS) | frac);
+  if (biased_exp == 0u) {
+    result.kind = kind_t::ZERO;
+  } else if (biased_exp == EXP_MAX) {
+    result.kind = (frac == 0u) ? kind_t::NOT_A_NUMBER : kind_t::INFINITE;
+  } else {
+    result.kind = kind_t::FINITE;
+  }
+  return result;
+}
+
+template <int EXP_BITS, int FRAC_BITS>
+uint32_t soft_float_t<EXP_BITS, FRAC_BITS>::round_and_pack(const bool negative,
+                                                           const uint64_t sig,
+                                                           const int32_t lsb_exp) {
+  // The exact value is sig * 2^lsb_exp. Since we round half away from zero, the bits below the
+  // ones that are kept only matter if they are >= one half, so no sticky bit is needed as long as
+  // sig has at least one bit more than the result precision.
+  const auto msb = msb_pos(sig);
+  auto exp = static_cast<int32_t>(msb) + lsb_exp;
+  const auto shift = msb - FRAC_BITS;
+  uint64_t m;
+  if (shift > 0) {
+    const auto half = UINT64_C(1) << (shift - 1);
+    const auto rem = sig & ((UINT64_C(1) << shift) - 1u);
+    m = (sig >> shift) + ((rem >= half) ? 1u : 0u);
+    if (m == (UINT64_C(2) << FRAC_BITS)) {
+      m >>= 1;
+      ++exp;
+    }
+  } else {
+    m = sig << (-shift);
+  }
+
+  const auto biased_exp = exp + BIAS;
+  if (biased_exp <= 0) {
+    return zero(negative);
+  } else if (biased_exp >= static_cast<int32_t>(EXP_MAX)) {
+    return inf(negative);
+  }
+  return (negative ? SIGN_BIT : 0u) | (static_cast<uint32_t>(biased_exp) << FRAC_BITS) |
+         (static_cast<uint32_t>(m) & FRAC_MASK);
+}
+
+template <int EXP_BITS, int FRAC_BITS>
+uint32_t soft_float_t<EXP_BITS, FRAC_BITS>::add(const uint32_t a, const uint32_t b) {
+  const auto ua = unpack(a);
+  const auto ub = unpack(b);
+  if (ua.kind == kind_t::NOT_A_NUMBER || ub.kind == kind_t::NOT_A_NUMBER) {
+    return NAN_BITS;
+  }
+  if (ua.kind == kind_t::INFINITE && ub.kind == kind_t::INFINITE) {
+    return (ua.negative == ub.negative) ? inf(ua.negative) : NAN_BITS;
+  }
+  if (ua.kind == kind_t::INFINITE || ub.kind == kind_t::INFINITE) {
+    return inf(ua.kind == kind_t::INFINITE ? ua.negative : ub.negative);
+  }
+  if (ua.kind == kind_t::ZERO && ub.kind == kind_t::ZERO) {
+    return zero(ua.negative && ub.negative);
+  }
+  if (ua.kind == kind_t::ZERO) {
+    return b;
+  }
+  if (ub.kind == kind_t::ZERO) {
+    return a;
+  }
+
+  // Align the significands to the smallest exponent (the result is exact).
+  const auto lsb_exp = std::min(ua.exp, ub.exp) - FRAC_BITS;
+  const auto sa = static_cast<int64_t>(ua.sig << (ua.exp - FRAC_BITS - lsb_exp));
+  const auto sb = static_cast<int64_t>(ub.sig << (ub.exp - FRAC_BITS - lsb_exp));
+  const auto sum = (ua.negative ? -sa : sa) + (ub.negative ? -sb : sb);
+  if (sum == 0) {
+    return zero(false);
+  }
+  return round_and_pack(sum < 0, static_cast<uint64_t>(sum < 0 ? -sum : sum), lsb_exp);
+}
+
+template <int EXP_BITS, int FRAC_BITS>
+uint32_t soft_float_t<EXP_BITS, FRAC_BITS>::sub(const uint32_t a, const uint32_t b) {
+  return add(a, b ^ SIGN_BIT);
+}
+
+template <int EXP_BITS, int FRAC_BITS>
+uint32_t soft_float_t<EXP_BITS, FRAC_BITS>::mul(const uint32_t a, const uint32_t b) {
+  const auto ua = unpack(a);
+  const auto ub = unpack(b);
+  const bool negative = (ua.negative != ub.negative);
+  if (ua.kind == kind_t::NOT_A_NUMBER || ub.kind == kind_t::NOT_A_NUMBER) {
+    return NAN_BITS;
+  }
+  if (ua.kind == kind_t::INFINITE || ub.kind == kind_t::INFINITE) {
+    return (ua.kind == kind_t::ZERO || ub.kind == kind_t::ZERO) ? NAN_BITS : inf(negative);
+  }
+  if (ua.kind == kind_t::ZERO || ub.kind == kind_t::ZERO) {
+    return zero(negative);
+  }
+  return round_and_pack(negative, ua.sig * ub.sig, ua.exp + ub.exp - 2 * FRAC_BITS);
+}
+
+template <int EXP_BITS, int FRAC_BITS>
+uint32_t soft_float_t<EXP_BITS, FRAC_BITS>::div(const uint32_t a, const uint32_t b) {
+  const auto ua = unpack(a);
+  const auto ub = unpack(b);
+  const bool negative = (ua.negative != ub.negative);
+  if (ua.kind == kind_t::NOT_A_NUMBER || ub.kind == kind_t::NOT_A_NUMBER) {
+    return NAN_BITS;
+  }
+  if (ua.kind == kind_t::INFINITE) {
+    return (ub.kind == kind_t::INFINITE) ? NAN_BITS : inf(negative);
+  }
+  if (ub.kind == kind_t::INFINITE) {
+    return zero(negative);
+  }
+  if (ub.kind == kind_t::ZERO) {
+    return (ua.kind == kind_t::ZERO) ? NAN_BITS : inf(negative);
+  }
+  if (ua.kind == kind_t::ZERO) {
+    return zero(negative);
+  }
+
+  // The truncated quotient has at least FRAC_BITS + 3 bits, which is enough for correct rounding.
+  const int K = FRAC_BITS + 3;
+  const auto q = (ua.sig << K) / ub.sig;
+  return round_and_pack(negative, q, ua.exp - ub.exp - K);
+}
+
+template <int EXP_BITS, int FRAC_BITS>
+uint32_t soft_float_t<EXP_BITS, FRAC_BITS>::sqrt(const uint32_t a) {
+  const auto ua = unpack(a);
+  if (ua.kind == kind_t::NOT_A_NUMBER) {
+    return NAN_BITS;
+  }
+  if (ua.kind == kind_t::ZERO) {
+    return zero(ua.negative);
+  }
+  if (ua.negative) {
+    return NAN_BITS;
+  }
+  if (ua.kind == kind_t::INFINITE) {
+    return inf(false);
+  }
+
+  // Make the exponent even, and scale the significand so that the truncated root has enough bits.
+  auto sig = ua.sig;
+  auto lsb_exp = ua.exp - FRAC_BITS;
+  if ((lsb_exp & 1) != 0) {
+    sig <<= 1;
+    --lsb_exp;
+  }
+  const int K = FRAC_BITS + 2;
+  return round_and_pack(false, isqrt(sig << (2 * K)), lsb_exp / 2 - K);
+}
+
+template <int EXP_BITS, int FRAC_BITS>
+uint32_t soft_float_t<EXP_BITS, FRAC_BITS>::from_f32(const uint32_t x) {
+  const bool negative = ((x & 0x80000000u) != 0u);
+  const auto biased_exp = static_cast<int32_t>((x >> 23) & 0xffu);
+  const auto frac = x & 0x007fffffu;
+  if (biased_exp == 255) {
+    return (frac != 0u) ? NAN_BITS : inf(negative);
+  }
+  if (biased_exp == 0) {
+    return zero(negative);
+  }
+  return round_and_pack(negative, static_cast<uint64_t>(frac | 0x00800000u), biased_exp - 127 - 23);
+}
+
+template class soft_float_t<5, 10>;
+template class soft_float_t<4, 3>;
+
+bool verify_packed_float(const uint64_t f16_samples) {
+  std::cout << "Verifying packed floating-point operations against the soft-float reference:\n";
+  uint64_t mismatches = 0u;
+
+  // All f8 operand pairs (in all lanes).
+  {
+    std::vector<uint32_t> a_ops;
+    std::vector<uint32_t> b_ops;
+    for (uint32_t a = 0u; a < 256u; ++a) {
+      for (uint32_t b = 0u; b < 256u; ++b) {
+        a_ops.push_back(a | (b << 8) | (a << 16) | (b << 24));
+        b_ops.push_back(b | (a << 8) | (b << 16) | (a << 24));
+      }
+    }
+    mismatches += verify_ops<soft_f8_t, f8x4_t>("f8", a_ops, b_ops);
+  }
+
+  // f16 operand pairs: all combinations of special and boundary values, plus random values.
+  {
+    std::vector<uint32_t> values;
+    for (uint32_t sign = 0u; sign < 2u; ++sign) {
+      for (uint32_t exp = 0u; exp < 32u; ++exp) {
+        for (const uint32_t frac : {0x000u, 0x001u, 0x200u, 0x3feu, 0x3ffu}) {
+          values.push_back((sign << 15) | (exp << 10) | frac);
+        }
+      }
+    }
+    std::vector<uint32_t> a_ops;
+    std::vector<uint32_t> b_ops;
+    for (const auto a : values) {
+      for (const auto b : values) {
+        a_ops.push_back(a | (b << 16));
+        b_ops.push_back(b | (a << 16));
+      }
+    }
+    std::mt19937 rnd(12345u);
+    for (uint64_t i = 0u; i < f16_samples; ++i) {
+      a_ops.push_back(static_cast<uint32_t>(rnd()));
+      b_ops.push_back(static_cast<uint32_t>(rnd()));
+    }
+    mismatches += verify_ops<soft_f16_t, f16x2_t>("f16", a_ops, b_ops);
+  }
+
+  // Conversions: f16 -> f8 (all values), and f32 -> f16 and f32 -> f8 (random values).
+  {
+    verifier_t f16_to_f8("f16 -> f8");
+    for (uint32_t a = 0u; a < 65536u; ++a) {
+      const auto x = a | (a << 16);
+      const auto fast = f8x4_t::from_f16x4(f16x2_t(x), f16x2_t(x)).packf();
+      const auto ref = soft_f8_t::from_f32(f32_bits(f16x2_t(x)[0]));
+      f16_to_f8.check(x, 0u, fast, ref | (ref << 8) | (ref << 16) | (ref << 24));
+    }
+    mismatches += f16_to_f8.report();
+
+    verifier_t f32_to_f16("f32 -> f16");
+    std::mt19937 rnd(54321u);
+    for (uint64_t i = 0u; i < f16_samples; ++i) {
+      const auto a = static_cast<uint32_t>(rnd());
+      const auto b = static_cast<uint32_t>(rnd());
+      const auto fast = f16x2_t::from_f32x2(bits_f32(a), bits_f32(b)).packf();
+      const auto ref = soft_f16_t::from_f32(a) | (soft_f16_t::from_f32(b) << 16);
+      f32_to_f16.check(a, b, fast, ref);
+    }
+    mismatches += f32_to_f16.report();
+
+    // Half of the f32 -> f8 samples have exponents in (and around) the f8 range.
+    verifier_t f32_to_f8("f32 -> f8");
+    for (uint64_t i = 0u; i < f16_samples; ++i) {
+      uint32_t x[4];
+      for (auto& e : x) {
+        e = static_cast<uint32_t>(rnd());
+        if ((i & 1u) != 0u) {
+          e = (e & 0x807fffffu) | ((112u + (e >> 23) % 32u) << 23);
+        }
+      }
+      const auto fast =
+          f8x4_t::from_f32x4(bits_f32(x[0]), bits_f32(x[1]), bits_f32(x[2]), bits_f32(x[3]))
+              .packf();
+      const auto ref = soft_f8_t::from_f32(x[0]) | (soft_f8_t::from_f32(x[1]) << 8) |
+                       (soft_f8_t::from_f32(x[2]) << 16) | (soft_f8_t::from_f32(x[3]) << 24);
+      f32_to_f8.check(x[0], x[1], fast, ref);
+    }
+    mismatches += f32_to_f8.report();
+  }
+
+  std::cout << (mismatches == 0u ? "All results are identical.\n" : "Found mismatches!\n");
+  return mismatches == 0u;
+}
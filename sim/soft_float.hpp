@@ -0,0 +1,98 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_SOFT_FLOAT_HPP_
+#define SIM_SOFT_FLOAT_HPP_
+
+#include <cstdint>
+
+//--------------------------------------------------------------------------------------------------
+// Bit-exact software implementation of the packed floating-point formats.
+//
+// This is the reference definition of the packed floating-point semantics of the simulator. It uses
+// integer arithmetic only, so the results do not depend on the host FPU. The formats have an IEEE
+// 754 style layout (sign, biased exponent, fraction), with the following differences:
+//
+//  - Denormals are not supported. Inputs with a zero exponent are treated as zero, and results
+//    whose magnitude is smaller than the smallest normal number are flushed to zero.
+//  - The exponent-all-ones encodings are swapped compared to IEEE 754: a zero fraction is NaN, and
+//    a non-zero fraction is Inf. Inf results are encoded with an all-ones fraction.
+//  - Results are rounded once (from the exact result) to nearest, with ties away from zero.
+//  - NaN results are always the canonical (positive) NaN.
+//
+// The host float implementation in packed_float.hpp is used by the simulator. verify_packed_float()
+// checks that it gives identical results.
+//--------------------------------------------------------------------------------------------------
+
+template <int EXP_BITS, int FRAC_BITS>
+class soft_float_t {
+public:
+  static uint32_t add(const uint32_t a, const uint32_t b);
+  static uint32_t sub(const uint32_t a, const uint32_t b);
+  static uint32_t mul(const uint32_t a, const uint32_t b);
+  static uint32_t div(const uint32_t a, const uint32_t b);
+  static uint32_t sqrt(const uint32_t a);
+
+  /// @brief Convert a 32-bit IEEE 754 floating-point value (given as bits) to this format.
+  static uint32_t from_f32(const uint32_t x);
+
+  static const int BITS = 1 + EXP_BITS + FRAC_BITS;
+  static const int BIAS = (1 << (EXP_BITS - 1)) - 1;
+  static const uint32_t EXP_MAX = (1u << EXP_BITS) - 1u;
+  static const uint32_t SIGN_BIT = 1u << (EXP_BITS + FRAC_BITS);
+  static const uint32_t FRAC_MASK = (1u << FRAC_BITS) - 1u;
+  static const uint32_t NAN_BITS = EXP_MAX << FRAC_BITS;
+  static const uint32_t INF_BITS = NAN_BITS | FRAC_MASK;
+
+private:
+  enum class kind_t { ZERO, FINITE, INFINITE, NOT_A_NUMBER };
+
+  struct unpacked_t {
+    kind_t kind;
+    bool negative;
+    int32_t exp;   // Unbiased exponent.
+    uint64_t sig;  // Significand, including the implicit one (FRAC_BITS + 1 bits).
+  };
+
+  static unpacked_t unpack(const uint32_t x);
+  static uint32_t round_and_pack(const bool negative, const uint64_t sig, const int32_t lsb_exp);
+
+  static uint32_t zero(const bool negative) {
+    return negative ? SIGN_BIT : 0u;
+  }
+
+  static uint32_t inf(const bool negative) {
+    return (negative ? SIGN_BIT : 0u) | INF_BITS;
+  }
+};
+
+using soft_f16_t = soft_float_t<5, 10>;
+using soft_f8_t = soft_float_t<4, 3>;
+
+/// @brief Verify the host float implementation of the packed floating-point operations.
+///
+/// The results of f16x2_t and f8x4_t are compared to soft_f16_t and soft_f8_t. All 8-bit operand
+/// pairs are checked exhaustively. The 16-bit operations are checked for all special and boundary
+/// values, plus a number of random operand pairs. The conversions to f8 and f16 are also checked.
+/// The results are reported per operation, in a fixed order.
+/// @param f16_samples The number of random 16-bit operand pairs to check per operation.
+/// @returns true if no mismatches were found.
+bool verify_packed_float(const uint64_t f16_samples);
+
+#endif  // SIM_SOFT_FLOAT_HPP_
@@ -0,0 +1,111 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "stack_profiler.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+
+namespace {
+// Number of functions to report.
+const std::size_t MAX_FUNCTIONS = 10u;
+}  // namespace
+
+stack_profiler_t::stack_profiler_t() {
+  reset();
+}
+
+void stack_profiler_t::reset() {
+  m_top_level = frame_t{0u, 0u, ~0u};
+  m_calls.clear();
+  m_func_stats.clear();
+  m_has_stack_top = false;
+  m_stack_top = 0u;
+  m_min_sp = 0u;
+  m_max_call_depth = 0u;
+}
+
+void stack_profiler_t::ret() {
+  record_frame(m_calls.back().data);
+  m_calls.pop();
+}
+
+void stack_profiler_t::record_frame(const frame_t& frame) {
+  auto it = m_func_stats.find(frame.func);
+  if (it == m_func_stats.end()) {
+    it = m_func_stats.emplace(frame.func, func_stats_t{0u, 0u, ~0u}).first;
+  }
+  auto& stats = it->second;
+  ++stats.calls;
+  if (frame.min_sp <= frame.entry_sp) {
+    stats.max_frame_size = std::max(stats.max_frame_size, frame.entry_sp - frame.min_sp);
+  }
+  stats.min_sp = std::min(stats.min_sp, frame.min_sp);
+}
+
+void stack_profiler_t::print_stats(perf_symbols_t& perf_symbols) const {
+  // Include the functions that are still active (e.g. main, if exit() was called).
+  stack_profiler_t profiler(*this);
+  while (!profiler.m_calls.empty()) {
+    profiler.ret();
+  }
+  profiler.record_frame(profiler.m_top_level);
+
+  printf("Stack usage:\n");
+  if (!m_has_stack_top) {
+    printf(" The stack pointer was never set\n");
+    return;
+  }
+  printf(" Stack top:            0x%08x\n", m_stack_top);
+  printf(" Lowest SP:            0x%08x\n", m_min_sp);
+  printf(" Max stack depth:      %u bytes\n", m_stack_top - m_min_sp);
+  printf(" Max call depth:       %u\n", m_max_call_depth);
+
+  // List the functions with the largest stack frames.
+  using func_t = std::pair<uint32_t, func_stats_t>;
+  std::vector<func_t> funcs(profiler.m_func_stats.begin(), profiler.m_func_stats.end());
+  std::sort(funcs.begin(), funcs.end(), [](const func_t& a, const func_t& b) {
+    return (a.second.max_frame_size != b.second.max_frame_size)
+               ? (a.second.max_frame_size > b.second.max_frame_size)
+               : (a.first < b.first);
+  });
+  funcs.resize(std::min(funcs.size(), MAX_FUNCTIONS));
+  printf(" Frame size   Depth        Calls        Function\n");
+  for (const auto& func : funcs) {
+    std::string name;
+    if (func.first == 0u) {
+      name = "<top level>";
+    } else {
+      name = perf_symbols.symbol_name(func.first);
+      if (name.empty()) {
+        char addr[16];
+        snprintf(addr, sizeof(addr), "0x%08x", func.first);
+        name = addr;
+      }
+    }
+    const auto min_sp = func.second.min_sp;
+    const auto depth = (min_sp <= m_stack_top) ? (m_stack_top - min_sp) : 0u;
+    printf(" %-12u %-12u %-12lu %s\n",
+           func.second.max_frame_size,
+           depth,
+           static_cast<unsigned long>(func.second.calls),
+           name.c_str());
+  }
+}
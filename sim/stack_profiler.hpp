@@ -0,0 +1,114 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_STACK_PROFILER_HPP_
+#define SIM_STACK_PROFILER_HPP_
+
+#include "call_stack.hpp"
+#include "perf_symbols.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/// @brief A stack usage profiler.
+///
+/// The profiler tracks the lowest value of the stack pointer (the stack high-water mark), both
+/// globally and per function. Functions are identified by the target address of the jl
+/// instruction that called them, and a shadow call stack (see call_stack_t) is used for attributing
+/// stack pointer updates to the currently executing function.
+class stack_profiler_t {
+public:
+  stack_profiler_t();
+
+  /// @brief Clear the statistics.
+  void reset();
+
+  /// @brief Record a write to the stack pointer.
+  void set_sp(const uint32_t sp) {
+    auto& frame = current_frame();
+    if (sp < frame.min_sp) {
+      frame.min_sp = sp;
+    }
+    if (!m_has_stack_top) {
+      // The first write to SP (usually in the startup code) sets up the stack.
+      m_stack_top = sp;
+      m_min_sp = sp;
+      frame.entry_sp = sp;
+      frame.min_sp = sp;
+      m_has_stack_top = true;
+    } else if (sp < m_min_sp) {
+      m_min_sp = sp;
+    }
+  }
+
+  /// @brief Record a j/jl instruction.
+  /// @param target The branch target address.
+  /// @param return_addr The return address (for jl).
+  /// @param is_call True for jl (subroutine call).
+  /// @param sp The current stack pointer.
+  void jump(const uint32_t target,
+            const uint32_t return_addr,
+            const bool is_call,
+            const uint32_t sp) {
+    if (m_calls.jump(target, return_addr, is_call, frame_t{target, sp, sp})) {
+      ret();
+    } else if (is_call) {
+      m_max_call_depth = std::max(m_max_call_depth, static_cast<uint32_t>(m_calls.depth()));
+    }
+  }
+
+  /// @brief Print the stack usage statistics.
+  /// @param perf_symbols Symbols for function names.
+  void print_stats(perf_symbols_t& perf_symbols) const;
+
+private:
+  struct frame_t {
+    uint32_t func;
+    uint32_t entry_sp;
+    uint32_t min_sp;
+  };
+
+  struct func_stats_t {
+    uint64_t calls;
+    uint32_t max_frame_size;  // Stack used by the function itself (bytes).
+    uint32_t min_sp;          // Lowest SP while executing the function itself.
+  };
+
+  frame_t& current_frame() {
+    return m_calls.empty() ? m_top_level : m_calls.back().data;
+  }
+
+  void ret();
+  void record_frame(const frame_t& frame);
+
+  // The program entry, and the active calls.
+  frame_t m_top_level;
+  call_stack_t<frame_t> m_calls;
+
+  std::unordered_map<uint32_t, func_stats_t> m_func_stats;
+
+  bool m_has_stack_top = false;
+  uint32_t m_stack_top = 0u;
+  uint32_t m_min_sp = 0u;
+  uint32_t m_max_call_depth = 0u;
+};
+
+#endif  // SIM_STACK_PROFILER_HPP_
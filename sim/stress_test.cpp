@@ -0,0 +1,419 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "stress_test.hpp"
+
+#include "branch_predictor.hpp"
+#include "cpu_pipelined.hpp"
+#include "cpu_simple.hpp"
+#include "hash.hpp"
+#include "packed_int.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace {
+// Number of random instructions per sequence.
+const uint32_t SEQUENCE_LENGTH = 1024u;
+
+// Program layout: The sequence is followed by an exit stub.
+const uint32_t CODE_START = 0x00000200u;
+const uint32_t STUB_SIZE = 3u;
+const uint32_t REG_LR = 30u;
+const uint64_t RAM_SIZE = 0x4000u;
+
+// Maximum number of reported mismatches.
+const uint64_t MAX_REPORTED = 5u;
+
+const uint32_t SEED = 12345u;
+
+// Number of operand pairs per call to compare_packed_int().
+const uint64_t PACKED_INT_BATCH_SIZE = 65536u;
+
+// EX operations of the register and immediate operand formats (A and C). Memory operations and
+// XCHGSR are excluded. Operations above 0x2f are only available in format A.
+const uint32_t AC_OPS[] = {0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a,
+                           0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20, 0x21, 0x22, 0x27, 0x28, 0x29,
+                           0x2a, 0x2b, 0x2c, 0x2e, 0x2f, 0x30, 0x31, 0x32, 0x33, 0x3a, 0x3b,
+                           0x3c, 0x3d, 0x3e, 0x3f, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46,
+                           0x47, 0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x50, 0x51, 0x52,
+                           0x53, 0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+                           0x6a, 0x6b};
+const uint32_t NUM_C_OPS = 27u;  // The first 27 operations are < 0x30.
+
+// Two-operand operations (format B), as (function << 8) | opcode.
+const uint32_t B_OPS[] = {
+    0x007c, 0x017c, 0x027c, 0x007d, 0x017d, 0x087d, 0x007e, 0x017e, 0x027e, 0x087e, 0x097e};
+
+// LDEA (address calculation without a memory access).
+const uint32_t OP_LDEA = 0x07u;
+
+// Register values that are likely to trigger corner cases (as bytes, half-words, words and
+// floating-point values).
+const uint32_t SPECIAL_VALUES[] = {0x00000000u, 0x00000001u, 0xffffffffu, 0x80000000u,
+                                   0x7fffffffu, 0x00008000u, 0x00007fffu, 0x80008000u,
+                                   0x7fff7fffu, 0x80808080u, 0x7f7f7f7fu, 0x01010101u,
+                                   0x3f800000u, 0xbf800000u, 0x7f800000u, 0x7fc00000u,
+                                   0x00800000u, 0x3c003c00u, 0x7c00fc00u, 0x38383838u};
+
+template <typename T, size_t N>
+uint32_t pick(std::mt19937& rnd, const T (&values)[N], const uint32_t count = N) {
+  return static_cast<uint32_t>(values[rnd() % count]);
+}
+
+uint32_t random_value(std::mt19937& rnd) {
+  switch (rnd() % 4u) {
+    case 0:
+      return pick(rnd, SPECIAL_VALUES);
+    case 1:
+      // Small (positive or negative) values.
+      return static_cast<uint32_t>(static_cast<int32_t>(rnd() % 33u) - 16);
+    default:
+      return static_cast<uint32_t>(rnd());
+  }
+}
+
+uint32_t random_instruction(std::mt19937& rnd) {
+  const uint32_t reg1 = rnd() % 32u;
+  const uint32_t reg2 = rnd() % 32u;
+  const uint32_t reg3 = rnd() % 32u;
+  const uint32_t packed_mode = rnd() % 3u;
+  switch (rnd() % 16u) {
+    default: {
+      // Format A: Three register operands (scalar, vector or folding vector), packed modes.
+      const uint32_t op = (rnd() % 32u == 0u) ? OP_LDEA : pick(rnd, AC_OPS);
+      const uint32_t vector_mode = rnd() % 4u;
+      return (reg1 << 21) | (reg2 << 16) | (vector_mode << 14) | (reg3 << 9) | (packed_mode << 7) |
+             op;
+    }
+    case 6:
+    case 7: {
+      // Format B: Two register operands, packed modes.
+      const uint32_t op = pick(rnd, B_OPS);
+      const uint32_t vector_mode = (rnd() % 2u) << 1;
+      return (reg1 << 21) | (reg2 << 16) | (vector_mode << 14) | ((op >> 8) << 9) |
+             (packed_mode << 7) | (op & 0x7fu);
+    }
+    case 8:
+    case 9:
+    case 10:
+    case 11: {
+      // Format C: Register and immediate operands.
+      const uint32_t op = (rnd() % 32u == 0u) ? OP_LDEA : pick(rnd, AC_OPS, NUM_C_OPS);
+      const uint32_t vector_mode = (rnd() % 2u) << 1;
+      return (op << 26) | (reg1 << 21) | (reg2 << 16) | (vector_mode << 14) | (rnd() & 0x7fffu);
+    }
+    case 12:
+    case 13: {
+      // Format D: ADDPC, ADDPCHI or LDI with a 21-bit immediate.
+      const uint32_t op = 0x34u + rnd() % 3u;
+      return (op << 26) | (reg1 << 21) | (rnd() & 0x1fffffu);
+    }
+    case 14: {
+      // Format E: Conditional branch, to the next instruction or the one after that.
+      const uint32_t condition = rnd() % 8u;
+      const uint32_t offset = 1u + rnd() % 2u;
+      return (0x37u << 26) | (reg1 << 21) | (condition << 18) | offset;
+    }
+  }
+}
+
+// The EXIT routine returns to LR, and the run loop fetches that instruction before it stops, so
+// LR must point to valid code. A branch can skip one instruction, hence the repeated LDI.
+void write_exit_stub(ram_t& ram, const uint32_t addr) {
+  const uint32_t ldi_lr = (0x36u << 26) | (REG_LR << 21) | (addr & 0xfffffu);
+  const uint32_t j_exit = (0x30u << 26) | ((static_cast<uint32_t>(-0x10000) >> 2) & 0x1fffffu);
+  ram.store32(addr, ldi_lr);
+  ram.store32(addr + 4u, ldi_lr);
+  ram.store32(addr + 8u, j_exit);
+}
+
+const char* format_name(const uint32_t iword) {
+  const auto op = iword >> 26;
+  if (op == 0x00u) {
+    return ((iword & 0x7cu) == 0x7cu) ? "B" : "A";
+  }
+  return (op < 0x30u) ? "C" : ((op < 0x37u) ? "D" : "E");
+}
+}  // namespace
+
+struct stress_tester_t::state_t {
+  std::array<uint32_t, 33> regs;
+  std::array<std::array<uint32_t, 16>, 32> vregs;
+  uint32_t exit_code;
+
+  bool operator==(const state_t& other) const {
+    return regs == other.regs && vregs == other.vregs && exit_code == other.exit_code;
+  }
+  bool operator!=(const state_t& other) const {
+    return !(*this == other);
+  }
+};
+
+struct stress_tester_t::engine_t {
+  std::string name;
+  std::unique_ptr<cpu_t> cpu;
+};
+
+struct stress_tester_t::results_t {
+  std::mutex mutex;
+  std::vector<std::string> engine_names;
+  std::vector<uint64_t> mismatches;  // Mismatching sequences per engine.
+  std::vector<uint64_t> sequence_hashes;
+  uint64_t num_reported = 0u;
+};
+
+bool stress_tester_t::run(const uint64_t num_instructions) {
+  static_assert(cpu_t::NUM_REGS == 33u && cpu_t::NUM_VECTOR_REGS == 32u &&
+                    cpu_t::NUM_VECTOR_ELEMENTS == 16u,
+                "state_t does not match the CPU register configuration");
+
+  const auto num_sequences = (num_instructions + SEQUENCE_LENGTH - 1u) / SEQUENCE_LENGTH;
+  const auto num_threads = std::max(1u, std::thread::hardware_concurrency());
+  std::cout << "Stress testing the execution engines with " << num_sequences * SEQUENCE_LENGTH
+            << " random instructions (" << num_threads << " threads):\n";
+
+  results_t results;
+  {
+    ram_t ram(RAM_SIZE);
+    perf_symbols_t perf_symbols;
+    for (const auto& engine : create_engines(ram, perf_symbols)) {
+      results.engine_names.push_back(engine.name);
+    }
+  }
+  results.mismatches.resize(results.engine_names.size(), 0u);
+  results.sequence_hashes.resize(num_sequences, 0u);
+
+  const auto t0 = std::chrono::high_resolution_clock::now();
+  std::vector<std::thread> threads;
+  for (uint32_t thread_no = 0u; thread_no < num_threads; ++thread_no) {
+    threads.emplace_back(run_thread, thread_no, num_threads, num_sequences, std::ref(results));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const auto dt = std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::high_resolution_clock::now() - t0)
+                      .count();
+
+  uint64_t total_mismatches = 0u;
+  for (size_t i = 1u; i < results.engine_names.size(); ++i) {
+    std::printf("  %-24s %10lu sequences, %lu mismatches\n",
+                results.engine_names[i].c_str(),
+                static_cast<unsigned long>(num_sequences),
+                static_cast<unsigned long>(results.mismatches[i]));
+    total_mismatches += results.mismatches[i];
+  }
+
+  // All run loop variants share the same ALU operations, so they are also compared against the
+  // portable reference implementations (see packed_int.hpp), with random operands.
+  {
+    const auto num_pairs = num_sequences * SEQUENCE_LENGTH;
+    std::mt19937 rnd(SEED);
+    std::vector<uint32_t> a_ops(PACKED_INT_BATCH_SIZE);
+    std::vector<uint32_t> b_ops(PACKED_INT_BATCH_SIZE);
+    uint64_t mismatches = 0u;
+    for (uint64_t i = 0u; i < num_pairs; i += PACKED_INT_BATCH_SIZE) {
+      const auto count = std::min(num_pairs - i, PACKED_INT_BATCH_SIZE);
+      a_ops.resize(count);
+      b_ops.resize(count);
+      for (uint64_t k = 0u; k < count; ++k) {
+        a_ops[k] = random_value(rnd);
+        b_ops[k] = random_value(rnd);
+      }
+      mismatches += compare_packed_int(a_ops, b_ops);
+    }
+    std::printf("  %-24s %10lu operand pairs, %lu mismatches\n",
+                "ALU ops vs. reference",
+                static_cast<unsigned long>(num_pairs),
+                static_cast<unsigned long>(mismatches));
+    total_mismatches += mismatches;
+  }
+  const auto checksum = hash64(&results.sequence_hashes[0], num_sequences * sizeof(uint64_t));
+  const auto seconds = std::max(static_cast<double>(dt) * 0.000001, 0.000001);
+  std::printf("  Reference checksum:      0x%016lx\n", static_cast<unsigned long>(checksum));
+  std::printf("  Speed:                   %.1f M instructions/s (all engines)\n",
+              static_cast<double>(num_sequences * SEQUENCE_LENGTH * results.engine_names.size()) /
+                  seconds * 0.000001);
+  std::cout << (total_mismatches == 0u ? "All results are identical.\n" : "Found mismatches!\n");
+  return total_mismatches == 0u;
+}
+
+std::vector<stress_tester_t::engine_t> stress_tester_t::create_engines(
+    ram_t& ram,
+    perf_symbols_t& perf_symbols) {
+  // All the variants of the run loop. The first one (a plain functional core) is the reference.
+  std::vector<engine_t> engines(6);
+  engines[0].name = "functional";
+  engines[0].cpu.reset(new cpu_simple_t(ram, perf_symbols, 0u, false));
+
+  engines[1].name = "functional, instrumented";
+  engines[1].cpu.reset(new cpu_simple_t(ram, perf_symbols, 0u, false));
+  engines[1].cpu->m_branch_predictor.reset(new branch_predictor_t(branch_predictor_t::params_t()));
+
+  engines[2].name = "latency";
+  engines[2].cpu.reset(new cpu_simple_t(ram, perf_symbols, 0u, false));
+  engines[2].cpu->m_timing_enabled = true;
+
+  engines[3].name = "latency, instrumented";
+  engines[3].cpu.reset(new cpu_simple_t(ram, perf_symbols, 0u, false));
+  engines[3].cpu->m_timing_enabled = true;
+  engines[3].cpu->m_branch_predictor.reset(new branch_predictor_t(branch_predictor_t::params_t()));
+
+  engines[4].name = "pipeline";
+  engines[4].cpu.reset(new cpu_pipelined_t(ram, perf_symbols, 0u, false));
+
+  engines[5].name = "pipeline, instrumented";
+  engines[5].cpu.reset(new cpu_pipelined_t(ram, perf_symbols, 0u, false));
+  engines[5].cpu->m_branch_predictor.reset(new branch_predictor_t(branch_predictor_t::params_t()));
+  return engines;
+}
+
+void stress_tester_t::run_thread(const uint32_t thread_no,
+                                 const uint32_t num_threads,
+                                 const uint64_t num_sequences,
+                                 results_t& results) {
+  ram_t ram(RAM_SIZE);
+  perf_symbols_t perf_symbols;
+  auto engines = create_engines(ram, perf_symbols);
+  std::vector<uint64_t> mismatches(engines.size(), 0u);
+
+  std::vector<uint32_t> code(SEQUENCE_LENGTH);
+  state_t initial_state;
+  state_t ref_result;
+  state_t result;
+  for (auto seq_no = static_cast<uint64_t>(thread_no); seq_no < num_sequences;
+       seq_no += num_threads) {
+    // Generate a random initial state and a random instruction sequence.
+    std::mt19937 rnd(SEED + static_cast<uint32_t>(seq_no));
+    for (auto& reg : initial_state.regs) {
+      reg = random_value(rnd);
+    }
+    initial_state.regs[cpu_t::REG_Z] = 0u;
+    initial_state.regs[cpu_t::REG_VL] = rnd() % (cpu_t::NUM_VECTOR_ELEMENTS + 1u);
+    for (auto& vreg : initial_state.vregs) {
+      for (auto& element : vreg) {
+        element = random_value(rnd);
+      }
+    }
+    initial_state.exit_code = 0u;
+    for (uint32_t i = 0u; i < SEQUENCE_LENGTH; ++i) {
+      code[i] = random_instruction(rnd);
+      ram.store32(CODE_START + 4u * i, code[i]);
+    }
+    write_exit_stub(ram, CODE_START + 4u * SEQUENCE_LENGTH);
+
+    // Run the sequence through all the engines.
+    execute(*engines[0].cpu, initial_state, ref_result);
+    results.sequence_hashes[seq_no] = hash64(&ref_result, sizeof(ref_result));
+    for (size_t e = 1u; e < engines.size(); ++e) {
+      execute(*engines[e].cpu, initial_state, result);
+      if (result == ref_result) {
+        continue;
+      }
+      ++mismatches[e];
+
+      // Find the first differing instruction by running increasingly long parts of the sequence.
+      {
+        std::lock_guard<std::mutex> lock(results.mutex);
+        if (results.num_reported >= MAX_REPORTED) {
+          continue;
+        }
+        ++results.num_reported;
+      }
+      state_t before = initial_state;
+      for (uint32_t n = 1u; n <= SEQUENCE_LENGTH; ++n) {
+        write_exit_stub(ram, CODE_START + 4u * n);
+        execute(*engines[0].cpu, initial_state, ref_result);
+        execute(*engines[e].cpu, initial_state, result);
+        for (uint32_t i = n; i < std::min(n + STUB_SIZE, SEQUENCE_LENGTH); ++i) {
+          ram.store32(CODE_START + 4u * i, code[i]);
+        }
+        if (result != ref_result) {
+          std::string report;
+          char line[128];
+          std::snprintf(line,
+                        sizeof(line),
+                        "  %s: instruction 0x%08x (format %s) in sequence %lu:\n",
+                        engines[e].name.c_str(),
+                        code[n - 1u],
+                        format_name(code[n - 1u]),
+                        static_cast<unsigned long>(seq_no));
+          report += line;
+          for (uint32_t r = 0u; r < cpu_t::NUM_REGS; ++r) {
+            if (result.regs[r] != ref_result.regs[r]) {
+              std::snprintf(line,
+                            sizeof(line),
+                            "    R%u = 0x%08x (expected 0x%08x, was 0x%08x)\n",
+                            r,
+                            result.regs[r],
+                            ref_result.regs[r],
+                            before.regs[r]);
+              report += line;
+            }
+          }
+          for (uint32_t r = 0u; r < cpu_t::NUM_VECTOR_REGS; ++r) {
+            for (uint32_t k = 0u; k < cpu_t::NUM_VECTOR_ELEMENTS; ++k) {
+              if (result.vregs[r][k] != ref_result.vregs[r][k]) {
+                std::snprintf(line,
+                              sizeof(line),
+                              "    V%u[%u] = 0x%08x (expected 0x%08x, was 0x%08x)\n",
+                              r,
+                              k,
+                              result.vregs[r][k],
+                              ref_result.vregs[r][k],
+                              before.vregs[r][k]);
+                report += line;
+              }
+            }
+          }
+          std::lock_guard<std::mutex> lock(results.mutex);
+          std::cout << report;
+          break;
+        }
+        before = ref_result;
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(results.mutex);
+  for (size_t e = 0u; e < engines.size(); ++e) {
+    results.mismatches[e] += mismatches[e];
+  }
+}
+
+void stress_tester_t::execute(cpu_t& cpu, const state_t& initial_state, state_t& result) {
+  cpu.m_regs = initial_state.regs;
+  for (uint32_t i = 0u; i < cpu_t::NUM_VECTOR_REGS; ++i) {
+    std::copy(initial_state.vregs[i].begin(), initial_state.vregs[i].end(), cpu.m_vregs[i].begin());
+  }
+  result.exit_code = cpu.run(CODE_START, -1);
+  result.regs = cpu.m_regs;
+  for (uint32_t i = 0u; i < cpu_t::NUM_VECTOR_REGS; ++i) {
+    std::copy(cpu.m_vregs[i].begin(), cpu.m_vregs[i].end(), result.vregs[i].begin());
+  }
+}
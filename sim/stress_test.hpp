@@ -0,0 +1,63 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_STRESS_TEST_HPP_
+#define SIM_STRESS_TEST_HPP_
+
+#include "cpu.hpp"
+#include "perf_symbols.hpp"
+#include "ram.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/// @brief Randomized instruction stream stress test of the execution engines.
+///
+/// Random valid instruction words (from all encoding classes A to E, in scalar, vector and packed
+/// modes, but without memory accesses and jumps) are executed on random register states through
+/// every variant of the run loop (functional, latency timing and pipeline timing, with and without
+/// instrumentation). The resulting architectural states are compared against a plain functional
+/// core, and the first differing instruction of each mismatching instruction sequence is reported.
+/// Since all the run loop variants share the same ALU operations, the packed integer operations
+/// are also compared against their portable reference implementations, with random operands.
+///
+/// The work is spread over all host CPU cores. The sequences are generated from fixed seeds, so a
+/// checksum of the reference results is also printed, which should be identical for all builds
+/// of the simulator (e.g. with and without the x86 SIMD implementations of the packed operations).
+class stress_tester_t {
+public:
+  /// @brief Run the stress test.
+  /// @param num_instructions The number of random instructions to execute per engine.
+  /// @returns true if no mismatches were found.
+  static bool run(const uint64_t num_instructions);
+
+private:
+  struct state_t;
+  struct engine_t;
+  struct results_t;
+
+  static std::vector<engine_t> create_engines(ram_t& ram, perf_symbols_t& perf_symbols);
+  static void run_thread(const uint32_t thread_no,
+                         const uint32_t num_threads,
+                         const uint64_t num_sequences,
+                         results_t& results);
+  static void execute(cpu_t& cpu, const state_t& initial_state, state_t& result);
+};
+
+#endif  // SIM_STRESS_TEST_HPP_
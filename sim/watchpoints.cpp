@@ -0,0 +1,182 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#include "watchpoints.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+
+namespace {
+uint32_t parse_number(const std::string& spec, const std::string& value) {
+  std::size_t pos = 0;
+  unsigned long long result = 0u;
+  try {
+    result = std::stoull(value, &pos, 0);
+  } catch (...) {
+    pos = 0;
+  }
+  if (pos == 0 || pos != value.size() || result > 0xffffffffull) {
+    throw std::runtime_error("Invalid watchpoint: " + spec);
+  }
+  return static_cast<uint32_t>(result);
+}
+
+std::string hex32(const uint32_t x, const uint32_t size = 4u) {
+  char str[16];
+  std::snprintf(str, sizeof(str), "0x%0*x", static_cast<int>(2u * size), x);
+  return std::string(str);
+}
+}  // namespace
+
+watchpoints_t::watchpoint_t watchpoints_t::parse_spec(const std::string& spec) {
+  watchpoint_t watchpoint{0u, 4u, false, true, false, 0u};
+  const auto pos1 = spec.find(':');
+  watchpoint.addr = parse_number(spec, spec.substr(0, pos1));
+  if (pos1 != std::string::npos) {
+    auto field = spec.substr(pos1 + 1);
+    const auto pos2 = field.find(':');
+    std::string mode;
+    if (pos2 != std::string::npos) {
+      watchpoint.size = parse_number(spec, field.substr(0, pos2));
+      mode = field.substr(pos2 + 1);
+    } else if (!field.empty() && field[0] >= '0' && field[0] <= '9') {
+      watchpoint.size = parse_number(spec, field);
+    } else {
+      mode = field;
+    }
+    if (pos2 != std::string::npos || !mode.empty()) {
+      watchpoint.write = false;
+      for (const auto c : mode) {
+        if (c == 'r') {
+          watchpoint.read = true;
+        } else if (c == 'w') {
+          watchpoint.write = true;
+        } else if (c == 's') {
+          watchpoint.stop = true;
+        } else {
+          throw std::runtime_error("Invalid watchpoint mode: " + spec);
+        }
+      }
+      if (!watchpoint.read && !watchpoint.write) {
+        watchpoint.write = true;
+      }
+    }
+  }
+  if (watchpoint.size == 0u ||
+      static_cast<uint64_t>(watchpoint.addr) + watchpoint.size > 0x100000000ull) {
+    throw std::runtime_error("Invalid watchpoint range: " + spec);
+  }
+  return watchpoint;
+}
+
+watchpoints_t::watchpoints_t(const std::vector<watchpoint_t>& watchpoints,
+                             ram_t& ram,
+                             perf_symbols_t& perf_symbols)
+    : m_watchpoints(watchpoints),
+      m_pages(1u << (32u - LOG2_PAGE_SIZE), 0u),
+      m_ram(ram),
+      m_perf_symbols(perf_symbols) {
+  for (const auto& watchpoint : m_watchpoints) {
+    const auto first_page = watchpoint.addr >> LOG2_PAGE_SIZE;
+    const auto last_page = (watchpoint.addr + (watchpoint.size - 1u)) >> LOG2_PAGE_SIZE;
+    for (auto page = first_page; page <= last_page; ++page) {
+      m_pages[page] = 1u;
+    }
+  }
+  reset();
+}
+
+void watchpoints_t::reset() {
+  m_calls.clear();
+  for (auto& watchpoint : m_watchpoints) {
+    watchpoint.hits = 0u;
+  }
+}
+
+std::string watchpoints_t::addr_name(const uint32_t addr) {
+  const auto name = m_perf_symbols.symbol_name(addr);
+  return name.empty() ? hex32(addr) : (hex32(addr) + " " + name);
+}
+
+void watchpoints_t::access(const uint32_t pc,
+                           const uint32_t addr,
+                           const uint32_t size,
+                           const bool is_store,
+                           const uint32_t value,
+                           const uint64_t cycle) {
+  // Count the hit on every matching watchpoint (the ranges may overlap).
+  const watchpoint_t* first_hit = nullptr;
+  const watchpoint_t* stop_hit = nullptr;
+  for (auto& watchpoint : m_watchpoints) {
+    const auto watch_end = static_cast<uint64_t>(watchpoint.addr) + watchpoint.size;
+    const bool overlaps =
+        (addr < watch_end) && (static_cast<uint64_t>(addr) + size > watchpoint.addr);
+    if (!overlaps || !(is_store ? watchpoint.write : watchpoint.read)) {
+      continue;
+    }
+    ++watchpoint.hits;
+    if (first_hit == nullptr) {
+      first_hit = &watchpoint;
+    }
+    if (watchpoint.stop && stop_hit == nullptr) {
+      stop_hit = &watchpoint;
+    }
+  }
+
+  // Invalid accesses are reported by the RAM when they are performed.
+  if (first_hit == nullptr || !m_ram.valid_range(addr, size)) {
+    return;
+  }
+  const auto old_value = (size == 1u) ? m_ram.load8(addr)
+                                      : ((size == 2u) ? m_ram.load16(addr) : m_ram.load32(addr));
+  const auto mask = (size == 4u) ? 0xffffffffu : ((1u << (8u * size)) - 1u);
+
+  // Log the access once, even if several watchpoints matched.
+  std::printf("Watchpoint %s: %s %s at cycle %lu by %s",
+              hex32(first_hit->addr).c_str(),
+              is_store ? "store to" : "load from",
+              hex32(addr).c_str(),
+              static_cast<unsigned long>(cycle),
+              addr_name(pc).c_str());
+  if (is_store) {
+    std::printf(": %s -> %s\n",
+                hex32(old_value, size).c_str(),
+                hex32(value & mask, size).c_str());
+  } else {
+    std::printf(": %s\n", hex32(old_value, size).c_str());
+  }
+  const auto& frames = m_calls.frames();
+  for (auto it = frames.rbegin(); it != frames.rend(); ++it) {
+    std::printf("  called from %s\n", addr_name(it->data).c_str());
+  }
+
+  if (stop_hit != nullptr) {
+    throw std::runtime_error("Stopped at watchpoint " + hex32(stop_hit->addr));
+  }
+}
+
+void watchpoints_t::print_stats() const {
+  std::printf("Watchpoints:\n");
+  for (const auto& watchpoint : m_watchpoints) {
+    std::printf(" %s (%u bytes): %lu hits\n",
+                hex32(watchpoint.addr).c_str(),
+                watchpoint.size,
+                static_cast<unsigned long>(watchpoint.hits));
+  }
+}
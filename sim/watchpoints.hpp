@@ -0,0 +1,115 @@
+//--------------------------------------------------------------------------------------------------
+// Copyright (c) 2018 Marcus Geelnard
+//
+// This software is provided 'as-is', without any express or implied warranty. In no event will the
+// authors be held liable for any damages arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose, including commercial
+// applications, and to alter it and redistribute it freely, subject to the following restrictions:
+//
+//  1. The origin of this software must not be misrepresented; you must not claim that you wrote
+//     the original software. If you use this software in a product, an acknowledgment in the
+//     product documentation would be appreciated but is not required.
+//
+//  2. Altered source versions must be plainly marked as such, and must not be misrepresented as
+//     being the original software.
+//
+//  3. This notice may not be removed or altered from any source distribution.
+//--------------------------------------------------------------------------------------------------
+
+#ifndef SIM_WATCHPOINTS_HPP_
+#define SIM_WATCHPOINTS_HPP_
+
+#include "call_stack.hpp"
+#include "perf_symbols.hpp"
+#include "ram.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// @brief Guest memory watchpoints.
+///
+/// Each watchpoint covers an address range, and every matching guest load and/or store is logged
+/// with the PC, cycle, old and new value and the call stack (from a shadow call stack of jl calls).
+/// A watchpoint can optionally stop the simulation, which gives the usual register dump.
+///
+/// The watched pages are marked in a per-page flag table, so that accesses to other pages only
+/// cost a table lookup. The hooks are only present in the instrumented run loop, so there is no
+/// cost when no watchpoints are set.
+class watchpoints_t {
+public:
+  /// @brief Watchpoint configuration.
+  struct watchpoint_t {
+    uint32_t addr;      ///< First watched address.
+    uint32_t size;      ///< Number of watched bytes.
+    bool read;          ///< Log loads.
+    bool write;         ///< Log stores.
+    bool stop;          ///< Stop the simulation on a hit.
+    uint64_t hits;      ///< Number of hits.
+  };
+
+  /// @brief Parse a watchpoint specification string.
+  ///
+  /// The specification is ADDR[:LEN][:MODE], where LEN is the number of bytes (default 4) and MODE
+  /// is a combination of the letters r (loads), w (stores) and s (stop the simulation). The
+  /// default mode is w.
+  /// @throws std::runtime_error if the specification is invalid.
+  static watchpoint_t parse_spec(const std::string& spec);
+
+  /// @brief Constructor.
+  watchpoints_t(const std::vector<watchpoint_t>& watchpoints,
+                ram_t& ram,
+                perf_symbols_t& perf_symbols);
+
+  /// @brief Clear the call stack and the hit counts.
+  void reset();
+
+  /// @brief Check if an address is in a page that contains a watched address.
+  bool is_watched_page(const uint32_t addr) const {
+    return m_pages[addr >> LOG2_PAGE_SIZE] != 0u;
+  }
+
+  /// @brief Record a data memory access (before it is performed).
+  /// @param pc The address of the memory instruction.
+  /// @param addr The data address.
+  /// @param size The access size (in bytes).
+  /// @param is_store True for stores.
+  /// @param value The value to be stored (for stores).
+  /// @param cycle The current cycle.
+  /// @throws std::runtime_error if a stopping watchpoint was hit.
+  void access(const uint32_t pc,
+              const uint32_t addr,
+              const uint32_t size,
+              const bool is_store,
+              const uint32_t value,
+              const uint64_t cycle);
+
+  /// @brief Record a j/jl instruction (for the call stack).
+  /// @param target The branch target address.
+  /// @param pc The address of the branch instruction.
+  /// @param is_call True for jl (subroutine call).
+  void jump(const uint32_t target, const uint32_t pc, const bool is_call) {
+    if (m_calls.jump(target, pc + 4u, is_call, pc)) {
+      m_calls.pop();
+    }
+  }
+
+  /// @brief Print the number of hits per watchpoint.
+  void print_stats() const;
+
+private:
+  static const uint32_t LOG2_PAGE_SIZE = 12u;
+
+  std::string addr_name(const uint32_t addr);
+
+  std::vector<watchpoint_t> m_watchpoints;
+  std::vector<uint8_t> m_pages;
+  ram_t& m_ram;
+  perf_symbols_t& m_perf_symbols;
+
+  // Shadow call stack (the frame data is the address of the jl instruction).
+  call_stack_t<uint32_t> m_calls;
+};
+
+#endif  // SIM_WATCHPOINTS_HPP_